@@ -23,3 +23,4 @@ isEmpty(QCHAT_STYLES_QRC_INCLUDED) {
 
 include($$PWD/../common/theme_manager.pri)
 include($$PWD/../common/qss_utils.pri)
+include($$PWD/../common/avatar_cache.pri)
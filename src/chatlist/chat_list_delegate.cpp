@@ -1,10 +1,27 @@
 #include "chat_list_delegate.h"
+#include "avatar_cache.h"
 #include <QPainter>
 #include <QPainterPath>
 #include <QPen>
 #include <QFontMetrics>
 #include <QPixmap>
 
+namespace {
+// 与裁剪路径保持一致：方形头像沿用 6px 圆角
+AvatarCache::Shape avatarCacheShape(ChatListDelegate::AvatarShape shape)
+{
+    return shape == ChatListDelegate::AvatarCircle ? AvatarCache::Circle : AvatarCache::RoundedRect;
+}
+
+int avatarCacheRadius(const ChatListDelegate::Style& style)
+{
+    if (style.avatarShape == ChatListDelegate::AvatarSquare) {
+        return 6;
+    }
+    return style.avatarShape == ChatListDelegate::AvatarRoundedRect ? qMax(0, style.avatarCornerRadius) : 0;
+}
+} // namespace
+
 ChatListDelegate::ChatListDelegate(QObject *parent) : QStyledItemDelegate(parent) {}
 
 void ChatListDelegate::setStyle(const Style &style)
@@ -88,16 +105,12 @@ void ChatListDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opti
 
     bool drewAvatarImage = false;
     if (!avatarPath.isEmpty()) {
-        QPixmap avatarPixmap(avatarPath);
+        // 缓存中是已裁剪好的成品，悬停/选中重绘只需贴图
+        const QPixmap avatarPixmap = AvatarCache::instance()->avatar(
+            avatarPath, avatarSize, avatarCacheShape(m_style.avatarShape), avatarCacheRadius(m_style),
+            painter->device()->devicePixelRatioF());
         if (!avatarPixmap.isNull()) {
-            painter->save();
-            painter->setClipPath(avatarClipPath);
-            painter->drawPixmap(
-                avatarRect,
-                avatarPixmap.scaled(avatarRect.size(),
-                                    Qt::KeepAspectRatioByExpanding,
-                                    Qt::SmoothTransformation));
-            painter->restore();
+            painter->drawPixmap(avatarRect.topLeft(), avatarPixmap);
             drewAvatarImage = true;
         }
     }
@@ -0,0 +1,271 @@
+#include "chat_file_history_source.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+QJsonObject toJson(const ChatWidgetMessage& message)
+{
+    QJsonObject object;
+    object.insert("id", message.messageId);
+    object.insert("senderId", message.senderId);
+    object.insert("sender", message.sender);
+    object.insert("content", message.content);
+    if (!message.avatarPath.isEmpty()) {
+        object.insert("avatar", message.avatarPath);
+    }
+    if (message.timestamp.isValid()) {
+        object.insert("ts", QString::number(message.timestamp.toMSecsSinceEpoch()));
+    }
+    object.insert("mine", message.isMine);
+    object.insert("type", static_cast<int>(message.messageType));
+    object.insert("status", static_cast<int>(message.status));
+    // 少用字段只在非空时写出
+    if (!message.imagePath.isEmpty()) {
+        object.insert("imagePath", message.imagePath);
+    }
+    if (!message.filePath.isEmpty()) {
+        object.insert("filePath", message.filePath);
+    }
+    if (!message.fileName.isEmpty()) {
+        object.insert("fileName", message.fileName);
+    }
+    if (message.fileSize != 0) {
+        object.insert("fileSize", QString::number(message.fileSize));
+    }
+    if (!message.replyToMessageId.isEmpty()) {
+        object.insert("replyTo", message.replyToMessageId);
+    }
+    if (!message.replySender.isEmpty()) {
+        object.insert("replySender", message.replySender);
+    }
+    if (!message.replyPreview.isEmpty()) {
+        object.insert("replyPreview", message.replyPreview);
+    }
+    if (message.isForwarded) {
+        object.insert("forwarded", true);
+    }
+    if (!message.forwardedFrom.isEmpty()) {
+        object.insert("forwardedFrom", message.forwardedFrom);
+    }
+    if (!message.reactions.isEmpty()) {
+        QJsonArray reactions;
+        for (const ChatWidgetReaction& reaction : message.reactions) {
+            QJsonObject item;
+            item.insert("emoji", reaction.emoji);
+            item.insert("count", reaction.count);
+            reactions.append(item);
+        }
+        object.insert("reactions", reactions);
+    }
+    if (!message.mentions.isEmpty()) {
+        object.insert("mentions", QJsonArray::fromStringList(message.mentions));
+    }
+    return object;
+}
+
+ChatWidgetMessage fromJson(const QJsonObject& object)
+{
+    ChatWidgetMessage message;
+    message.messageId = object.value("id").toString();
+    message.senderId = object.value("senderId").toString();
+    message.sender = object.value("sender").toString();
+    message.content = object.value("content").toString();
+    message.avatarPath = object.value("avatar").toString();
+    if (object.contains("ts")) {
+        message.timestamp = QDateTime::fromMSecsSinceEpoch(object.value("ts").toString().toLongLong());
+    }
+    message.isMine = object.value("mine").toBool();
+    message.messageType = static_cast<ChatWidgetMessage::MessageType>(object.value("type").toInt());
+    message.status = static_cast<ChatWidgetMessage::MessageStatus>(
+        object.value("status").toInt(static_cast<int>(ChatWidgetMessage::MessageStatus::Sent)));
+    message.imagePath = object.value("imagePath").toString();
+    message.filePath = object.value("filePath").toString();
+    message.fileName = object.value("fileName").toString();
+    message.fileSize = object.value("fileSize").toString().toLongLong();
+    message.replyToMessageId = object.value("replyTo").toString();
+    message.replySender = object.value("replySender").toString();
+    message.replyPreview = object.value("replyPreview").toString();
+    message.isForwarded = object.value("forwarded").toBool();
+    message.forwardedFrom = object.value("forwardedFrom").toString();
+    const QJsonArray reactions = object.value("reactions").toArray();
+    for (const QJsonValue& value : reactions) {
+        const QJsonObject item = value.toObject();
+        message.reactions.append(ChatWidgetReaction(item.value("emoji").toString(), item.value("count").toInt()));
+    }
+    const QJsonArray mentions = object.value("mentions").toArray();
+    for (const QJsonValue& value : mentions) {
+        message.mentions.append(value.toString());
+    }
+    return message;
+}
+
+// 从 i 处的引号开始跳过一个字符串，返回结束引号之后的位置；escaped 记录其中是否有转义
+int skipString(const QByteArray& line, int i, bool* escaped)
+{
+    for (++i; i < line.size(); ++i) {
+        if (line.at(i) == '\\') {
+            *escaped = true;
+            ++i;
+        } else if (line.at(i) == '"') {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+int skipSpaces(const QByteArray& line, int i)
+{
+    while (i < line.size() && (line.at(i) == ' ' || line.at(i) == '\t')) {
+        ++i;
+    }
+    return i;
+}
+
+// 打开时只需要 messageId：逐字节扫描顶层对象的 "id" 键，不构建 JSON 对象。
+// 值含转义、不是字符串或行格式不完整时返回 false，由调用方完整解析
+bool scanMessageId(const QByteArray& line, QString* messageId)
+{
+    int depth = 0;
+    for (int i = 0; i < line.size();) {
+        const char ch = line.at(i);
+        if (ch == '{' || ch == '[') {
+            ++depth;
+            ++i;
+        } else if (ch == '}' || ch == ']') {
+            --depth;
+            ++i;
+        } else if (ch == '"') {
+            bool escaped = false;
+            const int end = skipString(line, i, &escaped);
+            if (end < 0) {
+                return false;
+            }
+            const bool idKey = depth == 1 && end - i == 4 && line.at(i + 1) == 'i' && line.at(i + 2) == 'd';
+            i = skipSpaces(line, end);
+            if (idKey && i < line.size() && line.at(i) == ':') {
+                const int valueStart = skipSpaces(line, i + 1);
+                if (valueStart >= line.size() || line.at(valueStart) != '"') {
+                    return false;
+                }
+                const int valueEnd = skipString(line, valueStart, &escaped);
+                if (valueEnd < 0 || escaped) {
+                    return false;
+                }
+                *messageId = QString::fromUtf8(line.constData() + valueStart + 1, valueEnd - valueStart - 2);
+                return true;
+            }
+        } else {
+            ++i;
+        }
+    }
+    // 没有 "id" 键的完整对象
+    messageId->clear();
+    return depth == 0;
+}
+} // namespace
+
+ChatFileHistorySource::ChatFileHistorySource(const QString& filePath)
+    : m_file(filePath)
+{
+}
+
+bool ChatFileHistorySource::open()
+{
+    m_lineOffsets.clear();
+    m_lineById.clear();
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    while (!m_file.atEnd()) {
+        const qint64 offset = m_file.pos();
+        const QByteArray line = m_file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QString messageId;
+        if (!scanMessageId(line, &messageId)) {
+            messageId = QJsonDocument::fromJson(line).object().value("id").toString();
+        }
+        if (!messageId.isEmpty()) {
+            m_lineById.insert(messageId, m_lineOffsets.size());
+        }
+        m_lineOffsets.append(offset);
+    }
+    return true;
+}
+
+bool ChatFileHistorySource::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+int ChatFileHistorySource::messageCount() const
+{
+    return m_lineOffsets.size();
+}
+
+QList<ChatWidgetMessage> ChatFileHistorySource::fetchLatest(int count)
+{
+    const int total = m_lineOffsets.size();
+    return readLines(qMax(0, total - count), total);
+}
+
+QList<ChatWidgetMessage> ChatFileHistorySource::fetchBefore(const QString& messageId, int count)
+{
+    auto it = m_lineById.constFind(messageId);
+    if (it == m_lineById.constEnd()) {
+        return {};
+    }
+    return readLines(qMax(0, it.value() - count), it.value());
+}
+
+QList<ChatWidgetMessage> ChatFileHistorySource::fetchAfter(const QString& messageId, int count)
+{
+    auto it = m_lineById.constFind(messageId);
+    if (it == m_lineById.constEnd()) {
+        return {};
+    }
+    const int first = it.value() + 1;
+    return readLines(first, qMin(m_lineOffsets.size(), first + count));
+}
+
+bool ChatFileHistorySource::writeMessages(const QString& filePath, const QList<ChatWidgetMessage>& messages,
+                                          bool append)
+{
+    QFile file(filePath);
+    const QIODevice::OpenMode mode = QIODevice::WriteOnly | (append ? QIODevice::Append : QIODevice::Truncate);
+    if (!file.open(mode)) {
+        return false;
+    }
+    for (const ChatWidgetMessage& message : messages) {
+        file.write(QJsonDocument(toJson(message)).toJson(QJsonDocument::Compact));
+        file.write("\n");
+    }
+    return true;
+}
+
+QList<ChatWidgetMessage> ChatFileHistorySource::readLines(int first, int last)
+{
+    QList<ChatWidgetMessage> messages;
+    if (!m_file.isOpen() || first >= last) {
+        return messages;
+    }
+    messages.reserve(last - first);
+    if (!m_file.seek(m_lineOffsets.at(first))) {
+        return messages;
+    }
+    // 行在文件中连续存放，定位一次后顺序读取
+    while (messages.size() < last - first && !m_file.atEnd()) {
+        const QByteArray line = m_file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        messages.append(fromJson(QJsonDocument::fromJson(line).object()));
+    }
+    return messages;
+}
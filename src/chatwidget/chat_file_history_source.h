@@ -0,0 +1,37 @@
+#ifndef CHAT_FILE_HISTORY_SOURCE_H
+#define CHAT_FILE_HISTORY_SOURCE_H
+
+#include "chat_history_source.h"
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// 基于 JSON Lines 文件的历史来源：每行一条消息，按时间升序排列。
+// 打开时只建立行偏移与 messageId 索引（逐字节扫描 "id" 键，不解析整行 JSON），消息内容在分页时按需读取。
+class ChatFileHistorySource : public ChatHistorySource {
+public:
+    explicit ChatFileHistorySource(const QString& filePath);
+
+    bool open();
+    bool isOpen() const;
+    int messageCount() const;
+
+    QList<ChatWidgetMessage> fetchLatest(int count) override;
+    QList<ChatWidgetMessage> fetchBefore(const QString& messageId, int count) override;
+    QList<ChatWidgetMessage> fetchAfter(const QString& messageId, int count) override;
+
+    // 将消息写为 JSON Lines（append 为 true 时追加到文件末尾）
+    static bool writeMessages(const QString& filePath, const QList<ChatWidgetMessage>& messages, bool append = false);
+
+private:
+    QList<ChatWidgetMessage> readLines(int first, int last);
+
+    QFile m_file;
+    QVector<qint64> m_lineOffsets;
+    QHash<QString, int> m_lineById;
+};
+
+#endif // CHAT_FILE_HISTORY_SOURCE_H
@@ -0,0 +1,23 @@
+#ifndef CHAT_HISTORY_SOURCE_H
+#define CHAT_HISTORY_SOURCE_H
+
+#include "chat_widget_message.h"
+#include <QList>
+#include <QString>
+
+// 分页历史消息来源。ChatWidgetHistoryWindow 只在滚动接近窗口边缘时按页拉取，
+// 实现方可以是本地数据库、文件或网络接口。
+// 所有接口返回的消息均按时间升序排列；没有更多数据时返回空列表。
+class ChatHistorySource {
+public:
+    virtual ~ChatHistorySource() = default;
+
+    // 最新的 count 条消息
+    virtual QList<ChatWidgetMessage> fetchLatest(int count) = 0;
+    // 紧邻 messageId 之前（更早）的 count 条消息
+    virtual QList<ChatWidgetMessage> fetchBefore(const QString& messageId, int count) = 0;
+    // 紧邻 messageId 之后（更新）的 count 条消息
+    virtual QList<ChatWidgetMessage> fetchAfter(const QString& messageId, int count) = 0;
+};
+
+#endif // CHAT_HISTORY_SOURCE_H
@@ -1,17 +1,22 @@
 #include "chat_widget.h"
+#include "chat_widget_history_window.h"
 #include "chat_widget_input.h"
 #include "chat_widget_model.h"
+#include "chat_widget_stream_buffer.h"
 #include "chat_widget_view.h"
 #include "qss_utils.h"
 #include <QTimer>
 #include <QSizePolicy>
 #include <QVBoxLayout>
 #include <algorithm>
+#include <utility>
 
 ChatWidget::ChatWidget(QWidget* parent) : QWidget(parent)
 {
     m_streamingTimer = new QTimer(this);
     connect(m_streamingTimer, &QTimer::timeout, this, &ChatWidget::onStreamingTimeout);
+    m_streamBuffer = new ChatWidgetStreamBuffer(this);
+    connect(m_streamBuffer, &ChatWidgetStreamBuffer::flushed, this, &ChatWidget::onStreamBufferFlushed);
     setupUi();
 }
 
@@ -45,6 +50,9 @@ void ChatWidget::setupUi()
     connect(m_viewWidget, &ChatWidgetView::messageSelected, this, &ChatWidget::messageSelected);
     connect(m_viewWidget, &ChatWidgetView::messageContextMenuRequested, this, &ChatWidget::messageContextMenuRequested);
     connect(m_viewWidget, &ChatWidgetView::messageActionRequested, this, &ChatWidget::messageActionRequested);
+    // 搜索命中按行 key 记录：key 局部重新分配时换用新 key，模型重置后按原查询重新检索
+    connect(m_viewWidget, &ChatWidgetView::messageKeysChanged, this, &ChatWidget::remapSearchMatchKeys);
+    connect(m_viewWidget, &ChatWidgetView::messageKeysReset, this, &ChatWidget::collectSearchMatches);
     connect(m_inputWidget, &ChatWidgetInputBase::messageSent, this, &ChatWidget::onInputMessageSent);
     connect(m_inputWidget, &ChatWidgetInputBase::stopRequested, this, [this]() {
     setSendingState(false);
@@ -53,6 +61,8 @@ void ChatWidget::setupUi()
 
 void ChatWidget::addMessage(const MessageParams& params)
 {
+    // 已缓冲的片段属于当前最后一行，新消息加入前先提交
+    m_streamBuffer->flush();
     if (params.senderId.trimmed().isEmpty()) {
         const QString fallbackName = params.displayName.isEmpty() ? QStringLiteral("User") : params.displayName;
         ChatWidgetMessage msg;
@@ -82,7 +92,12 @@ void ChatWidget::addMessage(const MessageParams& params)
     }
     m_participants.insert(params.senderId, info);
 
-    const QString finalName = info.displayName.isEmpty() ? params.senderId : info.displayName;
+    // 追加的消息以非空资料覆盖模型中的参与者记录：没有显示名时只为新参与者回退到 senderId，
+    // 不以 id 覆盖已有的显示名
+    QString finalName = info.displayName;
+    if (finalName.isEmpty() && (!model() || model()->messageStore().participantId(params.senderId) < 0)) {
+        finalName = params.senderId;
+    }
     bool isMine = params.isMine;
     if (!m_currentUserId.isEmpty()) {
         isMine = params.senderId == m_currentUserId;
@@ -109,6 +124,22 @@ void ChatWidget::streamOutput(const QString& content)
     if (!m_isSending) {
         return;
     }
+    m_streamBuffer->append(content);
+}
+
+void ChatWidget::flushStreamOutput()
+{
+    m_streamBuffer->flush();
+    finishStreamRow();
+}
+
+ChatWidgetStreamBuffer* ChatWidget::streamBuffer() const
+{
+    return m_streamBuffer;
+}
+
+void ChatWidget::onStreamBufferFlushed(const QString& content)
+{
     if (auto* dataModel = model()) {
         int targetRow = m_streamTargetRow;
         if (targetRow < 0 || targetRow >= dataModel->messageCount()) {
@@ -123,14 +154,32 @@ void ChatWidget::streamOutput(const QString& content)
 
 void ChatWidget::setStreamTargetRow(int row)
 {
+    // 已缓冲的片段属于旧目标行，切换前先提交
+    m_streamBuffer->flush();
+    finishStreamRow();
     m_streamTargetRow = row;
 }
 
 void ChatWidget::clearStreamTargetRow()
 {
+    m_streamBuffer->flush();
+    finishStreamRow();
     m_streamTargetRow = -1;
 }
 
+void ChatWidget::finishStreamRow()
+{
+    auto* dataModel = model();
+    if (!dataModel || !m_viewWidget || dataModel->messageCount() == 0) {
+        return;
+    }
+    int targetRow = m_streamTargetRow;
+    if (targetRow < 0 || targetRow >= dataModel->messageCount()) {
+        targetRow = dataModel->messageCount() - 1;
+    }
+    m_viewWidget->finishStreaming(targetRow);
+}
+
 void ChatWidget::updateMessageContentAtRow(int row, const QString& content)
 {
     if (auto* dataModel = model()) {
@@ -145,6 +194,7 @@ void ChatWidget::removeMessageAt(int row)
 {
     if (row < 0)
         return;
+    m_streamBuffer->flush();
     if (auto* dataModel = model()) {
         dataModel->removeMessageAt(row);
         if (m_streamTargetRow == row) {
@@ -211,6 +261,7 @@ void ChatWidget::onInputMessageSent(const QString& content)
 
 void ChatWidget::removeLastMessage()
 {
+    m_streamBuffer->flush();
     if (auto* dataModel = model()) {
         if (m_streamTargetRow == dataModel->messageCount() - 1) {
             m_streamTargetRow = -1;
@@ -221,10 +272,10 @@ void ChatWidget::removeLastMessage()
 
 void ChatWidget::clearMessages()
 {
+    m_streamBuffer->discard();
     if (auto* dataModel = model()) {
         dataModel->clearMessages();
     }
-    m_messageIds.clear();
     m_streamTargetRow = -1;
 }
 
@@ -235,6 +286,11 @@ int ChatWidget::messageCount() const
 
 void ChatWidget::setSendingState(bool sending)
 {
+    if (!sending) {
+        // 流结束：已接收但尚未提交的片段立即上屏，目标行按完整内容重建一次
+        m_streamBuffer->flush();
+        finishStreamRow();
+    }
     m_isSending = sending; // 更新组件全局状态锁
     if (auto* input = qobject_cast<ChatWidgetInput*>(m_inputWidget)) {
         input->setSendingState(sending);
@@ -287,6 +343,13 @@ void ChatWidget::updateMessageStatus(const QString& messageId, ChatWidgetMessage
     }
 }
 
+void ChatWidget::updateMessageStatuses(const QHash<QString, ChatWidgetMessage::MessageStatus>& statuses)
+{
+    if (auto* dataModel = model()) {
+        dataModel->updateMessageStatuses(statuses);
+    }
+}
+
 void ChatWidget::updateMessageContent(const QString& messageId, const QString& content)
 {
     if (auto* dataModel = model()) {
@@ -336,6 +399,91 @@ void ChatWidget::setSearchKeyword(const QString& keyword)
     }
 }
 
+int ChatWidget::findMessages(const QString& query)
+{
+    m_searchQuery = query;
+    setSearchKeyword(query);
+    collectSearchMatches();
+    return m_searchMatchKeys.size();
+}
+
+void ChatWidget::collectSearchMatches()
+{
+    m_searchMatchKeys.clear();
+    m_currentSearchMatch = -1;
+    auto* dataModel = model();
+    if (dataModel && !m_searchQuery.trimmed().isEmpty()) {
+        const QVector<int> rows = dataModel->findMessages(m_searchQuery);
+        m_searchMatchKeys.reserve(rows.size());
+        for (int row : rows) {
+            m_searchMatchKeys.append(dataModel->messageKeyAt(row));
+        }
+    }
+    emit searchMatchChanged(m_currentSearchMatch, m_searchMatchKeys.size());
+}
+
+void ChatWidget::remapSearchMatchKeys(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys)
+{
+    if (m_searchMatchKeys.isEmpty()) {
+        return;
+    }
+    QHash<quint64, quint64> remapped;
+    remapped.reserve(oldKeys.size());
+    for (int i = 0; i < oldKeys.size(); ++i) {
+        remapped.insert(oldKeys.at(i), newKeys.at(i));
+    }
+    for (quint64& key : m_searchMatchKeys) {
+        key = remapped.value(key, key);
+    }
+}
+
+int ChatWidget::findNext()
+{
+    if (m_searchMatchKeys.isEmpty()) {
+        return -1;
+    }
+    scrollToSearchMatch((m_currentSearchMatch + 1) % m_searchMatchKeys.size());
+    return m_currentSearchMatch >= 0 ? model()->rowForKey(m_searchMatchKeys.at(m_currentSearchMatch)) : -1;
+}
+
+int ChatWidget::findPrevious()
+{
+    if (m_searchMatchKeys.isEmpty()) {
+        return -1;
+    }
+    // 首次向前查找从最新的命中开始
+    scrollToSearchMatch(m_currentSearchMatch <= 0 ? m_searchMatchKeys.size() - 1 : m_currentSearchMatch - 1);
+    return m_currentSearchMatch >= 0 ? model()->rowForKey(m_searchMatchKeys.at(m_currentSearchMatch)) : -1;
+}
+
+int ChatWidget::searchMatchCount() const
+{
+    return m_searchMatchKeys.size();
+}
+
+int ChatWidget::currentSearchMatch() const
+{
+    return m_currentSearchMatch;
+}
+
+void ChatWidget::scrollToSearchMatch(int matchIndex)
+{
+    auto* dataModel = model();
+    if (!dataModel || matchIndex < 0 || matchIndex >= m_searchMatchKeys.size()) {
+        return;
+    }
+    const int row = dataModel->rowForKey(m_searchMatchKeys.at(matchIndex));
+    if (row < 0) {
+        // 命中的消息已被删除
+        return;
+    }
+    m_currentSearchMatch = matchIndex;
+    if (m_viewWidget) {
+        m_viewWidget->scrollToRow(row);
+    }
+    emit searchMatchChanged(m_currentSearchMatch, m_searchMatchKeys.size());
+}
+
 QString ChatWidget::currentUserId() const
 {
     return m_currentUserId;
@@ -350,12 +498,13 @@ void ChatWidget::setCurrentUser(const QString& userId, const QString& displayNam
         upsertParticipant(userId, displayName, avatarPath);
     }
     m_currentUserId = userId;
+    if (m_historyWindow) {
+        m_historyWindow->setCurrentUserId(m_currentUserId);
+    }
+    // 模型只对 isMine 变化的行发出 dataChanged，视图据此重新测量，无需整体重排
     if (auto* dataModel = model()) {
         dataModel->updateIsMine(m_currentUserId);
     }
-    if (m_viewWidget) {
-        m_viewWidget->refreshLayout();
-    }
 }
 
 void ChatWidget::upsertParticipant(const QString& userId, const QString& displayName, const QString& avatarPath)
@@ -370,9 +519,6 @@ void ChatWidget::upsertParticipant(const QString& userId, const QString& display
         if (auto* dataModel = model()) {
             dataModel->updateParticipantInfo(userId, finalName, avatarPath);
         }
-        if (m_viewWidget) {
-            m_viewWidget->refreshLayout();
-        }
     }
 }
 
@@ -392,6 +538,11 @@ bool ChatWidget::hasParticipant(const QString& userId) const
 }
 
 void ChatWidget::setHistoryMessages(const QList<HistoryMessage>& messages, bool resetParticipants)
+{
+    setHistoryMessages(QList<HistoryMessage>(messages), resetParticipants);
+}
+
+void ChatWidget::setHistoryMessages(QList<HistoryMessage>&& messages, bool resetParticipants)
 {
     ParticipantInfo currentInfo;
     const bool hasCurrent = !m_currentUserId.isEmpty() && m_participants.contains(m_currentUserId);
@@ -404,263 +555,210 @@ void ChatWidget::setHistoryMessages(const QList<HistoryMessage>& messages, bool
         if (hasCurrent) {
             m_participants.insert(m_currentUserId, currentInfo);
         }
-        m_messageIds.clear();
-    }
-
-    QList<HistoryMessage> sorted = messages;
-    std::sort(sorted.begin(), sorted.end(), [](const HistoryMessage& a, const HistoryMessage& b) {
-        const qint64 at = a.timestamp.isValid() ? a.timestamp.toMSecsSinceEpoch() : 0;
-        const qint64 bt = b.timestamp.isValid() ? b.timestamp.toMSecsSinceEpoch() : 0;
-        return at < bt;
-    });
-
-    QList<ChatWidgetMessage> converted;
-    converted.reserve(sorted.size());
-    for (const HistoryMessage& history : sorted) {
-        if (!history.messageId.isEmpty() && m_messageIds.contains(history.messageId)) {
-            continue;
-        }
-
-        ChatWidgetMessage msg;
-        msg.messageId = history.messageId;
-        msg.content = history.content;
-        msg.timestamp = history.timestamp;
-        msg.messageType = history.messageType;
-        msg.status = history.status;
-        msg.imagePath = history.imagePath;
-        msg.filePath = history.filePath;
-        msg.fileName = history.fileName;
-        msg.fileSize = history.fileSize;
-        msg.replyToMessageId = history.replyToMessageId;
-        msg.replySender = history.replySender;
-        msg.replyPreview = history.replyPreview;
-        msg.isForwarded = history.isForwarded;
-        msg.forwardedFrom = history.forwardedFrom;
-        msg.reactions = history.reactions;
-        msg.mentions = history.mentions;
-
-        if (history.senderId.trimmed().isEmpty()) {
-            msg.senderId = QString();
-            msg.sender = history.displayName.isEmpty() ? QStringLiteral("User") : history.displayName;
-            msg.avatarPath = history.avatarPath;
-            msg.isMine = history.isMine;
-        } else {
-            ParticipantInfo info = m_participants.value(history.senderId);
-            info.id = history.senderId;
-            if (!history.displayName.isEmpty()) {
-                info.displayName = history.displayName;
-            }
-            if (!history.avatarPath.isEmpty()) {
-                info.avatarPath = history.avatarPath;
-            }
-            m_participants.insert(history.senderId, info);
-
-            msg.senderId = history.senderId;
-            msg.sender = info.displayName.isEmpty() ? history.senderId : info.displayName;
-            msg.avatarPath = info.avatarPath;
-            msg.isMine = !m_currentUserId.isEmpty() && history.senderId == m_currentUserId;
-            if (m_currentUserId.isEmpty()) {
-                msg.isMine = history.isMine;
-            }
-        }
-
-        if (!msg.messageId.isEmpty()) {
-            m_messageIds.insert(msg.messageId);
-        }
-        converted.append(msg);
     }
 
+    // 整体替换时只在本批内去重
+    QList<ChatWidgetMessage> converted = convertHistoryMessages(std::move(messages), true, false, nullptr);
     if (m_viewWidget) {
-        m_viewWidget->setMessages(converted);
+        m_viewWidget->setMessages(std::move(converted));
     }
 }
 
 void ChatWidget::appendHistoryMessages(const QList<HistoryMessage>& messages, bool sortAndDedupe)
+{
+    appendHistoryMessages(QList<HistoryMessage>(messages), sortAndDedupe);
+}
+
+void ChatWidget::appendHistoryMessages(QList<HistoryMessage>&& messages, bool sortAndDedupe)
 {
     if (messages.isEmpty()) {
         return;
     }
-    QList<HistoryMessage> sorted = messages;
-    if (sortAndDedupe) {
-        std::sort(sorted.begin(), sorted.end(), [](const HistoryMessage& a, const HistoryMessage& b) {
-            const qint64 at = a.timestamp.isValid() ? a.timestamp.toMSecsSinceEpoch() : 0;
-            const qint64 bt = b.timestamp.isValid() ? b.timestamp.toMSecsSinceEpoch() : 0;
-            return at < bt;
-        });
-    }
-    QList<ChatWidgetMessage> converted;
-    converted.reserve(sorted.size());
     QHash<QString, ParticipantInfo> updatedParticipants;
-    for (const HistoryMessage& history : sorted) {
-        if (sortAndDedupe && !history.messageId.isEmpty() && m_messageIds.contains(history.messageId)) {
-            continue;
-        }
+    QList<ChatWidgetMessage> converted =
+        convertHistoryMessages(std::move(messages), sortAndDedupe, sortAndDedupe, &updatedParticipants);
 
-        ChatWidgetMessage msg;
-        msg.messageId = history.messageId;
-        msg.content = history.content;
-        msg.timestamp = history.timestamp;
-        msg.messageType = history.messageType;
-        msg.status = history.status;
-        msg.imagePath = history.imagePath;
-        msg.filePath = history.filePath;
-        msg.fileName = history.fileName;
-        msg.fileSize = history.fileSize;
-        msg.replyToMessageId = history.replyToMessageId;
-        msg.replySender = history.replySender;
-        msg.replyPreview = history.replyPreview;
-        msg.isForwarded = history.isForwarded;
-        msg.forwardedFrom = history.forwardedFrom;
-        msg.reactions = history.reactions;
-        msg.mentions = history.mentions;
-
-        if (history.senderId.trimmed().isEmpty()) {
-            msg.senderId = QString();
-            msg.sender = history.displayName.isEmpty() ? QStringLiteral("User") : history.displayName;
-            msg.avatarPath = history.avatarPath;
-            msg.isMine = history.isMine;
+    if (m_viewWidget) {
+        if (sortAndDedupe) {
+            // 同步页与已加载内容大量重叠且可能含迟到消息：按时间并入而不是整体追加
+            model()->mergeMessages(std::move(converted));
+            m_viewWidget->scrollToBottom();
         } else {
-            ParticipantInfo info = m_participants.value(history.senderId);
-            const QString oldName = info.displayName;
-            const QString oldAvatar = info.avatarPath;
-            info.id = history.senderId;
-            if (!history.displayName.isEmpty()) {
-                info.displayName = history.displayName;
-            }
-            if (!history.avatarPath.isEmpty()) {
-                info.avatarPath = history.avatarPath;
-            }
-            m_participants.insert(history.senderId, info);
-            if ((!history.displayName.isEmpty() && oldName != info.displayName) ||
-                (!history.avatarPath.isEmpty() && oldAvatar != info.avatarPath)) {
-                updatedParticipants.insert(history.senderId, info);
-            }
-
-            msg.senderId = history.senderId;
-            msg.sender = info.displayName.isEmpty() ? history.senderId : info.displayName;
-            msg.avatarPath = info.avatarPath;
-            msg.isMine = !m_currentUserId.isEmpty() && history.senderId == m_currentUserId;
-            if (m_currentUserId.isEmpty()) {
-                msg.isMine = history.isMine;
-            }
+            m_viewWidget->appendMessages(std::move(converted));
         }
+    }
+    applyParticipantUpdates(updatedParticipants);
+}
 
-        if (!msg.messageId.isEmpty()) {
-            m_messageIds.insert(msg.messageId);
-        }
-        converted.append(msg);
+void ChatWidget::prependHistoryMessages(const QList<HistoryMessage>& messages, bool sortAndDedupe)
+{
+    prependHistoryMessages(QList<HistoryMessage>(messages), sortAndDedupe);
+}
+
+void ChatWidget::prependHistoryMessages(QList<HistoryMessage>&& messages, bool sortAndDedupe)
+{
+    if (messages.isEmpty()) {
+        return;
     }
+    QHash<QString, ParticipantInfo> updatedParticipants;
+    QList<ChatWidgetMessage> converted =
+        convertHistoryMessages(std::move(messages), sortAndDedupe, sortAndDedupe, &updatedParticipants);
 
     if (m_viewWidget) {
-        m_viewWidget->appendMessages(converted);
-    }
-    if (!updatedParticipants.isEmpty()) {
-        for (auto it = updatedParticipants.constBegin(); it != updatedParticipants.constEnd(); ++it) {
-            const ParticipantInfo& info = it.value();
-            const QString finalName = info.displayName.isEmpty() ? it.key() : info.displayName;
-            if (auto* dataModel = model()) {
-                dataModel->updateParticipantInfo(it.key(), finalName, info.avatarPath);
-            }
-        }
-        if (m_viewWidget) {
+        if (sortAndDedupe) {
+            model()->mergeMessages(std::move(converted));
             m_viewWidget->refreshLayout();
+        } else {
+            m_viewWidget->prependMessages(std::move(converted));
         }
     }
+    applyParticipantUpdates(updatedParticipants);
 }
 
-void ChatWidget::prependHistoryMessages(const QList<HistoryMessage>& messages, bool sortAndDedupe)
+QList<ChatWidgetMessage> ChatWidget::convertHistoryMessages(QList<HistoryMessage>&& messages, bool sortAndDedupe,
+                                                            bool skipLoaded, QHash<QString, ParticipantInfo>* updated)
 {
-    if (messages.isEmpty()) {
-        return;
-    }
-    QList<HistoryMessage> sorted = messages;
+    // 先在下标上完成去重与排序，被剔除的消息不做任何转换
+    QVector<int> order;
+    order.reserve(messages.size());
     if (sortAndDedupe) {
-        std::sort(sorted.begin(), sorted.end(), [](const HistoryMessage& a, const HistoryMessage& b) {
-            const qint64 at = a.timestamp.isValid() ? a.timestamp.toMSecsSinceEpoch() : 0;
-            const qint64 bt = b.timestamp.isValid() ? b.timestamp.toMSecsSinceEpoch() : 0;
-            return at < bt;
-        });
+        const ChatWidgetModel* dataModel = skipLoaded ? model() : nullptr;
+        QSet<QString> incomingIds;
+        incomingIds.reserve(messages.size());
+        for (int i = 0; i < messages.size(); ++i) {
+            const QString& messageId = messages.at(i).messageId;
+            if (!messageId.isEmpty()) {
+                if ((dataModel && dataModel->containsMessageId(messageId)) || incomingIds.contains(messageId)) {
+                    continue;
+                }
+                incomingIds.insert(messageId);
+            }
+            order.append(i);
+        }
+        const auto byTimestamp = [&messages](int a, int b) {
+            const QDateTime& at = messages.at(a).timestamp;
+            const QDateTime& bt = messages.at(b).timestamp;
+            return (at.isValid() ? at.toMSecsSinceEpoch() : 0) < (bt.isValid() ? bt.toMSecsSinceEpoch() : 0);
+        };
+        // 同步页通常已按时间排列，O(n) 检查后即可跳过排序
+        if (!std::is_sorted(order.cbegin(), order.cend(), byTimestamp)) {
+            std::stable_sort(order.begin(), order.end(), byTimestamp);
+        }
+    } else {
+        for (int i = 0; i < messages.size(); ++i) {
+            order.append(i);
+        }
     }
+
+    // 列表独占时字段直接移出；与调用方共享时逐条复制，不分离整个列表
+    const bool owned = messages.isDetached();
     QList<ChatWidgetMessage> converted;
-    converted.reserve(sorted.size());
-    QHash<QString, ParticipantInfo> updatedParticipants;
-    for (const HistoryMessage& history : sorted) {
-        if (sortAndDedupe && !history.messageId.isEmpty() && m_messageIds.contains(history.messageId)) {
-            continue;
+    converted.reserve(order.size());
+    for (int index : qAsConst(order)) {
+        if (owned) {
+            converted.append(takeHistoryMessage(std::move(messages[index]), updated));
+        } else {
+            converted.append(takeHistoryMessage(HistoryMessage(messages.at(index)), updated));
         }
+    }
+    messages.clear();
+    return converted;
+}
 
-        ChatWidgetMessage msg;
-        msg.messageId = history.messageId;
-        msg.content = history.content;
-        msg.timestamp = history.timestamp;
-        msg.messageType = history.messageType;
-        msg.status = history.status;
-        msg.imagePath = history.imagePath;
-        msg.filePath = history.filePath;
-        msg.fileName = history.fileName;
-        msg.fileSize = history.fileSize;
-        msg.replyToMessageId = history.replyToMessageId;
-        msg.replySender = history.replySender;
-        msg.replyPreview = history.replyPreview;
-        msg.isForwarded = history.isForwarded;
-        msg.forwardedFrom = history.forwardedFrom;
-        msg.reactions = history.reactions;
-        msg.mentions = history.mentions;
-
-        if (history.senderId.trimmed().isEmpty()) {
-            msg.senderId = QString();
-            msg.sender = history.displayName.isEmpty() ? QStringLiteral("User") : history.displayName;
-            msg.avatarPath = history.avatarPath;
-            msg.isMine = history.isMine;
-        } else {
-            ParticipantInfo info = m_participants.value(history.senderId);
-            const QString oldName = info.displayName;
-            const QString oldAvatar = info.avatarPath;
-            info.id = history.senderId;
-            if (!history.displayName.isEmpty()) {
-                info.displayName = history.displayName;
-            }
-            if (!history.avatarPath.isEmpty()) {
-                info.avatarPath = history.avatarPath;
-            }
-            m_participants.insert(history.senderId, info);
-            if ((!history.displayName.isEmpty() && oldName != info.displayName) ||
-                (!history.avatarPath.isEmpty() && oldAvatar != info.avatarPath)) {
-                updatedParticipants.insert(history.senderId, info);
-            }
+ChatWidgetMessage ChatWidget::takeHistoryMessage(HistoryMessage history, QHash<QString, ParticipantInfo>* updated)
+{
+    ChatWidgetMessage msg;
+    msg.messageId = std::move(history.messageId);
+    msg.content = std::move(history.content);
+    msg.timestamp = history.timestamp;
+    msg.messageType = history.messageType;
+    msg.status = history.status;
+    msg.imagePath = std::move(history.imagePath);
+    msg.filePath = std::move(history.filePath);
+    msg.fileName = std::move(history.fileName);
+    msg.fileSize = history.fileSize;
+    msg.replyToMessageId = std::move(history.replyToMessageId);
+    msg.replySender = std::move(history.replySender);
+    msg.replyPreview = std::move(history.replyPreview);
+    msg.isForwarded = history.isForwarded;
+    msg.forwardedFrom = std::move(history.forwardedFrom);
+    msg.reactions = std::move(history.reactions);
+    msg.mentions = std::move(history.mentions);
+
+    if (history.senderId.trimmed().isEmpty()) {
+        msg.senderId = QString();
+        msg.sender = history.displayName.isEmpty() ? QStringLiteral("User") : std::move(history.displayName);
+        msg.avatarPath = std::move(history.avatarPath);
+        msg.isMine = history.isMine;
+    } else {
+        ParticipantInfo info = m_participants.value(history.senderId);
+        const QString oldName = info.displayName;
+        const QString oldAvatar = info.avatarPath;
+        info.id = history.senderId;
+        if (!history.displayName.isEmpty()) {
+            info.displayName = history.displayName;
+        }
+        if (!history.avatarPath.isEmpty()) {
+            info.avatarPath = history.avatarPath;
+        }
+        m_participants.insert(history.senderId, info);
+        if (updated && ((!history.displayName.isEmpty() && oldName != info.displayName) ||
+                        (!history.avatarPath.isEmpty() && oldAvatar != info.avatarPath))) {
+            updated->insert(history.senderId, info);
+        }
 
-            msg.senderId = history.senderId;
-            msg.sender = info.displayName.isEmpty() ? history.senderId : info.displayName;
-            msg.avatarPath = info.avatarPath;
-            msg.isMine = !m_currentUserId.isEmpty() && history.senderId == m_currentUserId;
-            if (m_currentUserId.isEmpty()) {
-                msg.isMine = history.isMine;
-            }
+        msg.sender = info.displayName.isEmpty() ? history.senderId : info.displayName;
+        msg.avatarPath = info.avatarPath;
+        msg.isMine = !m_currentUserId.isEmpty() && history.senderId == m_currentUserId;
+        if (m_currentUserId.isEmpty()) {
+            msg.isMine = history.isMine;
         }
+        msg.senderId = std::move(history.senderId);
+    }
 
-        if (!msg.messageId.isEmpty()) {
-            m_messageIds.insert(msg.messageId);
+    return msg;
+}
+
+void ChatWidget::applyParticipantUpdates(const QHash<QString, ParticipantInfo>& updated)
+{
+    if (updated.isEmpty()) {
+        return;
+    }
+    for (auto it = updated.constBegin(); it != updated.constEnd(); ++it) {
+        const ParticipantInfo& info = it.value();
+        const QString finalName = info.displayName.isEmpty() ? it.key() : info.displayName;
+        if (auto* dataModel = model()) {
+            dataModel->updateParticipantInfo(it.key(), finalName, info.avatarPath);
         }
-        converted.append(msg);
     }
+}
 
+void ChatWidget::setHistorySource(ChatHistorySource* source, int pageSize)
+{
+    if (!m_historyWindow) {
+        m_historyWindow = new ChatWidgetHistoryWindow(model(), this);
+        connect(m_viewWidget, &ChatWidgetView::nearTopReached, m_historyWindow, &ChatWidgetHistoryWindow::loadOlder);
+        connect(m_viewWidget, &ChatWidgetView::nearBottomReached, m_historyWindow, &ChatWidgetHistoryWindow::loadNewer);
+    }
+    m_historyWindow->setCurrentUserId(m_currentUserId);
+    m_historyWindow->setPageSize(pageSize);
+    m_historyWindow->setSource(source);
+    if (!source) {
+        return;
+    }
+    m_streamBuffer->discard();
+    m_streamTargetRow = -1;
+    m_historyWindow->loadLatest();
     if (m_viewWidget) {
-        m_viewWidget->prependMessages(converted);
-    }
-    if (!updatedParticipants.isEmpty()) {
-        for (auto it = updatedParticipants.constBegin(); it != updatedParticipants.constEnd(); ++it) {
-            const ParticipantInfo& info = it.value();
-            const QString finalName = info.displayName.isEmpty() ? it.key() : info.displayName;
-            if (auto* dataModel = model()) {
-                dataModel->updateParticipantInfo(it.key(), finalName, info.avatarPath);
-            }
-        }
-        if (m_viewWidget) {
-            m_viewWidget->refreshLayout();
-        }
+        m_viewWidget->scrollToBottom();
     }
 }
 
+ChatWidgetHistoryWindow* ChatWidget::historyWindow() const
+{
+    return m_historyWindow;
+}
+
 void ChatWidget::onStreamingTimeout()
 {
     if (m_streamingIndex < m_streamingContent.length()) {
@@ -9,10 +9,14 @@
 #include <QPoint>
 #include <QSet>
 #include <QString>
+#include <QVector>
 #include <QWidget>
 
 class ChatWidgetView;
 class ChatWidgetInputBase;
+class ChatWidgetStreamBuffer;
+class ChatWidgetHistoryWindow;
+class ChatHistorySource;
 class QTimer;
 
 class ChatWidget : public QWidget {
@@ -69,7 +73,10 @@ public:
     void addMessage(const MessageParams& params);
 
     // API: 流式输出（追加内容到最后一条消息）
+    // 片段先进入缓冲，按刷新周期合并后提交到模型；流结束时可调用 flushStreamOutput() 立即提交
     void streamOutput(const QString& content);
+    void flushStreamOutput();
+    ChatWidgetStreamBuffer* streamBuffer() const;
     void setStreamTargetRow(int row);
     void clearStreamTargetRow();
     void updateMessageContentAtRow(int row, const QString& content);
@@ -93,11 +100,20 @@ public:
     bool removeParticipant(const QString& userId);
     void clearParticipants();
     bool hasParticipant(const QString& userId) const;
+    // 右值重载从传入的列表中移出字段，大批量加载时应 std::move 传入
     void setHistoryMessages(const QList<HistoryMessage>& messages, bool resetParticipants = true);
+    void setHistoryMessages(QList<HistoryMessage>&& messages, bool resetParticipants = true);
     void appendHistoryMessages(const QList<HistoryMessage>& messages, bool sortAndDedupe = true);
+    void appendHistoryMessages(QList<HistoryMessage>&& messages, bool sortAndDedupe = true);
     void prependHistoryMessages(const QList<HistoryMessage>& messages, bool sortAndDedupe = true);
+    void prependHistoryMessages(QList<HistoryMessage>&& messages, bool sortAndDedupe = true);
+    // 窗口化历史：模型只保留视口附近的消息，滚动到边缘时从 source 按页加载，远离视口的行被淘汰。
+    // source 不转移所有权；传入 nullptr 关闭分页。与 set/append/prependHistoryMessages 二选一使用
+    void setHistorySource(ChatHistorySource* source, int pageSize = 50);
+    ChatWidgetHistoryWindow* historyWindow() const;
 
     void updateMessageStatus(const QString& messageId, ChatWidgetMessage::MessageStatus status);
+    void updateMessageStatuses(const QHash<QString, ChatWidgetMessage::MessageStatus>& statuses);
     void updateMessageContent(const QString& messageId, const QString& content);
     void updateMessageReactions(const QString& messageId, const QList<ChatWidgetReaction>& reactions);
     void updateMessageAttachments(const QString& messageId, const QString& imagePath, const QString& filePath,
@@ -105,6 +121,14 @@ public:
     void updateMessageReply(const QString& messageId, const QString& replyToMessageId, const QString& replySender,
                             const QString& replyPreview, bool isForwarded, const QString& forwardedFrom);
     void setSearchKeyword(const QString& keyword);
+    // 会话内检索：高亮 query 并记录命中消息（按词前缀/短语匹配），返回命中数。
+    // findNext/findPrevious 循环切换当前命中并滚动到该消息，返回其行号（无命中时 -1）
+    int findMessages(const QString& query);
+    int findNext();
+    int findPrevious();
+    int searchMatchCount() const;
+    int currentSearchMatch() const;
+    void scrollToSearchMatch(int matchIndex);
 
     // API: 模拟 AI 自动流式回复（组件内部管理定时器）
     void startSimulatedStreaming(const QString& content, int interval = 30);
@@ -119,26 +143,47 @@ signals:
     void messageSelected(const QString& messageId);
     void messageContextMenuRequested(const QString& messageId, const QPoint& globalPos);
     void messageActionRequested(const QString& action, const QString& messageId);
+    // current 为当前命中序号（0 起，-1 表示未定位）
+    void searchMatchChanged(int current, int total);
 
 private slots:
     void onInputMessageSent(const QString& content);
     void onStreamingTimeout();
+    void onStreamBufferFlushed(const QString& content);
 
 private:
     void setupUi();
+    // 转换一批历史消息。sortAndDedupe 时剔除本批重复（skipLoaded 时还剔除模型中已有）的消息并按时间稳定排序，
+    // 已有序时不排序；updated 含义同 takeHistoryMessage
+    QList<ChatWidgetMessage> convertHistoryMessages(QList<HistoryMessage>&& messages, bool sortAndDedupe,
+                                                    bool skipLoaded, QHash<QString, ParticipantInfo>* updated);
+    // 转换一条历史消息并登记其发送者；
+    // updated 非空时记录显示名或头像发生变化的参与者
+    ChatWidgetMessage takeHistoryMessage(HistoryMessage history, QHash<QString, ParticipantInfo>* updated);
+    void applyParticipantUpdates(const QHash<QString, ParticipantInfo>& updated);
+    // 按 m_searchQuery 重新收集命中（当前命中复位）
+    void collectSearchMatches();
+    void remapSearchMatchKeys(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys);
+    // 流结束或切换目标行：当前目标行按完整内容重建一次
+    void finishStreamRow();
 
     class QVBoxLayout* m_mainLayout;
     class ChatWidgetView* m_viewWidget;
     class ChatWidgetInputBase* m_inputWidget;
     bool m_isSending = false;
+    // 参与者名录（含尚未发言的成员），用于转换历史消息时补全资料；消息行引用的是模型中的参与者记录
     QHash<QString, ParticipantInfo> m_participants;
     QString m_currentUserId;
-    QSet<QString> m_messageIds;
 
     QTimer* m_streamingTimer = nullptr;
+    ChatWidgetStreamBuffer* m_streamBuffer = nullptr;
+    ChatWidgetHistoryWindow* m_historyWindow = nullptr;
     QString m_streamingContent;
     int m_streamingIndex = 0;
     int m_streamTargetRow = -1;
+    QString m_searchQuery;              // 最近一次 findMessages 的查询
+    QVector<quint64> m_searchMatchKeys; // 命中消息的稳定标识，行号随插入/删除变化
+    int m_currentSearchMatch = -1;
 };
 
 #endif // CHAT_WIDGET_H
@@ -7,22 +7,53 @@ INCLUDEPATH += \
 
 SOURCES += \
     $$CHATWIDGET_DIR/chat_widget_model.cpp \
+    $$CHATWIDGET_DIR/chat_widget_message_store.cpp \
+    $$CHATWIDGET_DIR/chat_widget_search_index.cpp \
     $$CHATWIDGET_DIR/chat_widget_delegate.cpp \
+    $$CHATWIDGET_DIR/chat_widget_row_reader.cpp \
+    $$CHATWIDGET_DIR/chat_widget_layout_cache.cpp \
+    $$CHATWIDGET_DIR/chat_widget_prerenderer.cpp \
+    $$CHATWIDGET_DIR/chat_widget_highlighter.cpp \
+    $$CHATWIDGET_DIR/chat_widget_image_cache.cpp \
+    $$CHATWIDGET_DIR/chat_widget_streaming_renderer.cpp \
+    $$CHATWIDGET_DIR/chat_widget_code_highlighter.cpp \
     $$CHATWIDGET_DIR/chat_widget_view.cpp \
+    $$CHATWIDGET_DIR/chat_widget_list_view.cpp \
     $$CHATWIDGET_DIR/chat_widget_input.cpp \
+    $$CHATWIDGET_DIR/chat_widget_stream_buffer.cpp \
+    $$CHATWIDGET_DIR/chat_widget_history_window.cpp \
+    $$CHATWIDGET_DIR/chat_file_history_source.cpp \
     $$CHATWIDGET_DIR/chat_widget.cpp \
     $$CHATWIDGET_DIR/chat_widget_markdown_utils.cpp \
+    $$CHATWIDGET_DIR/chat_widget_markdown_document_builder.cpp \
     $$MD4C_DIR/md4c.c \
     $$MD4C_DIR/md4c-html.c \
     $$MD4C_DIR/entity.c
 
 HEADERS += \
+    $$CHATWIDGET_DIR/chat_widget_message.h \
     $$CHATWIDGET_DIR/chat_widget_model.h \
+    $$CHATWIDGET_DIR/chat_widget_message_store.h \
+    $$CHATWIDGET_DIR/chat_widget_gap_vector.h \
+    $$CHATWIDGET_DIR/chat_widget_search_index.h \
     $$CHATWIDGET_DIR/chat_widget_delegate.h \
+    $$CHATWIDGET_DIR/chat_widget_row_reader.h \
+    $$CHATWIDGET_DIR/chat_widget_layout_cache.h \
+    $$CHATWIDGET_DIR/chat_widget_prerenderer.h \
+    $$CHATWIDGET_DIR/chat_widget_highlighter.h \
+    $$CHATWIDGET_DIR/chat_widget_image_cache.h \
+    $$CHATWIDGET_DIR/chat_widget_streaming_renderer.h \
+    $$CHATWIDGET_DIR/chat_widget_code_highlighter.h \
     $$CHATWIDGET_DIR/chat_widget_view.h \
+    $$CHATWIDGET_DIR/chat_widget_list_view.h \
     $$CHATWIDGET_DIR/chat_widget_input.h \
+    $$CHATWIDGET_DIR/chat_widget_stream_buffer.h \
+    $$CHATWIDGET_DIR/chat_widget_history_window.h \
+    $$CHATWIDGET_DIR/chat_file_history_source.h \
+    $$CHATWIDGET_DIR/chat_history_source.h \
     $$CHATWIDGET_DIR/chat_widget.h \
     $$CHATWIDGET_DIR/chat_widget_markdown_utils.h \
+    $$CHATWIDGET_DIR/chat_widget_markdown_document_builder.h \
     $$MD4C_DIR/md4c.h \
     $$MD4C_DIR/md4c-html.h \
     $$MD4C_DIR/entity.h
@@ -35,3 +66,4 @@ isEmpty(QCHAT_STYLES_QRC_INCLUDED) {
 
 include($$PWD/../common/theme_manager.pri)
 include($$PWD/../common/qss_utils.pri)
+include($$PWD/../common/avatar_cache.pri)
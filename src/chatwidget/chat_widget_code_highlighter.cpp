@@ -0,0 +1,536 @@
+#include "chat_widget_code_highlighter.h"
+#include <QHash>
+#include <QSet>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+
+namespace {
+// 跨行状态，与语言一起参与行缓存的键
+const int kStateNormal = 0;
+const int kStateBlockComment = 1; // /* ... */
+const int kStateTripleDouble = 2; // """ ... """
+const int kStateTripleSingle = 3; // ''' ... '''
+
+// Markdown 中的一个围栏代码块：只记录定位所需的首行与行数
+struct Fence {
+    ChatWidgetCodeHighlighter::Language language = ChatWidgetCodeHighlighter::PlainText;
+    QString firstLine;
+    int lineCount = 0;
+};
+
+int leadingSpaces(const QStringRef& line)
+{
+    int indent = 0;
+    while (indent < line.size() && line.at(indent) == QLatin1Char(' ')) {
+        ++indent;
+    }
+    return indent;
+}
+
+int runLength(const QStringRef& line, int from, QChar ch)
+{
+    int end = from;
+    while (end < line.size() && line.at(end) == ch) {
+        ++end;
+    }
+    return end - from;
+}
+
+// 与 md4c 一致：缩进不超过 3 个空格、至少 3 个 ` 或 ~；未闭合的围栏延续到末尾
+QVector<Fence> fencedBlocks(const QString& markdown)
+{
+    QVector<Fence> fences;
+    bool inFence = false;
+    QChar fenceChar;
+    int fenceLength = 0;
+    int fenceIndent = 0;
+    int lineStart = 0;
+    while (lineStart < markdown.size()) {
+        int lineEnd = markdown.indexOf(QLatin1Char('\n'), lineStart);
+        const int next = lineEnd < 0 ? markdown.size() : lineEnd + 1;
+        if (lineEnd < 0) {
+            lineEnd = markdown.size();
+        }
+        QStringRef line = markdown.midRef(lineStart, lineEnd - lineStart);
+        if (line.endsWith(QLatin1Char('\r'))) {
+            line.chop(1);
+        }
+        lineStart = next;
+
+        const int indent = leadingSpaces(line);
+        if (inFence) {
+            const int run = indent <= 3 ? runLength(line, indent, fenceChar) : 0;
+            if (run >= fenceLength && line.mid(indent + run).trimmed().isEmpty()) {
+                inFence = false;
+                continue;
+            }
+            Fence& fence = fences.last();
+            if (fence.lineCount == 0) {
+                fence.firstLine = line.mid(qMin(indent, fenceIndent)).toString();
+            }
+            ++fence.lineCount;
+            continue;
+        }
+        if (indent > 3 || indent >= line.size()) {
+            continue;
+        }
+        const QChar ch = line.at(indent);
+        if (ch != QLatin1Char('`') && ch != QLatin1Char('~')) {
+            continue;
+        }
+        const int run = runLength(line, indent, ch);
+        const QStringRef info = line.mid(indent + run).trimmed();
+        if (run < 3 || (ch == QLatin1Char('`') && info.contains(QLatin1Char('`')))) {
+            continue;
+        }
+        inFence = true;
+        fenceChar = ch;
+        fenceLength = run;
+        fenceIndent = indent;
+        Fence fence;
+        fence.language = ChatWidgetCodeHighlighter::languageForInfo(info);
+        fences.append(fence);
+    }
+    return fences;
+}
+
+// <pre> 导入后每行一个不断行的块
+bool isCodeBlock(const QTextBlock& block)
+{
+    return block.blockFormat().nonBreakableLines() || block.charFormat().fontFixedPitch();
+}
+
+QSet<QString> wordSet(const char* words)
+{
+    QSet<QString> set;
+    for (const QString& word : QString::fromLatin1(words).split(QLatin1Char(' '))) {
+        set.insert(word);
+    }
+    return set;
+}
+
+const QSet<QString>& keywords(ChatWidgetCodeHighlighter::Language language)
+{
+    static const QSet<QString> cpp = wordSet(
+        "alignas alignof asm auto bool break case catch char char16_t char32_t char8_t class co_await co_return "
+        "co_yield const const_cast consteval constexpr constinit continue decltype default delete do double "
+        "dynamic_cast else enum explicit export extern false final float for friend goto if inline int long "
+        "mutable namespace new noexcept nullptr operator override private protected public register "
+        "reinterpret_cast return short signed sizeof static static_assert static_cast struct switch template "
+        "this thread_local throw true try typedef typeid typename union unsigned using virtual void volatile "
+        "wchar_t while");
+    static const QSet<QString> python = wordSet(
+        "False None True and as assert async await break class continue def del elif else except finally for "
+        "from global if import in is lambda nonlocal not or pass raise return self try while with yield");
+    static const QSet<QString> json = wordSet("true false null");
+    static const QSet<QString> shell = wordSet(
+        "if then else elif fi case esac for select while until do done in function return exit break continue "
+        "local export readonly declare unset source");
+    // SQL 不区分大小写，按小写比较
+    static const QSet<QString> sql = wordSet(
+        "add all alter and as asc begin between boolean by case char check commit constraint create cross date "
+        "default delete desc distinct double drop else end exists float foreign from full group having in index "
+        "inner insert int integer into is join key left like limit not null offset on or order outer primary "
+        "real references returning right rollback select set table text then timestamp transaction union unique "
+        "update values varchar view when where with");
+    static const QSet<QString> none;
+    switch (language) {
+    case ChatWidgetCodeHighlighter::Cpp:
+        return cpp;
+    case ChatWidgetCodeHighlighter::Python:
+        return python;
+    case ChatWidgetCodeHighlighter::Json:
+        return json;
+    case ChatWidgetCodeHighlighter::Shell:
+        return shell;
+    case ChatWidgetCodeHighlighter::Sql:
+        return sql;
+    default:
+        return none;
+    }
+}
+
+inline bool isWordChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+// 从 quote 处开始的字符串结束位置（不含时为行尾）；SQL 以重复引号转义，Shell 单引号内无转义
+int stringEnd(const QString& line, int pos, ChatWidgetCodeHighlighter::Language language)
+{
+    const QChar quote = line.at(pos);
+    const bool backslashEscapes = language != ChatWidgetCodeHighlighter::Sql
+                                  && !(language == ChatWidgetCodeHighlighter::Shell && quote == QLatin1Char('\''));
+    int i = pos + 1;
+    while (i < line.size()) {
+        const QChar ch = line.at(i);
+        if (backslashEscapes && ch == QLatin1Char('\\')) {
+            i += 2;
+            continue;
+        }
+        if (ch == quote) {
+            if (language == ChatWidgetCodeHighlighter::Sql && i + 1 < line.size() && line.at(i + 1) == quote) {
+                i += 2;
+                continue;
+            }
+            return i + 1;
+        }
+        ++i;
+    }
+    return line.size();
+}
+
+bool isPythonStringPrefix(const QString& line, int start, int end)
+{
+    if (end - start > 2 || end >= line.size()) {
+        return false;
+    }
+    const QChar next = line.at(end);
+    if (next != QLatin1Char('"') && next != QLatin1Char('\'')) {
+        return false;
+    }
+    for (int i = start; i < end; ++i) {
+        if (!QStringLiteral("rRbBfFuU").contains(line.at(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+ChatWidgetCodeHighlighter::ChatWidgetCodeHighlighter(int cacheLines)
+    : m_lines(qMax(0, cacheLines))
+{
+}
+
+void ChatWidgetCodeHighlighter::setFormat(TokenKind kind, const QTextCharFormat& format)
+{
+    if (kind >= 0 && kind < TokenKindCount) {
+        m_formats[kind] = format;
+    }
+}
+
+QTextCharFormat ChatWidgetCodeHighlighter::format(TokenKind kind) const
+{
+    return kind >= 0 && kind < TokenKindCount ? m_formats[kind] : QTextCharFormat();
+}
+
+int ChatWidgetCodeHighlighter::cachedLineCount() const
+{
+    return m_lines.count();
+}
+
+int ChatWidgetCodeHighlighter::tokenizedLineCount() const
+{
+    return m_tokenizedLines;
+}
+
+void ChatWidgetCodeHighlighter::clearCache()
+{
+    m_lines.clear();
+}
+
+ChatWidgetCodeHighlighter::Language ChatWidgetCodeHighlighter::languageForName(const QString& name)
+{
+    static const QHash<QString, Language> languages = [] {
+        QHash<QString, Language> map;
+        const struct {
+            const char* names;
+            Language language;
+        } groups[] = {
+            {"c c++ cc cpp cxx h hh hpp hxx objective-c", Cpp},
+            {"py py3 python python3 gyp", Python},
+            {"json jsonc json5 geojson", Json},
+            {"sh bash shell zsh ksh console shellsession", Shell},
+            {"sql mysql postgres postgresql psql plsql sqlite tsql", Sql},
+        };
+        for (const auto& group : groups) {
+            for (const QString& alias : QString::fromLatin1(group.names).split(QLatin1Char(' '))) {
+                map.insert(alias, group.language);
+            }
+        }
+        return map;
+    }();
+    QString key = name.trimmed().toLower();
+    if (key.startsWith(QLatin1String("language-"))) {
+        key.remove(0, 9);
+    }
+    return languages.value(key, PlainText);
+}
+
+ChatWidgetCodeHighlighter::Language ChatWidgetCodeHighlighter::languageForInfo(const QStringRef& info)
+{
+    const QStringRef trimmed = info.trimmed();
+    int nameEnd = 0;
+    while (nameEnd < trimmed.size() && !trimmed.at(nameEnd).isSpace() && trimmed.at(nameEnd) != QLatin1Char('{')) {
+        ++nameEnd;
+    }
+    return languageForName(trimmed.left(nameEnd).toString());
+}
+
+int ChatWidgetCodeHighlighter::tokenizeLine(const QString& line, Language language, int state,
+                                            QVector<Token>* tokens)
+{
+    const int size = line.size();
+    auto add = [tokens](int start, int end, TokenKind kind) {
+        if (end > start) {
+            tokens->append(Token{start, end - start, kind});
+        }
+    };
+    if (language == PlainText) {
+        return kStateNormal;
+    }
+
+    int pos = 0;
+    if (state == kStateBlockComment) {
+        const int end = line.indexOf(QLatin1String("*/"));
+        if (end < 0) {
+            add(0, size, Comment);
+            return state;
+        }
+        pos = end + 2;
+        add(0, pos, Comment);
+    } else if (state == kStateTripleDouble || state == kStateTripleSingle) {
+        const int end = line.indexOf(state == kStateTripleDouble ? QLatin1String("\"\"\"") : QLatin1String("'''"));
+        if (end < 0) {
+            add(0, size, String);
+            return state;
+        }
+        pos = end + 3;
+        add(0, pos, String);
+    }
+
+    const bool blockComments = language == Cpp || language == Sql;
+    const QSet<QString>& words = keywords(language);
+    bool atLineStart = true; // 当前位置之前只有空白
+    while (pos < size) {
+        const QChar ch = line.at(pos);
+        if (ch.isSpace()) {
+            ++pos;
+            continue;
+        }
+        const int start = pos;
+        const QChar next = pos + 1 < size ? line.at(pos + 1) : QChar();
+        const bool lineStart = atLineStart;
+        atLineStart = false;
+
+        // 注释
+        if ((language == Cpp && ch == QLatin1Char('/') && next == QLatin1Char('/'))
+            || (language == Sql && ch == QLatin1Char('-') && next == QLatin1Char('-'))
+            || (language == Python && ch == QLatin1Char('#'))
+            || (language == Shell && ch == QLatin1Char('#') && (pos == 0 || line.at(pos - 1).isSpace()))) {
+            add(start, size, Comment);
+            return kStateNormal;
+        }
+        if (blockComments && ch == QLatin1Char('/') && next == QLatin1Char('*')) {
+            const int end = line.indexOf(QLatin1String("*/"), pos + 2);
+            if (end < 0) {
+                add(start, size, Comment);
+                return kStateBlockComment;
+            }
+            pos = end + 2;
+            add(start, pos, Comment);
+            continue;
+        }
+
+        // 预处理指令与装饰器
+        if (lineStart && language == Cpp && ch == QLatin1Char('#')) {
+            add(start, size, Meta);
+            return kStateNormal;
+        }
+        if (lineStart && language == Python && ch == QLatin1Char('@')) {
+            ++pos;
+            while (pos < size && (isWordChar(line.at(pos)) || line.at(pos) == QLatin1Char('.'))) {
+                ++pos;
+            }
+            add(start, pos, Meta);
+            continue;
+        }
+
+        // Shell 变量：$name、${...}、$1、$? 等
+        if (language == Shell && ch == QLatin1Char('$') && pos + 1 < size) {
+            if (next == QLatin1Char('{')) {
+                const int end = line.indexOf(QLatin1Char('}'), pos + 2);
+                pos = end < 0 ? size : end + 1;
+            } else if (isWordChar(next)) {
+                pos += 2;
+                while (pos < size && isWordChar(line.at(pos))) {
+                    ++pos;
+                }
+            } else if (QStringLiteral("@#?*$!-").contains(next)) {
+                pos += 2;
+            } else {
+                ++pos;
+                continue;
+            }
+            add(start, pos, Meta);
+            continue;
+        }
+
+        // 字符串
+        const bool quote = ch == QLatin1Char('"') || (ch == QLatin1Char('\'') && language != Json)
+                           || (ch == QLatin1Char('`') && language == Sql);
+        if (quote) {
+            if (language == Python && next == ch && pos + 2 < size && line.at(pos + 2) == ch) {
+                const QLatin1String triple(ch == QLatin1Char('"') ? "\"\"\"" : "'''");
+                const int end = line.indexOf(triple, pos + 3);
+                if (end < 0) {
+                    add(start, size, String);
+                    return ch == QLatin1Char('"') ? kStateTripleDouble : kStateTripleSingle;
+                }
+                pos = end + 3;
+                add(start, pos, String);
+                continue;
+            }
+            pos = stringEnd(line, pos, language);
+            TokenKind kind = String;
+            if (language == Json) {
+                // 后跟冒号的字符串是键
+                int after = pos;
+                while (after < size && line.at(after).isSpace()) {
+                    ++after;
+                }
+                if (after < size && line.at(after) == QLatin1Char(':')) {
+                    kind = Meta;
+                }
+            } else if (language == Sql && ch != QLatin1Char('\'')) {
+                kind = Meta; // 带引号的标识符
+            }
+            add(start, pos, kind);
+            continue;
+        }
+
+        // 数字
+        if (ch.isDigit() || (ch == QLatin1Char('.') && next.isDigit())) {
+            ++pos;
+            while (pos < size) {
+                const QChar c = line.at(pos);
+                const QChar prev = line.at(pos - 1);
+                if (isWordChar(c) || c == QLatin1Char('.') || (language == Cpp && c == QLatin1Char('\''))
+                    || ((c == QLatin1Char('+') || c == QLatin1Char('-'))
+                        && (prev == QLatin1Char('e') || prev == QLatin1Char('E')))) {
+                    ++pos;
+                } else {
+                    break;
+                }
+            }
+            add(start, pos, Number);
+            continue;
+        }
+
+        // 标识符与关键字
+        if (isWordChar(ch)) {
+            while (pos < size && isWordChar(line.at(pos))) {
+                ++pos;
+            }
+            if (language == Python && isPythonStringPrefix(line, start, pos)) {
+                // r"..."、f'...' 等带前缀的字符串：前缀与字符串一起着色
+                const int prefixEnd = pos;
+                const int before = tokens->size();
+                const int endState = tokenizeLine(line.mid(prefixEnd), language, kStateNormal, tokens);
+                // 递归结果的位置相对于前缀之后，平移回整行坐标；首个字符串记号并入前缀
+                for (int i = before; i < tokens->size(); ++i) {
+                    (*tokens)[i].start += prefixEnd;
+                }
+                if (before < tokens->size()) {
+                    Token& first = (*tokens)[before];
+                    first.length += first.start - start;
+                    first.start = start;
+                }
+                return endState;
+            }
+            const QString word = QString::fromRawData(line.constData() + start, pos - start);
+            if (language == Sql ? words.contains(word.toLower()) : words.contains(word)) {
+                add(start, pos, Keyword);
+            }
+            continue;
+        }
+        ++pos;
+    }
+    return kStateNormal;
+}
+
+const ChatWidgetCodeHighlighter::CachedLine& ChatWidgetCodeHighlighter::tokenize(const QString& line,
+                                                                                 Language language, int state)
+{
+    const quint64 key = (quint64(qHash(line)) << 32) | (quint64(line.size() & 0xffffff) << 8)
+                        | (quint64(language & 0xf) << 4) | quint64(state & 0xf);
+    if (const CachedLine* cached = m_lines.object(key)) {
+        if (cached->text == line) {
+            return *cached;
+        }
+    }
+    m_scratch.text = line;
+    m_scratch.tokens.clear();
+    m_scratch.endState = tokenizeLine(line, language, state, &m_scratch.tokens);
+    ++m_tokenizedLines;
+    m_lines.insert(key, new CachedLine(m_scratch));
+    return m_scratch;
+}
+
+void ChatWidgetCodeHighlighter::highlight(QTextDocument* document, const QString& markdown, int from)
+{
+    if (!document || markdown.isEmpty()
+        || (!markdown.contains(QLatin1String("```")) && !markdown.contains(QLatin1String("~~~")))) {
+        return;
+    }
+    const QVector<Fence> fences = fencedBlocks(markdown);
+    int fenceIndex = 0;
+    QTextBlock block = document->findBlock(qMax(0, from));
+    // 按顺序把围栏与文档中的代码块对应：代码块首行与围栏首行一致才视为匹配，
+    // 缩进式代码块等没有对应围栏的 <pre> 会被跳过
+    while (block.isValid() && fenceIndex < fences.size()) {
+        const Fence& fence = fences.at(fenceIndex);
+        if (fence.lineCount == 0) {
+            ++fenceIndex;
+            continue;
+        }
+        if (!isCodeBlock(block) || block.text() != fence.firstLine) {
+            block = block.next();
+            continue;
+        }
+        ++fenceIndex;
+        highlightLines(block, fence.lineCount, fence.language, kStateNormal);
+        for (int i = 0; i < fence.lineCount && block.isValid(); ++i) {
+            block = block.next();
+        }
+    }
+}
+
+int ChatWidgetCodeHighlighter::highlightLines(QTextBlock block, int lineCount, Language language, int state)
+{
+    if (language == PlainText || !block.isValid()) {
+        return state;
+    }
+    // QTextBlock 只提供 const 文档；附加格式不改动内容，与 QSyntaxHighlighter 的做法相同
+    auto* document = const_cast<QTextDocument*>(block.document());
+    int dirtyStart = -1;
+    int dirtyEnd = -1;
+    for (int i = 0; i < lineCount && block.isValid(); ++i, block = block.next()) {
+        const CachedLine& line = tokenize(block.text(), language, state);
+        state = line.endState;
+        QVector<QTextLayout::FormatRange> ranges;
+        ranges.reserve(line.tokens.size());
+        for (const Token& token : line.tokens) {
+            if (m_formats[token.kind].isEmpty()) {
+                continue;
+            }
+            QTextLayout::FormatRange range;
+            range.start = token.start;
+            range.length = token.length;
+            range.format = m_formats[token.kind];
+            ranges.append(range);
+        }
+        block.layout()->setFormats(ranges);
+        if (dirtyStart < 0) {
+            dirtyStart = block.position();
+        }
+        dirtyEnd = block.position() + block.length();
+    }
+    if (dirtyStart >= 0) {
+        // 与 QSyntaxHighlighter 相同：附加格式在重新排版时生效
+        document->markContentsDirty(dirtyStart, dirtyEnd - dirtyStart);
+    }
+    return state;
+}
@@ -0,0 +1,83 @@
+#ifndef CHAT_WIDGET_CODE_HIGHLIGHTER_H
+#define CHAT_WIDGET_CODE_HIGHLIGHTER_H
+
+#include <QCache>
+#include <QString>
+#include <QTextCharFormat>
+#include <QVector>
+#include <QtGlobal>
+
+class QTextBlock;
+class QTextDocument;
+
+// 围栏代码块语法高亮（C++、Python、JSON、Shell、SQL）。逐行扫描并携带跨行状态（块注释、
+// 三引号字符串），每行的记号区间按（语言、行首状态、行文本）缓存，流式追加时只有新行需要扫描。
+// 颜色以 QTextLayout 附加格式（QTextCharFormat）叠加到文档的代码行上，不改动文档内容与 HTML；
+// 格式只改颜色，不影响排版尺寸，预渲染测得的高度仍然有效。
+class ChatWidgetCodeHighlighter {
+public:
+    enum Language {
+        PlainText,
+        Cpp,
+        Python,
+        Json,
+        Shell,
+        Sql
+    };
+
+    enum TokenKind {
+        Keyword,
+        String,
+        Number,
+        Comment,
+        Meta, // 预处理指令、装饰器、Shell 变量、JSON 键
+        TokenKindCount
+    };
+
+    struct Token {
+        int start = 0;
+        int length = 0;
+        TokenKind kind = Keyword;
+    };
+
+    explicit ChatWidgetCodeHighlighter(int cacheLines = 8192);
+
+    // 未设置格式（空格式）的记号不着色
+    void setFormat(TokenKind kind, const QTextCharFormat& format);
+    QTextCharFormat format(TokenKind kind) const;
+
+    // 按 Markdown 源码中的围栏代码块为 document 中 from 位置之后的代码行着色；
+    // markdown 必须是生成该段文档的源码（流式模式下为本次插入的分片）
+    void highlight(QTextDocument* document, const QString& markdown, int from = 0);
+    // 从 block 起为 lineCount 个代码行着色，state 为首行的行首状态，返回末行的行尾状态；
+    // 流式追加未闭合的代码块时只为新行着色
+    int highlightLines(QTextBlock block, int lineCount, Language language, int state);
+
+    // 围栏信息串（如 "cpp"、"py"、"bash"）对应的语言，未知时为 PlainText
+    static Language languageForName(const QString& name);
+    // 围栏开头行中围栏符之后的信息串（如 "cpp {.numberLines}"）对应的语言
+    static Language languageForInfo(const QStringRef& info);
+    // 扫描一行，state 为行首状态（首行为 0），返回行尾状态
+    static int tokenizeLine(const QString& line, Language language, int state, QVector<Token>* tokens);
+
+    int cachedLineCount() const;
+    // 统计：本实例实际扫描（未命中缓存）的行数
+    int tokenizedLineCount() const;
+    void clearCache();
+
+private:
+    struct CachedLine {
+        QString text;
+        QVector<Token> tokens;
+        int endState = 0;
+    };
+
+    const CachedLine& tokenize(const QString& line, Language language, int state);
+
+    QTextCharFormat m_formats[TokenKindCount];
+    QCache<quint64, CachedLine> m_lines;
+    CachedLine m_scratch; // 最近一次扫描的结果（缓存容量为 0 时仍可用）
+    int m_tokenizedLines = 0;
+};
+
+#endif // CHAT_WIDGET_CODE_HIGHLIGHTER_H
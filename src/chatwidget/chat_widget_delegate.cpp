@@ -1,14 +1,25 @@
 #include "chat_widget_delegate.h"
-#include "chat_widget_markdown_utils.h"
+#include "avatar_cache.h"
+#include "chat_widget_code_highlighter.h"
+#include "chat_widget_highlighter.h"
+#include "chat_widget_image_cache.h"
+#include "chat_widget_layout_cache.h"
+#include "chat_widget_markdown_document_builder.h"
 #include "chat_widget_model.h"
+#include "chat_widget_prerenderer.h"
+#include "chat_widget_row_reader.h"
 #include <QAbstractTextDocumentLayout>
 #include <QFontMetrics>
 #include <QPainter>
 #include <QPainterPath>
 #include <QPixmap>
+#include <QTextCharFormat>
+#include <QTextCursor>
 #include <QTextDocument>
 #include <QVariant>
+#include <QWidget>
 #include <QtMath>
+#include <algorithm>
 
 namespace {
 const int kLineSpacing = 6;
@@ -23,6 +34,8 @@ const int kSystemPaddingV = 6;
 const int kFooterTextHPadding = 4;
 const int kFooterTextVPadding = 2;
 const int kFooterBottomSafety = 3;
+const int kLayoutWidthStep = 8;
+const int kTextWidthCacheLimit = 512;
 
 QString formatStatus(ChatWidgetMessage::MessageStatus status)
 {
@@ -48,70 +61,155 @@ QString formatTimestamp(const QDateTime& timestamp)
     return timestamp.toString("HH:mm");
 }
 
-QString applyHighlights(const QString& html, const QStringList& mentions, const QString& keyword,
-                        const ChatWidgetDelegate::Style& style)
+bool isSystemType(ChatWidgetMessage::MessageType type)
 {
-    QString highlighted = html;
-    const QString mentionColor = style.mentionHighlightColor.name();
-    const QString searchColor = style.searchHighlightColor.name();
-
-    for (const QString& mention : mentions) {
-        if (mention.trimmed().isEmpty()) {
-            continue;
-        }
-        const QString replacement =
-            QString("<span style=\"background-color:%1;\">%2</span>").arg(mentionColor, mention);
-        highlighted.replace(mention, replacement, Qt::CaseSensitive);
-    }
+    return type == ChatWidgetMessage::MessageType::System ||
+           type == ChatWidgetMessage::MessageType::DateSeparator;
+}
 
-    if (!keyword.trimmed().isEmpty()) {
-        const QString replacement =
-            QString("<span style=\"background-color:%1;\">%2</span>").arg(searchColor, keyword);
-        highlighted.replace(keyword, replacement, Qt::CaseInsensitive);
-    }
+int textPixelWidth(const QFontMetrics& metrics, const QString& text)
+{
+    return qMax(metrics.horizontalAdvance(text), metrics.boundingRect(text).width());
+}
 
-    return highlighted;
+int layoutTextWidth(int rowWidth)
+{
+    int maxWidth = rowWidth * 0.6;
+    if (maxWidth <= 0)
+        maxWidth = 400;
+    // 文本宽度按档位量化，同一档位内的宽度变化复用已有排版
+    return qMax(kLayoutWidthStep, maxWidth - maxWidth % kLayoutWidthStep);
 }
 
-QList<ChatWidgetReaction> reactionsFromVariant(const QVariant& value)
+bool affectsRowSize(int role)
 {
-    QList<ChatWidgetReaction> reactions;
-    const QVariantList list = value.toList();
-    reactions.reserve(list.size());
-    for (const QVariant& item : list) {
-        const QVariantMap map = item.toMap();
-        const QString emoji = map.value("emoji").toString();
-        if (emoji.isEmpty()) {
-            continue;
-        }
-        ChatWidgetReaction reaction;
-        reaction.emoji = emoji;
-        reaction.count = map.value("count").toInt();
-        reactions.append(reaction);
+    switch (role) {
+    case ChatWidgetModel::ChatWidgetSenderRole:
+    case ChatWidgetModel::ChatWidgetSenderIdRole:
+    case ChatWidgetModel::ChatWidgetIsMineRole:
+    case ChatWidgetModel::ChatWidgetTimestampRole:
+    case ChatWidgetModel::ChatWidgetMessageTypeRole:
+    case ChatWidgetModel::ChatWidgetImagePathRole:
+    case ChatWidgetModel::ChatWidgetFileNameRole:
+    case ChatWidgetModel::ChatWidgetReplyToMessageIdRole:
+    case ChatWidgetModel::ChatWidgetReplySenderRole:
+    case ChatWidgetModel::ChatWidgetReplyPreviewRole:
+    case ChatWidgetModel::ChatWidgetIsForwardedRole:
+    case ChatWidgetModel::ChatWidgetForwardedFromRole:
+    case ChatWidgetModel::ChatWidgetReactionsRole:
+        return true;
+    default:
+        return false;
     }
-    return reactions;
 }
+} // namespace
 
-bool isSystemType(ChatWidgetMessage::MessageType type)
+struct ChatWidgetDelegate::ResolvedStyle {
+    ResolvedStyle(const Style& style, const QPaintDevice* device);
+
+    int timestampWidth(const QString& text) const { return cachedWidth(timestampWidths, timestampMetrics, text); }
+    int statusWidth(const QString& text) const { return cachedWidth(statusWidths, statusMetrics, text); }
+    int reactionWidth(const QString& label) const { return cachedWidth(reactionWidths, reactionMetrics, label); }
+
+    int logicalDpi;
+    QFontMetrics messageMetrics;
+    QFontMetrics systemMetrics;
+    QFontMetrics nameMetrics;
+    QFontMetrics timestampMetrics;
+    QFontMetrics statusMetrics;
+    QFontMetrics reactionMetrics;
+    QFontMetrics replyMetrics;
+
+    int systemBubbleHeight; // 系统消息气泡
+    int systemRowHeight;
+    int nameBlockHeight;    // 昵称行及其与气泡的间距
+    int reactionChipHeight;
+    int timestampTextHeight;
+    int statusTextHeight;
+    int footerBlockHeight;  // 气泡下方时间/状态行占用的高度
+    int minRowHeight;
+
+private:
+    static int cachedWidth(QHash<QString, int>& cache, const QFontMetrics& metrics, const QString& text);
+
+    // 时间、状态与表情回应的取值有限，宽度按文本缓存
+    mutable QHash<QString, int> timestampWidths;
+    mutable QHash<QString, int> statusWidths;
+    mutable QHash<QString, int> reactionWidths;
+};
+
+ChatWidgetDelegate::ResolvedStyle::ResolvedStyle(const Style& style, const QPaintDevice* device)
+    : logicalDpi(device ? device->logicalDpiY() : 0)
+    , messageMetrics(style.messageFont, device)
+    , systemMetrics(style.systemFont, device)
+    , nameMetrics(style.nameFont, device)
+    , timestampMetrics(style.timestampFont, device)
+    , statusMetrics(style.statusFont, device)
+    , reactionMetrics(style.reactionFont, device)
+    , replyMetrics(style.replyFont, device)
 {
-    return type == ChatWidgetMessage::MessageType::System ||
-           type == ChatWidgetMessage::MessageType::DateSeparator;
+    systemBubbleHeight = systemMetrics.height() + kSystemPaddingV * 2;
+    systemRowHeight = systemBubbleHeight + style.margin * 2;
+    nameBlockHeight = nameMetrics.height() + style.nameSpacing;
+    reactionChipHeight = reactionMetrics.height() + kReactionPaddingV * 2;
+    timestampTextHeight = timestampMetrics.height() + kFooterTextVPadding;
+    statusTextHeight = statusMetrics.height() + kFooterTextVPadding;
+    footerBlockHeight = qMax(timestampTextHeight, statusTextHeight) + kLineSpacing + kFooterBottomSafety;
+    minRowHeight = style.avatarSize + style.margin * 2;
 }
 
-int textPixelWidth(const QFontMetrics& metrics, const QString& text)
+int ChatWidgetDelegate::ResolvedStyle::cachedWidth(QHash<QString, int>& cache, const QFontMetrics& metrics,
+                                                   const QString& text)
 {
-    return qMax(metrics.horizontalAdvance(text), metrics.boundingRect(text).width());
+    auto it = cache.constFind(text);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+    if (cache.size() >= kTextWidthCacheLimit) {
+        cache.clear();
+    }
+    const int width = textPixelWidth(metrics, text);
+    cache.insert(text, width);
+    return width;
 }
-} // namespace
 
 ChatWidgetDelegate::ChatWidgetDelegate(QObject* parent)
     : QStyledItemDelegate(parent)
+    , m_resolved(new ResolvedStyle(m_style, nullptr))
+    , m_layoutCache(new ChatWidgetLayoutCache)
+    , m_codeHighlighter(new ChatWidgetCodeHighlighter)
+    , m_imageCache(new ChatWidgetImageCache(this))
+    , m_prerenderer(new ChatWidgetPrerenderer(this))
 {
+    connect(m_imageCache, &ChatWidgetImageCache::thumbnailLoaded, this, &ChatWidgetDelegate::onThumbnailLoaded);
+    connect(m_prerenderer, &ChatWidgetPrerenderer::rendered, this, &ChatWidgetDelegate::onPrerendered);
+    applyCodeFormats();
 }
 
+ChatWidgetDelegate::~ChatWidgetDelegate() { }
+
 void ChatWidgetDelegate::setStyle(const Style& style)
 {
     m_style = style;
+    resolveStyle();
+    applyCodeFormats();
+    // 缓存条目按样式代数懒惰重建，无需立即清空
+    ++m_styleGeneration;
+}
+
+void ChatWidgetDelegate::setMetricsWidget(QWidget* widget)
+{
+    const int previousDpi = m_resolved->logicalDpi;
+    m_metricsWidget = widget;
+    resolveStyle();
+    if (m_resolved->logicalDpi != previousDpi) {
+        ++m_styleGeneration;
+    }
+}
+
+void ChatWidgetDelegate::resolveStyle()
+{
+    m_resolved.reset(new ResolvedStyle(m_style, m_metricsWidget.data()));
 }
 
 ChatWidgetDelegate::Style ChatWidgetDelegate::style() const
@@ -119,55 +217,352 @@ ChatWidgetDelegate::Style ChatWidgetDelegate::style() const
     return m_style;
 }
 
+void ChatWidgetDelegate::setLayoutCacheCapacity(int entries)
+{
+    m_layoutCache->setCapacity(entries);
+}
+
+int ChatWidgetDelegate::layoutCacheCapacity() const
+{
+    return m_layoutCache->capacity();
+}
+
+void ChatWidgetDelegate::clearLayoutCache()
+{
+    m_layoutCache->clear();
+    m_prerenderer->clear();
+}
+
+void ChatWidgetDelegate::remapKeys(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys)
+{
+    m_layoutCache->remap(oldKeys, newKeys);
+    m_prerenderer->remap(oldKeys, newKeys);
+}
+
+bool ChatWidgetDelegate::finishStreaming(const QModelIndex& index)
+{
+    const quint64 key = ChatWidgetRowReader(index).key();
+    ChatWidgetLayoutEntry* entry = key != 0 ? m_layoutCache->find(key) : nullptr;
+    if (!entry || !entry->streamer) {
+        return false;
+    }
+    entry->streamer.reset();
+    // 样式代数清零即在下次排版时重建文档、重新排版并重算高亮
+    entry->styleGeneration = 0;
+    entry->highlightStyleGeneration = 0;
+    entry->sizeHint = QSize();
+    return true;
+}
+
+ChatWidgetImageCache* ChatWidgetDelegate::imageCache() const
+{
+    return m_imageCache;
+}
+
+ChatWidgetCodeHighlighter* ChatWidgetDelegate::codeHighlighter() const
+{
+    return m_codeHighlighter.data();
+}
+
+void ChatWidgetDelegate::applyCodeFormats()
+{
+    // 只设置前景色：不改变字宽，预渲染测得的文档尺寸仍然有效
+    const QColor colors[] = {m_style.codeKeywordColor, m_style.codeStringColor, m_style.codeNumberColor,
+                             m_style.codeCommentColor, m_style.codeMetaColor};
+    for (int kind = 0; kind < ChatWidgetCodeHighlighter::TokenKindCount; ++kind) {
+        QTextCharFormat format;
+        if (colors[kind].isValid()) {
+            format.setForeground(colors[kind]);
+        }
+        m_codeHighlighter->setFormat(static_cast<ChatWidgetCodeHighlighter::TokenKind>(kind), format);
+    }
+}
+
+ChatWidgetPrerenderer* ChatWidgetDelegate::prerenderer() const
+{
+    return m_prerenderer;
+}
+
+void ChatWidgetDelegate::prerenderRows(const QAbstractItemModel* model, int first, int last)
+{
+    if (!model || first > last) {
+        return;
+    }
+    const int textWidth = m_lastTextWidth > 0 ? m_lastTextWidth : layoutTextWidth(0);
+    QVector<ChatWidgetPrerenderer::Request> requests;
+    requests.reserve(last - first + 1);
+    for (int row = first; row <= last; ++row) {
+        const ChatWidgetRowReader reader(model->index(row, 0));
+        if (isSystemType(reader.messageType())) {
+            continue;
+        }
+        ChatWidgetPrerenderer::Request request;
+        request.key = reader.key();
+        request.revision = reader.revision();
+        if (request.key == 0) {
+            continue;
+        }
+        const ChatWidgetLayoutEntry* entry = m_layoutCache->find(request.key);
+        if (entry && entry->revision == request.revision) {
+            continue;
+        }
+        request.source = reader.content();
+        requests.append(request);
+    }
+    if (requests.isEmpty()) {
+        return;
+    }
+    m_prerenderModel = model;
+    m_prerenderer->enqueue(requests, m_style.messageFont, textWidth, m_styleGeneration);
+}
+
+void ChatWidgetDelegate::onPrerendered(const QVector<quint64>& keys)
+{
+    // 按 key 映射回当前行：期间被淘汰或删除的行没有对应行号，直接跳过
+    const auto* model = qobject_cast<const ChatWidgetModel*>(m_prerenderModel.data());
+    if (!model) {
+        return;
+    }
+    QVector<int> rows;
+    rows.reserve(keys.size());
+    for (quint64 key : keys) {
+        const int row = model->rowForKey(key);
+        if (row >= 0 && row < model->rowCount()) {
+            rows.append(row);
+        }
+    }
+    if (rows.isEmpty()) {
+        return;
+    }
+    std::sort(rows.begin(), rows.end());
+    emit rowsPrerendered(rows);
+    // 通用视图据此延迟重新布局；同一事件循环内多次发出会合并
+    emit sizeHintChanged(model->index(rows.first(), 0));
+}
+
+void ChatWidgetDelegate::onThumbnailLoaded(const QString& path)
+{
+    const QList<QPersistentModelIndex> waiters = m_imageWaiters.take(path);
+    for (const QPersistentModelIndex& index : waiters) {
+        if (index.isValid()) {
+            emit rowRepaintRequested(index);
+        }
+    }
+}
+
+void ChatWidgetDelegate::invalidateLayout(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                          const QVector<int>& roles)
+{
+    if (!topLeft.isValid() || !bottomRight.isValid()) {
+        return;
+    }
+
+    // 提及变化需要丢弃整条排版；内容变化由修订号识别（流式追加可增量更新），
+    // 其余角色只影响行高或仅影响绘制
+    const bool dropEntry = roles.isEmpty() || roles.contains(ChatWidgetModel::ChatWidgetMentionsRole);
+    bool resetSize = dropEntry || roles.contains(ChatWidgetModel::ChatWidgetContentRole);
+    for (int i = 0; !resetSize && i < roles.size(); ++i) {
+        resetSize = affectsRowSize(roles.at(i));
+    }
+    if (!resetSize) {
+        return;
+    }
+
+    const QAbstractItemModel* model = topLeft.model();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const quint64 key = ChatWidgetRowReader(model->index(row, 0, topLeft.parent())).key();
+        if (key == 0) {
+            continue;
+        }
+        if (dropEntry) {
+            m_layoutCache->remove(key);
+            m_prerenderer->remove(key);
+        } else {
+            m_layoutCache->invalidateSize(key);
+        }
+    }
+}
+
+ChatWidgetLayoutEntry* ChatWidgetDelegate::layoutEntry(const ChatWidgetRowReader& row, int textWidth,
+                                                       bool needDocument) const
+{
+    const quint64 key = row.key();
+    const quint64 revision = row.revision();
+    ChatWidgetLayoutEntry* entry = key != 0 ? m_layoutCache->find(key) : nullptr;
+    if (entry && entry->revision != revision) {
+        const QString content = row.content();
+        if (!entry->documentDeferred && entry->styleGeneration == m_styleGeneration
+            && appendStreamingContent(entry, content)) {
+            entry->revision = revision;
+        } else {
+            entry = nullptr;
+        }
+    }
+    if (!entry && !needDocument && key != 0 && m_prerenderer->isPending(key, revision)) {
+        // 后台预渲染尚未完成：按行数粗估文档高度，结果到达后视图会重新布局
+        const QString content = row.content();
+        const QFontMetrics& metrics = m_resolved->messageMetrics;
+        const int wrapped = metrics.averageCharWidth() * content.size() / qMax(1, textWidth);
+        m_scratchEntry.reset(new ChatWidgetLayoutEntry);
+        m_scratchEntry->widthBucket = textWidth;
+        m_scratchEntry->documentSize = QSize(textWidth, (content.count(QLatin1Char('\n')) + 1 + wrapped)
+                                                            * metrics.lineSpacing());
+        return m_scratchEntry.data();
+    }
+    if (!entry) {
+        entry = key != 0 ? m_layoutCache->create(key) : nullptr;
+        if (!entry) {
+            // 非 ChatWidgetModel 或缓存被禁用：使用一次性条目
+            m_scratchEntry.reset(new ChatWidgetLayoutEntry);
+            entry = m_scratchEntry.data();
+        }
+        entry->revision = revision;
+        entry->source = row.content();
+        ChatWidgetPrerenderer::Result prerendered;
+        if (key != 0 && m_prerenderer->find(key, revision, &prerendered)
+            && prerendered.styleGeneration == m_styleGeneration && prerendered.textWidth == textWidth) {
+            entry->styleGeneration = m_styleGeneration;
+            entry->widthBucket = textWidth;
+            entry->documentSize = prerendered.documentSize;
+            // 接管后台线程构建好的文档，GUI 线程只需叠加代码高亮（只改颜色，不影响尺寸）；
+            // 超出保留上限而被丢弃的，绘制前再补建
+            if (QSharedPointer<QTextDocument> document = m_prerenderer->takeDocument(key)) {
+                entry->document = document;
+                m_codeHighlighter->highlight(entry->document.data(), entry->source);
+            } else {
+                entry->documentDeferred = true;
+            }
+        }
+    }
+
+    if (entry->documentDeferred) {
+        if (!needDocument && entry->styleGeneration == m_styleGeneration && entry->widthBucket == textWidth) {
+            return entry;
+        }
+        // 需要绘制或排版条件已变化：按当前样式补建文档
+        entry->documentDeferred = false;
+        entry->styleGeneration = 0;
+    }
+
+    if (entry->styleGeneration != m_styleGeneration) {
+        entry->document->setDefaultFont(m_style.messageFont);
+        if (entry->streamer) {
+            entry->streamer->reset(entry->source);
+        } else {
+            ChatWidgetMarkdownDocumentBuilder::build(entry->source, entry->document.data());
+            m_codeHighlighter->highlight(entry->document.data(), entry->source);
+        }
+        entry->styleGeneration = m_styleGeneration;
+        entry->widthBucket = 0;
+    }
+
+    if (entry->widthBucket != textWidth) {
+        entry->document->setTextWidth(textWidth);
+        entry->widthBucket = textWidth;
+        updateDocumentSize(entry);
+    }
+    return entry;
+}
+
+void ChatWidgetDelegate::updateHighlights(ChatWidgetLayoutEntry* entry, const ChatWidgetRowReader& row) const
+{
+    const QString keyword = row.searchKeyword();
+    if (entry->highlightStyleGeneration == m_styleGeneration && entry->highlightRevision == entry->revision
+        && entry->highlightKeyword == keyword) {
+        return;
+    }
+    entry->highlights.clear();
+    entry->highlightKeyword = keyword;
+    entry->highlightRevision = entry->revision;
+    entry->highlightStyleGeneration = m_styleGeneration;
+
+    const ChatWidgetHighlighter highlighter(row.mentions(), keyword);
+    if (highlighter.isEmpty()) {
+        return;
+    }
+    // 在文档纯文本上匹配，位置与文档光标位置一一对应
+    const QVector<ChatWidgetHighlighter::Match> matches = highlighter.match(entry->document->toRawText());
+    QTextCharFormat mentionFormat;
+    mentionFormat.setBackground(m_style.mentionHighlightColor);
+    QTextCharFormat keywordFormat;
+    keywordFormat.setBackground(m_style.searchHighlightColor);
+    // 先提及后关键字，重叠处以搜索高亮为准
+    for (const ChatWidgetHighlighter::Kind kind : {ChatWidgetHighlighter::Mention, ChatWidgetHighlighter::Keyword}) {
+        for (const ChatWidgetHighlighter::Match& match : matches) {
+            if (match.kind != kind) {
+                continue;
+            }
+            QAbstractTextDocumentLayout::Selection selection;
+            selection.cursor = QTextCursor(entry->document.data());
+            selection.cursor.setPosition(match.start);
+            selection.cursor.setPosition(match.start + match.length, QTextCursor::KeepAnchor);
+            selection.format = kind == ChatWidgetHighlighter::Mention ? mentionFormat : keywordFormat;
+            entry->highlights.append(selection);
+        }
+    }
+}
+
+bool ChatWidgetDelegate::appendStreamingContent(ChatWidgetLayoutEntry* entry, const QString& content) const
+{
+    if (!entry->streamer) {
+        // 首次出现尾部追加时转入流式模式，之后每次只重排末尾未闭合的块
+        if (content.size() <= entry->source.size() || !content.startsWith(entry->source)) {
+            return false;
+        }
+        entry->streamer.reset(new ChatWidgetStreamingRenderer(entry->document.data(), m_codeHighlighter.data()));
+        entry->streamer->reset(content);
+    } else if (!entry->streamer->append(content)) {
+        return false;
+    }
+    entry->source = content;
+    // 文档保持原排版宽度，仅增量排版新增部分
+    updateDocumentSize(entry);
+    return true;
+}
+
+void ChatWidgetDelegate::updateDocumentSize(ChatWidgetLayoutEntry* entry) const
+{
+    entry->documentSize = QSize(qMin(entry->widthBucket, qCeil(entry->document->idealWidth())),
+                                qCeil(entry->document->size().height()));
+    entry->sizeHint = QSize();
+}
+
 QSize ChatWidgetDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
-    const auto type = static_cast<ChatWidgetMessage::MessageType>(
-        index.data(ChatWidgetModel::ChatWidgetMessageTypeRole).toInt());
-    const QString content = index.data(ChatWidgetModel::ChatWidgetContentRole).toString();
-    const QDateTime timestamp = index.data(ChatWidgetModel::ChatWidgetTimestampRole).toDateTime();
+    const ChatWidgetRowReader row(index);
+    const auto type = row.messageType();
+    const QDateTime timestamp = row.timestamp();
     if (isSystemType(type)) {
+        const QString content = row.content();
         const QString text = content.isEmpty() && timestamp.isValid()
             ? timestamp.toString("yyyy-MM-dd")
             : content;
-        QFontMetrics sysMetrics(m_style.systemFont);
-        const int textWidth = sysMetrics.horizontalAdvance(text);
+        const int textWidth = m_resolved->systemMetrics.horizontalAdvance(text);
         const int maxWidth = option.rect.width() > 0 ? option.rect.width() * 0.8 : 400;
         const int finalWidth = qMin(maxWidth, textWidth + kSystemPaddingH * 2);
-        const int height = sysMetrics.height() + kSystemPaddingV * 2 + m_style.margin * 2;
-        return QSize(finalWidth, height);
+        return QSize(finalWidth, m_resolved->systemRowHeight);
     }
 
-    QString html = ChatWidgetMarkdownUtils::renderMarkdown(content);
-    const QStringList mentions = index.data(ChatWidgetModel::ChatWidgetMentionsRole).toStringList();
-    const QString searchKeyword = index.data(ChatWidgetModel::ChatWidgetSearchKeywordRole).toString();
-    html = applyHighlights(html, mentions, searchKeyword, m_style);
-
-    int maxWidth = option.rect.width() * 0.6;
-    if (maxWidth <= 0)
-        maxWidth = 400;
-
-    QTextDocument doc;
-    doc.setDefaultFont(m_style.messageFont);
-    doc.setHtml(html);
-    doc.setTextWidth(maxWidth);
-
-    const int docHeight = qCeil(doc.size().height());
+    const int textWidth = layoutTextWidth(option.rect.width());
+    m_lastTextWidth = textWidth;
+    ChatWidgetLayoutEntry* entry = layoutEntry(row, textWidth, false);
+    if (entry->sizeHint.isValid()) {
+        return QSize(option.rect.width(), entry->sizeHint.height());
+    }
 
-    const bool isMine = index.data(ChatWidgetModel::ChatWidgetIsMineRole).toBool();
-    const QString senderName = index.data(ChatWidgetModel::ChatWidgetSenderRole).toString();
-    const QString senderId = index.data(ChatWidgetModel::ChatWidgetSenderIdRole).toString();
-    const QString imagePath = index.data(ChatWidgetModel::ChatWidgetImagePathRole).toString();
-    const QString fileName = index.data(ChatWidgetModel::ChatWidgetFileNameRole).toString();
-    const bool hasImage = !imagePath.isEmpty() || type == ChatWidgetMessage::MessageType::Image;
-    const bool hasFile = !fileName.isEmpty() || type == ChatWidgetMessage::MessageType::File;
+    entry->sizeHint = QSize(option.rect.width(), rowHeight(row, entry->documentSize.height()));
+    return entry->sizeHint;
+}
 
-    const QString replySender = index.data(ChatWidgetModel::ChatWidgetReplySenderRole).toString();
-    const QString replyPreview = index.data(ChatWidgetModel::ChatWidgetReplyPreviewRole).toString();
-    const QString replyId = index.data(ChatWidgetModel::ChatWidgetReplyToMessageIdRole).toString();
-    const bool isForwarded = index.data(ChatWidgetModel::ChatWidgetIsForwardedRole).toBool();
-    const QString forwardedFrom = index.data(ChatWidgetModel::ChatWidgetForwardedFromRole).toString();
-    const bool hasReply = !replySender.isEmpty() || !replyPreview.isEmpty() || !replyId.isEmpty();
-    const bool hasForward = isForwarded || !forwardedFrom.isEmpty();
+int ChatWidgetDelegate::rowHeight(const ChatWidgetRowReader& row, int documentHeight) const
+{
+    const auto type = row.messageType();
+    const bool isMine = row.isMine();
+    const bool hasImage = !row.imagePath().isEmpty() || type == ChatWidgetMessage::MessageType::Image;
+    const bool hasFile = !row.fileName().isEmpty() || type == ChatWidgetMessage::MessageType::File;
+    const bool hasReply =
+        !row.replySender().isEmpty() || !row.replyPreview().isEmpty() || !row.replyToMessageId().isEmpty();
+    const bool hasForward = row.isForwarded() || !row.forwardedFrom().isEmpty();
 
     int attachmentHeight = 0;
     if (hasImage) {
@@ -178,26 +573,13 @@ QSize ChatWidgetDelegate::sizeHint(const QStyleOptionViewItem& option, const QMo
 
     int replyHeight = 0;
     if (hasReply || hasForward) {
-        QFontMetrics replyMetrics(m_style.replyFont);
-        int lines = 0;
-        if (hasForward) {
-            lines += 1;
-        }
-        if (hasReply) {
-            lines += 1;
-        }
-        replyHeight = lines * replyMetrics.height() + kReplyPadding * 2;
+        const int lines = (hasForward ? 1 : 0) + (hasReply ? 1 : 0);
+        replyHeight = lines * m_resolved->replyMetrics.height() + kReplyPadding * 2;
     }
 
-    const QList<ChatWidgetReaction> reactions =
-        reactionsFromVariant(index.data(ChatWidgetModel::ChatWidgetReactionsRole));
-    int reactionHeight = 0;
-    if (!reactions.isEmpty()) {
-        QFontMetrics reactionMetrics(m_style.reactionFont);
-        reactionHeight = reactionMetrics.height() + kReactionPaddingV * 2;
-    }
+    const int reactionHeight = row.reactions().isEmpty() ? 0 : m_resolved->reactionChipHeight;
 
-    int contentHeight = docHeight;
+    int contentHeight = documentHeight;
     if (replyHeight > 0) {
         contentHeight += replyHeight + kLineSpacing;
     }
@@ -209,21 +591,153 @@ QSize ChatWidgetDelegate::sizeHint(const QStyleOptionViewItem& option, const QMo
     }
 
     int totalHeight = contentHeight + (m_style.bubblePadding * 2) + (m_style.margin * 2);
-    if (!isMine && !senderId.isEmpty() && !senderName.isEmpty()) {
-        QFontMetrics nameMetrics(m_style.nameFont);
-        totalHeight += nameMetrics.height() + m_style.nameSpacing;
+    if (!isMine && !row.senderId().isEmpty() && !row.sender().isEmpty()) {
+        totalHeight += m_resolved->nameBlockHeight;
     }
 
-    const QString timestampText = formatTimestamp(timestamp);
-    if (!timestampText.isEmpty() || isMine) {
-        QFontMetrics timestampMetrics(m_style.timestampFont);
-        QFontMetrics statusMetrics(m_style.statusFont);
-        const int footerTextHeight =
-            qMax(timestampMetrics.height(), statusMetrics.height()) + kFooterTextVPadding;
-        totalHeight += footerTextHeight + kLineSpacing + kFooterBottomSafety;
+    if (row.timestamp().isValid() || isMine) {
+        totalHeight += m_resolved->footerBlockHeight;
     }
 
-    return QSize(option.rect.width(), qMax(totalHeight, m_style.avatarSize + m_style.margin * 2));
+    return qMax(totalHeight, m_resolved->minRowHeight);
+}
+
+int ChatWidgetDelegate::textLayoutWidth(int rowWidth)
+{
+    return layoutTextWidth(rowWidth);
+}
+
+int ChatWidgetDelegate::estimatedHeight(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    const ChatWidgetRowReader row(index);
+    const auto type = row.messageType();
+    if (isSystemType(type)) {
+        return m_resolved->systemRowHeight;
+    }
+    const quint64 key = row.key();
+    if (const ChatWidgetLayoutEntry* entry = key != 0 ? m_layoutCache->find(key) : nullptr) {
+        if (entry->sizeHint.isValid() && entry->revision == row.revision()) {
+            return entry->sizeHint.height();
+        }
+    }
+    const int textWidth = layoutTextWidth(option.rect.width());
+    // 后台预渲染已测得文档尺寸：视口外的行也能以实际高度计入滚动范围
+    ChatWidgetPrerenderer::Result prerendered;
+    if (key != 0 && m_prerenderer->find(key, row.revision(), &prerendered)
+        && prerendered.styleGeneration == m_styleGeneration && prerendered.textWidth == textWidth) {
+        return rowHeight(row, prerendered.documentSize.height());
+    }
+
+    const QString content = row.content();
+    const QFontMetrics& metrics = m_resolved->messageMetrics;
+    const int lines = content.isEmpty()
+        ? 0
+        : content.count(QLatin1Char('\n')) + 1 + metrics.averageCharWidth() * content.size() / textWidth;
+    int height = lines * metrics.lineSpacing() + m_style.bubblePadding * 2 + m_style.margin * 2;
+    if (type == ChatWidgetMessage::MessageType::Image) {
+        height += kAttachmentHeight + kLineSpacing;
+    } else if (type == ChatWidgetMessage::MessageType::File) {
+        height += kFileCardHeight + kLineSpacing;
+    }
+    if (!row.isMine()) {
+        height += m_resolved->nameBlockHeight;
+    }
+    height += m_resolved->footerBlockHeight;
+    return qMax(height, m_resolved->minRowHeight);
+}
+
+bool ChatWidgetDelegate::isSizeCached(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    const ChatWidgetRowReader row(index);
+    const quint64 key = row.key();
+    // 非 ChatWidgetModel 的行无法缓存，按已就绪处理，避免反复推迟
+    if (key == 0 || isSystemType(row.messageType())) {
+        return true;
+    }
+    const quint64 revision = row.revision();
+    const int textWidth = layoutTextWidth(option.rect.width());
+    if (const ChatWidgetLayoutEntry* entry = m_layoutCache->find(key)) {
+        if (entry->revision == revision || entry->streamer) {
+            return entry->styleGeneration == m_styleGeneration && entry->widthBucket == textWidth;
+        }
+    }
+    if (m_prerenderer->isPending(key, revision)) {
+        return true;
+    }
+    ChatWidgetPrerenderer::Result prerendered;
+    return m_prerenderer->find(key, revision, &prerendered) && prerendered.styleGeneration == m_styleGeneration
+        && prerendered.textWidth == textWidth;
+}
+
+bool ChatWidgetDelegate::isLayoutCached(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    const ChatWidgetRowReader row(index);
+    const quint64 key = row.key();
+    if (key == 0 || isSystemType(row.messageType())) {
+        return true;
+    }
+    const ChatWidgetLayoutEntry* entry = m_layoutCache->find(key);
+    // 流式追加只增量排版末尾，视为已就绪
+    return entry && (entry->revision == row.revision() || entry->streamer) && !entry->documentDeferred
+        && entry->styleGeneration == m_styleGeneration && entry->widthBucket == layoutTextWidth(option.rect.width());
+}
+
+void ChatWidgetDelegate::prepareLayout(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    const ChatWidgetRowReader row(index);
+    if (!isSystemType(row.messageType())) {
+        layoutEntry(row, layoutTextWidth(option.rect.width()));
+    }
+}
+
+void ChatWidgetDelegate::paintSkeleton(QPainter* painter, const QStyleOptionViewItem& option,
+                                       const QModelIndex& index) const
+{
+    const ChatWidgetRowReader row(index);
+    const bool isMine = row.isMine();
+    const QRect rect = option.rect;
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(Qt::NoPen);
+    const QRect avatarRect = this->avatarRect(rect, isMine);
+    painter->setBrush(isMine ? m_style.myAvatarColor : m_style.otherAvatarColor);
+    painter->drawEllipse(avatarRect);
+
+    // 气泡按当前行高（估算或已测量）占位，宽度按正文长度粗估
+    int top = rect.top() + m_style.margin;
+    if (!isMine && !row.senderId().isEmpty() && !row.sender().isEmpty()) {
+        top += m_resolved->nameBlockHeight;
+    }
+    const int bottom = rect.bottom() - m_style.margin - m_resolved->footerBlockHeight;
+    const QFontMetrics& metrics = m_resolved->messageMetrics;
+    const int textWidth = layoutTextWidth(rect.width());
+    const int lineWidth = qBound(metrics.averageCharWidth() * 4, metrics.averageCharWidth() * row.content().size(),
+                                 textWidth);
+    const int bubbleWidth = lineWidth + m_style.bubblePadding * 2;
+    const int bubbleHeight = qMax(bottom - top, metrics.lineSpacing() + m_style.bubblePadding * 2);
+    const QRect bubbleRect = isMine
+        ? QRect(avatarRect.left() - m_style.margin - bubbleWidth, top, bubbleWidth, bubbleHeight)
+        : QRect(avatarRect.right() + m_style.margin, top, bubbleWidth, bubbleHeight);
+    painter->setBrush(isMine ? m_style.myBubbleColor : m_style.otherBubbleColor);
+    painter->drawRoundedRect(bubbleRect, m_style.bubbleRadius, m_style.bubbleRadius);
+
+    // 文本条：每行一条，最后一行缩短
+    QColor barColor = m_style.nameColor;
+    barColor.setAlpha(60);
+    painter->setBrush(barColor);
+    const QRect textRect = bubbleRect.adjusted(m_style.bubblePadding, m_style.bubblePadding, -m_style.bubblePadding,
+                                               -m_style.bubblePadding);
+    const int lineHeight = metrics.lineSpacing();
+    const int barHeight = qMax(4, metrics.height() / 2);
+    const int lines = qMax(1, textRect.height() / lineHeight);
+    for (int i = 0; i < lines; ++i) {
+        const int width = i == lines - 1 && lines > 1 ? textRect.width() * 2 / 3 : textRect.width();
+        const QRect bar(textRect.left(), textRect.top() + i * lineHeight + (lineHeight - barHeight) / 2, width,
+                        barHeight);
+        painter->drawRoundedRect(bar, barHeight / 2.0, barHeight / 2.0);
+    }
+    painter->restore();
 }
 
 void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
@@ -231,21 +745,20 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
     painter->save();
     painter->setRenderHint(QPainter::Antialiasing);
 
-    const auto type = static_cast<ChatWidgetMessage::MessageType>(
-        index.data(ChatWidgetModel::ChatWidgetMessageTypeRole).toInt());
-    const bool isMine = index.data(ChatWidgetModel::ChatWidgetIsMineRole).toBool();
-    const QString content = index.data(ChatWidgetModel::ChatWidgetContentRole).toString();
-    const QDateTime timestamp = index.data(ChatWidgetModel::ChatWidgetTimestampRole).toDateTime();
+    const ChatWidgetRowReader row(index);
+    const auto type = row.messageType();
+    const bool isMine = row.isMine();
+    const QString content = row.content();
+    const QDateTime timestamp = row.timestamp();
 
     if (isSystemType(type)) {
         const QString text = content.isEmpty() && timestamp.isValid()
             ? timestamp.toString("yyyy-MM-dd")
             : content;
-        QFontMetrics sysMetrics(m_style.systemFont);
-        const int textWidth = sysMetrics.horizontalAdvance(text);
+        const int textWidth = m_resolved->systemMetrics.horizontalAdvance(text);
         const int maxWidth = option.rect.width() > 0 ? option.rect.width() * 0.8 : 400;
         const int bubbleWidth = qMin(maxWidth, textWidth + kSystemPaddingH * 2);
-        const int bubbleHeight = sysMetrics.height() + kSystemPaddingV * 2;
+        const int bubbleHeight = m_resolved->systemBubbleHeight;
         const int centerX = option.rect.center().x() - bubbleWidth / 2;
         const int centerY = option.rect.center().y() - bubbleHeight / 2;
         QRect bubbleRect(centerX, centerY, bubbleWidth, bubbleHeight);
@@ -259,36 +772,22 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
         return;
     }
 
-    QString html = ChatWidgetMarkdownUtils::renderMarkdown(content);
-    const QStringList mentions = index.data(ChatWidgetModel::ChatWidgetMentionsRole).toStringList();
-    const QString searchKeyword = index.data(ChatWidgetModel::ChatWidgetSearchKeywordRole).toString();
-    html = applyHighlights(html, mentions, searchKeyword, m_style);
-
     QRect rect = option.rect;
-    int maxWidth = rect.width() * 0.6;
-    if (maxWidth <= 0)
-        maxWidth = 400;
-
-    QTextDocument doc;
-    doc.setDefaultFont(m_style.messageFont);
-    doc.setHtml(html);
-    doc.setTextWidth(maxWidth);
+    ChatWidgetLayoutEntry* entry = layoutEntry(row, layoutTextWidth(rect.width()));
+    const QSize docSize = entry->documentSize;
+    const int docWidth = docSize.width();
 
-    const int docWidth = qMin(maxWidth, qCeil(doc.idealWidth()));
-    const int docHeight = qCeil(doc.size().height());
-    const QSize docSize(docWidth, docHeight);
-
-    const QString imagePath = index.data(ChatWidgetModel::ChatWidgetImagePathRole).toString();
-    const QString fileName = index.data(ChatWidgetModel::ChatWidgetFileNameRole).toString();
-    const qint64 fileSize = index.data(ChatWidgetModel::ChatWidgetFileSizeRole).toLongLong();
+    const QString imagePath = row.imagePath();
+    const QString fileName = row.fileName();
+    const qint64 fileSize = row.fileSize();
     const bool hasImage = !imagePath.isEmpty() || type == ChatWidgetMessage::MessageType::Image;
     const bool hasFile = !fileName.isEmpty() || type == ChatWidgetMessage::MessageType::File;
 
-    const QString replySender = index.data(ChatWidgetModel::ChatWidgetReplySenderRole).toString();
-    const QString replyPreview = index.data(ChatWidgetModel::ChatWidgetReplyPreviewRole).toString();
-    const QString replyId = index.data(ChatWidgetModel::ChatWidgetReplyToMessageIdRole).toString();
-    const bool isForwarded = index.data(ChatWidgetModel::ChatWidgetIsForwardedRole).toBool();
-    const QString forwardedFrom = index.data(ChatWidgetModel::ChatWidgetForwardedFromRole).toString();
+    const QString replySender = row.replySender();
+    const QString replyPreview = row.replyPreview();
+    const QString replyId = row.replyToMessageId();
+    const bool isForwarded = row.isForwarded();
+    const QString forwardedFrom = row.forwardedFrom();
     const bool hasReply = !replySender.isEmpty() || !replyPreview.isEmpty() || !replyId.isEmpty();
     const bool hasForward = isForwarded || !forwardedFrom.isEmpty();
 
@@ -304,41 +803,26 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
 
     int replyHeight = 0;
     if (hasReply || hasForward) {
-        QFontMetrics replyMetrics(m_style.replyFont);
-        int lines = 0;
-        if (hasForward) {
-            lines += 1;
-        }
-        if (hasReply) {
-            lines += 1;
-        }
-        replyHeight = lines * replyMetrics.height() + kReplyPadding * 2;
+        const int lines = (hasForward ? 1 : 0) + (hasReply ? 1 : 0);
+        replyHeight = lines * m_resolved->replyMetrics.height() + kReplyPadding * 2;
     }
 
-    const QList<ChatWidgetReaction> reactions =
-        reactionsFromVariant(index.data(ChatWidgetModel::ChatWidgetReactionsRole));
-    int reactionHeight = 0;
-    if (!reactions.isEmpty()) {
-        QFontMetrics reactionMetrics(m_style.reactionFont);
-        reactionHeight = reactionMetrics.height() + kReactionPaddingV * 2;
-    }
+    const QList<ChatWidgetReaction> reactions = row.reactions();
+    const int reactionHeight = reactions.isEmpty() ? 0 : m_resolved->reactionChipHeight;
 
     // 绘制头像
-    QRect avatarRect = this->avatarRect(option, index);
-    const QString avatarPath = index.data(ChatWidgetModel::ChatWidgetAvatarRole).toString();
-    const QString senderName = index.data(ChatWidgetModel::ChatWidgetSenderRole).toString();
-    const QString senderId = index.data(ChatWidgetModel::ChatWidgetSenderIdRole).toString();
+    QRect avatarRect = this->avatarRect(rect, isMine);
+    const QString avatarPath = row.avatarPath();
+    const QString senderName = row.sender();
+    const QString senderId = row.senderId();
 
     painter->setPen(Qt::NoPen);
     bool drawAvatarText = true;
     if (!avatarPath.isEmpty()) {
-        QPixmap avatarPixmap(avatarPath);
+        const QPixmap avatarPixmap = AvatarCache::instance()->avatar(
+            avatarPath, avatarRect.width(), AvatarCache::Circle, 0, painter->device()->devicePixelRatioF());
         if (!avatarPixmap.isNull()) {
-            QPainterPath clipPath;
-            clipPath.addEllipse(avatarRect);
-            painter->setClipPath(clipPath);
-            painter->drawPixmap(avatarRect, avatarPixmap);
-            painter->setClipping(false);
+            painter->drawPixmap(avatarRect.topLeft(), avatarPixmap);
             drawAvatarText = false;
         } else {
             painter->setBrush(isMine ? m_style.myAvatarColor : m_style.otherAvatarColor);
@@ -377,8 +861,7 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
     if (!isMine && !senderId.isEmpty() && !senderName.isEmpty()) {
         painter->setPen(m_style.nameColor);
         painter->setFont(m_style.nameFont);
-        QFontMetrics nameMetrics(m_style.nameFont);
-        const int nameHeight = nameMetrics.height();
+        const int nameHeight = m_resolved->nameMetrics.height();
         QRect nameRect(avatarRect.right() + m_style.margin, contentTop,
                        rect.right() - avatarRect.right() - m_style.margin * 2, nameHeight);
         painter->drawText(nameRect, Qt::AlignLeft | Qt::AlignVCenter, senderName);
@@ -416,7 +899,7 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
         painter->setPen(m_style.replyTextColor);
         painter->setFont(m_style.replyFont);
         int textY = replyRect.top() + kReplyPadding;
-        QFontMetrics replyMetrics(m_style.replyFont);
+        const QFontMetrics& replyMetrics = m_resolved->replyMetrics;
         const int textWidth = replyRect.width() - kReplyPadding * 2;
         if (hasForward) {
             const QString forwardLabel = forwardedFrom.isEmpty()
@@ -448,7 +931,15 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
         painter->drawRoundedRect(attachRect, 6, 6);
 
         if (hasImage) {
-            QPixmap image(imagePath);
+            // 缩略图在后台解码，未就绪时先画占位卡片，完成后只重绘本行
+            const qreal dpr = painter->device()->devicePixelRatioF();
+            const QPixmap image = m_imageCache->thumbnail(imagePath, attachRect.size(), dpr);
+            if (image.isNull() && m_imageCache->isPending(imagePath, attachRect.size(), dpr)) {
+                QList<QPersistentModelIndex>& waiters = m_imageWaiters[imagePath];
+                if (!waiters.contains(index)) {
+                    waiters.append(index);
+                }
+            }
             if (!image.isNull()) {
                 QPainterPath clipPath;
                 clipPath.addRoundedRect(attachRect, 6, 6);
@@ -464,7 +955,7 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
         } else if (hasFile) {
             painter->setPen(m_style.replyTextColor);
             painter->setFont(m_style.replyFont);
-            QFontMetrics fileMetrics(m_style.replyFont);
+            const QFontMetrics& fileMetrics = m_resolved->replyMetrics;
             const int textWidth = attachRect.width() - kReplyPadding * 2;
             const QString nameText = fileMetrics.elidedText(fileName, Qt::ElideRight, textWidth);
             const QString sizeText = fileSize > 0
@@ -485,7 +976,12 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
         painter->save();
         painter->translate(innerRect.left(), cursorY);
         QRectF clip(0, 0, innerRect.width(), docSize.height());
-        doc.drawContents(painter, clip);
+        updateHighlights(entry, row);
+        QAbstractTextDocumentLayout::PaintContext context;
+        context.clip = clip;
+        context.selections = entry->highlights;
+        painter->setClipRect(clip);
+        entry->document->documentLayout()->draw(painter, context);
         painter->restore();
         cursorY += docSize.height();
     }
@@ -493,14 +989,13 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
     if (!reactions.isEmpty()) {
         cursorY += kLineSpacing;
         painter->setFont(m_style.reactionFont);
-        QFontMetrics reactionMetrics(m_style.reactionFont);
         int x = innerRect.left();
-        const int chipHeight = reactionMetrics.height() + kReactionPaddingV * 2;
+        const int chipHeight = m_resolved->reactionChipHeight;
         for (const ChatWidgetReaction& reaction : reactions) {
             const QString label = reaction.count > 0
                 ? QString("%1 %2").arg(reaction.emoji).arg(reaction.count)
                 : reaction.emoji;
-            const int chipWidth = reactionMetrics.horizontalAdvance(label) + kReactionPaddingH * 2;
+            const int chipWidth = m_resolved->reactionWidth(label) + kReactionPaddingH * 2;
             QRect chipRect(x, cursorY, chipWidth, chipHeight);
             painter->setPen(Qt::NoPen);
             painter->setBrush(m_style.reactionChipColor);
@@ -515,21 +1010,16 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
     }
 
     const QString timestampText = formatTimestamp(timestamp);
-    const QString statusText = isMine ? formatStatus(static_cast<ChatWidgetMessage::MessageStatus>(
-                                    index.data(ChatWidgetModel::ChatWidgetMessageStatusRole).toInt()))
-                                      : QString();
+    const QString statusText = isMine ? formatStatus(row.status()) : QString();
     if (!timestampText.isEmpty() || !statusText.isEmpty()) {
         const int footerY = bubbleRect.bottom() + kLineSpacing + 1;
         if (isMine) {
-            painter->setFont(m_style.statusFont);
-            QFontMetrics statusMetrics(m_style.statusFont);
             int textX = bubbleRect.right() + 1;
             if (!timestampText.isEmpty()) {
                 painter->setFont(m_style.timestampFont);
                 painter->setPen(m_style.timestampColor);
-                QFontMetrics tsMetrics(m_style.timestampFont);
-                const int tsWidth = textPixelWidth(tsMetrics, timestampText) + kFooterTextHPadding;
-                const int tsHeight = tsMetrics.height() + kFooterTextVPadding;
+                const int tsWidth = m_resolved->timestampWidth(timestampText) + kFooterTextHPadding;
+                const int tsHeight = m_resolved->timestampTextHeight;
                 QRect tsRect(textX - tsWidth, footerY, tsWidth, tsHeight);
                 painter->drawText(tsRect, Qt::AlignRight | Qt::AlignVCenter, timestampText);
                 textX = tsRect.left() - 6;
@@ -537,18 +1027,16 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
             if (!statusText.isEmpty()) {
                 painter->setFont(m_style.statusFont);
                 painter->setPen(m_style.statusColor);
-                const int statusWidth =
-                    textPixelWidth(statusMetrics, statusText) + kFooterTextHPadding;
-                const int statusHeight = statusMetrics.height() + kFooterTextVPadding;
+                const int statusWidth = m_resolved->statusWidth(statusText) + kFooterTextHPadding;
+                const int statusHeight = m_resolved->statusTextHeight;
                 QRect statusRect(textX - statusWidth, footerY, statusWidth, statusHeight);
                 painter->drawText(statusRect, Qt::AlignRight | Qt::AlignVCenter, statusText);
             }
         } else if (!timestampText.isEmpty()) {
             painter->setFont(m_style.timestampFont);
             painter->setPen(m_style.timestampColor);
-            QFontMetrics tsMetrics(m_style.timestampFont);
-            const int tsWidth = textPixelWidth(tsMetrics, timestampText) + kFooterTextHPadding;
-            const int tsHeight = tsMetrics.height() + kFooterTextVPadding;
+            const int tsWidth = m_resolved->timestampWidth(timestampText) + kFooterTextHPadding;
+            const int tsHeight = m_resolved->timestampTextHeight;
             QRect tsRect(bubbleRect.left(), footerY, tsWidth, tsHeight);
             painter->drawText(tsRect, Qt::AlignLeft | Qt::AlignVCenter, timestampText);
         }
@@ -559,8 +1047,11 @@ void ChatWidgetDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
 
 QRect ChatWidgetDelegate::avatarRect(const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
-    const bool isMine = index.data(ChatWidgetModel::ChatWidgetIsMineRole).toBool();
-    const QRect rect = option.rect;
+    return avatarRect(option.rect, ChatWidgetRowReader(index).isMine());
+}
+
+QRect ChatWidgetDelegate::avatarRect(const QRect& rect, bool isMine) const
+{
     if (isMine) {
         return QRect(rect.right() - m_style.margin - m_style.avatarSize, rect.top() + m_style.margin, m_style.avatarSize, m_style.avatarSize);
     }
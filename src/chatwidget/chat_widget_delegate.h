@@ -3,7 +3,19 @@
 
 #include <QColor>
 #include <QFont>
+#include <QHash>
+#include <QPersistentModelIndex>
+#include <QPointer>
+#include <QScopedPointer>
 #include <QStyledItemDelegate>
+#include <QVector>
+
+class ChatWidgetCodeHighlighter;
+class ChatWidgetImageCache;
+class ChatWidgetLayoutCache;
+class ChatWidgetPrerenderer;
+class ChatWidgetRowReader;
+struct ChatWidgetLayoutEntry;
 
 class ChatWidgetDelegate : public QStyledItemDelegate {
     Q_OBJECT
@@ -36,6 +48,12 @@ public:
         QColor searchHighlightColor = QColor(255, 241, 118);
         QColor fileCardColor = QColor(250, 250, 252);
         QColor fileBorderColor = QColor(220, 220, 220);
+        // 围栏代码块语法高亮
+        QColor codeKeywordColor = QColor(215, 58, 73);
+        QColor codeStringColor = QColor(3, 47, 98);
+        QColor codeNumberColor = QColor(0, 92, 197);
+        QColor codeCommentColor = QColor(106, 115, 125);
+        QColor codeMetaColor = QColor(111, 66, 193);
 
         QFont messageFont = QFont("Microsoft YaHei", 11);
         QFont avatarFont = QFont("Microsoft YaHei", 10, QFont::Bold);
@@ -48,16 +66,87 @@ public:
     };
 
     explicit ChatWidgetDelegate(QObject* parent = nullptr);
+    ~ChatWidgetDelegate() override;
 
     void setStyle(const Style& style);
     Style style() const;
+    // 字体度量按该控件所在屏幕的 DPI 解析；屏幕（DPI）变化时由视图再次调用
+    void setMetricsWidget(QWidget* widget);
+
+    // 排版缓存：按消息缓存 Markdown 渲染结果与文档排版，容量为条目数
+    void setLayoutCacheCapacity(int entries);
+    int layoutCacheCapacity() const;
+    void clearLayoutCache();
+    // 与模型 messageKeysChanged 对接：排版缓存与预渲染结果改用新 key
+    void remapKeys(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys);
+    // 与模型 dataChanged 对接：仅按角色失效必要的部分（如表情回应只重算行高）
+    void invalidateLayout(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                          const QVector<int>& roles = QVector<int>());
+    // 流式输出结束：丢弃该行的增量渲染器，下次排版时按完整内容一次性重建文档，
+    // 分片边界处的结构与一次性解析一致。返回该行此前是否处于流式模式
+    bool finishStreaming(const QModelIndex& index);
+
+    // 图片附件缩略图缓存（后台解码），预算单位 KB
+    ChatWidgetImageCache* imageCache() const;
+
+    // 在后台线程预渲染 [first, last] 行的 Markdown 并测量文档高度；未完成的行先按估算高度布局，
+    // 每个分片完成后发出 rowsPrerendered（结果已计入 estimatedHeight）与 sizeHintChanged
+    void prerenderRows(const QAbstractItemModel* model, int first, int last);
+    ChatWidgetPrerenderer* prerenderer() const;
+    // 代码块高亮：按行缓存记号，颜色取自 Style 的 code*Color
+    ChatWidgetCodeHighlighter* codeHighlighter() const;
 
     void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
     QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    // 行宽对应的文本排版宽度（按档位量化）；档位不变时行高不变，视图据此决定是否重新测量
+    static int textLayoutWidth(int rowWidth);
+    // 不做排版的行高估算（按消息类型与文本长度）；已缓存或已预渲染的行直接返回实际高度
+    int estimatedHeight(const QStyleOptionViewItem& option, const QModelIndex& index) const;
+    // 渐进绘制：为真时 sizeHint（isSizeCached）或 paint（isLayoutCached）不会同步渲染 Markdown、排版文档
+    bool isSizeCached(const QStyleOptionViewItem& option, const QModelIndex& index) const;
+    bool isLayoutCached(const QStyleOptionViewItem& option, const QModelIndex& index) const;
+    // 补建绘制所需的排版（不绘制），供视图在后续帧中分片完成
+    void prepareLayout(const QStyleOptionViewItem& option, const QModelIndex& index) const;
+    // 超出绘制预算的行先画骨架气泡：头像底色与灰色文本条，不读取正文排版
+    void paintSkeleton(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const;
     QRect avatarRect(const QStyleOptionViewItem& option, const QModelIndex& index) const;
 
+signals:
+    // 某行的图片缩略图已就绪，视图只需重绘该行
+    void rowRepaintRequested(const QModelIndex& index);
+    // 预渲染结果到达的行（升序）：视图据此把视口外行的估算高度换成实际高度
+    void rowsPrerendered(const QVector<int>& rows);
+
 private:
+    struct ResolvedStyle;
+
+    void resolveStyle();
+    void applyCodeFormats();
+    // needDocument 为 false 时（仅测量）可使用预渲染结果或估算值，不生成文档
+    ChatWidgetLayoutEntry* layoutEntry(const ChatWidgetRowReader& row, int textWidth, bool needDocument = true) const;
+    bool appendStreamingContent(ChatWidgetLayoutEntry* entry, const QString& content) const;
+    void updateDocumentSize(ChatWidgetLayoutEntry* entry) const;
+    void updateHighlights(ChatWidgetLayoutEntry* entry, const ChatWidgetRowReader& row) const;
+    QRect avatarRect(const QRect& rowRect, bool isMine) const;
+    void onThumbnailLoaded(const QString& path);
+    void onPrerendered(const QVector<quint64>& keys);
+    // 尺寸与消息类型、附件、回复等组成整行高度（与 sizeHint 一致）
+    int rowHeight(const ChatWidgetRowReader& row, int documentHeight) const;
+
     Style m_style;
+    quint32 m_styleGeneration = 1;
+    // 由 m_style 派生的字体度量、固定高度与文本宽度缓存，只在样式或 DPI 变化时重建
+    QScopedPointer<ResolvedStyle> m_resolved;
+    QPointer<QWidget> m_metricsWidget;
+    QScopedPointer<ChatWidgetLayoutCache> m_layoutCache;
+    QScopedPointer<ChatWidgetCodeHighlighter> m_codeHighlighter;
+    mutable QScopedPointer<ChatWidgetLayoutEntry> m_scratchEntry;
+    ChatWidgetImageCache* m_imageCache;
+    ChatWidgetPrerenderer* m_prerenderer;
+    QPointer<const QAbstractItemModel> m_prerenderModel; // 预渲染结果按 key 映射回该模型的行
+    mutable int m_lastTextWidth = 0;        // 最近一次测量使用的文本宽度，预渲染按此宽度排版
+    // 等待缩略图的行，按图片路径分组
+    mutable QHash<QString, QList<QPersistentModelIndex>> m_imageWaiters;
 };
 
 #endif // CHAT_WIDGET_DELEGATE_H
@@ -0,0 +1,123 @@
+#ifndef CHAT_WIDGET_GAP_VECTOR_H
+#define CHAT_WIDGET_GAP_VECTOR_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <utility>
+
+// 头部预留空位的顺序容器，下标语义与 QVector 相同。
+// 头部插入 k 个元素均摊 O(k)（空位不足时按当前长度倍增预留），头部删除只移动起点；
+// 尾部追加与 QVector 相同，中间插入/删除仍为 O(n)。
+// 用于模型的列式存储与行状态：向前翻页加载历史时代价与已加载的行数无关
+template <typename T>
+class ChatWidgetGapVector {
+public:
+    int size() const { return m_data.size() - m_front; }
+    bool isEmpty() const { return size() == 0; }
+    // 头部可直接使用的空位数
+    int frontCapacity() const { return m_front; }
+
+    void reserve(int size) { m_data.reserve(m_front + size); }
+    void clear()
+    {
+        m_data.clear();
+        m_front = 0;
+    }
+
+    const T& at(int i) const { return m_data.at(m_front + i); }
+    const T& operator[](int i) const { return m_data.at(m_front + i); }
+    T& operator[](int i) { return m_data[m_front + i]; }
+
+    T* begin() { return m_data.data() + m_front; }
+    T* end() { return m_data.data() + m_data.size(); }
+    const T* begin() const { return m_data.constData() + m_front; }
+    const T* end() const { return m_data.constData() + m_data.size(); }
+    const T* cbegin() const { return begin(); }
+    const T* cend() const { return end(); }
+
+    void append(const T& value) { m_data.append(value); }
+    void append(T&& value) { m_data.append(std::move(value)); }
+
+    // 在 row 之前插入 values（按顺序移入）
+    void insert(int row, QVector<T>&& values)
+    {
+        const int count = values.size();
+        if (count == 0) {
+            return;
+        }
+        row = qBound(0, row, size());
+        if (row == size()) {
+            m_data.reserve(m_data.size() + count);
+            for (T& value : values) {
+                m_data.append(std::move(value));
+            }
+            return;
+        }
+        if (row == 0) {
+            if (m_front < count) {
+                growFront(count);
+            }
+            m_front -= count;
+            T* target = m_data.data() + m_front;
+            for (int i = 0; i < count; ++i) {
+                target[i] = std::move(values[i]);
+            }
+            return;
+        }
+        m_data.insert(m_data.begin() + m_front + row, count, T());
+        T* target = m_data.data() + m_front + row;
+        for (int i = 0; i < count; ++i) {
+            target[i] = std::move(values[i]);
+        }
+    }
+
+    void remove(int first, int count)
+    {
+        if (count <= 0) {
+            return;
+        }
+        if (first == 0 && count < size()) {
+            // 头部删除：元素复位以释放内容，起点后移
+            T* data = m_data.data() + m_front;
+            for (int i = 0; i < count; ++i) {
+                data[i] = T();
+            }
+            m_front += count;
+            // 空位超过有效元素时收缩，避免反复淘汰头部后持续占用内存
+            if (m_front > kMinFront && m_front > size()) {
+                m_data.erase(m_data.begin(), m_data.begin() + m_front);
+                m_front = 0;
+            }
+            return;
+        }
+        if (first == 0) {
+            clear();
+            return;
+        }
+        m_data.erase(m_data.begin() + m_front + first, m_data.begin() + m_front + first + count);
+    }
+
+private:
+    static constexpr int kMinFront = 64;
+
+    // 重新分配，使头部至少有 needed 个空位；插入后仍保留与当前长度相当的空位
+    void growFront(int needed)
+    {
+        const int length = size();
+        const int front = needed + qMax(length, kMinFront);
+        QVector<T> grown;
+        grown.reserve(front + length);
+        grown.resize(front);
+        T* data = m_data.data() + m_front;
+        for (int i = 0; i < length; ++i) {
+            grown.append(std::move(data[i]));
+        }
+        m_data.swap(grown);
+        m_front = front;
+    }
+
+    QVector<T> m_data;
+    int m_front = 0; // m_data 头部未使用的槽位数
+};
+
+#endif // CHAT_WIDGET_GAP_VECTOR_H
@@ -0,0 +1,129 @@
+#include "chat_widget_highlighter.h"
+#include "chat_widget_search_index.h"
+#include <QQueue>
+
+namespace {
+// 按 UTF-16 码元折叠大小写，保证折叠前后长度一致、位置可直接对应原文
+inline ushort foldCase(QChar ch)
+{
+    return ch.isSurrogate() ? ch.unicode() : ch.toCaseFolded().unicode();
+}
+} // namespace
+
+ChatWidgetHighlighter::ChatWidgetHighlighter()
+{
+    m_nodes.resize(1);
+}
+
+ChatWidgetHighlighter::ChatWidgetHighlighter(const QStringList& mentions, const QString& keyword)
+{
+    setPatterns(mentions, keyword);
+}
+
+void ChatWidgetHighlighter::setPatterns(const QStringList& mentions, const QString& keyword)
+{
+    m_nodes.clear();
+    m_nodes.resize(1);
+    m_patterns.clear();
+    m_kinds.clear();
+    for (const QString& mention : mentions) {
+        if (!mention.trimmed().isEmpty()) {
+            addPattern(mention, Mention);
+        }
+    }
+    if (!keyword.trimmed().isEmpty()) {
+        addPattern(keyword, Keyword);
+    }
+    build();
+}
+
+bool ChatWidgetHighlighter::isEmpty() const
+{
+    return m_patterns.isEmpty();
+}
+
+void ChatWidgetHighlighter::addPattern(const QString& pattern, Kind kind)
+{
+    // 统一在折叠后的字符上建树，提及在命中后再按原文校验大小写
+    int state = 0;
+    for (const QChar ch : pattern) {
+        const ushort key = foldCase(ch);
+        auto it = m_nodes[state].next.constFind(key);
+        if (it == m_nodes[state].next.constEnd()) {
+            m_nodes.append(Node());
+            const int created = m_nodes.size() - 1;
+            m_nodes[state].next.insert(key, created);
+            state = created;
+        } else {
+            state = it.value();
+        }
+    }
+    m_nodes[state].patterns.append(m_patterns.size());
+    m_patterns.append(pattern);
+    m_kinds.append(kind);
+}
+
+void ChatWidgetHighlighter::build()
+{
+    QQueue<int> queue;
+    for (auto it = m_nodes[0].next.constBegin(); it != m_nodes[0].next.constEnd(); ++it) {
+        m_nodes[it.value()].fail = 0;
+        queue.enqueue(it.value());
+    }
+    while (!queue.isEmpty()) {
+        const int state = queue.dequeue();
+        for (auto it = m_nodes[state].next.constBegin(); it != m_nodes[state].next.constEnd(); ++it) {
+            const ushort key = it.key();
+            const int child = it.value();
+            int fallback = m_nodes[state].fail;
+            while (fallback != 0 && !m_nodes[fallback].next.contains(key)) {
+                fallback = m_nodes[fallback].fail;
+            }
+            const int target = m_nodes[fallback].next.value(key, 0);
+            m_nodes[child].fail = target != child ? target : 0;
+            const int failState = m_nodes[child].fail;
+            m_nodes[child].outputLink = m_nodes[failState].patterns.isEmpty() ? m_nodes[failState].outputLink
+                                                                              : failState;
+            queue.enqueue(child);
+        }
+    }
+}
+
+QVector<ChatWidgetHighlighter::Match> ChatWidgetHighlighter::match(const QString& text) const
+{
+    QVector<Match> matches;
+    if (m_patterns.isEmpty()) {
+        return matches;
+    }
+    int state = 0;
+    const int length = text.size();
+    for (int i = 0; i < length; ++i) {
+        const ushort key = foldCase(text.at(i));
+        while (state != 0 && !m_nodes[state].next.contains(key)) {
+            state = m_nodes[state].fail;
+        }
+        state = m_nodes[state].next.value(key, 0);
+
+        for (int node = m_nodes[state].patterns.isEmpty() ? m_nodes[state].outputLink : state; node > 0;
+             node = m_nodes[node].outputLink) {
+            for (int pattern : m_nodes[node].patterns) {
+                const QString& source = m_patterns.at(pattern);
+                const int start = i - source.size() + 1;
+                if (m_kinds.at(pattern) == Mention
+                    && text.midRef(start, source.size()).compare(source, Qt::CaseSensitive) != 0) {
+                    continue;
+                }
+                // 关键字与全文索引同一规则：只在词首命中
+                if (m_kinds.at(pattern) == Keyword && !ChatWidgetSearchIndex::isTokenStart(text, start)) {
+                    continue;
+                }
+                Match match;
+                match.start = start;
+                match.length = source.size();
+                match.kind = m_kinds.at(pattern);
+                matches.append(match);
+            }
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,49 @@
+#ifndef CHAT_WIDGET_HIGHLIGHTER_H
+#define CHAT_WIDGET_HIGHLIGHTER_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 多模式高亮匹配（Aho–Corasick）：提及区分大小写、任意位置命中；搜索关键字不区分大小写、
+// 只在词首命中（与 ChatWidgetSearchIndex 的切分一致，模型计数与高亮因此同一规则）。
+// 一次扫描纯文本即可得到全部命中区间。只匹配文本内容，不会命中 HTML 标签或实体。
+class ChatWidgetHighlighter {
+public:
+    enum Kind {
+        Mention,
+        Keyword
+    };
+
+    struct Match {
+        int start = 0;
+        int length = 0;
+        Kind kind = Keyword;
+    };
+
+    ChatWidgetHighlighter();
+    ChatWidgetHighlighter(const QStringList& mentions, const QString& keyword);
+
+    void setPatterns(const QStringList& mentions, const QString& keyword);
+    bool isEmpty() const;
+    // 按结束位置升序返回所有命中（可能重叠）
+    QVector<Match> match(const QString& text) const;
+
+private:
+    struct Node {
+        QHash<ushort, int> next;
+        int fail = 0;
+        int outputLink = -1; // 沿失配链最近的带输出节点
+        QVector<int> patterns;
+    };
+
+    void addPattern(const QString& pattern, Kind kind);
+    void build();
+
+    QVector<Node> m_nodes;
+    QStringList m_patterns;
+    QVector<Kind> m_kinds;
+};
+
+#endif // CHAT_WIDGET_HIGHLIGHTER_H
@@ -0,0 +1,164 @@
+#include "chat_widget_history_window.h"
+#include "chat_history_source.h"
+#include "chat_widget_model.h"
+#include <utility>
+
+ChatWidgetHistoryWindow::ChatWidgetHistoryWindow(ChatWidgetModel* model, QObject* parent)
+    : QObject(parent)
+    , m_model(model)
+{
+}
+
+void ChatWidgetHistoryWindow::setSource(ChatHistorySource* source)
+{
+    m_source = source;
+    m_hasMoreOlder = false;
+    m_hasMoreNewer = false;
+}
+
+ChatHistorySource* ChatWidgetHistoryWindow::source() const
+{
+    return m_source;
+}
+
+void ChatWidgetHistoryWindow::setPageSize(int size)
+{
+    m_pageSize = qMax(1, size);
+}
+
+int ChatWidgetHistoryWindow::pageSize() const
+{
+    return m_pageSize;
+}
+
+void ChatWidgetHistoryWindow::setMaxRows(int rows)
+{
+    m_maxRows = rows;
+}
+
+int ChatWidgetHistoryWindow::maxRows() const
+{
+    return m_maxRows;
+}
+
+void ChatWidgetHistoryWindow::setCurrentUserId(const QString& userId)
+{
+    m_currentUserId = userId;
+}
+
+void ChatWidgetHistoryWindow::loadLatest()
+{
+    if (!m_source || !m_model || m_loading) {
+        return;
+    }
+    m_loading = true;
+    QList<ChatWidgetMessage> messages = m_source->fetchLatest(m_pageSize);
+    applyCurrentUser(messages);
+    m_hasMoreOlder = messages.size() >= m_pageSize;
+    m_model->setMessages(std::move(messages));
+    m_hasMoreNewer = false;
+    m_loading = false;
+}
+
+int ChatWidgetHistoryWindow::loadOlder()
+{
+    if (!m_source || !m_model || m_loading || !m_hasMoreOlder) {
+        return 0;
+    }
+    const QString anchorId = edgeMessageId(true);
+    if (anchorId.isEmpty()) {
+        return 0;
+    }
+    m_loading = true;
+    QList<ChatWidgetMessage> messages = m_source->fetchBefore(anchorId, m_pageSize);
+    m_hasMoreOlder = messages.size() >= m_pageSize;
+    applyCurrentUser(messages);
+    const int before = m_model->rowCount();
+    m_model->prependMessages(std::move(messages));
+    const int inserted = m_model->rowCount() - before;
+
+    // 在窗口底部淘汰超出容量的行，之后需要时再从来源重新拉取
+    const int excess = m_maxRows > 0 ? m_model->rowCount() - m_maxRows : 0;
+    if (excess > 0) {
+        m_model->removeMessages(m_model->rowCount() - excess, excess);
+        m_hasMoreNewer = true;
+    }
+    m_loading = false;
+
+    if (inserted > 0) {
+        emit olderLoaded(inserted);
+    }
+    if (excess > 0) {
+        emit rowsEvicted(excess, false);
+    }
+    return inserted;
+}
+
+int ChatWidgetHistoryWindow::loadNewer()
+{
+    if (!m_source || !m_model || m_loading || !m_hasMoreNewer) {
+        return 0;
+    }
+    const QString anchorId = edgeMessageId(false);
+    if (anchorId.isEmpty()) {
+        return 0;
+    }
+    m_loading = true;
+    QList<ChatWidgetMessage> messages = m_source->fetchAfter(anchorId, m_pageSize);
+    m_hasMoreNewer = messages.size() >= m_pageSize;
+    applyCurrentUser(messages);
+    const int before = m_model->rowCount();
+    m_model->appendMessages(std::move(messages));
+    const int inserted = m_model->rowCount() - before;
+
+    const int excess = m_maxRows > 0 ? m_model->rowCount() - m_maxRows : 0;
+    if (excess > 0) {
+        m_model->removeMessages(0, excess);
+        m_hasMoreOlder = true;
+    }
+    m_loading = false;
+
+    if (inserted > 0) {
+        emit newerLoaded(inserted);
+    }
+    if (excess > 0) {
+        emit rowsEvicted(excess, true);
+    }
+    return inserted;
+}
+
+bool ChatWidgetHistoryWindow::hasMoreOlder() const
+{
+    return m_hasMoreOlder;
+}
+
+bool ChatWidgetHistoryWindow::hasMoreNewer() const
+{
+    return m_hasMoreNewer;
+}
+
+void ChatWidgetHistoryWindow::applyCurrentUser(QList<ChatWidgetMessage>& messages) const
+{
+    if (m_currentUserId.isEmpty()) {
+        return;
+    }
+    for (ChatWidgetMessage& message : messages) {
+        if (!message.senderId.isEmpty()) {
+            message.isMine = message.senderId == m_currentUserId;
+        }
+    }
+}
+
+QString ChatWidgetHistoryWindow::edgeMessageId(bool first) const
+{
+    const int count = m_model->rowCount();
+    // 跳过没有 messageId 的本地消息（如系统提示），以最近的可定位消息作为分页锚点
+    for (int i = 0; i < count; ++i) {
+        const int row = first ? i : count - 1 - i;
+        const QString messageId = m_model->index(row, 0).data(ChatWidgetModel::ChatWidgetMessageIdRole).toString();
+        if (!messageId.isEmpty()) {
+            return messageId;
+        }
+    }
+    return QString();
+}
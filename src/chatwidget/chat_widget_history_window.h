@@ -0,0 +1,58 @@
+#ifndef CHAT_WIDGET_HISTORY_WINDOW_H
+#define CHAT_WIDGET_HISTORY_WINDOW_H
+
+#include "chat_widget_message.h"
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class ChatHistorySource;
+class ChatWidgetModel;
+
+// 历史消息滑动窗口：模型只保留视口附近的一段行，滚动接近边缘时从 ChatHistorySource
+// 按页拉取更早/更新的消息，并淘汰窗口另一端超出 maxRows 的行。
+class ChatWidgetHistoryWindow : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ChatWidgetHistoryWindow(ChatWidgetModel* model, QObject* parent = nullptr);
+
+    // source 不转移所有权，调用方需保证其生命周期长于窗口
+    void setSource(ChatHistorySource* source);
+    ChatHistorySource* source() const;
+    void setPageSize(int size);
+    int pageSize() const;
+    // 模型最多保留的行数，<= 0 表示不淘汰
+    void setMaxRows(int rows);
+    int maxRows() const;
+    // 设置后按 senderId 重新计算拉取到的消息的 isMine
+    void setCurrentUserId(const QString& userId);
+
+    // 以最新一页重置模型
+    void loadLatest();
+    // 返回实际插入的行数
+    int loadOlder();
+    int loadNewer();
+    bool hasMoreOlder() const;
+    bool hasMoreNewer() const;
+
+signals:
+    void olderLoaded(int count);
+    void newerLoaded(int count);
+    void rowsEvicted(int count, bool fromTop);
+
+private:
+    void applyCurrentUser(QList<ChatWidgetMessage>& messages) const;
+    QString edgeMessageId(bool first) const;
+
+    ChatWidgetModel* m_model;
+    ChatHistorySource* m_source = nullptr;
+    QString m_currentUserId;
+    int m_pageSize = 50;
+    int m_maxRows = 300;
+    bool m_hasMoreOlder = false;
+    bool m_hasMoreNewer = false;
+    bool m_loading = false;
+};
+
+#endif // CHAT_WIDGET_HISTORY_WINDOW_H
@@ -0,0 +1,156 @@
+#include "chat_widget_image_cache.h"
+#include <QImageReader>
+#include <QRunnable>
+#include <QtMath>
+#include <functional>
+
+namespace {
+const int kDefaultBudgetKB = 32 * 1024;
+const int kDecodeThreads = 2;
+
+QString cacheKey(const QString& path, const QSize& pixelSize)
+{
+    return QStringLiteral("%1|%2x%3").arg(path).arg(pixelSize.width()).arg(pixelSize.height());
+}
+
+QSize pixelSize(const QSize& size, qreal devicePixelRatio)
+{
+    return QSize(qCeil(size.width() * devicePixelRatio), qCeil(size.height() * devicePixelRatio));
+}
+
+class DecodeTask : public QRunnable {
+public:
+    DecodeTask(ChatWidgetImageCache* cache, const QString& path, const QSize& size,
+               std::function<void(const QImage&)> done)
+        : m_cache(cache)
+        , m_path(path)
+        , m_size(size)
+        , m_done(std::move(done))
+    {
+    }
+
+    void run() override
+    {
+        const QImage image = ChatWidgetImageCache::decodeThumbnail(m_path, m_size);
+        // 回到缓存所在线程；缓存析构时会等待线程池，投递期间 m_cache 有效
+        auto done = m_done;
+        QMetaObject::invokeMethod(m_cache, [done, image]() { done(image); }, Qt::QueuedConnection);
+    }
+
+private:
+    ChatWidgetImageCache* m_cache;
+    QString m_path;
+    QSize m_size;
+    std::function<void(const QImage&)> m_done;
+};
+} // namespace
+
+ChatWidgetImageCache::ChatWidgetImageCache(QObject* parent)
+    : QObject(parent)
+    , m_pixmaps(kDefaultBudgetKB)
+{
+    m_pool.setMaxThreadCount(kDecodeThreads);
+}
+
+ChatWidgetImageCache::~ChatWidgetImageCache()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void ChatWidgetImageCache::setMemoryBudget(int kilobytes)
+{
+    m_pixmaps.setMaxCost(qMax(0, kilobytes));
+}
+
+int ChatWidgetImageCache::memoryBudget() const
+{
+    return m_pixmaps.maxCost();
+}
+
+int ChatWidgetImageCache::count() const
+{
+    return m_pixmaps.count();
+}
+
+void ChatWidgetImageCache::clear()
+{
+    // 正在解码的任务完成后仍会写入缓存，只清空已有结果与失败记录
+    m_pixmaps.clear();
+    m_failed.clear();
+}
+
+QPixmap ChatWidgetImageCache::thumbnail(const QString& path, const QSize& size, qreal devicePixelRatio)
+{
+    if (path.isEmpty() || size.isEmpty()) {
+        return QPixmap();
+    }
+    const QSize pixels = pixelSize(size, devicePixelRatio);
+    const QString key = cacheKey(path, pixels);
+    if (const QPixmap* pixmap = m_pixmaps.object(key)) {
+        return *pixmap;
+    }
+    if (m_pending.contains(key) || m_failed.contains(key)) {
+        return QPixmap();
+    }
+
+    m_pending.insert(key);
+    m_pool.start(new DecodeTask(this, path, pixels, [this, key, path, devicePixelRatio](const QImage& image) {
+        onDecoded(key, path, devicePixelRatio, image);
+    }));
+    return QPixmap();
+}
+
+bool ChatWidgetImageCache::isPending(const QString& path, const QSize& size, qreal devicePixelRatio) const
+{
+    return m_pending.contains(cacheKey(path, pixelSize(size, devicePixelRatio)));
+}
+
+QImage ChatWidgetImageCache::decodeThumbnail(const QString& path, const QSize& size)
+{
+    if (path.isEmpty() || size.isEmpty()) {
+        return QImage();
+    }
+    QImageReader reader(path);
+    const QSize sourceSize = reader.size();
+    QImage image;
+    if (sourceSize.isValid()) {
+        // 让解码器直接输出缩放并裁剪后的结果（JPEG 等格式可在解码阶段降采样）
+        const QSize scaled = sourceSize.scaled(size, Qt::KeepAspectRatioByExpanding);
+        reader.setScaledSize(scaled);
+        reader.setScaledClipRect(QRect((scaled.width() - size.width()) / 2,
+                                       (scaled.height() - size.height()) / 2, size.width(), size.height()));
+        image = reader.read();
+    } else {
+        image = reader.read();
+        if (!image.isNull()) {
+            image = image.scaled(size, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+            image = image.copy((image.width() - size.width()) / 2, (image.height() - size.height()) / 2,
+                               size.width(), size.height());
+        }
+    }
+    if (image.isNull()) {
+        return image;
+    }
+    // 预乘格式绘制时无需再转换
+    return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                         : QImage::Format_RGB32);
+}
+
+void ChatWidgetImageCache::onDecoded(const QString& key, const QString& path, qreal devicePixelRatio,
+                                     const QImage& image)
+{
+    m_pending.remove(key);
+    if (image.isNull()) {
+        m_failed.insert(key);
+    } else {
+        auto* pixmap = new QPixmap(QPixmap::fromImage(image));
+        pixmap->setDevicePixelRatio(devicePixelRatio);
+        const int cost = qMax(1, static_cast<int>(image.sizeInBytes() / 1024));
+        // 单张超出预算时 QCache 会释放并拒绝插入，记为失败以免反复解码
+        if (!m_pixmaps.insert(key, pixmap, cost)) {
+            m_failed.insert(key);
+        }
+    }
+    emit thumbnailLoaded(path);
+}
@@ -0,0 +1,48 @@
+#ifndef CHAT_WIDGET_IMAGE_CACHE_H
+#define CHAT_WIDGET_IMAGE_CACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+// 图片附件缩略图缓存：在线程池中解码并缩放到目标尺寸，结果按 路径+尺寸+像素比 存入
+// 有内存预算的 LRU。未就绪时 thumbnail() 返回空图并排队解码，完成后发出 thumbnailLoaded。
+class ChatWidgetImageCache : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ChatWidgetImageCache(QObject* parent = nullptr);
+    ~ChatWidgetImageCache() override;
+
+    // 内存预算，单位 KB
+    void setMemoryBudget(int kilobytes);
+    int memoryBudget() const;
+    int count() const;
+    void clear();
+
+    // 仅在 GUI 线程调用。返回的像素图已设置 devicePixelRatio，逻辑尺寸等于 size
+    QPixmap thumbnail(const QString& path, const QSize& size, qreal devicePixelRatio = 1.0);
+    bool isPending(const QString& path, const QSize& size, qreal devicePixelRatio = 1.0) const;
+
+    // 解码并居中裁剪为 size（像素），保持宽高比；可在任意线程调用
+    static QImage decodeThumbnail(const QString& path, const QSize& size);
+
+signals:
+    // 解码结束（成功或失败）后发出，失败的图片不会重复排队
+    void thumbnailLoaded(const QString& path);
+
+private:
+    void onDecoded(const QString& key, const QString& path, qreal devicePixelRatio, const QImage& image);
+
+    QCache<QString, QPixmap> m_pixmaps;
+    QSet<QString> m_pending;
+    QSet<QString> m_failed;
+    QThreadPool m_pool;
+};
+
+#endif // CHAT_WIDGET_IMAGE_CACHE_H
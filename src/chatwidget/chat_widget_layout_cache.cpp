@@ -0,0 +1,71 @@
+#include "chat_widget_layout_cache.h"
+
+ChatWidgetLayoutCache::ChatWidgetLayoutCache(int capacity)
+    : m_entries(qMax(0, capacity))
+{
+}
+
+int ChatWidgetLayoutCache::capacity() const
+{
+    return m_entries.maxCost();
+}
+
+void ChatWidgetLayoutCache::setCapacity(int capacity)
+{
+    m_entries.setMaxCost(qMax(0, capacity));
+}
+
+int ChatWidgetLayoutCache::count() const
+{
+    return m_entries.count();
+}
+
+ChatWidgetLayoutEntry* ChatWidgetLayoutCache::find(quint64 key) const
+{
+    return m_entries.object(key);
+}
+
+ChatWidgetLayoutEntry* ChatWidgetLayoutCache::create(quint64 key)
+{
+    if (m_entries.maxCost() <= 0) {
+        return nullptr;
+    }
+    auto* entry = new ChatWidgetLayoutEntry;
+    // 每个条目代价为 1，容量即条目上限；插入失败时 QCache 会负责释放
+    if (!m_entries.insert(key, entry, 1)) {
+        return nullptr;
+    }
+    return entry;
+}
+
+void ChatWidgetLayoutCache::remove(quint64 key)
+{
+    m_entries.remove(key);
+}
+
+void ChatWidgetLayoutCache::invalidateSize(quint64 key)
+{
+    if (ChatWidgetLayoutEntry* entry = m_entries.object(key)) {
+        entry->sizeHint = QSize();
+    }
+}
+
+void ChatWidgetLayoutCache::remap(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys)
+{
+    // 先全部取出再插入，避免新 key 覆盖尚未取出的旧条目
+    QVector<ChatWidgetLayoutEntry*> entries;
+    entries.reserve(oldKeys.size());
+    for (quint64 key : oldKeys) {
+        entries.append(m_entries.take(key));
+    }
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries.at(i)) {
+            m_entries.insert(newKeys.at(i), entries.at(i), 1);
+        }
+    }
+}
+
+void ChatWidgetLayoutCache::clear()
+{
+    m_entries.clear();
+}
@@ -0,0 +1,55 @@
+#ifndef CHAT_WIDGET_LAYOUT_CACHE_H
+#define CHAT_WIDGET_LAYOUT_CACHE_H
+
+#include "chat_widget_streaming_renderer.h"
+#include <QAbstractTextDocumentLayout>
+#include <QCache>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QTextDocument>
+#include <QVector>
+#include <QtGlobal>
+
+// 单条消息的排版结果。条目按消息稳定标识索引，内容修订号、宽度档位与样式代数
+// 任一不一致时由 ChatWidgetDelegate 原地重建对应部分。
+struct ChatWidgetLayoutEntry {
+    quint64 revision = 0;        // 生成 document 时的内容修订号
+    quint32 styleGeneration = 0; // 生成 document 时的样式代数（0 表示文档未生成）
+    int widthBucket = 0;         // document 当前的排版宽度（已量化）
+    QString source;              // 生成文档时的 Markdown 原文
+    // 已按 widthBucket 排版的文档；可直接接管后台预渲染构建的文档
+    QSharedPointer<QTextDocument> document = QSharedPointer<QTextDocument>::create();
+    QSize documentSize;          // 文档尺寸（宽度已收缩到 idealWidth）
+    QSize sizeHint;              // 整行尺寸，无效时需重新计算
+    bool documentDeferred = false; // documentSize 来自后台预渲染但文档已被丢弃，document 尚未生成（绘制前补建）
+    QScopedPointer<ChatWidgetStreamingRenderer> streamer; // 非空表示处于流式增量模式
+    // 提及/搜索高亮：绘制时作为选区叠加，不改动文档，关键字变化无需重新解析
+    QVector<QAbstractTextDocumentLayout::Selection> highlights;
+    QString highlightKeyword;              // 生成 highlights 时的搜索关键字
+    quint64 highlightRevision = 0;         // 生成 highlights 时的内容修订号
+    quint32 highlightStyleGeneration = 0;  // 生成 highlights 时的样式代数（0 表示未生成）
+};
+
+class ChatWidgetLayoutCache {
+public:
+    explicit ChatWidgetLayoutCache(int capacity = 1024);
+
+    int capacity() const;
+    void setCapacity(int capacity);
+    int count() const;
+
+    ChatWidgetLayoutEntry* find(quint64 key) const;
+    ChatWidgetLayoutEntry* create(quint64 key);
+    void remove(quint64 key);
+    void invalidateSize(quint64 key);
+    // 条目改用新 key（oldKeys[i] -> newKeys[i]），新旧 key 可以交叉
+    void remap(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys);
+    void clear();
+
+private:
+    QCache<quint64, ChatWidgetLayoutEntry> m_entries;
+};
+
+#endif // CHAT_WIDGET_LAYOUT_CACHE_H
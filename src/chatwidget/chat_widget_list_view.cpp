@@ -0,0 +1,749 @@
+#include "chat_widget_list_view.h"
+#include "chat_widget_delegate.h"
+#include <QCursor>
+#include <QElapsedTimer>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPair>
+#include <QResizeEvent>
+#include <QScrollBar>
+#include <algorithm>
+
+namespace {
+const int kSingleStep = 20;
+const int kMaxRefinePasses = 3;
+const int kResizeSettleMs = 150;
+const int kRelayoutSliceMs = 8;
+const int kDefaultFrameBudgetMs = 8;
+} // namespace
+
+ChatWidgetListView::ChatWidgetListView(QWidget* parent) : QListView(parent), m_frameBudget(kDefaultFrameBudgetMs)
+{
+    setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_resizeSettleTimer.setSingleShot(true);
+    m_resizeSettleTimer.setInterval(kResizeSettleMs);
+    connect(&m_resizeSettleTimer, &QTimer::timeout, this, &ChatWidgetListView::startRelayout);
+    m_relayoutTimer.setInterval(0);
+    connect(&m_relayoutTimer, &QTimer::timeout, this, &ChatWidgetListView::relayoutSlice);
+    m_resolveTimer.setSingleShot(true);
+    m_resolveTimer.setInterval(0);
+    connect(&m_resolveTimer, &QTimer::timeout, this, &ChatWidgetListView::resolveSlice);
+}
+
+void ChatWidgetListView::setModel(QAbstractItemModel* model)
+{
+    disconnect(m_rowsRemovedConnection);
+    invalidateRows();
+    QListView::setModel(model);
+    if (model) {
+        // QAbstractItemView 没有 rowsRemoved 虚函数；删除前的行高仍需用于视图锚点计算
+        m_rowsRemovedConnection =
+            connect(model, &QAbstractItemModel::rowsRemoved, this, &ChatWidgetListView::onRowsRemoved);
+    }
+}
+
+void ChatWidgetListView::reset()
+{
+    invalidateRows();
+    QListView::reset();
+}
+
+void ChatWidgetListView::doItemsLayout()
+{
+    // 不调用 QListView::doItemsLayout：它会对所有行调用 sizeHint
+    if (model() && m_heights.size() != model()->rowCount(rootIndex())) {
+        estimateAllRows();
+    }
+    // 显式重新布局时视口内的行重新测量（委托有缓存，代价很小）
+    m_measured.fill(false);
+    QAbstractItemView::doItemsLayout();
+    refineVisibleRows();
+    if (m_relayoutTimer.isActive()) {
+        startRelayout();
+    }
+}
+
+QRect ChatWidgetListView::visualRect(const QModelIndex& index) const
+{
+    if (!index.isValid() || index.model() != model() || index.row() >= m_heights.size()) {
+        return QRect();
+    }
+    return QRect(0, rowOffset(index.row()) - verticalOffset(), viewport()->width(), m_heights.at(index.row()));
+}
+
+QModelIndex ChatWidgetListView::indexAt(const QPoint& point) const
+{
+    const int y = point.y() + verticalOffset();
+    if (!model() || y < 0 || y >= m_totalHeight) {
+        return QModelIndex();
+    }
+    return model()->index(rowAtOffset(y), modelColumn(), rootIndex());
+}
+
+void ChatWidgetListView::scrollTo(const QModelIndex& index, ScrollHint hint)
+{
+    if (!index.isValid() || index.model() != model()) {
+        return;
+    }
+    executeDelayedItemsLayout();
+    const int row = index.row();
+    if (row >= m_heights.size()) {
+        return;
+    }
+    if (!m_measured.at(row)) {
+        m_measured[row] = true;
+        setRowHeight(row, measureRow(row));
+        updateGeometries();
+    }
+
+    const int top = rowOffset(row);
+    const int height = m_heights.at(row);
+    const int viewHeight = viewport()->height();
+    const int current = verticalOffset();
+    int value = current;
+    switch (hint) {
+    case PositionAtTop:
+        value = top;
+        break;
+    case PositionAtBottom:
+        value = top + height - viewHeight;
+        break;
+    case PositionAtCenter:
+        value = top - (viewHeight - height) / 2;
+        break;
+    case EnsureVisible:
+    default:
+        if (top < current) {
+            value = top;
+        } else if (top + height > current + viewHeight) {
+            value = qMin(top, top + height - viewHeight);
+        }
+        break;
+    }
+    verticalScrollBar()->setValue(value);
+}
+
+int ChatWidgetListView::contentHeight() const
+{
+    return m_totalHeight;
+}
+
+bool ChatWidgetListView::isRowMeasured(int row) const
+{
+    return row >= 0 && row < m_measured.size() && m_measured.at(row);
+}
+
+void ChatWidgetListView::refreshEstimates(const QVector<int>& rows)
+{
+    if (!model()) {
+        return;
+    }
+    bool changed = false;
+    for (int row : rows) {
+        if (row < 0 || row >= m_heights.size() || m_measured.at(row)) {
+            continue;
+        }
+        const int height = estimateRow(row);
+        if (height != m_heights.at(row)) {
+            setRowHeight(row, height);
+            changed = true;
+        }
+    }
+    if (changed) {
+        updateGeometries();
+        viewport()->update();
+    }
+}
+
+void ChatWidgetListView::remeasureRow(int row)
+{
+    if (row < 0 || row >= m_measured.size()) {
+        return;
+    }
+    m_measured[row] = false;
+    refineVisibleRows();
+    viewport()->update();
+}
+
+void ChatWidgetListView::paintEvent(QPaintEvent* event)
+{
+    executeDelayedItemsLayout();
+    if (!model() || m_heights.isEmpty()) {
+        return;
+    }
+    QPainter painter(viewport());
+    const QStyleOptionViewItem baseOption = viewOptions();
+    const QModelIndex current = currentIndex();
+    const QModelIndex hover =
+        viewport()->underMouse() ? indexAt(viewport()->mapFromGlobal(QCursor::pos())) : QModelIndex();
+    const int offset = verticalOffset();
+    const QRect area = event->rect();
+    const int bottom = offset + area.bottom();
+    const auto* delegate = m_frameBudget > 0 ? qobject_cast<const ChatWidgetDelegate*>(itemDelegate()) : nullptr;
+    QElapsedTimer clock;
+    clock.start();
+
+    // 已排版的行直接绘制；需要排版的行稍后按离视口中心由近及远在预算内绘制
+    QVector<QPair<QModelIndex, QStyleOptionViewItem>> deferred;
+    int row = rowAtOffset(qMax(0, offset + area.top()));
+    int y = rowOffset(row);
+    for (; row < m_heights.size() && y <= bottom; y += m_heights.at(row), ++row) {
+        const QModelIndex index = model()->index(row, modelColumn(), rootIndex());
+        QStyleOptionViewItem option = baseOption;
+        option.rect = QRect(0, y - offset, viewport()->width(), m_heights.at(row));
+        if (selectionModel() && selectionModel()->isSelected(index)) {
+            option.state |= QStyle::State_Selected;
+        }
+        if (index == current && hasFocus()) {
+            option.state |= QStyle::State_HasFocus;
+        }
+        if (index == hover) {
+            option.state |= QStyle::State_MouseOver;
+        }
+        if (delegate && !delegate->isLayoutCached(option, index)) {
+            deferred.append(qMakePair(index, option));
+            continue;
+        }
+        itemDelegate(index)->paint(&painter, option, index);
+    }
+    if (deferred.isEmpty()) {
+        return;
+    }
+    const int centre = viewport()->height() / 2;
+    std::sort(deferred.begin(), deferred.end(),
+              [centre](const QPair<QModelIndex, QStyleOptionViewItem>& a,
+                       const QPair<QModelIndex, QStyleOptionViewItem>& b) {
+                  return qAbs(a.second.rect.center().y() - centre) < qAbs(b.second.rect.center().y() - centre);
+              });
+    bool skeleton = false;
+    for (const auto& item : qAsConst(deferred)) {
+        if (clock.elapsed() < m_frameBudget) {
+            delegate->paint(&painter, item.second, item.first);
+        } else {
+            delegate->paintSkeleton(&painter, item.second, item.first);
+            skeleton = true;
+        }
+    }
+    if (skeleton) {
+        scheduleResolve();
+    }
+}
+
+void ChatWidgetListView::resizeEvent(QResizeEvent* event)
+{
+    // 跳过 QListView::resizeEvent（Adjust 模式会触发全量布局）
+    QAbstractItemView::resizeEvent(event);
+    const int bucket = layoutBucket();
+    if (bucket == m_layoutBucket) {
+        return;
+    }
+    m_layoutBucket = bucket;
+    cancelRelayout();
+    // 视口内立即修正；视口外的行暂用旧高度作为估算值，尺寸稳定后再空闲测量
+    m_measured.fill(false);
+    refineVisibleRows();
+    if (!m_heights.isEmpty()) {
+        m_resizeSettleTimer.start();
+    }
+}
+
+bool ChatWidgetListView::isRelayoutPending() const
+{
+    return m_resizeSettleTimer.isActive() || m_relayoutTimer.isActive();
+}
+
+void ChatWidgetListView::cancelRelayout()
+{
+    m_resizeSettleTimer.stop();
+    m_relayoutTimer.stop();
+}
+
+void ChatWidgetListView::setFrameBudget(int msecs)
+{
+    m_frameBudget = qMax(0, msecs);
+}
+
+int ChatWidgetListView::frameBudget() const
+{
+    return m_frameBudget;
+}
+
+bool ChatWidgetListView::isViewportResolved() const
+{
+    return !m_unresolved;
+}
+
+int ChatWidgetListView::layoutBucket() const
+{
+    const int width = viewport()->width();
+    return qobject_cast<const ChatWidgetDelegate*>(itemDelegate()) ? ChatWidgetDelegate::textLayoutWidth(width)
+                                                                    : width;
+}
+
+void ChatWidgetListView::startRelayout()
+{
+    if (!model() || m_heights.isEmpty()) {
+        return;
+    }
+    const int top = verticalOffset();
+    const int firstVisible = rowAtOffset(top);
+    const int lastVisible = rowAtOffset(qMin(m_totalHeight - 1, top + viewport()->height()));
+    m_relayoutUp = firstVisible - 1;
+    m_relayoutDown = lastVisible + 1;
+    m_relayoutDone = 0;
+    m_relayoutTotal = m_heights.size() - (lastVisible - firstVisible + 1);
+    m_relayoutTimer.start();
+}
+
+void ChatWidgetListView::relayoutSlice()
+{
+    const int count = m_heights.size();
+    QScrollBar* bar = verticalScrollBar();
+    const bool pinnedToBottom = bar->maximum() > 0 && bar->value() >= bar->maximum();
+    auto remeasure = [this](int row) {
+        ++m_relayoutDone;
+        if (m_measured.at(row)) {
+            return 0;
+        }
+        m_measured[row] = true;
+        const int delta = measureRow(row) - m_heights.at(row);
+        if (delta != 0) {
+            setRowHeight(row, m_heights.at(row) + delta);
+        }
+        return delta;
+    };
+
+    m_refining = true;
+    QElapsedTimer clock;
+    clock.start();
+    int shiftAbove = 0;
+    // 由视口向两端交替推进，离视口越近的行越早得到精确高度
+    while ((m_relayoutUp >= 0 || m_relayoutDown < count) && clock.elapsed() < kRelayoutSliceMs) {
+        if (m_relayoutDown < count) {
+            remeasure(m_relayoutDown++);
+        }
+        if (m_relayoutUp >= 0) {
+            shiftAbove += remeasure(m_relayoutUp--);
+        }
+    }
+    updateGeometries();
+    // 视口上方的行高变化时同步移动滚动位置，已显示的内容保持不动
+    if (pinnedToBottom) {
+        bar->setValue(bar->maximum());
+    } else if (shiftAbove != 0) {
+        bar->setValue(bar->value() + shiftAbove);
+    }
+    m_refining = false;
+
+    emit relayoutProgress(m_relayoutDone, m_relayoutTotal);
+    if (m_relayoutUp < 0 && m_relayoutDown >= count) {
+        m_relayoutTimer.stop();
+        emit relayoutFinished();
+    }
+}
+
+QVector<int> ChatWidgetListView::visibleRowsByPriority() const
+{
+    QVector<QPair<int, int>> distances; // (到视口中心的距离, 行号)
+    const int top = verticalOffset();
+    const int bottom = top + viewport()->height();
+    const int centre = top + viewport()->height() / 2;
+    int row = rowAtOffset(top);
+    for (int y = rowOffset(row); row < m_heights.size() && y < bottom; y += m_heights.at(row), ++row) {
+        distances.append(qMakePair(qAbs(y + m_heights.at(row) / 2 - centre), row));
+    }
+    std::sort(distances.begin(), distances.end());
+    QVector<int> rows;
+    rows.reserve(distances.size());
+    for (const auto& item : qAsConst(distances)) {
+        rows.append(item.second);
+    }
+    return rows;
+}
+
+void ChatWidgetListView::scheduleResolve()
+{
+    m_unresolved = true;
+    if (!m_resolveTimer.isActive()) {
+        m_resolveTimer.start();
+    }
+}
+
+void ChatWidgetListView::resolveSlice()
+{
+    const auto* delegate = qobject_cast<const ChatWidgetDelegate*>(itemDelegate());
+    if (!model() || m_heights.isEmpty()) {
+        m_unresolved = false;
+        return;
+    }
+    QScrollBar* bar = verticalScrollBar();
+    const bool pinnedToBottom = bar->maximum() > 0 && bar->value() >= bar->maximum();
+    const QStyleOptionViewItem option = measureOption();
+    QElapsedTimer clock;
+    clock.start();
+    bool heightChanged = false;
+    bool remaining = false;
+    m_refining = true;
+    // 先测量行高，再补建绘制所需的排版；每帧在预算内推进，未完成的留到下一帧
+    for (int row : visibleRowsByPriority()) {
+        const QModelIndex index = model()->index(row, modelColumn(), rootIndex());
+        const bool needsLayout = delegate && !delegate->isLayoutCached(option, index);
+        if (m_measured.at(row) && !needsLayout) {
+            continue;
+        }
+        if (m_frameBudget > 0 && clock.elapsed() >= m_frameBudget) {
+            remaining = true;
+            break;
+        }
+        if (!m_measured.at(row)) {
+            m_measured[row] = true;
+            const int height = measureRow(row);
+            if (height != m_heights.at(row)) {
+                setRowHeight(row, height);
+                heightChanged = true;
+            }
+        }
+        if (needsLayout) {
+            delegate->prepareLayout(option, index);
+        }
+    }
+    if (heightChanged) {
+        // 视口顶部行之上的行高不变，内容以顶部行为锚点；贴底时保持贴底
+        updateGeometries();
+        if (pinnedToBottom) {
+            bar->setValue(bar->maximum());
+        }
+    }
+    m_refining = false;
+    viewport()->update();
+    if (remaining) {
+        scheduleResolve();
+        return;
+    }
+    m_unresolved = false;
+    emit viewportResolved();
+}
+
+void ChatWidgetListView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    if (m_refining || refineVisibleRows()) {
+        viewport()->update();
+    } else {
+        viewport()->scroll(0, dy);
+    }
+}
+
+void ChatWidgetListView::updateGeometries()
+{
+    QScrollBar* bar = verticalScrollBar();
+    bar->setSingleStep(kSingleStep);
+    bar->setPageStep(viewport()->height());
+    bar->setRange(0, qMax(0, m_totalHeight - viewport()->height()));
+    horizontalScrollBar()->setRange(0, 0);
+    QAbstractItemView::updateGeometries();
+}
+
+void ChatWidgetListView::rowsInserted(const QModelIndex& parent, int start, int end)
+{
+    const int count = end - start + 1;
+    if (parent == rootIndex() && m_heights.size() + count == model()->rowCount(rootIndex())) {
+        // 新行只做估算，偏移量整体重建（只是整数累加）
+        m_heights.insert(start, count, 0);
+        m_measured.insert(start, count, false);
+        for (int row = start; row <= end; ++row) {
+            m_heights[row] = estimateRow(row);
+        }
+        rebuildOffsets();
+        updateGeometries();
+        if (m_relayoutTimer.isActive()) {
+            // 行号已变化，从当前视口重新推进（已测量的行会被跳过）
+            startRelayout();
+        }
+    } else if (parent == rootIndex()) {
+        invalidateRows();
+    }
+    QListView::rowsInserted(parent, start, end);
+}
+
+void ChatWidgetListView::onRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    if (parent != rootIndex()) {
+        return;
+    }
+    const int count = last - first + 1;
+    if (last < m_heights.size() && m_heights.size() - count == model()->rowCount(rootIndex())) {
+        m_heights.remove(first, count);
+        m_measured.remove(first, count);
+        rebuildOffsets();
+        updateGeometries();
+        if (m_relayoutTimer.isActive()) {
+            startRelayout();
+        }
+    } else {
+        invalidateRows();
+    }
+}
+
+void ChatWidgetListView::dataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                     const QVector<int>& roles)
+{
+    QListView::dataChanged(topLeft, bottomRight, roles);
+    if (!topLeft.isValid() || topLeft.parent() != rootIndex()) {
+        return;
+    }
+    const int last = qMin(bottomRight.row(), m_measured.size() - 1);
+    for (int row = topLeft.row(); row <= last; ++row) {
+        m_measured[row] = false;
+    }
+    // 变化的行在视口内时立即修正（流式回复逐段增高）
+    refineVisibleRows();
+}
+
+QModelIndex ChatWidgetListView::moveCursor(CursorAction cursorAction, Qt::KeyboardModifiers modifiers)
+{
+    Q_UNUSED(modifiers);
+    const int count = m_heights.size();
+    if (!model() || count == 0) {
+        return QModelIndex();
+    }
+    const QModelIndex current = currentIndex();
+    int row = current.isValid() ? current.row() : -1;
+    switch (cursorAction) {
+    case MoveUp:
+    case MovePrevious:
+        row = row - 1;
+        break;
+    case MoveDown:
+    case MoveNext:
+        row = row + 1;
+        break;
+    case MoveHome:
+        row = 0;
+        break;
+    case MoveEnd:
+        row = count - 1;
+        break;
+    case MovePageUp:
+        row = rowAtOffset(qMax(0, rowOffset(qMax(0, row)) - viewport()->height()));
+        break;
+    case MovePageDown:
+        row = rowAtOffset(qMin(m_totalHeight - 1, rowOffset(qMax(0, row)) + viewport()->height()));
+        break;
+    default:
+        break;
+    }
+    return model()->index(qBound(0, row, count - 1), modelColumn(), rootIndex());
+}
+
+int ChatWidgetListView::horizontalOffset() const
+{
+    return 0;
+}
+
+int ChatWidgetListView::verticalOffset() const
+{
+    return verticalScrollBar()->value();
+}
+
+bool ChatWidgetListView::isIndexHidden(const QModelIndex& index) const
+{
+    Q_UNUSED(index);
+    return false;
+}
+
+void ChatWidgetListView::setSelection(const QRect& rect, QItemSelectionModel::SelectionFlags command)
+{
+    if (!model() || !selectionModel() || m_totalHeight <= 0) {
+        return;
+    }
+    const QRect normalized = rect.normalized();
+    const int first = rowAtOffset(qBound(0, normalized.top() + verticalOffset(), m_totalHeight - 1));
+    const int last = rowAtOffset(qBound(0, normalized.bottom() + verticalOffset(), m_totalHeight - 1));
+    const QItemSelection selection(model()->index(first, modelColumn(), rootIndex()),
+                                   model()->index(last, modelColumn(), rootIndex()));
+    selectionModel()->select(selection, command);
+}
+
+QRegion ChatWidgetListView::visualRegionForSelection(const QItemSelection& selection) const
+{
+    QRegion region;
+    if (m_heights.isEmpty()) {
+        return region;
+    }
+    // 只计算与视口相交的部分
+    const int offset = verticalOffset();
+    const int firstVisible = rowAtOffset(offset);
+    const int lastVisible = rowAtOffset(qMin(m_totalHeight - 1, offset + viewport()->height()));
+    for (const QItemSelectionRange& range : selection) {
+        if (range.parent() != rootIndex()) {
+            continue;
+        }
+        const int first = qMax(range.top(), firstVisible);
+        const int last = qMin(range.bottom(), lastVisible);
+        if (first > last) {
+            continue;
+        }
+        const int top = rowOffset(first);
+        region += QRect(0, top - offset, viewport()->width(), rowOffset(last) + m_heights.at(last) - top);
+    }
+    return region;
+}
+
+void ChatWidgetListView::invalidateRows()
+{
+    // 下一次布局时重新估算全部行
+    cancelRelayout();
+    m_heights.clear();
+    m_measured.clear();
+    m_tree.clear();
+    m_totalHeight = 0;
+}
+
+void ChatWidgetListView::estimateAllRows()
+{
+    const int count = model() ? model()->rowCount(rootIndex()) : 0;
+    m_heights.resize(count);
+    m_measured.fill(false, count);
+    for (int row = 0; row < count; ++row) {
+        m_heights[row] = estimateRow(row);
+    }
+    m_layoutBucket = layoutBucket();
+    rebuildOffsets();
+}
+
+int ChatWidgetListView::estimateRow(int row) const
+{
+    const QModelIndex index = model()->index(row, modelColumn(), rootIndex());
+    if (const auto* delegate = qobject_cast<const ChatWidgetDelegate*>(itemDelegate(index))) {
+        return qMax(1, delegate->estimatedHeight(measureOption(), index));
+    }
+    return measureRow(row);
+}
+
+int ChatWidgetListView::measureRow(int row) const
+{
+    const QModelIndex index = model()->index(row, modelColumn(), rootIndex());
+    // 行高至少为 1，保证偏移量到行号的映射唯一
+    return qMax(1, itemDelegate(index)->sizeHint(measureOption(), index).height());
+}
+
+QStyleOptionViewItem ChatWidgetListView::measureOption() const
+{
+    // 测量只用到行宽
+    QStyleOptionViewItem option = viewOptions();
+    option.rect = QRect(0, 0, viewport()->width(), 0);
+    return option;
+}
+
+bool ChatWidgetListView::refineVisibleRows()
+{
+    if (m_refining || !model() || m_heights.isEmpty()) {
+        return false;
+    }
+    m_refining = true;
+    QScrollBar* bar = verticalScrollBar();
+    const bool pinnedToBottom = bar->maximum() > 0 && bar->value() >= bar->maximum();
+    const auto* delegate = m_frameBudget > 0 ? qobject_cast<const ChatWidgetDelegate*>(itemDelegate()) : nullptr;
+    const QStyleOptionViewItem option = measureOption();
+    QElapsedTimer clock;
+    clock.start();
+    bool deferred = false;
+    bool changed = false;
+    // 从视口顶部行向下测量：其上方的行高不变，顶部行位置即为锚点
+    for (int pass = 0; pass < kMaxRefinePasses; ++pass) {
+        const int top = bar->value();
+        const int bottom = top + viewport()->height();
+        bool passChanged = false;
+        int row = rowAtOffset(top);
+        for (int y = rowOffset(row); row < m_heights.size() && y < bottom; y += m_heights.at(row), ++row) {
+            if (m_measured.at(row)) {
+                continue;
+            }
+            // 超出预算后需要同步排版的行暂用估算高度，由后续帧补全
+            if (delegate && clock.elapsed() >= m_frameBudget
+                && !delegate->isSizeCached(option, model()->index(row, modelColumn(), rootIndex()))) {
+                deferred = true;
+                continue;
+            }
+            m_measured[row] = true;
+            const int height = measureRow(row);
+            if (height != m_heights.at(row)) {
+                setRowHeight(row, height);
+                passChanged = true;
+            }
+        }
+        if (!passChanged) {
+            break;
+        }
+        changed = true;
+        updateGeometries();
+        if (!pinnedToBottom || bar->value() == bar->maximum()) {
+            break;
+        }
+        // 贴底时行高变化会改变滚动范围，跟随到底部后再测量新露出的行
+        bar->setValue(bar->maximum());
+    }
+    m_refining = false;
+    if (deferred) {
+        scheduleResolve();
+    }
+    return changed;
+}
+
+void ChatWidgetListView::setRowHeight(int row, int height)
+{
+    const int delta = height - m_heights.at(row);
+    m_heights[row] = height;
+    m_totalHeight += delta;
+    for (int i = row + 1; i < m_tree.size(); i += i & -i) {
+        m_tree[i] += delta;
+    }
+}
+
+void ChatWidgetListView::rebuildOffsets()
+{
+    const int count = m_heights.size();
+    m_tree.fill(0, count + 1);
+    m_totalHeight = 0;
+    for (int i = 1; i <= count; ++i) {
+        m_tree[i] += m_heights.at(i - 1);
+        m_totalHeight += m_heights.at(i - 1);
+        const int parent = i + (i & -i);
+        if (parent <= count) {
+            m_tree[parent] += m_tree[i];
+        }
+    }
+}
+
+int ChatWidgetListView::rowOffset(int row) const
+{
+    int offset = 0;
+    for (int i = qMin(row, m_heights.size()); i > 0; i -= i & -i) {
+        offset += m_tree.at(i);
+    }
+    return offset;
+}
+
+int ChatWidgetListView::rowAtOffset(int y) const
+{
+    // 返回起始偏移不大于 y 的最后一行
+    const int count = m_heights.size();
+    if (count == 0) {
+        return 0;
+    }
+    int step = 1;
+    while (step * 2 <= count) {
+        step *= 2;
+    }
+    int position = 0;
+    int remaining = y;
+    for (; step > 0; step /= 2) {
+        if (position + step <= count && m_tree.at(position + step) <= remaining) {
+            position += step;
+            remaining -= m_tree.at(position);
+        }
+    }
+    return qMin(position, count - 1);
+}
@@ -0,0 +1,114 @@
+#ifndef CHAT_WIDGET_LIST_VIEW_H
+#define CHAT_WIDGET_LIST_VIEW_H
+
+#include <QListView>
+#include <QMetaObject>
+#include <QTimer>
+#include <QVector>
+
+// 按估算行高布局的聊天列表。行高先取委托的估算值（ChatWidgetDelegate::estimatedHeight，
+// 其他委托退化为 sizeHint），只有进入视口的行才调用 sizeHint 精确测量；偏移量用树状数组维护，
+// 定位与修正均为 O(log n)。修正行高时以视口顶部行为锚点，已显示的内容不会跳动。
+// 宽度变化时只有文本排版档位改变才重新测量：先测视口内的行，视口外的行在尺寸稳定后
+// 于空闲时分片测量（由近及远，可取消），滚动范围逐步收敛而不阻塞拖动缩放。
+// 每帧的排版有预算：大量未排版的行同时进入视口（跳转、搜索定位、窗口恢复）时，超出预算的行
+// 先画骨架气泡，之后各帧按离视口中心由近及远补全，全部完成时发出 viewportResolved。
+// 仅支持单列列表模型；保留 QListView 类型以沿用样式表选择器。
+class ChatWidgetListView : public QListView {
+    Q_OBJECT
+
+public:
+    explicit ChatWidgetListView(QWidget* parent = nullptr);
+
+    void setModel(QAbstractItemModel* model) override;
+    void reset() override;
+    void doItemsLayout() override;
+
+    QRect visualRect(const QModelIndex& index) const override;
+    QModelIndex indexAt(const QPoint& point) const override;
+    void scrollTo(const QModelIndex& index, ScrollHint hint = EnsureVisible) override;
+
+    // 已知的内容总高度（含估算值）
+    int contentHeight() const;
+    // 行高是否已由 sizeHint 测量（否则为估算值）
+    bool isRowMeasured(int row) const;
+    // 重新估算指定的未测量行（如后台预渲染已得出实际高度），O(k log n)
+    void refreshEstimates(const QVector<int>& rows);
+    // 行的排版已失效（如流式输出结束后重建文档）：在视口内时立即重新测量
+    void remeasureRow(int row);
+
+    // 视口外行的空闲重新测量
+    bool isRelayoutPending() const;
+    void cancelRelayout();
+
+    // 每帧用于测量与排版新行的时间预算（毫秒），0 表示不限制
+    void setFrameBudget(int msecs);
+    int frameBudget() const;
+    // 视口内的行是否都已测量并以完整排版绘制
+    bool isViewportResolved() const;
+
+signals:
+    // measured 为本轮已处理的视口外行数
+    void relayoutProgress(int measured, int total);
+    void relayoutFinished();
+    // 视口内的骨架行全部补全
+    void viewportResolved();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void updateGeometries() override;
+    void rowsInserted(const QModelIndex& parent, int start, int end) override;
+    void dataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                     const QVector<int>& roles = QVector<int>()) override;
+
+    QModelIndex moveCursor(CursorAction cursorAction, Qt::KeyboardModifiers modifiers) override;
+    int horizontalOffset() const override;
+    int verticalOffset() const override;
+    bool isIndexHidden(const QModelIndex& index) const override;
+    void setSelection(const QRect& rect, QItemSelectionModel::SelectionFlags command) override;
+    QRegion visualRegionForSelection(const QItemSelection& selection) const override;
+
+private:
+    void onRowsRemoved(const QModelIndex& parent, int first, int last);
+    void invalidateRows();
+    void estimateAllRows();
+    int estimateRow(int row) const;
+    int measureRow(int row) const;
+    // 测量视口内尚未测量的行，返回是否有行高变化；修正前贴底的视图修正后仍保持贴底
+    bool refineVisibleRows();
+    void setRowHeight(int row, int height);
+    int layoutBucket() const;
+    void startRelayout();
+    void relayoutSlice();
+    // 视口内的行，按离视口中心由近及远排列
+    QVector<int> visibleRowsByPriority() const;
+    QStyleOptionViewItem measureOption() const;
+    void scheduleResolve();
+    void resolveSlice();
+
+    // 树状数组：前缀和即行的起始偏移
+    void rebuildOffsets();
+    int rowOffset(int row) const;
+    int rowAtOffset(int y) const;
+
+    QVector<int> m_heights;
+    QVector<bool> m_measured;
+    QVector<int> m_tree;
+    int m_totalHeight = 0;
+    int m_layoutBucket = 0;
+    bool m_refining = false;
+    QMetaObject::Connection m_rowsRemovedConnection;
+    QTimer m_resizeSettleTimer;
+    QTimer m_relayoutTimer;
+    int m_relayoutUp = -1;   // 向上推进的下一行
+    int m_relayoutDown = 0;  // 向下推进的下一行
+    int m_relayoutDone = 0;
+    int m_relayoutTotal = 0;
+    QTimer m_resolveTimer;
+    int m_frameBudget;
+    bool m_unresolved = false; // 视口内有未测量或以骨架绘制的行
+};
+
+#endif // CHAT_WIDGET_LIST_VIEW_H
@@ -0,0 +1,549 @@
+#include "chat_widget_markdown_document_builder.h"
+#include "chat_widget_markdown_utils.h"
+#include "md4c.h"
+#include <QDebug>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextList>
+#include <QTextTable>
+#include <QVector>
+
+namespace {
+const int kBlockSpacing = 12; // 与 Qt HTML 导入中 <p>、<ul>、<pre>、<h4> 的上边距一致
+const int kQuoteIndent = 40;  // 与 <blockquote> 的左右边距一致
+const int kTableCellPadding = 4;
+
+// 预构建的格式：首次使用时创建，之后只复制（隐式共享，引用计数为原子操作，可跨线程读取）
+struct Formats {
+    Formats();
+
+    QTextCharFormat emphasis;
+    QTextCharFormat strong;
+    QTextCharFormat underline;
+    QTextCharFormat strikeOut;
+    QTextCharFormat code;
+    QTextCharFormat link;
+    QTextCharFormat image;
+    QTextCharFormat tableHeader;
+    QTextCharFormat headings[6];
+    QTextBlockFormat rule;
+    QTextTableFormat table;
+};
+
+Formats::Formats()
+{
+    emphasis.setFontItalic(true);
+    strong.setFontWeight(QFont::Bold);
+    underline.setFontUnderline(true);
+    strikeOut.setFontStrikeOut(true);
+    // 与 Qt HTML 导入中 <code> 的字体一致
+    code.setFontFamily(QStringLiteral("Courier New,courier"));
+    code.setFontFixedPitch(true);
+    link.setAnchor(true);
+    link.setFontUnderline(true);
+    link.setForeground(QColor(0, 102, 204));
+    image.setFontItalic(true);
+    tableHeader.setFontWeight(QFont::Bold);
+    // h1..h6 对应 xx-large..x-small
+    const int sizeAdjustments[6] = {3, 2, 1, 0, -1, -2};
+    for (int level = 0; level < 6; ++level) {
+        headings[level].setFontWeight(QFont::Bold);
+        headings[level].setProperty(QTextFormat::FontSizeAdjustment, sizeAdjustments[level]);
+    }
+    rule.setProperty(QTextFormat::BlockTrailingHorizontalRulerWidth, QTextLength(QTextLength::PercentageLength, 100));
+    table.setBorder(1);
+    table.setBorderStyle(QTextFrameFormat::BorderStyle_Solid);
+    table.setBorderBrush(QColor(220, 220, 220));
+    table.setCellSpacing(0);
+    table.setCellPadding(kTableCellPadding);
+    table.setTopMargin(kBlockSpacing);
+}
+
+const Formats& formats()
+{
+    static const Formats instance;
+    return instance;
+}
+
+QString attributeText(const MD_ATTRIBUTE& attribute)
+{
+    QString result;
+    for (int i = 0; attribute.substr_offsets[i] < attribute.size; ++i) {
+        const MD_OFFSET offset = attribute.substr_offsets[i];
+        const MD_SIZE size = attribute.substr_offsets[i + 1] - offset;
+        const MD_CHAR* text = attribute.text + offset;
+        switch (attribute.substr_types[i]) {
+        case MD_TEXT_NULLCHAR:
+            result += QChar(QChar::ReplacementCharacter);
+            break;
+        case MD_TEXT_ENTITY:
+            result += ChatWidgetMarkdownUtils::decodeEntity(text, size);
+            break;
+        default:
+            result += QString::fromUtf8(text, int(size));
+            break;
+        }
+    }
+    return result;
+}
+
+Qt::Alignment cellAlignment(MD_ALIGN align, bool header)
+{
+    switch (align) {
+    case MD_ALIGN_LEFT:
+        return Qt::AlignLeft;
+    case MD_ALIGN_CENTER:
+        return Qt::AlignHCenter;
+    case MD_ALIGN_RIGHT:
+        return Qt::AlignRight;
+    default:
+        return header ? Qt::AlignHCenter : Qt::AlignLeft;
+    }
+}
+
+// 解析回调的状态：块结构以光标插入，文本按当前字符格式合并后一次插入
+class DocumentBuilder {
+public:
+    explicit DocumentBuilder(QTextCursor& cursor)
+        : m_cursor(cursor)
+        , m_reuseBlock(cursor.block().length() <= 1)
+    {
+        m_formats.append(QTextCharFormat());
+    }
+
+    bool parse(const QString& markdown)
+    {
+        MD_PARSER parser = {};
+        parser.flags = ChatWidgetMarkdownUtils::parserFlags();
+        parser.enter_block = &DocumentBuilder::enterBlock;
+        parser.leave_block = &DocumentBuilder::leaveBlock;
+        parser.enter_span = &DocumentBuilder::enterSpan;
+        parser.leave_span = &DocumentBuilder::leaveSpan;
+        parser.text = &DocumentBuilder::text;
+        const QByteArray utf8 = markdown.toUtf8();
+        const int ret = md_parse(utf8.constData(), MD_SIZE(utf8.size()), &parser, this);
+        flush();
+        return ret == 0;
+    }
+
+private:
+    struct ListLevel {
+        QTextListFormat format;
+        QTextList* list = nullptr;
+        bool loose = false;
+        bool firstItem = true;
+    };
+
+    static int enterBlock(MD_BLOCKTYPE type, void* detail, void* userdata)
+    {
+        static_cast<DocumentBuilder*>(userdata)->onEnterBlock(type, detail);
+        return 0;
+    }
+    static int leaveBlock(MD_BLOCKTYPE type, void* /*detail*/, void* userdata)
+    {
+        static_cast<DocumentBuilder*>(userdata)->onLeaveBlock(type);
+        return 0;
+    }
+    static int enterSpan(MD_SPANTYPE type, void* detail, void* userdata)
+    {
+        static_cast<DocumentBuilder*>(userdata)->onEnterSpan(type, detail);
+        return 0;
+    }
+    static int leaveSpan(MD_SPANTYPE /*type*/, void* /*detail*/, void* userdata)
+    {
+        static_cast<DocumentBuilder*>(userdata)->popFormat();
+        return 0;
+    }
+    static int text(MD_TEXTTYPE type, const MD_CHAR* text, MD_SIZE size, void* userdata)
+    {
+        static_cast<DocumentBuilder*>(userdata)->onText(type, text, size);
+        return 0;
+    }
+
+    void onEnterBlock(MD_BLOCKTYPE type, void* detail)
+    {
+        switch (type) {
+        case MD_BLOCK_QUOTE:
+            ++m_quoteDepth;
+            break;
+        case MD_BLOCK_UL:
+        case MD_BLOCK_OL: {
+            ListLevel level;
+            if (type == MD_BLOCK_UL) {
+                static const QTextListFormat::Style bullets[] = {QTextListFormat::ListDisc, QTextListFormat::ListCircle,
+                                                                 QTextListFormat::ListSquare};
+                level.format.setStyle(bullets[m_lists.size() % 3]);
+                level.loose = !static_cast<const MD_BLOCK_UL_DETAIL*>(detail)->is_tight;
+            } else {
+                // Qt 5 的 QTextListFormat 不支持起始序号，与 HTML 导入相同从 1 开始
+                level.format.setStyle(QTextListFormat::ListDecimal);
+                level.loose = !static_cast<const MD_BLOCK_OL_DETAIL*>(detail)->is_tight;
+            }
+            level.format.setIndent(m_lists.size() + 1);
+            m_lists.append(level);
+            break;
+        }
+        case MD_BLOCK_LI: {
+            ListLevel& level = m_lists.last();
+            // 列表整体与前文间隔一段，松散列表的各项之间也间隔一段
+            openBlock(blockFormat(level.firstItem ? m_lists.size() == 1 : level.loose, true));
+            if (!level.list) {
+                level.list = m_cursor.createList(level.format);
+            } else {
+                level.list->add(m_cursor.block());
+            }
+            level.firstItem = false;
+            m_itemEmpty = true;
+            const auto* item = static_cast<const MD_BLOCK_LI_DETAIL*>(detail);
+            if (item->is_task) {
+                m_pending += item->task_mark == ' ' ? QStringLiteral("☐ ") : QStringLiteral("☑ ");
+            }
+            break;
+        }
+        case MD_BLOCK_HR: {
+            QTextBlockFormat format = blockFormat(true);
+            format.merge(formats().rule);
+            openBlock(format);
+            break;
+        }
+        case MD_BLOCK_H: {
+            const int level = qBound(1, int(static_cast<const MD_BLOCK_H_DETAIL*>(detail)->level), 6);
+            pushFormat(formats().headings[level - 1]);
+            QTextBlockFormat format = blockFormat(true);
+            format.setHeadingLevel(level);
+            openBlock(format);
+            break;
+        }
+        case MD_BLOCK_CODE:
+            // 每行一个不断行的块，首行在遇到内容时才创建
+            pushFormat(formats().code);
+            m_inCode = true;
+            m_codeNeedsBlock = true;
+            m_codeFirstLine = true;
+            break;
+        case MD_BLOCK_HTML:
+            m_inHtmlBlock = true;
+            m_html.clear();
+            break;
+        case MD_BLOCK_P:
+            // 列表项内的第一段直接写入项自身的块
+            if (!m_itemEmpty) {
+                openBlock(blockFormat(true));
+            }
+            break;
+        case MD_BLOCK_TABLE: {
+            const auto* table = static_cast<const MD_BLOCK_TABLE_DETAIL*>(detail);
+            flush();
+            QTextTableFormat format = formats().table;
+            if (isAtDocumentStart()) {
+                format.setTopMargin(0);
+            }
+            if (m_quoteDepth > 0) {
+                format.setLeftMargin(kQuoteIndent * m_quoteDepth);
+            }
+            m_tableRows = qMax(1, int(table->head_row_count + table->body_row_count));
+            m_tableColumns = qMax(1, int(table->col_count));
+            m_table = m_cursor.insertTable(m_tableRows, m_tableColumns, format);
+            m_reuseBlock = false;
+            m_itemEmpty = false;
+            m_row = -1;
+            break;
+        }
+        case MD_BLOCK_TR:
+            ++m_row;
+            m_column = -1;
+            break;
+        case MD_BLOCK_TH:
+        case MD_BLOCK_TD: {
+            flush();
+            ++m_column;
+            const bool header = type == MD_BLOCK_TH;
+            if (m_table && m_row < m_tableRows && m_column < m_tableColumns) {
+                m_cursor = m_table->cellAt(m_row, m_column).firstCursorPosition();
+                QTextBlockFormat format;
+                format.setAlignment(cellAlignment(static_cast<const MD_BLOCK_TD_DETAIL*>(detail)->align, header));
+                m_cursor.setBlockFormat(format);
+            }
+            pushFormat(header ? formats().tableHeader : QTextCharFormat());
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void onLeaveBlock(MD_BLOCKTYPE type)
+    {
+        switch (type) {
+        case MD_BLOCK_QUOTE:
+            flush();
+            --m_quoteDepth;
+            break;
+        case MD_BLOCK_UL:
+        case MD_BLOCK_OL:
+            flush();
+            m_lists.removeLast();
+            m_itemEmpty = false;
+            break;
+        case MD_BLOCK_H:
+            popFormat();
+            break;
+        case MD_BLOCK_CODE:
+            m_inCode = false;
+            popFormat();
+            break;
+        case MD_BLOCK_HTML:
+            // 原始 HTML 块是完整片段，交给 Qt 解析
+            m_inHtmlBlock = false;
+            openBlock(blockFormat(true));
+            m_cursor.insertHtml(m_html);
+            m_html.clear();
+            break;
+        case MD_BLOCK_TH:
+        case MD_BLOCK_TD:
+            popFormat();
+            break;
+        case MD_BLOCK_TABLE:
+            flush();
+            if (m_table) {
+                // 表格之后总有一个空块，后续内容直接使用
+                m_cursor = m_table->lastCursorPosition();
+                m_cursor.movePosition(QTextCursor::NextBlock);
+                m_reuseBlock = m_cursor.block().length() <= 1;
+                m_table = nullptr;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onEnterSpan(MD_SPANTYPE type, void* detail)
+    {
+        const Formats& shared = formats();
+        switch (type) {
+        case MD_SPAN_EM:
+            pushFormat(shared.emphasis);
+            break;
+        case MD_SPAN_STRONG:
+            pushFormat(shared.strong);
+            break;
+        case MD_SPAN_U:
+            pushFormat(shared.underline);
+            break;
+        case MD_SPAN_DEL:
+            pushFormat(shared.strikeOut);
+            break;
+        case MD_SPAN_CODE:
+            pushFormat(shared.code);
+            break;
+        case MD_SPAN_A: {
+            const auto* link = static_cast<const MD_SPAN_A_DETAIL*>(detail);
+            QTextCharFormat format = shared.link;
+            format.setAnchorHref(attributeText(link->href));
+            const QString title = attributeText(link->title);
+            if (!title.isEmpty()) {
+                format.setToolTip(title);
+            }
+            pushFormat(format);
+            break;
+        }
+        case MD_SPAN_IMG:
+            // 只显示替代文本，不在解析时加载图片
+            pushFormat(shared.image);
+            break;
+        default:
+            pushFormat(QTextCharFormat());
+            break;
+        }
+    }
+
+    void onText(MD_TEXTTYPE type, const MD_CHAR* text, MD_SIZE size)
+    {
+        switch (type) {
+        case MD_TEXT_NULLCHAR:
+            appendText(QString(QChar(QChar::ReplacementCharacter)));
+            break;
+        case MD_TEXT_BR:
+            appendText(QString(QChar(QChar::LineSeparator)));
+            break;
+        case MD_TEXT_SOFTBR:
+            appendText(QStringLiteral(" "));
+            break;
+        case MD_TEXT_ENTITY:
+            appendText(ChatWidgetMarkdownUtils::decodeEntity(text, size));
+            break;
+        case MD_TEXT_HTML:
+            if (m_inHtmlBlock) {
+                m_html += QString::fromUtf8(text, int(size));
+            } else if (ChatWidgetMarkdownUtils::isLineBreakTag(text, size)) {
+                // 行内原始 HTML 只识别换行，其余标签丢弃、保留其间的文本
+                appendText(QString(QChar(QChar::LineSeparator)));
+            }
+            break;
+        case MD_TEXT_CODE:
+            if (m_inCode) {
+                appendCode(QString::fromUtf8(text, int(size)));
+            } else {
+                appendText(QString::fromUtf8(text, int(size)));
+            }
+            break;
+        default:
+            appendText(QString::fromUtf8(text, int(size)));
+            break;
+        }
+    }
+
+    bool isAtDocumentStart() const
+    {
+        return m_reuseBlock && m_cursor.block().position() == 0;
+    }
+
+    // 列表项的缩进由 QTextList 决定，项内的其他块按列表层级缩进以与项文本对齐
+    QTextBlockFormat blockFormat(bool spaced, bool listItem = false) const
+    {
+        QTextBlockFormat format;
+        if (spaced && !isAtDocumentStart()) {
+            format.setTopMargin(kBlockSpacing);
+        }
+        if (m_quoteDepth > 0) {
+            format.setLeftMargin(kQuoteIndent * m_quoteDepth);
+            format.setRightMargin(kQuoteIndent);
+        }
+        if (!listItem && !m_lists.isEmpty()) {
+            format.setIndent(m_lists.size());
+        }
+        return format;
+    }
+
+    void openBlock(const QTextBlockFormat& format)
+    {
+        flush();
+        if (m_reuseBlock) {
+            m_cursor.setBlockFormat(format);
+            m_cursor.setBlockCharFormat(m_formats.last());
+            m_reuseBlock = false;
+        } else {
+            m_cursor.insertBlock(format, m_formats.last());
+        }
+        m_itemEmpty = false;
+    }
+
+    void pushFormat(const QTextCharFormat& format)
+    {
+        flush();
+        QTextCharFormat merged = m_formats.last();
+        merged.merge(format);
+        m_formats.append(merged);
+    }
+
+    void popFormat()
+    {
+        flush();
+        if (m_formats.size() > 1) {
+            m_formats.removeLast();
+        }
+    }
+
+    void appendText(const QString& text)
+    {
+        m_pending += text;
+        m_itemEmpty = false;
+    }
+
+    // 代码块文本含换行：每行一个块，末尾的换行不产生空块
+    void appendCode(const QString& text)
+    {
+        int from = 0;
+        for (;;) {
+            const int newline = text.indexOf(QLatin1Char('\n'), from);
+            const QStringRef line = text.midRef(from, newline < 0 ? -1 : newline - from);
+            if (!line.isEmpty()) {
+                openCodeLine();
+                m_pending += line;
+            }
+            if (newline < 0) {
+                break;
+            }
+            openCodeLine();
+            flush();
+            m_codeNeedsBlock = true;
+            from = newline + 1;
+        }
+    }
+
+    void openCodeLine()
+    {
+        if (!m_codeNeedsBlock) {
+            return;
+        }
+        QTextBlockFormat format = blockFormat(m_codeFirstLine);
+        format.setNonBreakableLines(true);
+        openBlock(format);
+        m_codeNeedsBlock = false;
+        m_codeFirstLine = false;
+    }
+
+    void flush()
+    {
+        if (m_pending.isEmpty()) {
+            return;
+        }
+        m_cursor.insertText(m_pending, m_formats.last());
+        m_pending.clear();
+    }
+
+    QTextCursor& m_cursor;
+    QVector<QTextCharFormat> m_formats; // 字符格式栈，末尾为当前格式
+    QVector<ListLevel> m_lists;
+    QString m_pending;         // 以当前格式待插入的文本
+    bool m_reuseBlock;         // 光标所在的空块尚未使用，下一个块直接占用
+    bool m_itemEmpty = false;  // 刚打开的列表项块尚无内容
+    int m_quoteDepth = 0;
+    bool m_inCode = false;
+    bool m_codeNeedsBlock = false;
+    bool m_codeFirstLine = false;
+    bool m_inHtmlBlock = false;
+    QString m_html;
+    QTextTable* m_table = nullptr;
+    int m_tableRows = 0;
+    int m_tableColumns = 0;
+    int m_row = -1;
+    int m_column = -1;
+};
+} // namespace
+
+bool ChatWidgetMarkdownDocumentBuilder::build(const QString& markdown, QTextDocument* document)
+{
+    if (!document) {
+        return false;
+    }
+    const bool undoRedo = document->isUndoRedoEnabled();
+    document->setUndoRedoEnabled(false);
+    document->clear();
+    QTextCursor cursor(document);
+    const bool ok = insert(cursor, markdown);
+    document->setUndoRedoEnabled(undoRedo);
+    return ok;
+}
+
+bool ChatWidgetMarkdownDocumentBuilder::insert(QTextCursor& cursor, const QString& markdown)
+{
+    if (markdown.isEmpty()) {
+        return true;
+    }
+    const int start = cursor.position();
+    // 编辑块内的插入只在结束时通知排版一次
+    cursor.beginEditBlock();
+    DocumentBuilder builder(cursor);
+    const bool ok = builder.parse(markdown);
+    if (!ok) {
+        qWarning() << "Markdown parsing failed";
+        cursor.setPosition(start, QTextCursor::KeepAnchor);
+        cursor.removeSelectedText();
+        cursor.insertText(markdown);
+    }
+    cursor.endEditBlock();
+    return ok;
+}
@@ -0,0 +1,22 @@
+#ifndef CHAT_WIDGET_MARKDOWN_DOCUMENT_BUILDER_H
+#define CHAT_WIDGET_MARKDOWN_DOCUMENT_BUILDER_H
+
+#include <QString>
+
+class QTextCursor;
+class QTextDocument;
+
+// 由 md4c 解析回调直接经 QTextCursor 构建文档，不生成 HTML、也不经 QTextDocument 的 HTML 解析。
+// 块与字符格式预先构建并在线程间共享（只读），可在预渲染线程中使用。
+// 段落、标题、列表、引用、代码块与表格的结构与 setHtml(md_html 输出) 一致：代码块每行一个
+// 不断行的块，列表使用 QTextList，表格使用 QTextTable。行内原始 HTML 除 <br> 外只保留其中的文本。
+class ChatWidgetMarkdownDocumentBuilder {
+public:
+    // 替换 document 的全部内容（不记录撤销）
+    static bool build(const QString& markdown, QTextDocument* document);
+    // 在 cursor 处插入；cursor 所在块为空时直接使用该块，完成后 cursor 位于插入内容之后。
+    // 解析失败时以纯文本插入并返回 false
+    static bool insert(QTextCursor& cursor, const QString& markdown);
+};
+
+#endif // CHAT_WIDGET_MARKDOWN_DOCUMENT_BUILDER_H
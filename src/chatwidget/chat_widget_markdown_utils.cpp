@@ -3,12 +3,257 @@
 #include <QByteArray>
 #include <QDebug>
 
+extern "C" {
+#include "entity.h"
+}
+
 static void process_output(const MD_CHAR* text, MD_SIZE size, void* userdata)
 {
     QString* out = static_cast<QString*>(userdata);
     out->append(QString::fromUtf8(text, size));
 }
 
+namespace {
+QString codepointText(uint codepoint)
+{
+    if (codepoint == 0 || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        codepoint = QChar::ReplacementCharacter;
+    }
+    return QString::fromUcs4(&codepoint, 1);
+}
+
+// 渲染结果与原文相同：单个段落、没有块标记与行内标记，首尾不是空白（md4c 会去掉）
+bool rendersVerbatim(const QString& markdown)
+{
+    static const QString kMarkup = QStringLiteral("\\`*_[]<>&!~|#=+-:");
+    if (markdown.isEmpty() || markdown.at(0).isSpace() || markdown.at(0).isDigit()
+        || markdown.at(markdown.size() - 1).isSpace()) {
+        return false;
+    }
+    for (const QChar ch : markdown) {
+        if (ch == QLatin1Char('\n') || ch == QLatin1Char('\r') || ch == QLatin1Char('\t') || ch.unicode() == 0
+            || kMarkup.contains(ch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 原始 HTML 块交给 insertHtml 后的文字：标签丢弃（<br> 换行），实体解码，连续空白折叠为一个空格
+QString htmlText(const QString& html)
+{
+    QString result;
+    bool pendingSpace = false;
+    for (int i = 0; i < html.size(); ++i) {
+        const QChar ch = html.at(i);
+        if (ch == QLatin1Char('<')) {
+            const int close = html.indexOf(QLatin1Char('>'), i);
+            if (close < 0) {
+                break;
+            }
+            const QByteArray tag = html.mid(i, close - i + 1).toUtf8();
+            if (ChatWidgetMarkdownUtils::isLineBreakTag(tag.constData(), unsigned(tag.size()))) {
+                result += QChar(QChar::LineSeparator);
+                pendingSpace = false;
+            }
+            i = close;
+            continue;
+        }
+        if (ch.isSpace()) {
+            pendingSpace = !result.isEmpty() && result.at(result.size() - 1) != QChar(QChar::LineSeparator);
+            continue;
+        }
+        if (pendingSpace) {
+            result += QLatin1Char(' ');
+            pendingSpace = false;
+        }
+        const int semicolon = ch == QLatin1Char('&') ? html.indexOf(QLatin1Char(';'), i) : -1;
+        if (semicolon > i + 1 && semicolon - i <= 32) {
+            const QByteArray entity = html.mid(i, semicolon - i + 1).toUtf8();
+            result += ChatWidgetMarkdownUtils::decodeEntity(entity.constData(), unsigned(entity.size()));
+            i = semicolon;
+        } else {
+            result += ch;
+        }
+    }
+    return result;
+}
+
+// 解析回调的状态：与 ChatWidgetMarkdownDocumentBuilder 产生相同的文字，块之间插入 U+2029
+class TextCollector {
+public:
+    bool parse(const QString& markdown)
+    {
+        MD_PARSER parser = {};
+        parser.flags = ChatWidgetMarkdownUtils::parserFlags();
+        parser.enter_block = &TextCollector::enterBlock;
+        parser.leave_block = &TextCollector::leaveBlock;
+        parser.enter_span = &TextCollector::span;
+        parser.leave_span = &TextCollector::span;
+        parser.text = &TextCollector::text;
+        const QByteArray utf8 = markdown.toUtf8();
+        return md_parse(utf8.constData(), MD_SIZE(utf8.size()), &parser, this) == 0;
+    }
+
+    QString result() const
+    {
+        return m_text.endsWith(QChar(QChar::ParagraphSeparator)) ? m_text.left(m_text.size() - 1) : m_text;
+    }
+
+private:
+    static int enterBlock(MD_BLOCKTYPE type, void* detail, void* userdata)
+    {
+        static_cast<TextCollector*>(userdata)->onEnterBlock(type, detail);
+        return 0;
+    }
+    static int leaveBlock(MD_BLOCKTYPE type, void* /*detail*/, void* userdata)
+    {
+        static_cast<TextCollector*>(userdata)->onLeaveBlock(type);
+        return 0;
+    }
+    static int span(MD_SPANTYPE /*type*/, void* /*detail*/, void* /*userdata*/)
+    {
+        // 行内格式不影响文字；链接只保留链接文本，图片只保留替代文本
+        return 0;
+    }
+    static int text(MD_TEXTTYPE type, const MD_CHAR* text, MD_SIZE size, void* userdata)
+    {
+        static_cast<TextCollector*>(userdata)->onText(type, text, size);
+        return 0;
+    }
+
+    void onEnterBlock(MD_BLOCKTYPE type, void* detail)
+    {
+        switch (type) {
+        case MD_BLOCK_LI: {
+            separate();
+            const auto* item = static_cast<const MD_BLOCK_LI_DETAIL*>(detail);
+            if (item->is_task) {
+                m_text += item->task_mark == ' ' ? QStringLiteral("☐ ") : QStringLiteral("☑ ");
+            }
+            m_itemEmpty = true;
+            break;
+        }
+        case MD_BLOCK_P:
+            // 列表项内的第一段直接写入项自身的块
+            if (!m_itemEmpty) {
+                separate();
+            }
+            break;
+        case MD_BLOCK_CODE:
+            m_inCode = true;
+            separate();
+            break;
+        case MD_BLOCK_HTML:
+            m_inHtmlBlock = true;
+            m_html.clear();
+            separate();
+            break;
+        case MD_BLOCK_H:
+        case MD_BLOCK_HR:
+        case MD_BLOCK_TABLE:
+        case MD_BLOCK_TH:
+        case MD_BLOCK_TD:
+            separate();
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onLeaveBlock(MD_BLOCKTYPE type)
+    {
+        switch (type) {
+        case MD_BLOCK_UL:
+        case MD_BLOCK_OL:
+            m_itemEmpty = false;
+            break;
+        case MD_BLOCK_CODE:
+            m_inCode = false;
+            break;
+        case MD_BLOCK_HTML:
+            m_inHtmlBlock = false;
+            appendText(htmlText(m_html));
+            m_html.clear();
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onText(MD_TEXTTYPE type, const MD_CHAR* text, MD_SIZE size)
+    {
+        switch (type) {
+        case MD_TEXT_NULLCHAR:
+            appendText(QString(QChar(QChar::ReplacementCharacter)));
+            break;
+        case MD_TEXT_BR:
+            appendText(QString(QChar(QChar::LineSeparator)));
+            break;
+        case MD_TEXT_SOFTBR:
+            appendText(QStringLiteral(" "));
+            break;
+        case MD_TEXT_ENTITY:
+            appendText(ChatWidgetMarkdownUtils::decodeEntity(text, size));
+            break;
+        case MD_TEXT_HTML:
+            if (m_inHtmlBlock) {
+                m_html += QString::fromUtf8(text, int(size));
+            } else if (ChatWidgetMarkdownUtils::isLineBreakTag(text, size)) {
+                appendText(QString(QChar(QChar::LineSeparator)));
+            }
+            break;
+        case MD_TEXT_CODE:
+            if (m_inCode) {
+                // 代码块每行一个块，末尾的换行不产生空块
+                const QString code = QString::fromUtf8(text, int(size));
+                int from = 0;
+                for (int newline = code.indexOf(QLatin1Char('\n')); newline >= 0;
+                     newline = code.indexOf(QLatin1Char('\n'), from)) {
+                    appendText(code.mid(from, newline - from));
+                    separate();
+                    from = newline + 1;
+                }
+                appendText(code.mid(from));
+            } else {
+                appendText(QString::fromUtf8(text, int(size)));
+            }
+            break;
+        default:
+            appendText(QString::fromUtf8(text, int(size)));
+            break;
+        }
+    }
+
+    void appendText(const QString& text)
+    {
+        if (!text.isEmpty()) {
+            m_text += text;
+            m_itemEmpty = false;
+        }
+    }
+
+    void separate()
+    {
+        if (!m_text.isEmpty() && !m_text.endsWith(QChar(QChar::ParagraphSeparator))) {
+            m_text += QChar(QChar::ParagraphSeparator);
+        }
+    }
+
+    QString m_text;
+    bool m_itemEmpty = false; // 刚打开的列表项尚无内容
+    bool m_inCode = false;
+    bool m_inHtmlBlock = false;
+    QString m_html;
+};
+} // namespace
+
+unsigned ChatWidgetMarkdownUtils::parserFlags()
+{
+    // GFM Dialect + Tables + Underline + Strikethrough
+    return MD_DIALECT_GITHUB | MD_FLAG_UNDERLINE | MD_FLAG_STRIKETHROUGH | MD_FLAG_TABLES | MD_FLAG_TASKLISTS;
+}
+
 QString ChatWidgetMarkdownUtils::renderMarkdown(const QString& input)
 {
     if (input.isEmpty()) {
@@ -18,8 +263,7 @@ QString ChatWidgetMarkdownUtils::renderMarkdown(const QString& input)
     QByteArray ba = input.toUtf8();
     QString output;
 
-    // GFM Dialect + Tables + Underline + Strikethrough
-    unsigned parser_flags = MD_DIALECT_GITHUB | MD_FLAG_UNDERLINE | MD_FLAG_STRIKETHROUGH | MD_FLAG_TABLES | MD_FLAG_TASKLISTS;
+    unsigned parser_flags = parserFlags();
     unsigned renderer_flags = MD_HTML_FLAG_DEBUG;
 
     int ret = md_html(ba.data(), ba.size(), process_output, &output, parser_flags, renderer_flags);
@@ -31,3 +275,43 @@ QString ChatWidgetMarkdownUtils::renderMarkdown(const QString& input)
 
     return output;
 }
+
+QString ChatWidgetMarkdownUtils::plainText(const QString& markdown)
+{
+    if (markdown.isEmpty() || rendersVerbatim(markdown)) {
+        return markdown;
+    }
+    TextCollector collector;
+    if (!collector.parse(markdown)) {
+        // 与文档构建相同：解析失败时按原文显示
+        return markdown;
+    }
+    return collector.result();
+}
+
+QString ChatWidgetMarkdownUtils::decodeEntity(const char* text, unsigned size)
+{
+    if (size >= 4 && text[1] == '#') {
+        const bool hex = text[2] == 'x' || text[2] == 'X';
+        const int digitsStart = hex ? 3 : 2;
+        bool ok = false;
+        const uint codepoint = QByteArray(text + digitsStart, int(size) - digitsStart - 1).toUInt(&ok, hex ? 16 : 10);
+        return codepointText(ok ? codepoint : 0);
+    }
+    if (const ENTITY* entity = entity_lookup(text, size)) {
+        QString decoded = codepointText(entity->codepoints[0]);
+        if (entity->codepoints[1]) {
+            decoded += codepointText(entity->codepoints[1]);
+        }
+        return decoded;
+    }
+    return QString::fromUtf8(text, int(size));
+}
+
+bool ChatWidgetMarkdownUtils::isLineBreakTag(const char* text, unsigned size)
+{
+    QByteArray tag(text, int(size));
+    tag = tag.toLower();
+    tag.replace(' ', QByteArray());
+    return tag == "<br>" || tag == "<br/>";
+}
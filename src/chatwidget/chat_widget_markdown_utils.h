@@ -5,7 +5,18 @@
 
 class ChatWidgetMarkdownUtils {
 public:
+    // Markdown 转 HTML（md_html）；显示用的文档请直接由 ChatWidgetMarkdownDocumentBuilder 构建
     static QString renderMarkdown(const QString& input);
+    // 两种渲染路径共用的 md4c 解析选项：GFM + 下划线 + 删除线 + 表格 + 任务列表
+    static unsigned parserFlags();
+    // ChatWidgetMarkdownDocumentBuilder 所建文档的纯文本（块、表格单元格之间以 U+2029 分隔），
+    // 只走 md4c 解析回调、不构建 QTextDocument，供检索在与高亮相同的文字上匹配。
+    // 单行且不含 Markdown 标记字符的常见消息直接返回原文
+    static QString plainText(const QString& markdown);
+    // md4c 原样传出的实体文本（"&amp;"、"&#123;"、"&#x1F600;"），按 md_html 的规则解码
+    static QString decodeEntity(const char* text, unsigned size);
+    // 行内原始 HTML 中只识别换行标签 <br>
+    static bool isLineBreakTag(const char* text, unsigned size);
 };
 
 #endif // CHAT_WIDGET_MARKDOWN_UTILS_H
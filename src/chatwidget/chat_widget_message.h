@@ -0,0 +1,74 @@
+#ifndef CHAT_WIDGET_MESSAGE_H
+#define CHAT_WIDGET_MESSAGE_H
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+struct ChatWidgetReaction {
+    QString emoji;
+    int count = 0;
+
+    ChatWidgetReaction() = default;
+    ChatWidgetReaction(const QString& emojiValue, int countValue)
+        : emoji(emojiValue)
+        , count(countValue)
+    {
+    }
+};
+
+inline bool operator==(const ChatWidgetReaction& lhs, const ChatWidgetReaction& rhs)
+{
+    return lhs.emoji == rhs.emoji && lhs.count == rhs.count;
+}
+
+inline bool operator!=(const ChatWidgetReaction& lhs, const ChatWidgetReaction& rhs)
+{
+    return !(lhs == rhs);
+}
+
+struct ChatWidgetMessage {
+    enum class MessageType {
+        Text,
+        Image,
+        File,
+        System,
+        DateSeparator
+    };
+
+    enum class MessageStatus {
+        Sending,
+        Sent,
+        Failed,
+        Read
+    };
+
+    QString senderId;    // 发送者ID（多人聊天用）
+    QString sender;      // 发送者姓名
+    QString content;     // 消息内容
+    QString avatarPath;  // 头像路径
+    QDateTime timestamp; // 时间戳
+    bool isMine = false; // 是否是我发的消息
+    QString messageId;   // 消息唯一ID
+
+    MessageType messageType = MessageType::Text;
+    MessageStatus status = MessageStatus::Sent;
+
+    QString imagePath;
+    QString filePath;
+    QString fileName;
+    qint64 fileSize = 0;
+
+    QString replyToMessageId;
+    QString replySender;
+    QString replyPreview;
+    bool isForwarded = false;
+    QString forwardedFrom;
+
+    QList<ChatWidgetReaction> reactions;
+    QStringList mentions;
+};
+
+#endif // CHAT_WIDGET_MESSAGE_H
@@ -0,0 +1,625 @@
+#include "chat_widget_message_store.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr quint8 kTypeMask = 0x07;
+constexpr int kStatusShift = 3;
+constexpr quint8 kStatusMask = 0x18;
+constexpr quint8 kIsMineBit = 0x20;
+constexpr quint8 kUtcBit = 0x40;
+constexpr quint8 kHasTimestampBit = 0x80;
+
+const QString& emptyString()
+{
+    static const QString empty;
+    return empty;
+}
+
+// 有 senderId 的参与者按 id 索引；没有 id 的按显示名与头像索引，以分隔符开头避免与 id 冲突
+QString participantKey(const QString& senderId, const QString& sender, const QString& avatarPath)
+{
+    if (!senderId.isEmpty()) {
+        return senderId;
+    }
+    const QChar separator(0x1f);
+    return separator + sender + separator + avatarPath;
+}
+} // namespace
+
+bool ChatWidgetMessageStore::Extra::isEmpty() const
+{
+    return imagePath.isEmpty() && filePath.isEmpty() && fileName.isEmpty() && fileSize == 0 &&
+           replyToMessageId.isEmpty() && replySender.isEmpty() && replyPreview.isEmpty() && !isForwarded &&
+           forwardedFrom.isEmpty() && reactions.isEmpty() && mentions.isEmpty() && timeSpec == Qt::LocalTime;
+}
+
+int ChatWidgetMessageStore::count() const
+{
+    return m_contents.size();
+}
+
+bool ChatWidgetMessageStore::isEmpty() const
+{
+    return m_contents.isEmpty();
+}
+
+void ChatWidgetMessageStore::reserve(int size)
+{
+    m_contents.reserve(size);
+    m_messageIds.reserve(size);
+    m_timestamps.reserve(size);
+    m_packed.reserve(size);
+    m_participantOf.reserve(size);
+    m_extraOf.reserve(size);
+}
+
+void ChatWidgetMessageStore::clear()
+{
+    m_contents.clear();
+    m_messageIds.clear();
+    m_timestamps.clear();
+    m_packed.clear();
+    m_participantOf.clear();
+    m_extraOf.clear();
+    m_participants.clear();
+    m_freeParticipants.clear();
+    m_participantIndex.clear();
+    m_updatedParticipants.clear();
+    m_extras.clear();
+    m_freeExtras.clear();
+}
+
+void ChatWidgetMessageStore::append(const ChatWidgetMessage& message)
+{
+    append(ChatWidgetMessage(message));
+}
+
+void ChatWidgetMessageStore::append(ChatWidgetMessage&& message)
+{
+    EncodedRow encoded = encode(std::move(message), true);
+    m_contents.append(std::move(encoded.content));
+    m_messageIds.append(std::move(encoded.messageId));
+    m_timestamps.append(encoded.timestamp);
+    m_packed.append(encoded.packed);
+    m_participantOf.append(encoded.participant);
+    m_extraOf.append(encoded.extra);
+}
+
+void ChatWidgetMessageStore::insert(int row, const QList<ChatWidgetMessage>& messages)
+{
+    insert(row, QList<ChatWidgetMessage>(messages));
+}
+
+void ChatWidgetMessageStore::insert(int row, QList<ChatWidgetMessage>&& messages)
+{
+    if (messages.isEmpty()) {
+        return;
+    }
+    row = qBound(0, row, count());
+    // 追加到末尾的是最新的消息，其资料覆盖参与者记录
+    EncodedColumns columns = encodeColumns(std::move(messages), row == count());
+    m_contents.insert(row, std::move(columns.contents));
+    m_messageIds.insert(row, std::move(columns.messageIds));
+    m_timestamps.insert(row, std::move(columns.timestamps));
+    m_packed.insert(row, std::move(columns.packed));
+    m_participantOf.insert(row, std::move(columns.participants));
+    m_extraOf.insert(row, std::move(columns.extras));
+}
+
+void ChatWidgetMessageStore::removeAt(int row)
+{
+    removeRange(row, 1);
+}
+
+void ChatWidgetMessageStore::removeRange(int first, int count)
+{
+    if (first < 0 || count <= 0 || first >= this->count()) {
+        return;
+    }
+    count = qMin(count, this->count() - first);
+    for (int row = first; row < first + count; ++row) {
+        releaseExtra(row);
+        releaseParticipant(m_participantOf.at(row));
+    }
+    m_contents.remove(first, count);
+    m_messageIds.remove(first, count);
+    m_timestamps.remove(first, count);
+    m_packed.remove(first, count);
+    m_participantOf.remove(first, count);
+    m_extraOf.remove(first, count);
+}
+
+ChatWidgetMessage ChatWidgetMessageStore::message(int row) const
+{
+    ChatWidgetMessage message;
+    const Participant& participant = participantAt(row);
+    message.senderId = participant.senderId;
+    message.sender = participant.sender;
+    message.avatarPath = participant.avatarPath;
+    message.content = m_contents.at(row);
+    message.timestamp = timestamp(row);
+    message.isMine = isMine(row);
+    message.messageId = m_messageIds.at(row);
+    message.messageType = messageType(row);
+    message.status = status(row);
+    if (const Extra* extra = extraAt(row)) {
+        message.imagePath = extra->imagePath;
+        message.filePath = extra->filePath;
+        message.fileName = extra->fileName;
+        message.fileSize = extra->fileSize;
+        message.replyToMessageId = extra->replyToMessageId;
+        message.replySender = extra->replySender;
+        message.replyPreview = extra->replyPreview;
+        message.isForwarded = extra->isForwarded;
+        message.forwardedFrom = extra->forwardedFrom;
+        message.reactions = extra->reactions;
+        message.mentions = extra->mentions;
+    }
+    return message;
+}
+
+const QString& ChatWidgetMessageStore::senderId(int row) const
+{
+    return participantAt(row).senderId;
+}
+
+const QString& ChatWidgetMessageStore::sender(int row) const
+{
+    return participantAt(row).sender;
+}
+
+const QString& ChatWidgetMessageStore::avatarPath(int row) const
+{
+    return participantAt(row).avatarPath;
+}
+
+const QString& ChatWidgetMessageStore::content(int row) const
+{
+    return m_contents.at(row);
+}
+
+const QString& ChatWidgetMessageStore::messageId(int row) const
+{
+    return m_messageIds.at(row);
+}
+
+QDateTime ChatWidgetMessageStore::timestamp(int row) const
+{
+    const quint8 packed = m_packed.at(row);
+    if (!(packed & kHasTimestampBit)) {
+        return QDateTime();
+    }
+    if (const Extra* extra = extraAt(row)) {
+        if (extra->timeSpec == Qt::OffsetFromUTC) {
+            return QDateTime::fromMSecsSinceEpoch(m_timestamps.at(row), Qt::OffsetFromUTC, extra->offsetFromUtc);
+        }
+        if (extra->timeSpec == Qt::TimeZone) {
+            return QDateTime::fromMSecsSinceEpoch(m_timestamps.at(row), extra->timeZone);
+        }
+    }
+    return QDateTime::fromMSecsSinceEpoch(m_timestamps.at(row), (packed & kUtcBit) ? Qt::UTC : Qt::LocalTime);
+}
+
+qint64 ChatWidgetMessageStore::timestampKey(int row) const
+{
+    return (m_packed.at(row) & kHasTimestampBit) ? m_timestamps.at(row) : 0;
+}
+
+bool ChatWidgetMessageStore::isMine(int row) const
+{
+    const Participant& participant = participantAt(row);
+    if (!m_currentUserId.isEmpty() && !participant.senderId.isEmpty()) {
+        return participant.isMine;
+    }
+    return m_packed.at(row) & kIsMineBit;
+}
+
+ChatWidgetMessage::MessageType ChatWidgetMessageStore::messageType(int row) const
+{
+    return static_cast<ChatWidgetMessage::MessageType>(m_packed.at(row) & kTypeMask);
+}
+
+ChatWidgetMessage::MessageStatus ChatWidgetMessageStore::status(int row) const
+{
+    return static_cast<ChatWidgetMessage::MessageStatus>((m_packed.at(row) & kStatusMask) >> kStatusShift);
+}
+
+const QString& ChatWidgetMessageStore::imagePath(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->imagePath : emptyString();
+}
+
+const QString& ChatWidgetMessageStore::filePath(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->filePath : emptyString();
+}
+
+const QString& ChatWidgetMessageStore::fileName(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->fileName : emptyString();
+}
+
+qint64 ChatWidgetMessageStore::fileSize(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->fileSize : 0;
+}
+
+const QString& ChatWidgetMessageStore::replyToMessageId(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->replyToMessageId : emptyString();
+}
+
+const QString& ChatWidgetMessageStore::replySender(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->replySender : emptyString();
+}
+
+const QString& ChatWidgetMessageStore::replyPreview(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->replyPreview : emptyString();
+}
+
+bool ChatWidgetMessageStore::isForwarded(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra && extra->isForwarded;
+}
+
+const QString& ChatWidgetMessageStore::forwardedFrom(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->forwardedFrom : emptyString();
+}
+
+QList<ChatWidgetReaction> ChatWidgetMessageStore::reactions(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->reactions : QList<ChatWidgetReaction>();
+}
+
+QStringList ChatWidgetMessageStore::mentions(int row) const
+{
+    const Extra* extra = extraAt(row);
+    return extra ? extra->mentions : QStringList();
+}
+
+void ChatWidgetMessageStore::setContent(int row, const QString& content)
+{
+    m_contents[row] = content;
+}
+
+void ChatWidgetMessageStore::appendContent(int row, const QString& content)
+{
+    m_contents[row].append(content);
+}
+
+void ChatWidgetMessageStore::setStatus(int row, ChatWidgetMessage::MessageStatus status)
+{
+    quint8& packed = m_packed[row];
+    packed = static_cast<quint8>((packed & ~kStatusMask) | ((static_cast<quint8>(status) << kStatusShift) & kStatusMask));
+}
+
+bool ChatWidgetMessageStore::setReactions(int row, const QList<ChatWidgetReaction>& reactions)
+{
+    const Extra* current = extraAt(row);
+    if (current ? current->reactions == reactions : reactions.isEmpty()) {
+        return false;
+    }
+    ensureExtra(row).reactions = reactions;
+    releaseExtraIfEmpty(row);
+    return true;
+}
+
+bool ChatWidgetMessageStore::setAttachments(int row, const QString& imagePath, const QString& filePath,
+                                            const QString& fileName, qint64 fileSize)
+{
+    if (this->imagePath(row) == imagePath && this->filePath(row) == filePath && this->fileName(row) == fileName &&
+        this->fileSize(row) == fileSize) {
+        return false;
+    }
+    Extra& extra = ensureExtra(row);
+    extra.imagePath = imagePath;
+    extra.filePath = filePath;
+    extra.fileName = fileName;
+    extra.fileSize = fileSize;
+    releaseExtraIfEmpty(row);
+    return true;
+}
+
+bool ChatWidgetMessageStore::setReply(int row, const QString& replyToMessageId, const QString& replySender,
+                                      const QString& replyPreview, bool isForwarded, const QString& forwardedFrom)
+{
+    if (this->replyToMessageId(row) == replyToMessageId && this->replySender(row) == replySender &&
+        this->replyPreview(row) == replyPreview && this->isForwarded(row) == isForwarded &&
+        this->forwardedFrom(row) == forwardedFrom) {
+        return false;
+    }
+    Extra& extra = ensureExtra(row);
+    extra.replyToMessageId = replyToMessageId;
+    extra.replySender = replySender;
+    extra.replyPreview = replyPreview;
+    extra.isForwarded = isForwarded;
+    extra.forwardedFrom = forwardedFrom;
+    releaseExtraIfEmpty(row);
+    return true;
+}
+
+bool ChatWidgetMessageStore::updateParticipant(const QString& senderId, const QString& displayName,
+                                               const QString& avatarPath, bool* named)
+{
+    const int index = participantId(senderId);
+    if (index < 0) {
+        return false;
+    }
+    Participant& participant = m_participants[index];
+    if (named) {
+        *named = participant.sender.isEmpty() && !displayName.isEmpty();
+    }
+    bool changed = false;
+    if (!displayName.isEmpty() && participant.sender != displayName) {
+        participant.sender = displayName;
+        changed = true;
+    }
+    if (!avatarPath.isEmpty() && participant.avatarPath != avatarPath) {
+        participant.avatarPath = avatarPath;
+        changed = true;
+    }
+    return changed;
+}
+
+void ChatWidgetMessageStore::setCurrentUserId(const QString& userId)
+{
+    m_currentUserId = userId;
+    for (Participant& participant : m_participants) {
+        participant.isMine = !participant.senderId.isEmpty() && participant.senderId == userId;
+    }
+}
+
+const QString& ChatWidgetMessageStore::currentUserId() const
+{
+    return m_currentUserId;
+}
+
+int ChatWidgetMessageStore::participantOf(int row) const
+{
+    return m_participantOf.at(row);
+}
+
+int ChatWidgetMessageStore::participantId(const QString& senderId) const
+{
+    if (senderId.isEmpty()) {
+        return -1;
+    }
+    return m_participantIndex.value(senderId, -1);
+}
+
+int ChatWidgetMessageStore::participantCount() const
+{
+    return m_participants.size() - m_freeParticipants.size();
+}
+
+int ChatWidgetMessageStore::participantSlotCount() const
+{
+    return m_participants.size();
+}
+
+const QString& ChatWidgetMessageStore::participantSenderId(int participant) const
+{
+    return m_participants.at(participant).senderId;
+}
+
+QVector<ChatWidgetMessageStore::ParticipantUpdate> ChatWidgetMessageStore::takeUpdatedParticipants()
+{
+    QVector<ParticipantUpdate> updated;
+    updated.swap(m_updatedParticipants);
+    return updated;
+}
+
+int ChatWidgetMessageStore::extraCount() const
+{
+    return m_extras.size() - m_freeExtras.size();
+}
+
+ChatWidgetMessageStore::EncodedColumns ChatWidgetMessageStore::encodeColumns(QList<ChatWidgetMessage>&& messages,
+                                                                            bool latest)
+{
+    const int size = messages.size();
+    EncodedColumns columns;
+    columns.contents.reserve(size);
+    columns.messageIds.reserve(size);
+    columns.timestamps.reserve(size);
+    columns.packed.reserve(size);
+    columns.participants.reserve(size);
+    columns.extras.reserve(size);
+    const bool owned = messages.isDetached();
+    for (int i = 0; i < size; ++i) {
+        EncodedRow encoded =
+            owned ? encode(std::move(messages[i]), latest) : encode(ChatWidgetMessage(messages.at(i)), latest);
+        columns.contents.append(std::move(encoded.content));
+        columns.messageIds.append(std::move(encoded.messageId));
+        columns.timestamps.append(encoded.timestamp);
+        columns.packed.append(encoded.packed);
+        columns.participants.append(encoded.participant);
+        columns.extras.append(encoded.extra);
+    }
+    return columns;
+}
+
+ChatWidgetMessageStore::EncodedRow ChatWidgetMessageStore::encode(ChatWidgetMessage&& message, bool latest)
+{
+    EncodedRow encoded;
+    encoded.content = std::move(message.content);
+    encoded.messageId = std::move(message.messageId);
+    encoded.packed = static_cast<quint8>(message.messageType) & kTypeMask;
+    encoded.packed |= (static_cast<quint8>(message.status) << kStatusShift) & kStatusMask;
+    if (message.isMine) {
+        encoded.packed |= kIsMineBit;
+    }
+    Extra extra;
+    if (message.timestamp.isValid()) {
+        encoded.packed |= kHasTimestampBit;
+        encoded.timestamp = message.timestamp.toMSecsSinceEpoch();
+        switch (message.timestamp.timeSpec()) {
+        case Qt::UTC:
+            encoded.packed |= kUtcBit;
+            break;
+        case Qt::OffsetFromUTC:
+            extra.timeSpec = Qt::OffsetFromUTC;
+            extra.offsetFromUtc = message.timestamp.offsetFromUtc();
+            break;
+        case Qt::TimeZone:
+            extra.timeSpec = Qt::TimeZone;
+            extra.timeZone = message.timestamp.timeZone();
+            break;
+        default:
+            break;
+        }
+    }
+    encoded.participant = internParticipant(message.senderId, message.sender, message.avatarPath, latest);
+
+    extra.imagePath = std::move(message.imagePath);
+    extra.filePath = std::move(message.filePath);
+    extra.fileName = std::move(message.fileName);
+    extra.fileSize = message.fileSize;
+    extra.replyToMessageId = std::move(message.replyToMessageId);
+    extra.replySender = std::move(message.replySender);
+    extra.replyPreview = std::move(message.replyPreview);
+    extra.isForwarded = message.isForwarded;
+    extra.forwardedFrom = std::move(message.forwardedFrom);
+    extra.reactions = std::move(message.reactions);
+    extra.mentions = std::move(message.mentions);
+    if (!extra.isEmpty()) {
+        encoded.extra = allocateExtra(extra);
+    }
+    return encoded;
+}
+
+int ChatWidgetMessageStore::internParticipant(const QString& senderId, const QString& sender,
+                                              const QString& avatarPath, bool latest)
+{
+    const QString key = participantKey(senderId, sender, avatarPath);
+    auto it = m_participantIndex.constFind(key);
+    if (it != m_participantIndex.constEnd()) {
+        const int index = it.value();
+        if (!senderId.isEmpty()) {
+            // 最新的消息（追加到末尾）以非空资料覆盖记录，随消息到达的改名立即生效；
+            // 插入到已有行之前的旧消息（向前翻页、迟到合并）只补全空字段，不覆盖较新的资料
+            Participant& participant = m_participants[index];
+            const bool named = participant.sender.isEmpty() && !sender.isEmpty();
+            bool filled = false;
+            if (!sender.isEmpty() && (latest ? participant.sender != sender : participant.sender.isEmpty())) {
+                participant.sender = sender;
+                filled = true;
+            }
+            if (!avatarPath.isEmpty()
+                && (latest ? participant.avatarPath != avatarPath : participant.avatarPath.isEmpty())) {
+                participant.avatarPath = avatarPath;
+                filled = true;
+            }
+            if (filled) {
+                auto it = std::find_if(m_updatedParticipants.begin(), m_updatedParticipants.end(),
+                                       [index](const ParticipantUpdate& update) { return update.participant == index; });
+                if (it != m_updatedParticipants.end()) {
+                    it->named = it->named || named;
+                } else {
+                    ParticipantUpdate update;
+                    update.participant = index;
+                    update.named = named;
+                    m_updatedParticipants.append(update);
+                }
+            }
+        }
+        ++m_participants[index].rowCount;
+        return index;
+    }
+    Participant participant;
+    participant.senderId = senderId;
+    participant.sender = sender;
+    participant.avatarPath = avatarPath;
+    participant.isMine = !senderId.isEmpty() && senderId == m_currentUserId;
+    participant.rowCount = 1;
+    int index = m_participants.size();
+    if (!m_freeParticipants.isEmpty()) {
+        index = m_freeParticipants.takeLast();
+        m_participants[index] = participant;
+    } else {
+        m_participants.append(participant);
+    }
+    m_participantIndex.insert(key, index);
+    return index;
+}
+
+void ChatWidgetMessageStore::releaseParticipant(int index)
+{
+    Participant& participant = m_participants[index];
+    if (--participant.rowCount > 0) {
+        return;
+    }
+    // 最后一行已删除：释放记录（长会话中翻页淘汰的发送者不再常驻），再出现时按消息重新驻留
+    m_participantIndex.remove(participantKey(participant.senderId, participant.sender, participant.avatarPath));
+    participant = Participant();
+    m_freeParticipants.append(index);
+    m_updatedParticipants.erase(std::remove_if(m_updatedParticipants.begin(), m_updatedParticipants.end(),
+                                               [index](const ParticipantUpdate& update) {
+                                                   return update.participant == index;
+                                               }),
+                                m_updatedParticipants.end());
+}
+
+const ChatWidgetMessageStore::Participant& ChatWidgetMessageStore::participantAt(int row) const
+{
+    return m_participants.at(m_participantOf.at(row));
+}
+
+const ChatWidgetMessageStore::Extra* ChatWidgetMessageStore::extraAt(int row) const
+{
+    const int slot = m_extraOf.at(row);
+    return slot >= 0 ? &m_extras.at(slot) : nullptr;
+}
+
+ChatWidgetMessageStore::Extra& ChatWidgetMessageStore::ensureExtra(int row)
+{
+    int& slot = m_extraOf[row];
+    if (slot < 0) {
+        slot = allocateExtra(Extra());
+    }
+    return m_extras[slot];
+}
+
+int ChatWidgetMessageStore::allocateExtra(const Extra& extra)
+{
+    if (!m_freeExtras.isEmpty()) {
+        const int slot = m_freeExtras.takeLast();
+        m_extras[slot] = extra;
+        return slot;
+    }
+    m_extras.append(extra);
+    return m_extras.size() - 1;
+}
+
+void ChatWidgetMessageStore::releaseExtra(int row)
+{
+    int& slot = m_extraOf[row];
+    if (slot < 0) {
+        return;
+    }
+    m_extras[slot] = Extra();
+    m_freeExtras.append(slot);
+    slot = -1;
+}
+
+void ChatWidgetMessageStore::releaseExtraIfEmpty(int row)
+{
+    const Extra* extra = extraAt(row);
+    if (extra && extra->isEmpty()) {
+        releaseExtra(row);
+    }
+}
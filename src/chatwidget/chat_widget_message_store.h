@@ -0,0 +1,175 @@
+#ifndef CHAT_WIDGET_MESSAGE_STORE_H
+#define CHAT_WIDGET_MESSAGE_STORE_H
+
+#include "chat_widget_gap_vector.h"
+#include "chat_widget_message.h"
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTimeZone>
+#include <QVector>
+#include <QtGlobal>
+
+// ChatWidgetModel 的列式存储。
+// 热字段（类型、状态、isMine、时间戳、发送者序号）按列紧凑存放；
+// 消息以小整数序号引用参与者表中的共享记录：有 senderId 的发送者按 id 只保存一份，
+// 显示名、头像与 isMine 在读取时解析，资料变化只改一条记录；无 senderId 的消息按显示名与头像驻留。
+// 回复、转发、附件、回应、提及以及固定偏移/时区时间戳的时区等少用字段放在稀疏附加表中，普通文本消息不占用。
+// 参与者记录按引用它的行数计数，最后一行删除后释放，空位留给之后的新参与者。
+class ChatWidgetMessageStore {
+public:
+    struct ParticipantUpdate {
+        int participant = -1;
+        bool named = false; // 显示名由空变为非空：行上出现名字区，行高随之变化
+    };
+
+    int count() const;
+    bool isEmpty() const;
+    void reserve(int size);
+    void clear();
+
+    // 右值重载把字符串等字段移入各列；共享中的列表逐条复制，不整体分离
+    void append(const ChatWidgetMessage& message);
+    void append(ChatWidgetMessage&& message);
+    void insert(int row, const QList<ChatWidgetMessage>& messages);
+    void insert(int row, QList<ChatWidgetMessage>&& messages);
+    void removeAt(int row);
+    void removeRange(int first, int count);
+
+    // 还原为完整的消息结构（按需构造，不缓存）
+    ChatWidgetMessage message(int row) const;
+
+    const QString& senderId(int row) const;
+    const QString& sender(int row) const;
+    const QString& avatarPath(int row) const;
+    const QString& content(int row) const;
+    const QString& messageId(int row) const;
+    QDateTime timestamp(int row) const;
+    qint64 timestampKey(int row) const; // 毫秒时间戳，无效时间为 0
+    bool isMine(int row) const;
+    ChatWidgetMessage::MessageType messageType(int row) const;
+    ChatWidgetMessage::MessageStatus status(int row) const;
+
+    const QString& imagePath(int row) const;
+    const QString& filePath(int row) const;
+    const QString& fileName(int row) const;
+    qint64 fileSize(int row) const;
+    const QString& replyToMessageId(int row) const;
+    const QString& replySender(int row) const;
+    const QString& replyPreview(int row) const;
+    bool isForwarded(int row) const;
+    const QString& forwardedFrom(int row) const;
+    QList<ChatWidgetReaction> reactions(int row) const;
+    QStringList mentions(int row) const;
+
+    void setContent(int row, const QString& content);
+    void appendContent(int row, const QString& content);
+    void setStatus(int row, ChatWidgetMessage::MessageStatus status);
+    // 以下 set* 返回是否有字段发生变化
+    bool setReactions(int row, const QList<ChatWidgetReaction>& reactions);
+    bool setAttachments(int row, const QString& imagePath, const QString& filePath, const QString& fileName,
+                        qint64 fileSize);
+    bool setReply(int row, const QString& replyToMessageId, const QString& replySender, const QString& replyPreview,
+                  bool isForwarded, const QString& forwardedFrom);
+    // 更新某个发送者的显示名与头像（空值表示保持不变），O(1)；返回记录是否变化，
+    // named 置为显示名是否由空变为非空
+    bool updateParticipant(const QString& senderId, const QString& displayName, const QString& avatarPath,
+                           bool* named = nullptr);
+    // 设置当前用户后，有 senderId 的行的 isMine 按身份解析（否则沿用消息自带的值）
+    void setCurrentUserId(const QString& userId);
+    const QString& currentUserId() const;
+
+    // 行引用的参与者序号；行存在期间序号不变，参与者的行全部删除后序号可能被新参与者复用
+    int participantOf(int row) const;
+    // senderId 对应的参与者序号，不存在时返回 -1
+    int participantId(const QString& senderId) const;
+    // 仍被行引用的参与者数
+    int participantCount() const;
+    // 序号上界（含已释放的空位），按序号索引的外部表据此分配
+    int participantSlotCount() const;
+    const QString& participantSenderId(int participant) const;
+    // 写入消息时改变了显示名或头像的参与者（追加的消息覆盖、插入的旧消息补全空字段），
+    // 取出后清空；已有行的显示随之变化
+    QVector<ParticipantUpdate> takeUpdatedParticipants();
+    int extraCount() const;
+
+private:
+    struct Participant {
+        QString senderId;
+        QString sender;
+        QString avatarPath;
+        bool isMine = false; // senderId 与当前用户相同，仅在设置了当前用户时使用
+        int rowCount = 0;    // 引用该记录的行数，为 0 时释放
+    };
+
+    struct Extra {
+        QString imagePath;
+        QString filePath;
+        QString fileName;
+        qint64 fileSize = 0;
+        QString replyToMessageId;
+        QString replySender;
+        QString replyPreview;
+        bool isForwarded = false;
+        QString forwardedFrom;
+        QList<ChatWidgetReaction> reactions;
+        QStringList mentions;
+        // 本地时间与 UTC 由 m_packed 中的标记表示，只有固定偏移与时区需要记录
+        Qt::TimeSpec timeSpec = Qt::LocalTime;
+        int offsetFromUtc = 0;
+        QTimeZone timeZone;
+
+        bool isEmpty() const;
+    };
+
+    struct EncodedRow {
+        QString content;
+        QString messageId;
+        qint64 timestamp = 0;
+        quint8 packed = 0;
+        int participant = 0;
+        int extra = -1;
+    };
+
+    struct EncodedColumns {
+        QVector<QString> contents;
+        QVector<QString> messageIds;
+        QVector<qint64> timestamps;
+        QVector<quint8> packed;
+        QVector<int> participants;
+        QVector<int> extras;
+    };
+
+    // latest：消息晚于已有的全部行（追加到末尾），其资料覆盖参与者记录，否则只补全空字段
+    EncodedRow encode(ChatWidgetMessage&& message, bool latest);
+    // 共享中的列表逐条复制，独占时移入
+    EncodedColumns encodeColumns(QList<ChatWidgetMessage>&& messages, bool latest);
+    int internParticipant(const QString& senderId, const QString& sender, const QString& avatarPath, bool latest);
+    void releaseParticipant(int index);
+    const Participant& participantAt(int row) const;
+    const Extra* extraAt(int row) const;
+    Extra& ensureExtra(int row);
+    int allocateExtra(const Extra& extra);
+    void releaseExtra(int row);
+    void releaseExtraIfEmpty(int row);
+
+    // 各列按行对齐；头部预留空位，向前翻页插入只移动新增的行
+    ChatWidgetGapVector<QString> m_contents;
+    ChatWidgetGapVector<QString> m_messageIds;
+    ChatWidgetGapVector<qint64> m_timestamps;
+    ChatWidgetGapVector<quint8> m_packed; // 类型(3 位)、状态(2 位)、isMine、UTC 与时间戳有效标记
+    ChatWidgetGapVector<int> m_participantOf;
+    ChatWidgetGapVector<int> m_extraOf; // -1 表示没有附加字段
+
+    QVector<Participant> m_participants;
+    QVector<int> m_freeParticipants;
+    QHash<QString, int> m_participantIndex;
+    QVector<ParticipantUpdate> m_updatedParticipants;
+    QString m_currentUserId;
+    QVector<Extra> m_extras;
+    QVector<int> m_freeExtras;
+};
+
+#endif // CHAT_WIDGET_MESSAGE_STORE_H
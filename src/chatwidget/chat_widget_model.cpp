@@ -1,7 +1,14 @@
 #include "chat_widget_model.h"
+#include "chat_widget_markdown_utils.h"
 #include <algorithm>
+#include <utility>
 
 namespace {
+const quint64 kInitialKey = quint64(1) << 62;
+const quint64 kKeyStride = quint64(1) << 20;
+// 中间插入时相邻 key 的最小间距，不足时扩大重新分配的窗口
+const quint64 kMinKeyGap = kKeyStride >> 4;
+
 bool isSystemMessage(ChatWidgetMessage::MessageType type)
 {
     return type == ChatWidgetMessage::MessageType::System ||
@@ -13,17 +20,27 @@ qint64 messageTimestampKey(const ChatWidgetMessage& message)
     return message.timestamp.isValid() ? message.timestamp.toMSecsSinceEpoch() : 0;
 }
 
-bool messageIdExists(const QList<ChatWidgetMessage>& messages, const QString& messageId)
+// 批处理期间以位掩码记录角色，便于合并区间时求并集
+quint64 roleMask(const QVector<int>& roles)
 {
-    if (messageId.isEmpty()) {
-        return false;
+    quint64 mask = 0;
+    for (int role : roles) {
+        const int bit = role - ChatWidgetModel::ChatWidgetSenderRole;
+        Q_ASSERT(bit >= 0 && bit < 64);
+        mask |= quint64(1) << bit;
     }
-    for (const ChatWidgetMessage& msg : messages) {
-        if (msg.messageId == messageId) {
-            return true;
+    return mask;
+}
+
+QVector<int> rolesFromMask(quint64 mask)
+{
+    QVector<int> roles;
+    for (int bit = 0; mask != 0; ++bit, mask >>= 1) {
+        if (mask & 1) {
+            roles.append(ChatWidgetModel::ChatWidgetSenderRole + bit);
         }
     }
-    return false;
+    return roles;
 }
 } // namespace
 
@@ -36,57 +53,58 @@ int ChatWidgetModel::rowCount(const QModelIndex& parent) const
 {
     if (parent.isValid())
         return 0;
-    return m_messages.count();
+    return m_store.count() - m_pendingAppendCount;
 }
 
 QVariant ChatWidgetModel::data(const QModelIndex& index, int role) const
 {
-    if (!index.isValid() || index.row() < 0 || index.row() >= m_messages.count())
+    if (!index.isValid() || index.row() < 0 || index.row() >= rowCount())
         return QVariant();
 
-    const ChatWidgetMessage& msg = m_messages[index.row()];
+    const int row = index.row();
 
     switch (role) {
     case ChatWidgetSenderRole:
-        return msg.sender;
+        return m_store.sender(row);
     case ChatWidgetContentRole:
-        return msg.content;
+        return m_store.content(row);
     case ChatWidgetAvatarRole:
-        return msg.avatarPath;
+        return m_store.avatarPath(row);
     case ChatWidgetTimestampRole:
-        return msg.timestamp;
+        return m_store.timestamp(row);
     case ChatWidgetIsMineRole:
-        return msg.isMine;
+        return m_store.isMine(row);
     case ChatWidgetSenderIdRole:
-        return msg.senderId;
+        return m_store.senderId(row);
     case ChatWidgetMessageIdRole:
-        return msg.messageId;
+        return m_store.messageId(row);
     case ChatWidgetMessageTypeRole:
-        return static_cast<int>(msg.messageType);
+        return static_cast<int>(m_store.messageType(row));
     case ChatWidgetMessageStatusRole:
-        return static_cast<int>(msg.status);
+        return static_cast<int>(m_store.status(row));
     case ChatWidgetImagePathRole:
-        return msg.imagePath;
+        return m_store.imagePath(row);
     case ChatWidgetFilePathRole:
-        return msg.filePath;
+        return m_store.filePath(row);
     case ChatWidgetFileNameRole:
-        return msg.fileName;
+        return m_store.fileName(row);
     case ChatWidgetFileSizeRole:
-        return msg.fileSize;
+        return m_store.fileSize(row);
     case ChatWidgetReplyToMessageIdRole:
-        return msg.replyToMessageId;
+        return m_store.replyToMessageId(row);
     case ChatWidgetReplySenderRole:
-        return msg.replySender;
+        return m_store.replySender(row);
     case ChatWidgetReplyPreviewRole:
-        return msg.replyPreview;
+        return m_store.replyPreview(row);
     case ChatWidgetIsForwardedRole:
-        return msg.isForwarded;
+        return m_store.isForwarded(row);
     case ChatWidgetForwardedFromRole:
-        return msg.forwardedFrom;
+        return m_store.forwardedFrom(row);
     case ChatWidgetReactionsRole: {
+        const QList<ChatWidgetReaction> reactions = m_store.reactions(row);
         QVariantList reactionList;
-        reactionList.reserve(msg.reactions.size());
-        for (const ChatWidgetReaction& reaction : msg.reactions) {
+        reactionList.reserve(reactions.size());
+        for (const ChatWidgetReaction& reaction : reactions) {
             QVariantMap map;
             map.insert("emoji", reaction.emoji);
             map.insert("count", reaction.count);
@@ -95,11 +113,15 @@ QVariant ChatWidgetModel::data(const QModelIndex& index, int role) const
         return reactionList;
     }
     case ChatWidgetMentionsRole:
-        return msg.mentions;
+        return m_store.mentions(row);
     case ChatWidgetIsSystemRole:
-        return isSystemMessage(msg.messageType);
+        return isSystemMessage(m_store.messageType(row));
     case ChatWidgetSearchKeywordRole:
         return m_searchKeyword;
+    case ChatWidgetMessageKeyRole:
+        return m_rowStates.at(row).key;
+    case ChatWidgetContentRevisionRole:
+        return m_rowStates.at(row).revision;
     default:
         return QVariant();
     }
@@ -130,306 +152,489 @@ QHash<int, QByteArray> ChatWidgetModel::roleNames() const
     roles[ChatWidgetMentionsRole] = "mentions";
     roles[ChatWidgetIsSystemRole] = "isSystem";
     roles[ChatWidgetSearchKeywordRole] = "searchKeyword";
+    roles[ChatWidgetMessageKeyRole] = "messageKey";
+    roles[ChatWidgetContentRevisionRole] = "contentRevision";
     return roles;
 }
 
 void ChatWidgetModel::addMessage(const ChatWidgetMessage& message)
 {
-    beginInsertRows(QModelIndex(), m_messages.count(), m_messages.count());
-    m_messages.append(message);
-    if (!message.messageId.isEmpty()) {
-        m_messageIds.insert(message.messageId);
+    addMessage(ChatWidgetMessage(message));
+}
+
+void ChatWidgetModel::addMessage(ChatWidgetMessage&& message)
+{
+    const bool batching = m_batchDepth > 0;
+    if (batching) {
+        // 批处理中的追加合并到 endBatch() 时一次性通知
+        ++m_pendingAppendCount;
+    } else {
+        beginInsertRows(QModelIndex(), m_store.count(), m_store.count());
     }
-    endInsertRows();
+    const QString messageId = message.messageId;
+    m_store.append(std::move(message));
+    const int row = m_store.count() - 1;
+    m_rowStates.append(createRowState(m_store.content(row), allocateKey(false)));
+    if (!messageId.isEmpty()) {
+        if (m_keyById.contains(messageId)) {
+            m_hasDuplicateIds = true;
+        } else {
+            indexRow(messageId, row);
+        }
+    }
+    indexParticipantRows(row, row);
+    if (!batching) {
+        endInsertRows();
+    }
+    notifyUpdatedParticipants();
 }
 
 void ChatWidgetModel::setMessages(const QList<ChatWidgetMessage>& messages)
+{
+    setMessages(QList<ChatWidgetMessage>(messages));
+}
+
+void ChatWidgetModel::setMessages(QList<ChatWidgetMessage>&& messages)
 {
     beginResetModel();
-    m_messages.clear();
-    m_messageIds.clear();
+    m_store.clear();
+    m_rowStates.clear();
+    m_searchIndex.clear();
+    m_searchCandidatesValid = false;
+    m_keyById.clear();
+    m_hasDuplicateIds = false;
+    m_pendingChanges.clear();
+    m_pendingAppendCount = 0;
+    resetParticipantRows();
 
-    QList<ChatWidgetMessage> sorted = messages;
-    std::sort(sorted.begin(), sorted.end(), [](const ChatWidgetMessage& a, const ChatWidgetMessage& b) {
+    // 已按时间排序的列表（常见的历史加载）不触发分离
+    const auto byTimestamp = [](const ChatWidgetMessage& a, const ChatWidgetMessage& b) {
         return messageTimestampKey(a) < messageTimestampKey(b);
-    });
+    };
+    if (!std::is_sorted(messages.cbegin(), messages.cend(), byTimestamp)) {
+        std::sort(messages.begin(), messages.end(), byTimestamp);
+    }
 
-    for (const ChatWidgetMessage& message : sorted) {
+    m_store.reserve(messages.size());
+    m_rowStates.reserve(messages.size());
+    for (const ChatWidgetMessage& message : qAsConst(messages)) {
+        if (!message.messageId.isEmpty() && m_keyById.contains(message.messageId)) {
+            continue;
+        }
+        m_store.append(message);
+        m_rowStates.append(createRowState(message.content, allocateKey(false)));
         if (!message.messageId.isEmpty()) {
-            if (m_messageIds.contains(message.messageId)) {
-                continue;
-            }
-            m_messageIds.insert(message.messageId);
+            indexRow(message.messageId, m_store.count() - 1);
         }
-        m_messages.append(message);
     }
+    // 重置已覆盖全部行，资料变化的参与者无需另行通知
+    m_store.takeUpdatedParticipants();
     endResetModel();
 }
 
 void ChatWidgetModel::appendMessages(const QList<ChatWidgetMessage>& messages)
+{
+    appendMessages(QList<ChatWidgetMessage>(messages));
+}
+
+void ChatWidgetModel::appendMessages(QList<ChatWidgetMessage>&& messages)
 {
     if (messages.isEmpty()) {
         return;
     }
-    QList<ChatWidgetMessage> filtered;
-    filtered.reserve(messages.size());
-    for (const ChatWidgetMessage& message : messages) {
-        if (!message.messageId.isEmpty() && m_messageIds.contains(message.messageId)) {
-            continue;
+    // 原地剔除重复消息：保留的元素前移，没有重复时列表不被修改（也不分离）
+    const int start = m_store.count();
+    QSet<QString> incomingIds;
+    incomingIds.reserve(messages.size());
+    int kept = 0;
+    for (int i = 0; i < messages.size(); ++i) {
+        const QString& messageId = messages.at(i).messageId;
+        if (!messageId.isEmpty()) {
+            if (m_keyById.contains(messageId) || incomingIds.contains(messageId)) {
+                continue;
+            }
+            incomingIds.insert(messageId);
         }
-        if (!message.messageId.isEmpty()) {
-            m_messageIds.insert(message.messageId);
+        if (kept != i) {
+            messages[kept] = std::move(messages[i]);
         }
-        filtered.append(message);
+        ++kept;
     }
-    if (filtered.isEmpty()) {
+    if (kept == 0) {
         return;
     }
-    int start = m_messages.count();
-    beginInsertRows(QModelIndex(), start, start + filtered.count() - 1);
-    m_messages.append(filtered);
-    endInsertRows();
+    if (kept < messages.size()) {
+        messages.erase(messages.begin() + kept, messages.end());
+    }
+    const bool batching = m_batchDepth > 0;
+    if (batching) {
+        m_pendingAppendCount += kept;
+    } else {
+        beginInsertRows(QModelIndex(), start, start + kept - 1);
+    }
+    m_store.insert(start, std::move(messages));
+    m_rowStates.reserve(m_store.count());
+    for (int row = start; row < start + kept; ++row) {
+        m_rowStates.append(createRowState(m_store.content(row), allocateKey(false)));
+        indexRow(m_store.messageId(row), row);
+    }
+    indexParticipantRows(start, start + kept - 1);
+    if (!batching) {
+        endInsertRows();
+    }
+    notifyUpdatedParticipants();
 }
 
 void ChatWidgetModel::prependMessages(const QList<ChatWidgetMessage>& messages)
+{
+    prependMessages(QList<ChatWidgetMessage>(messages));
+}
+
+void ChatWidgetModel::prependMessages(QList<ChatWidgetMessage>&& messages)
 {
     if (messages.isEmpty()) {
         return;
     }
-    QList<ChatWidgetMessage> filtered;
-    filtered.reserve(messages.size());
-    for (const ChatWidgetMessage& message : messages) {
-        if (!message.messageId.isEmpty() && m_messageIds.contains(message.messageId)) {
-            continue;
+    QSet<QString> incomingIds;
+    incomingIds.reserve(messages.size());
+    int kept = 0;
+    for (int i = 0; i < messages.size(); ++i) {
+        const QString& messageId = messages.at(i).messageId;
+        if (!messageId.isEmpty()) {
+            if (m_keyById.contains(messageId) || incomingIds.contains(messageId)) {
+                continue;
+            }
+            incomingIds.insert(messageId);
         }
-        if (!message.messageId.isEmpty()) {
-            m_messageIds.insert(message.messageId);
+        if (kept != i) {
+            messages[kept] = std::move(messages[i]);
         }
-        filtered.append(message);
+        ++kept;
     }
-    if (filtered.isEmpty()) {
+    if (kept == 0) {
         return;
     }
-    beginInsertRows(QModelIndex(), 0, filtered.count() - 1);
-    QList<ChatWidgetMessage> combined = filtered;
-    combined.append(m_messages);
-    m_messages.swap(combined);
+    if (kept < messages.size()) {
+        messages.erase(messages.begin() + kept, messages.end());
+    }
+    // 待通知的行号会随插入失效，先提交批处理中已收集的变更
+    flushBatch();
+    beginInsertRows(QModelIndex(), 0, kept - 1);
+    m_store.insert(0, std::move(messages));
+    QVector<RowState> states(kept);
+    for (int i = kept - 1; i >= 0; --i) {
+        states[i] = createRowState(m_store.content(i), allocateKey(true));
+    }
+    m_rowStates.insert(0, std::move(states));
+    // 索引按 key 记录，已有条目不受行号变化影响
+    for (int i = 0; i < kept; ++i) {
+        indexRow(m_store.messageId(i), i);
+    }
+    indexParticipantRows(0, kept - 1);
     endInsertRows();
+    notifyUpdatedParticipants();
 }
 
-void ChatWidgetModel::updateIsMine(const QString& currentUserId)
+void ChatWidgetModel::mergeMessages(QList<ChatWidgetMessage>&& messages)
 {
-    if (currentUserId.trimmed().isEmpty() || m_messages.isEmpty()) {
+    if (messages.isEmpty()) {
         return;
     }
-    bool anyChanged = false;
-    for (int i = 0; i < m_messages.size(); ++i) {
-        if (m_messages[i].senderId.isEmpty()) {
-            continue;
+    const auto byTimestamp = [](const ChatWidgetMessage& a, const ChatWidgetMessage& b) {
+        return messageTimestampKey(a) < messageTimestampKey(b);
+    };
+    if (!std::is_sorted(messages.cbegin(), messages.cend(), byTimestamp)) {
+        std::stable_sort(messages.begin(), messages.end(), byTimestamp);
+    }
+
+    QSet<QString> incomingIds;
+    incomingIds.reserve(messages.size());
+    int kept = 0;
+    for (int i = 0; i < messages.size(); ++i) {
+        const QString& messageId = messages.at(i).messageId;
+        if (!messageId.isEmpty()) {
+            if (m_keyById.contains(messageId) || incomingIds.contains(messageId)) {
+                continue;
+            }
+            incomingIds.insert(messageId);
         }
-        const bool newIsMine = m_messages[i].senderId == currentUserId;
-        if (m_messages[i].isMine != newIsMine) {
-            m_messages[i].isMine = newIsMine;
-            anyChanged = true;
+        if (kept != i) {
+            messages[kept] = std::move(messages[i]);
+        }
+        ++kept;
+    }
+    if (kept == 0) {
+        return;
+    }
+    if (kept < messages.size()) {
+        messages.erase(messages.begin() + kept, messages.end());
+    }
+
+    // 先看两端：整页早于首行（向前翻页）或不早于末行（新消息）时直接前插/追加，O(k)
+    if (m_store.isEmpty() || messageTimestampKey(messages.first()) >= m_store.timestampKey(m_store.count() - 1)) {
+        appendMessages(std::move(messages));
+        return;
+    }
+    if (messageTimestampKey(messages.last()) <= m_store.timestampKey(0)) {
+        prependMessages(std::move(messages));
+        return;
+    }
+
+    // 与现有行交错：二分查找第一个插入点，之后与现有行同向推进，得到各条插入前的行号
+    const int count = m_store.count();
+    int row = 0;
+    for (int step = count; step > 0;) {
+        const int half = step / 2;
+        if (m_store.timestampKey(row + half) <= messageTimestampKey(messages.first())) {
+            row += half + 1;
+            step -= half + 1;
+        } else {
+            step = half;
         }
     }
-    if (anyChanged) {
-        QModelIndex first = index(0, 0);
-        QModelIndex last = index(m_messages.size() - 1, 0);
-        emit dataChanged(first, last, { ChatWidgetIsMineRole });
+    QVector<int> positions(kept);
+    for (int i = 0; i < kept; ++i) {
+        const qint64 key = messageTimestampKey(messages.at(i));
+        while (row < count && m_store.timestampKey(row) <= key) {
+            ++row;
+        }
+        positions[i] = row;
     }
+    insertMessagesAt(positions, std::move(messages));
 }
 
-void ChatWidgetModel::updateParticipantInfo(const QString& senderId, const QString& displayName, const QString& avatarPath)
+void ChatWidgetModel::insertMessagesAt(const QVector<int>& positions, QList<ChatWidgetMessage>&& messages)
 {
-    if (senderId.trimmed().isEmpty() || m_messages.isEmpty()) {
-        return;
+    // 待通知的行号会随插入失效，先提交批处理中已收集的变更
+    flushBatch();
+    emit rowsAboutToBeMerged(positions.first());
+    // 按插入位置相同的段从后往前插入：之前各段的插入位置不受影响，每段的数据都在自己的
+    // beginInsertRows/endInsertRows 之间就位，任一通知时模型中的行都与已通知的行一致
+    int last = positions.size() - 1;
+    while (last >= 0) {
+        int first = last;
+        while (first > 0 && positions.at(first - 1) == positions.at(last)) {
+            --first;
+        }
+        const int row = positions.at(last);
+        const int count = last - first + 1;
+        QList<ChatWidgetMessage> segment;
+        segment.reserve(count);
+        for (int i = first; i <= last; ++i) {
+            segment.append(std::move(messages[i]));
+        }
+
+        beginInsertRows(QModelIndex(), row, row + count - 1);
+        m_store.insert(row, std::move(segment));
+        m_rowStates.insert(row, QVector<RowState>(count));
+        QVector<quint64> oldKeys;
+        QVector<quint64> newKeys;
+        assignInsertedKeys(row, count, oldKeys, newKeys);
+        for (int inserted = row; inserted < row + count; ++inserted) {
+            m_rowStates[inserted] = createRowState(m_store.content(inserted), m_rowStates.at(inserted).key);
+            indexRow(m_store.messageId(inserted), inserted);
+        }
+        indexParticipantRows(row, row + count - 1);
+        endInsertRows();
+        if (!oldKeys.isEmpty()) {
+            emit messageKeysChanged(oldKeys, newKeys);
+        }
+        last = first - 1;
     }
-    bool anyChanged = false;
-    for (int i = 0; i < m_messages.size(); ++i) {
-        if (m_messages[i].senderId != senderId) {
+    emit rowsMerged();
+    notifyUpdatedParticipants();
+}
+
+void ChatWidgetModel::assignInsertedKeys(int first, int count, QVector<quint64>& oldKeys, QVector<quint64>& newKeys)
+{
+    // 取前后相邻行 key 之间的间隔均分；间隔不足时以新行为中心成倍扩大窗口，只重新分配窗口内的行
+    const int rows = m_rowStates.size();
+    const int end = first + count;
+    for (int radius = 0;; radius = qMax(1, radius * 2)) {
+        const int lo = qMax(0, first - radius);
+        const int hi = qMin(rows, end + radius);
+        const quint64 slots = quint64(hi - lo) + 1;
+        const quint64 lower = lo > 0 ? m_rowStates.at(lo - 1).key : m_prevKey - slots * kKeyStride;
+        const quint64 upper = hi < rows ? m_rowStates.at(hi).key : m_nextKey + slots * kKeyStride;
+        const quint64 step = (upper - lower) / slots;
+        if (step < kMinKeyGap && (lo > 0 || hi < rows)) {
             continue;
         }
-        if (!displayName.isEmpty() && m_messages[i].sender != displayName) {
-            m_messages[i].sender = displayName;
-            anyChanged = true;
+        const int firstChanged = oldKeys.size();
+        QVector<int> rekeyedRows;
+        for (int row = lo; row < hi; ++row) {
+            const quint64 key = lower + step * quint64(row - lo + 1);
+            RowState& state = m_rowStates[row];
+            if (state.key != 0 && state.key != key) {
+                oldKeys.append(state.key);
+                newKeys.append(key);
+                // 参与者索引先移除全部旧 key、再加入新 key：新 key 可能正是尚未换 key 的行的旧 key
+                unindexParticipantRows(row, row);
+                rekeyedRows.append(row);
+                auto it = m_keyById.find(m_store.messageId(row));
+                if (it != m_keyById.end() && it.value() == state.key) {
+                    it.value() = key;
+                }
+                m_searchCandidatesValid = false;
+            }
+            state.key = key;
+        }
+        for (int row : qAsConst(rekeyedRows)) {
+            indexParticipantRows(row, row);
+        }
+        if (m_searchIndexBuilt && oldKeys.size() > firstChanged) {
+            m_searchIndex.rekeyDocuments(oldKeys.mid(firstChanged), newKeys.mid(firstChanged));
         }
-        if (!avatarPath.isEmpty() && m_messages[i].avatarPath != avatarPath) {
-            m_messages[i].avatarPath = avatarPath;
-            anyChanged = true;
+        m_prevKey = qMin(m_prevKey, m_rowStates.at(0).key);
+        m_nextKey = qMax(m_nextKey, m_rowStates.at(rows - 1).key);
+        return;
+    }
+}
+
+void ChatWidgetModel::updateIsMine(const QString& currentUserId)
+{
+    const QString previous = m_store.currentUserId();
+    if (currentUserId.trimmed().isEmpty() || currentUserId == previous) {
+        return;
+    }
+    // 已按身份解析时只有新旧当前用户的行可能变化；首次设置时消息自带的 isMine 可能与身份不符，逐行比较
+    QVector<int> rows;
+    if (previous.isEmpty()) {
+        rows.reserve(m_store.count());
+        for (int row = 0; row < m_store.count(); ++row) {
+            rows.append(row);
         }
+    } else {
+        for (const QString& userId : { previous, currentUserId }) {
+            const int participant = m_store.participantId(userId);
+            if (participant >= 0) {
+                rows += participantRows(participant);
+            }
+        }
+    }
+    QVector<bool> before;
+    before.reserve(rows.size());
+    for (int row : qAsConst(rows)) {
+        before.append(m_store.isMine(row));
+    }
+    m_store.setCurrentUserId(currentUserId);
+    QVector<int> changed;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (m_store.isMine(rows.at(i)) != before.at(i)) {
+            changed.append(rows.at(i));
+        }
+    }
+    emitRowsChanged(changed, { ChatWidgetIsMineRole });
+}
+
+void ChatWidgetModel::updateParticipantInfo(const QString& senderId, const QString& displayName, const QString& avatarPath)
+{
+    if (senderId.trimmed().isEmpty()) {
+        return;
     }
-    if (anyChanged) {
-        QModelIndex first = index(0, 0);
-        QModelIndex last = index(m_messages.size() - 1, 0);
-        emit dataChanged(first, last, { ChatWidgetSenderRole, ChatWidgetAvatarRole });
+    bool named = false;
+    if (m_store.updateParticipant(senderId, displayName, avatarPath, &named)) {
+        notifyParticipantChanged(m_store.participantId(senderId), named);
     }
 }
 
 void ChatWidgetModel::appendContentToLastMessage(const QString& content)
 {
-    if (m_messages.isEmpty())
+    if (m_store.isEmpty())
         return;
 
-    m_messages.last().content.append(content);
-    QModelIndex idx = index(m_messages.count() - 1, 0);
-    emit dataChanged(idx, idx, { ChatWidgetContentRole });
+    const int row = m_store.count() - 1;
+    m_store.appendContent(row, content);
+    bumpContentRevision(row);
+    notifyRowsChanged(row, row, { ChatWidgetContentRole });
 }
 
 void ChatWidgetModel::appendContentToMessageAt(int row, const QString& content)
 {
-    if (row < 0 || row >= m_messages.size())
+    if (row < 0 || row >= m_store.count())
         return;
 
-    m_messages[row].content.append(content);
-    QModelIndex idx = index(row, 0);
-    emit dataChanged(idx, idx, { ChatWidgetContentRole });
+    m_store.appendContent(row, content);
+    bumpContentRevision(row);
+    notifyRowsChanged(row, row, { ChatWidgetContentRole });
 }
 
 void ChatWidgetModel::updateMessageContentAt(int row, const QString& content)
 {
-    if (row < 0 || row >= m_messages.size())
+    if (row < 0 || row >= m_store.count())
         return;
-    if (m_messages[row].content == content)
+    if (m_store.content(row) == content)
         return;
 
-    m_messages[row].content = content;
-    QModelIndex idx = index(row, 0);
-    emit dataChanged(idx, idx, { ChatWidgetContentRole });
+    m_store.setContent(row, content);
+    bumpContentRevision(row);
+    notifyRowsChanged(row, row, { ChatWidgetContentRole });
 }
 
 void ChatWidgetModel::updateMessageStatus(const QString& messageId, ChatWidgetMessage::MessageStatus status)
 {
-    if (messageId.trimmed().isEmpty()) {
+    const int row = rowForMessageId(messageId);
+    if (row < 0 || m_store.status(row) == status) {
         return;
     }
-    for (int i = 0; i < m_messages.size(); ++i) {
-        if (m_messages[i].messageId != messageId) {
+    m_store.setStatus(row, status);
+    notifyRowsChanged(row, row, { ChatWidgetMessageStatusRole });
+}
+
+void ChatWidgetModel::updateMessageStatuses(const QHash<QString, ChatWidgetMessage::MessageStatus>& statuses)
+{
+    QVector<int> changedRows;
+    changedRows.reserve(statuses.size());
+    for (auto it = statuses.constBegin(); it != statuses.constEnd(); ++it) {
+        const int row = rowForMessageId(it.key());
+        if (row < 0 || m_store.status(row) == it.value()) {
             continue;
         }
-        if (m_messages[i].status == status) {
-            return;
-        }
-        m_messages[i].status = status;
-        QModelIndex idx = index(i, 0);
-        emit dataChanged(idx, idx, { ChatWidgetMessageStatusRole });
-        return;
+        m_store.setStatus(row, it.value());
+        changedRows.append(row);
     }
+    emitRowsChanged(changedRows, { ChatWidgetMessageStatusRole });
 }
 
 void ChatWidgetModel::updateMessageContent(const QString& messageId, const QString& content)
 {
-    if (messageId.trimmed().isEmpty()) {
-        return;
-    }
-    for (int i = 0; i < m_messages.size(); ++i) {
-        if (m_messages[i].messageId != messageId) {
-            continue;
-        }
-        if (m_messages[i].content == content) {
-            return;
-        }
-        m_messages[i].content = content;
-        QModelIndex idx = index(i, 0);
-        emit dataChanged(idx, idx, { ChatWidgetContentRole });
+    const int row = rowForMessageId(messageId);
+    if (row < 0 || m_store.content(row) == content) {
         return;
     }
+    m_store.setContent(row, content);
+    bumpContentRevision(row);
+    notifyRowsChanged(row, row, { ChatWidgetContentRole });
 }
 
 void ChatWidgetModel::updateMessageReactions(const QString& messageId, const QList<ChatWidgetReaction>& reactions)
 {
-    if (messageId.trimmed().isEmpty()) {
-        return;
-    }
-    for (int i = 0; i < m_messages.size(); ++i) {
-        if (m_messages[i].messageId != messageId) {
-            continue;
-        }
-        if (m_messages[i].reactions == reactions) {
-            return;
-        }
-        m_messages[i].reactions = reactions;
-        QModelIndex idx = index(i, 0);
-        emit dataChanged(idx, idx, { ChatWidgetReactionsRole });
+    const int row = rowForMessageId(messageId);
+    if (row < 0 || !m_store.setReactions(row, reactions)) {
         return;
     }
+    notifyRowsChanged(row, row, { ChatWidgetReactionsRole });
 }
 
 void ChatWidgetModel::updateMessageAttachments(const QString& messageId, const QString& imagePath, const QString& filePath,
                                                const QString& fileName, qint64 fileSize)
 {
-    if (messageId.trimmed().isEmpty()) {
-        return;
-    }
-    for (int i = 0; i < m_messages.size(); ++i) {
-        if (m_messages[i].messageId != messageId) {
-            continue;
-        }
-        bool changed = false;
-        if (m_messages[i].imagePath != imagePath) {
-            m_messages[i].imagePath = imagePath;
-            changed = true;
-        }
-        if (m_messages[i].filePath != filePath) {
-            m_messages[i].filePath = filePath;
-            changed = true;
-        }
-        if (m_messages[i].fileName != fileName) {
-            m_messages[i].fileName = fileName;
-            changed = true;
-        }
-        if (m_messages[i].fileSize != fileSize) {
-            m_messages[i].fileSize = fileSize;
-            changed = true;
-        }
-        if (!changed) {
-            return;
-        }
-        QModelIndex idx = index(i, 0);
-        emit dataChanged(idx, idx, { ChatWidgetImagePathRole, ChatWidgetFilePathRole, ChatWidgetFileNameRole, ChatWidgetFileSizeRole });
+    const int row = rowForMessageId(messageId);
+    if (row < 0 || !m_store.setAttachments(row, imagePath, filePath, fileName, fileSize)) {
         return;
     }
+    notifyRowsChanged(row, row, { ChatWidgetImagePathRole, ChatWidgetFilePathRole, ChatWidgetFileNameRole, ChatWidgetFileSizeRole });
 }
 
 void ChatWidgetModel::updateMessageReply(const QString& messageId, const QString& replyToMessageId, const QString& replySender,
                                          const QString& replyPreview, bool isForwarded, const QString& forwardedFrom)
 {
-    if (messageId.trimmed().isEmpty()) {
-        return;
-    }
-    for (int i = 0; i < m_messages.size(); ++i) {
-        if (m_messages[i].messageId != messageId) {
-            continue;
-        }
-        bool changed = false;
-        if (m_messages[i].replyToMessageId != replyToMessageId) {
-            m_messages[i].replyToMessageId = replyToMessageId;
-            changed = true;
-        }
-        if (m_messages[i].replySender != replySender) {
-            m_messages[i].replySender = replySender;
-            changed = true;
-        }
-        if (m_messages[i].replyPreview != replyPreview) {
-            m_messages[i].replyPreview = replyPreview;
-            changed = true;
-        }
-        if (m_messages[i].isForwarded != isForwarded) {
-            m_messages[i].isForwarded = isForwarded;
-            changed = true;
-        }
-        if (m_messages[i].forwardedFrom != forwardedFrom) {
-            m_messages[i].forwardedFrom = forwardedFrom;
-            changed = true;
-        }
-        if (!changed) {
-            return;
-        }
-        QModelIndex idx = index(i, 0);
-        emit dataChanged(idx, idx, { ChatWidgetReplyToMessageIdRole, ChatWidgetReplySenderRole, ChatWidgetReplyPreviewRole,
-                                     ChatWidgetIsForwardedRole, ChatWidgetForwardedFromRole });
+    const int row = rowForMessageId(messageId);
+    if (row < 0 || !m_store.setReply(row, replyToMessageId, replySender, replyPreview, isForwarded, forwardedFrom)) {
         return;
     }
+    notifyRowsChanged(row, row, { ChatWidgetReplyToMessageIdRole, ChatWidgetReplySenderRole, ChatWidgetReplyPreviewRole,
+                                 ChatWidgetIsForwardedRole, ChatWidgetForwardedFromRole });
 }
 
 void ChatWidgetModel::setSearchKeyword(const QString& keyword)
@@ -437,56 +642,459 @@ void ChatWidgetModel::setSearchKeyword(const QString& keyword)
     if (m_searchKeyword == keyword) {
         return;
     }
+    const QString previous = m_searchKeyword;
     m_searchKeyword = keyword;
-    if (m_messages.isEmpty()) {
+    m_searchMatcher.setPatterns(QStringList(), keyword);
+    // 不逐行判定：已缓存的命中状态整体失效，绘制或查询到的行再按需重算
+    invalidateSearchMatches();
+    emit searchKeywordChanged(keyword, previous);
+}
+
+QString ChatWidgetModel::searchKeyword() const
+{
+    return m_searchKeyword;
+}
+
+bool ChatWidgetModel::isSearchMatch(int row) const
+{
+    if (row < 0 || row >= m_rowStates.size() || m_searchMatcher.isEmpty()) {
+        return false;
+    }
+    const RowState& state = m_rowStates.at(row);
+    if (state.searchGeneration != m_searchGeneration) {
+        state.searchGeneration = m_searchGeneration;
+        state.searchMatch = isSearchCandidate(state.key)
+            && !m_searchMatcher.match(searchableText(row)).isEmpty();
+    }
+    return state.searchMatch;
+}
+
+int ChatWidgetModel::searchMatchCount() const
+{
+    if (m_searchMatcher.isEmpty()) {
+        return 0;
+    }
+    int count = 0;
+    ensureSearchCandidates();
+    if (!m_searchIndexed) {
+        for (int row = 0; row < m_rowStates.size(); ++row) {
+            count += isSearchMatch(row) ? 1 : 0;
+        }
+        return count;
+    }
+    for (quint64 key : m_searchCandidates) {
+        count += isSearchMatch(rowForKey(key)) ? 1 : 0;
+    }
+    return count;
+}
+
+void ChatWidgetModel::ensureSearchCandidates() const
+{
+    if (m_searchCandidatesValid) {
         return;
     }
-    QModelIndex first = index(0, 0);
-    QModelIndex last = index(m_messages.size() - 1, 0);
-    emit dataChanged(first, last, { ChatWidgetSearchKeywordRole });
+    ensureSearchIndex();
+    m_searchCandidates = m_searchIndex.candidates(m_searchKeyword, &m_searchIndexed);
+    m_searchCandidatesValid = true;
+}
+
+bool ChatWidgetModel::isSearchCandidate(quint64 key) const
+{
+    ensureSearchCandidates();
+    return !m_searchIndexed || std::binary_search(m_searchCandidates.cbegin(), m_searchCandidates.cend(), key);
+}
+
+QString ChatWidgetModel::searchableText(int row) const
+{
+    // 纯文本在行加入索引或内容修改时算好一次，这里只读缓存
+    ensureSearchIndex();
+    return m_searchIndex.text(m_rowStates.at(row).key);
+}
+
+void ChatWidgetModel::invalidateSearchMatches()
+{
+    // 代数 0 留给尚未判定的行
+    if (++m_searchGeneration == 0) {
+        ++m_searchGeneration;
+    }
+    m_searchCandidatesValid = false;
 }
 
 void ChatWidgetModel::removeMessageAt(int row)
 {
-    if (row < 0 || row >= m_messages.size()) {
+    removeMessages(row, 1);
+}
+
+void ChatWidgetModel::removeMessages(int first, int count)
+{
+    if (first < 0 || count <= 0 || first >= m_store.count()) {
         return;
     }
-    beginRemoveRows(QModelIndex(), row, row);
-    const QString messageId = m_messages.at(row).messageId;
-    m_messages.removeAt(row);
-    if (!messageId.isEmpty()) {
-        m_messageIds.remove(messageId);
+    count = qMin(count, m_store.count() - first);
+    if (first >= rowCount()) {
+        // 批处理中尚未通知视图的追加行，直接与追加相抵
+        removeRowRange(first, count);
+        m_pendingAppendCount -= count;
+        return;
     }
+    flushBatch();
+    beginRemoveRows(QModelIndex(), first, first + count - 1);
+    removeRowRange(first, count);
     endRemoveRows();
 }
 
 void ChatWidgetModel::removeLastMessage()
 {
-    if (m_messages.isEmpty()) {
+    if (m_store.isEmpty()) {
         return;
     }
+    removeMessageAt(m_store.count() - 1);
+}
 
-    int lastIdx = m_messages.size() - 1;
-    const QString removedId = m_messages[lastIdx].messageId;
-    beginRemoveRows(QModelIndex(), lastIdx, lastIdx);
-    m_messages.removeAt(lastIdx);
-    endRemoveRows();
-    if (!removedId.isEmpty() && !messageIdExists(m_messages, removedId)) {
-        m_messageIds.remove(removedId);
+void ChatWidgetModel::clearMessages()
+{
+    if (m_store.isEmpty())
+        return;
+    m_pendingChanges.clear();
+    const int visibleRows = rowCount();
+    if (visibleRows > 0) {
+        beginRemoveRows(QModelIndex(), 0, visibleRows - 1);
+    }
+    m_store.clear();
+    m_rowStates.clear();
+    m_searchIndex.clear();
+    m_searchCandidatesValid = false;
+    m_keyById.clear();
+    m_hasDuplicateIds = false;
+    m_pendingAppendCount = 0;
+    resetParticipantRows();
+    if (visibleRows > 0) {
+        endRemoveRows();
     }
 }
 
-void ChatWidgetModel::clearMessages()
+void ChatWidgetModel::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+void ChatWidgetModel::endBatch()
 {
-    if (m_messages.isEmpty())
+    if (m_batchDepth <= 0) {
         return;
-    beginRemoveRows(QModelIndex(), 0, m_messages.size() - 1);
-    m_messages.clear();
-    m_messageIds.clear();
-    endRemoveRows();
+    }
+    if (--m_batchDepth == 0) {
+        flushBatch();
+    }
+}
+
+bool ChatWidgetModel::isBatching() const
+{
+    return m_batchDepth > 0;
+}
+
+int ChatWidgetModel::rowForMessageId(const QString& messageId) const
+{
+    if (messageId.isEmpty()) {
+        return -1;
+    }
+    auto it = m_keyById.constFind(messageId);
+    if (it == m_keyById.constEnd()) {
+        return -1;
+    }
+    return rowForKey(it.value());
+}
+
+bool ChatWidgetModel::containsMessageId(const QString& messageId) const
+{
+    return !messageId.isEmpty() && m_keyById.contains(messageId);
 }
 
 int ChatWidgetModel::messageCount() const
 {
-    return m_messages.size();
+    return m_store.count();
+}
+
+quint64 ChatWidgetModel::allocateKey(bool prepend)
+{
+    if (prepend) {
+        m_prevKey -= kKeyStride;
+        return m_prevKey;
+    }
+    m_nextKey += kKeyStride;
+    return m_nextKey;
+}
+
+ChatWidgetModel::RowState ChatWidgetModel::createRowState(const QString& content, quint64 key)
+{
+    RowState state;
+    state.key = key;
+    state.revision = ++m_nextRevision;
+    m_searchCandidatesValid = false;
+    if (m_searchIndexBuilt) {
+        m_searchIndex.addDocument(state.key, ChatWidgetMarkdownUtils::plainText(content));
+    }
+    return state;
+}
+
+void ChatWidgetModel::ensureSearchIndex() const
+{
+    if (m_searchIndexBuilt) {
+        return;
+    }
+    for (int row = 0; row < m_rowStates.size(); ++row) {
+        const QString text = ChatWidgetMarkdownUtils::plainText(m_store.content(row));
+        m_searchIndex.addDocument(m_rowStates.at(row).key, text);
+    }
+    m_searchIndexBuilt = true;
+}
+
+QVector<int> ChatWidgetModel::participantRows(int participant) const
+{
+    if (!m_participantKeysBuilt) {
+        m_participantKeys = QVector<QVector<quint64>>(m_store.participantSlotCount());
+        for (int row = 0; row < m_store.count(); ++row) {
+            m_participantKeys[m_store.participantOf(row)].append(m_rowStates.at(row).key);
+        }
+        m_participantKeysBuilt = true;
+    }
+    QVector<int> rows;
+    if (participant < 0 || participant >= m_participantKeys.size()) {
+        return rows;
+    }
+    const QVector<quint64>& keys = m_participantKeys.at(participant);
+    rows.reserve(keys.size());
+    for (quint64 key : keys) {
+        rows.append(rowForKey(key));
+    }
+    return rows;
+}
+
+void ChatWidgetModel::indexParticipantRows(int first, int last)
+{
+    if (!m_participantKeysBuilt) {
+        return;
+    }
+    if (m_participantKeys.size() < m_store.participantSlotCount()) {
+        m_participantKeys.resize(m_store.participantSlotCount());
+    }
+    for (int row = first; row <= last; ++row) {
+        QVector<quint64>& keys = m_participantKeys[m_store.participantOf(row)];
+        const quint64 key = m_rowStates.at(row).key;
+        // 追加的行直接放到末尾，前插与中间插入的行按 key 定位
+        if (keys.isEmpty() || keys.last() < key) {
+            keys.append(key);
+        } else {
+            keys.insert(std::lower_bound(keys.begin(), keys.end(), key), key);
+        }
+    }
+}
+
+void ChatWidgetModel::unindexParticipantRows(int first, int last)
+{
+    if (!m_participantKeysBuilt) {
+        return;
+    }
+    for (int row = first; row <= last; ++row) {
+        QVector<quint64>& keys = m_participantKeys[m_store.participantOf(row)];
+        const quint64 key = m_rowStates.at(row).key;
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it != keys.end() && *it == key) {
+            keys.erase(it);
+        }
+    }
+}
+
+void ChatWidgetModel::resetParticipantRows()
+{
+    m_participantKeys.clear();
+    m_participantKeysBuilt = false;
+}
+
+void ChatWidgetModel::notifyParticipantChanged(int participant, bool named)
+{
+    if (named) {
+        // 名字区出现，行高变化：按参与者的行索引逐行通知
+        emitRowsChanged(participantRows(participant), { ChatWidgetSenderRole, ChatWidgetAvatarRole });
+        return;
+    }
+    // 只影响绘制：不对整段历史逐行发出 dataChanged，视图只重绘可见的行
+    emit participantChanged(m_store.participantSenderId(participant));
+}
+
+void ChatWidgetModel::notifyUpdatedParticipants()
+{
+    // 新消息更新（追加）或补全（插入旧消息）了参与者的显示名或头像，已有行随之变化
+    const QVector<ChatWidgetMessageStore::ParticipantUpdate> updated = m_store.takeUpdatedParticipants();
+    for (const ChatWidgetMessageStore::ParticipantUpdate& update : updated) {
+        notifyParticipantChanged(update.participant, update.named);
+    }
+}
+
+QVector<int> ChatWidgetModel::findMessages(const QString& query) const
+{
+    QVector<int> rows;
+    const ChatWidgetHighlighter matcher(QStringList(), query);
+    if (matcher.isEmpty()) {
+        return rows;
+    }
+    const int visibleRows = rowCount();
+    ensureSearchIndex();
+    bool indexed = false;
+    const QVector<quint64> keys = m_searchIndex.candidates(query, &indexed);
+    if (!indexed) {
+        // 查询中没有可索引的词（如纯标点）：逐行比对
+        for (int row = 0; row < visibleRows; ++row) {
+            if (!matcher.match(searchableText(row)).isEmpty()) {
+                rows.append(row);
+            }
+        }
+        return rows;
+    }
+    // 候选集只保证包含全部查询词，再在渲染后的纯文本上按高亮器的规则（词首命中）校验短语连续，
+    // 与绘制时的高亮一致
+    for (quint64 key : keys) {
+        const int row = rowForKey(key);
+        if (row >= 0 && row < visibleRows && !matcher.match(searchableText(row)).isEmpty()) {
+            rows.append(row);
+        }
+    }
+    return rows;
+}
+
+int ChatWidgetModel::rowForKey(quint64 key) const
+{
+    auto it = std::lower_bound(m_rowStates.cbegin(), m_rowStates.cend(), key,
+                               [](const RowState& state, quint64 value) { return state.key < value; });
+    if (it == m_rowStates.cend() || it->key != key) {
+        return -1;
+    }
+    return static_cast<int>(it - m_rowStates.cbegin());
+}
+
+const ChatWidgetMessageStore& ChatWidgetModel::messageStore() const
+{
+    return m_store;
+}
+
+quint64 ChatWidgetModel::messageKeyAt(int row) const
+{
+    return m_rowStates.at(row).key;
+}
+
+quint64 ChatWidgetModel::contentRevisionAt(int row) const
+{
+    return m_rowStates.at(row).revision;
+}
+
+void ChatWidgetModel::bumpContentRevision(int row)
+{
+    RowState& state = m_rowStates[row];
+    state.revision = ++m_nextRevision;
+    if (m_searchIndexBuilt) {
+        m_searchIndex.updateDocument(state.key, ChatWidgetMarkdownUtils::plainText(m_store.content(row)));
+    }
+    state.searchGeneration = 0;
+    m_searchCandidatesValid = false;
+}
+
+void ChatWidgetModel::indexRow(const QString& messageId, int row)
+{
+    if (!messageId.isEmpty()) {
+        m_keyById.insert(messageId, m_rowStates.at(row).key);
+    }
+}
+
+void ChatWidgetModel::emitRowsChanged(QVector<int> rows, const QVector<int>& roles)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+    std::sort(rows.begin(), rows.end());
+    int first = rows.first();
+    int last = first;
+    for (int i = 1; i < rows.size(); ++i) {
+        if (rows.at(i) <= last + 1) {
+            last = qMax(last, rows.at(i));
+            continue;
+        }
+        notifyRowsChanged(first, last, roles);
+        first = last = rows.at(i);
+    }
+    notifyRowsChanged(first, last, roles);
+}
+
+void ChatWidgetModel::notifyRowsChanged(int first, int last, const QVector<int>& roles)
+{
+    // 批处理中追加的行尚未通知视图，插入通知本身已覆盖其内容
+    last = qMin(last, rowCount() - 1);
+    if (first < 0 || first > last) {
+        return;
+    }
+    if (m_batchDepth > 0) {
+        m_pendingChanges.append({ first, last, roleMask(roles) });
+        return;
+    }
+    emit dataChanged(index(first, 0), index(last, 0), roles);
+}
+
+void ChatWidgetModel::flushBatch()
+{
+    if (!m_pendingChanges.isEmpty()) {
+        QVector<PendingChange> changes;
+        changes.swap(m_pendingChanges);
+        std::sort(changes.begin(), changes.end(),
+                  [](const PendingChange& a, const PendingChange& b) { return a.first < b.first; });
+        // 相邻或重叠的区间合并为一次 dataChanged，角色取并集
+        PendingChange merged = changes.first();
+        for (int i = 1; i < changes.size(); ++i) {
+            const PendingChange& change = changes.at(i);
+            if (change.first <= merged.last + 1) {
+                merged.last = qMax(merged.last, change.last);
+                merged.roles |= change.roles;
+                continue;
+            }
+            emit dataChanged(index(merged.first, 0), index(merged.last, 0), rolesFromMask(merged.roles));
+            merged = change;
+        }
+        emit dataChanged(index(merged.first, 0), index(merged.last, 0), rolesFromMask(merged.roles));
+    }
+    if (m_pendingAppendCount > 0) {
+        const int first = m_store.count() - m_pendingAppendCount;
+        beginInsertRows(QModelIndex(), first, m_store.count() - 1);
+        m_pendingAppendCount = 0;
+        endInsertRows();
+    }
+}
+
+void ChatWidgetModel::removeRowRange(int first, int count)
+{
+    QStringList removedIds;
+    for (int row = first; row < first + count; ++row) {
+        auto it = m_keyById.find(m_store.messageId(row));
+        if (it != m_keyById.end() && it.value() == m_rowStates.at(row).key) {
+            removedIds.append(it.key());
+            m_keyById.erase(it);
+        }
+    }
+    for (int row = first; row < first + count; ++row) {
+        if (m_searchIndexBuilt) {
+            m_searchIndex.removeDocument(m_rowStates.at(row).key);
+        }
+    }
+    unindexParticipantRows(first, first + count - 1);
+    m_store.removeRange(first, count);
+    m_rowStates.remove(first, count);
+    // 索引按 key 记录，其余行前移不必改写
+    if (m_hasDuplicateIds) {
+        // 通过 addMessage 加入的重复 messageId：索引改指向剩余的第一条
+        for (const QString& messageId : removedIds) {
+            for (int i = 0; i < m_store.count(); ++i) {
+                if (m_store.messageId(i) == messageId) {
+                    indexRow(messageId, i);
+                    break;
+                }
+            }
+        }
+    }
 }
@@ -1,80 +1,20 @@
 #ifndef CHAT_WIDGET_MODEL_H
 #define CHAT_WIDGET_MODEL_H
 
+#include "chat_widget_gap_vector.h"
+#include "chat_widget_highlighter.h"
+#include "chat_widget_message.h"
+#include "chat_widget_message_store.h"
+#include "chat_widget_search_index.h"
 #include <QAbstractListModel>
-#include <QDateTime>
 #include <QHash>
 #include <QList>
-#include <QStringList>
 #include <QString>
 #include <QtGlobal>
 #include <QVariant>
+#include <QVector>
 #include <QSet>
 
-struct ChatWidgetReaction {
-    QString emoji;
-    int count = 0;
-
-    ChatWidgetReaction() = default;
-    ChatWidgetReaction(const QString& emojiValue, int countValue)
-        : emoji(emojiValue)
-        , count(countValue)
-    {
-    }
-};
-
-inline bool operator==(const ChatWidgetReaction& lhs, const ChatWidgetReaction& rhs)
-{
-    return lhs.emoji == rhs.emoji && lhs.count == rhs.count;
-}
-
-inline bool operator!=(const ChatWidgetReaction& lhs, const ChatWidgetReaction& rhs)
-{
-    return !(lhs == rhs);
-}
-
-struct ChatWidgetMessage {
-    enum class MessageType {
-        Text,
-        Image,
-        File,
-        System,
-        DateSeparator
-    };
-
-    enum class MessageStatus {
-        Sending,
-        Sent,
-        Failed,
-        Read
-    };
-
-    QString senderId;    // 发送者ID（多人聊天用）
-    QString sender;      // 发送者姓名
-    QString content;     // 消息内容
-    QString avatarPath;  // 头像路径
-    QDateTime timestamp; // 时间戳
-    bool isMine = false; // 是否是我发的消息
-    QString messageId;   // 消息唯一ID
-
-    MessageType messageType = MessageType::Text;
-    MessageStatus status = MessageStatus::Sent;
-
-    QString imagePath;
-    QString filePath;
-    QString fileName;
-    qint64 fileSize = 0;
-
-    QString replyToMessageId;
-    QString replySender;
-    QString replyPreview;
-    bool isForwarded = false;
-    QString forwardedFrom;
-
-    QList<ChatWidgetReaction> reactions;
-    QStringList mentions;
-};
-
 class ChatWidgetModel : public QAbstractListModel {
     Q_OBJECT
 public:
@@ -100,7 +40,9 @@ public:
         ChatWidgetReactionsRole,
         ChatWidgetMentionsRole,
         ChatWidgetIsSystemRole,
-        ChatWidgetSearchKeywordRole
+        ChatWidgetSearchKeywordRole,
+        ChatWidgetMessageKeyRole,     // 模型内稳定标识（不随行号变化，供缓存使用）
+        ChatWidgetContentRevisionRole // 内容修订号（内容变化时递增）
     };
 
     explicit ChatWidgetModel(QObject* parent = nullptr);
@@ -109,32 +51,176 @@ public:
     QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
 
+    // 右值重载就地排序/过滤传入的列表，不再复制整批消息；调用方不再使用时应 std::move 传入
     void addMessage(const ChatWidgetMessage& message);
+    void addMessage(ChatWidgetMessage&& message);
     void setMessages(const QList<ChatWidgetMessage>& messages);
+    void setMessages(QList<ChatWidgetMessage>&& messages);
     void appendMessages(const QList<ChatWidgetMessage>& messages);
+    void appendMessages(QList<ChatWidgetMessage>&& messages);
     void prependMessages(const QList<ChatWidgetMessage>& messages);
+    void prependMessages(QList<ChatWidgetMessage>&& messages);
+    // 按时间戳把消息并入现有时间线：输入已有序时不排序；整批不早于末行时按追加、不晚于首行时
+    // 按前插处理（O(k)），否则二分查找第一个插入点，按插入段从后往前逐段插入并通知
+    // （每段各自 beginInsertRows/endInsertRows，前后发出 rowsAboutToBeMerged/rowsMerged）。
+    // 迟到的消息时间相同时排在已有消息之后；messageId 已存在的消息被忽略
+    void mergeMessages(QList<ChatWidgetMessage>&& messages);
+    // 行引用共享的参与者记录，显示名、头像与 isMine 在读取时解析，以下两个接口只改记录：
+    // updateIsMine 按参与者的行索引只对其所在的行发出 dataChanged；显示名或头像变化不影响行高时
+    // 不逐行通知，只发出 participantChanged，由视图重绘可见的行（显示名由空变为非空时行高变化，仍逐行通知）
     void updateIsMine(const QString& currentUserId);
     void updateParticipantInfo(const QString& senderId, const QString& displayName, const QString& avatarPath);
     void appendContentToLastMessage(const QString& content);
     void appendContentToMessageAt(int row, const QString& content);
     void updateMessageContentAt(int row, const QString& content);
     void updateMessageStatus(const QString& messageId, ChatWidgetMessage::MessageStatus status);
+    // 批量更新状态：按行合并为连续区间发出 dataChanged
+    void updateMessageStatuses(const QHash<QString, ChatWidgetMessage::MessageStatus>& statuses);
     void updateMessageContent(const QString& messageId, const QString& content);
     void updateMessageReactions(const QString& messageId, const QList<ChatWidgetReaction>& reactions);
     void updateMessageAttachments(const QString& messageId, const QString& imagePath, const QString& filePath,
                                   const QString& fileName, qint64 fileSize);
     void updateMessageReply(const QString& messageId, const QString& replyToMessageId, const QString& replySender,
                             const QString& replyPreview, bool isForwarded, const QString& forwardedFrom);
+    // 关键字变化只使命中状态失效并发出 searchKeywordChanged（O(1)），不逐行判定、不发出 dataChanged。
+    // 命中按需判定并缓存到行上：候选行由全文索引按词前缀筛选（同 findMessages），再在渲染后的
+    // 纯文本（与绘制高亮所用的 QTextDocument::toRawText() 相同）上按高亮器匹配。
+    // 模型与委托同一规则：关键字只在词首命中，索引候选集因此是命中的超集
     void setSearchKeyword(const QString& keyword);
+    QString searchKeyword() const;
+    bool isSearchMatch(int row) const;
+    // 遍历候选行计数，供统计使用
+    int searchMatchCount() const;
+    // 全文检索：按词前缀/短语匹配（词首命中，规则同 isSearchMatch 与高亮）（不区分大小写，中日韩文字按二元组索引），返回升序行号。
+    // 倒排索引在首次检索时建立，之后随增删改增量维护
+    QVector<int> findMessages(const QString& query) const;
+    // 行的稳定标识（ChatWidgetMessageKeyRole）对应的行号，不存在时返回 -1（O(log n)）
+    int rowForKey(quint64 key) const;
+
+    // 类型化只读访问（见 ChatWidgetRowReader），供委托绕过 QVariant 角色直接读取字段；
+    // 角色接口保留给 QML 与其他使用者。row 须有效
+    const ChatWidgetMessageStore& messageStore() const;
+    quint64 messageKeyAt(int row) const;
+    quint64 contentRevisionAt(int row) const;
     void removeMessageAt(int row);
+    // 一次移除 [first, first + count) 区间的行（历史窗口淘汰等场景）
+    void removeMessages(int first, int count);
     void removeLastMessage();
     void clearMessages();
     int messageCount() const;
 
+    // 批量修改：期间的 dataChanged 按行区间合并、角色取并集，追加的行合并为一次插入，
+    // 在最外层 endBatch() 时统一发出。可嵌套；建议使用 ChatWidgetModelBatch
+    void beginBatch();
+    void endBatch();
+    bool isBatching() const;
+    // messageId 对应的行号，不存在时返回 -1（O(log n)）
+    int rowForMessageId(const QString& messageId) const;
+    bool containsMessageId(const QString& messageId) const;
+
+signals:
+    // 视图据此只重绘可见区域内新旧关键字命中的行
+    void searchKeywordChanged(const QString& keyword, const QString& previousKeyword);
+    // 中间插入时 key 间隔不足，局部重新分配了已有行的 key（oldKeys[i] -> newKeys[i]）；
+    // 按 key 保存的缓存与定位据此换用新 key，不必丢弃
+    void messageKeysChanged(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys);
+    // mergeMessages 与已有行交错时逐段发出 rowsInserted，两者包住整次合并（firstRow 为第一个插入点）；
+    // 视图据此只在合并前后各保存、恢复一次滚动位置
+    void rowsAboutToBeMerged(int firstRow);
+    void rowsMerged();
+    // 参与者的显示名或头像变化且行高不变（见 updateParticipantInfo）
+    void participantChanged(const QString& senderId);
+
 private:
-    QList<ChatWidgetMessage> m_messages;
+    struct RowState {
+        quint64 key = 0;
+        quint64 revision = 0;
+        // searchGeneration 等于模型当前的关键字代数时 searchMatch 有效
+        mutable quint32 searchGeneration = 0;
+        mutable bool searchMatch = false;
+    };
+
+    struct PendingChange {
+        int first;
+        int last;
+        quint64 roles; // 以 ChatWidgetSenderRole 为基准的位掩码
+    };
+
+    quint64 allocateKey(bool prepend);
+    RowState createRowState(const QString& content, quint64 key);
+    // positions[i] 为 messages[i] 插入前的行号（非降序）
+    void insertMessagesAt(const QVector<int>& positions, QList<ChatWidgetMessage>&& messages);
+    // 为 [first, first + count) 的新行分配 key，重新分配的已有行追加到 oldKeys/newKeys
+    void assignInsertedKeys(int first, int count, QVector<quint64>& oldKeys, QVector<quint64>& newKeys);
+    void ensureSearchIndex() const;
+    // 当前关键字的候选 key（升序），关键字变化或行增改后首次使用时查询索引；
+    // 关键字中没有可索引的词时所有行都是候选
+    void ensureSearchCandidates() const;
+    bool isSearchCandidate(quint64 key) const;
+    // 检索校验所用的文本：内容渲染后的纯文本（与委托高亮匹配的文档文本一致），
+    // 每个内容版本在加入索引时算一次并存在索引中
+    QString searchableText(int row) const;
+    void invalidateSearchMatches();
+    // 参与者 -> 行号（升序），由按 key 记录的索引换算；索引首次使用时构建，之后随插入、删除行
+    // 增量维护（key 不随行号变化，已有条目不必改写）
+    QVector<int> participantRows(int participant) const;
+    void indexParticipantRows(int first, int last);
+    void unindexParticipantRows(int first, int last);
+    void resetParticipantRows();
+    void notifyParticipantChanged(int participant, bool named);
+    void notifyUpdatedParticipants();
+    void bumpContentRevision(int row);
+    void indexRow(const QString& messageId, int row);
+    void emitRowsChanged(QVector<int> rows, const QVector<int>& roles);
+    void notifyRowsChanged(int first, int last, const QVector<int>& roles);
+    void flushBatch();
+    void removeRowRange(int first, int count);
+
+    ChatWidgetMessageStore m_store;
+    ChatWidgetGapVector<RowState> m_rowStates;
     QString m_searchKeyword;
-    QSet<QString> m_messageIds;
+    ChatWidgetHighlighter m_searchMatcher;
+    quint32 m_searchGeneration = 0;
+    mutable QVector<quint64> m_searchCandidates;
+    mutable bool m_searchCandidatesValid = false;
+    mutable bool m_searchIndexed = false;
+    // messageId -> 行 key，行号由 rowForKey 二分得到：任意位置插入/删除行都不必改写已有条目
+    QHash<QString, quint64> m_keyById;
+    bool m_hasDuplicateIds = false; // addMessage 不去重，可能存在重复 messageId
+    int m_batchDepth = 0;
+    int m_pendingAppendCount = 0; // 批处理中已追加到末尾、尚未通知视图的行数
+    QVector<PendingChange> m_pendingChanges;
+    // 追加行的 key 向上、头部插入行的 key 向下按固定间隔分配，key 顺序始终与行顺序一致；
+    // 间隔留给中间插入的行，不足时只重新分配插入点附近的窗口
+    quint64 m_nextKey = quint64(1) << 62; // 已分配的最大 key
+    quint64 m_prevKey = quint64(1) << 62; // 已分配的最小 key
+    mutable ChatWidgetSearchIndex m_searchIndex;
+    mutable bool m_searchIndexBuilt = false;
+    mutable QVector<QVector<quint64>> m_participantKeys; // 参与者 -> 行 key（升序）
+    mutable bool m_participantKeysBuilt = false;
+    quint64 m_nextRevision = 0;
+};
+
+// 作用域内的批量修改，析构时提交
+class ChatWidgetModelBatch {
+public:
+    explicit ChatWidgetModelBatch(ChatWidgetModel* model)
+        : m_model(model)
+    {
+        if (m_model) {
+            m_model->beginBatch();
+        }
+    }
+    ~ChatWidgetModelBatch()
+    {
+        if (m_model) {
+            m_model->endBatch();
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(ChatWidgetModelBatch)
+    ChatWidgetModel* m_model;
 };
 
 #endif // CHAT_WIDGET_MODEL_H
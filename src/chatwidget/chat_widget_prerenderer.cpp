@@ -0,0 +1,272 @@
+#include "chat_widget_prerenderer.h"
+#include "chat_widget_markdown_document_builder.h"
+#include <QRunnable>
+#include <QTextDocument>
+#include <QThread>
+#include <QtMath>
+#include <functional>
+
+namespace {
+const int kChunkSize = 128;
+
+class RenderTask : public QRunnable {
+public:
+    RenderTask(ChatWidgetPrerenderer* owner, const QVector<ChatWidgetPrerenderer::Request>& requests,
+               const QFont& font, int textWidth, quint32 styleGeneration,
+               std::function<void(const QVector<quint64>&, const QVector<ChatWidgetPrerenderer::Result>&)> done)
+        : m_owner(owner)
+        , m_requests(requests)
+        , m_font(font)
+        , m_textWidth(textWidth)
+        , m_styleGeneration(styleGeneration)
+        , m_done(std::move(done))
+    {
+    }
+
+    void run() override
+    {
+        QVector<quint64> keys;
+        QVector<ChatWidgetPrerenderer::Result> results;
+        keys.reserve(m_requests.size());
+        results.reserve(m_requests.size());
+        for (const ChatWidgetPrerenderer::Request& request : m_requests) {
+            ChatWidgetPrerenderer::Result result = ChatWidgetPrerenderer::render(request.source, m_font, m_textWidth);
+            result.revision = request.revision;
+            result.styleGeneration = m_styleGeneration;
+            // 交给 GUI 线程接管：必须在文档当前所在的线程移交
+            result.document->moveToThread(m_owner->thread());
+            keys.append(request.key);
+            results.append(result);
+        }
+        // 析构时会等待线程池，投递期间 m_owner 有效
+        auto done = m_done;
+        QMetaObject::invokeMethod(
+            m_owner, [done, keys, results]() { done(keys, results); }, Qt::QueuedConnection);
+    }
+
+private:
+    ChatWidgetPrerenderer* m_owner;
+    QVector<ChatWidgetPrerenderer::Request> m_requests;
+    QFont m_font;
+    int m_textWidth;
+    quint32 m_styleGeneration;
+    std::function<void(const QVector<quint64>&, const QVector<ChatWidgetPrerenderer::Result>&)> m_done;
+};
+} // namespace
+
+ChatWidgetPrerenderer::ChatWidgetPrerenderer(QObject* parent) : QObject(parent)
+{
+    // 留一个核心给 GUI 线程
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+ChatWidgetPrerenderer::~ChatWidgetPrerenderer()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void ChatWidgetPrerenderer::setMaxThreadCount(int threads)
+{
+    m_pool.setMaxThreadCount(qMax(1, threads));
+}
+
+int ChatWidgetPrerenderer::maxThreadCount() const
+{
+    return m_pool.maxThreadCount();
+}
+
+void ChatWidgetPrerenderer::enqueue(const QVector<Request>& requests, const QFont& font, int textWidth,
+                                    quint32 styleGeneration)
+{
+    QVector<Request> chunk;
+    chunk.reserve(kChunkSize);
+    const quint64 generation = m_generation;
+    auto flush = [&]() {
+        if (chunk.isEmpty()) {
+            return;
+        }
+        m_pool.start(new RenderTask(this, chunk, font, textWidth, styleGeneration,
+                                    [this, generation](const QVector<quint64>& keys, const QVector<Result>& results) {
+                                        onChunkRendered(generation, keys, results);
+                                    }));
+        chunk.clear();
+    };
+    for (const Request& request : requests) {
+        if (request.key == 0 || m_pending.value(request.key) == request.revision) {
+            continue;
+        }
+        auto it = m_results.constFind(request.key);
+        if (it != m_results.constEnd() && it->revision == request.revision && it->textWidth == textWidth
+            && it->styleGeneration == styleGeneration) {
+            continue;
+        }
+        m_pending.insert(request.key, request.revision);
+        chunk.append(request);
+        if (chunk.size() >= kChunkSize) {
+            flush();
+        }
+    }
+    flush();
+}
+
+bool ChatWidgetPrerenderer::isPending(quint64 key, quint64 revision) const
+{
+    auto it = m_pending.constFind(key);
+    return it != m_pending.constEnd() && it.value() == revision;
+}
+
+bool ChatWidgetPrerenderer::find(quint64 key, quint64 revision, Result* result) const
+{
+    auto it = m_results.constFind(key);
+    if (it == m_results.constEnd() || it->revision != revision) {
+        return false;
+    }
+    if (result) {
+        *result = it.value();
+    }
+    return true;
+}
+
+QSharedPointer<QTextDocument> ChatWidgetPrerenderer::takeDocument(quint64 key)
+{
+    auto it = m_results.find(key);
+    if (it == m_results.end() || !it->document) {
+        return QSharedPointer<QTextDocument>();
+    }
+    QSharedPointer<QTextDocument> document = it->document;
+    releaseDocument(&it.value());
+    return document;
+}
+
+int ChatWidgetPrerenderer::documentCount() const
+{
+    return m_documentCount;
+}
+
+void ChatWidgetPrerenderer::remove(quint64 key)
+{
+    auto it = m_results.find(key);
+    if (it != m_results.end()) {
+        releaseDocument(&it.value());
+        m_results.erase(it);
+    }
+}
+
+void ChatWidgetPrerenderer::remap(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys)
+{
+    QVector<Result> results;
+    QVector<bool> found;
+    results.reserve(oldKeys.size());
+    found.reserve(oldKeys.size());
+    for (quint64 key : oldKeys) {
+        m_pending.remove(key);
+        auto it = m_results.find(key);
+        found.append(it != m_results.end());
+        results.append(found.last() ? it.value() : Result());
+        if (found.last()) {
+            m_results.erase(it);
+        }
+    }
+    for (int i = 0; i < results.size(); ++i) {
+        m_pending.remove(newKeys.at(i));
+        if (found.at(i)) {
+            m_results.insert(newKeys.at(i), results.at(i));
+            if (results.at(i).document) {
+                m_documentKeys.enqueue(newKeys.at(i));
+            }
+        }
+    }
+}
+
+void ChatWidgetPrerenderer::clear()
+{
+    m_pool.clear();
+    m_pending.clear();
+    m_results.clear();
+    m_documentKeys.clear();
+    m_documentCount = 0;
+    ++m_generation;
+}
+
+int ChatWidgetPrerenderer::pendingCount() const
+{
+    return m_pending.size();
+}
+
+int ChatWidgetPrerenderer::resultCount() const
+{
+    return m_results.size();
+}
+
+ChatWidgetPrerenderer::Result ChatWidgetPrerenderer::render(const QString& source, const QFont& font, int textWidth)
+{
+    Result result;
+    result.textWidth = textWidth;
+    // QTextDocument 可重入：每次使用线程内的独立实例
+    result.document = QSharedPointer<QTextDocument>::create();
+    QTextDocument* document = result.document.data();
+    document->setDefaultFont(font);
+    ChatWidgetMarkdownDocumentBuilder::build(source, document);
+    document->setTextWidth(textWidth);
+    result.documentSize = QSize(qMin(textWidth, qCeil(document->idealWidth())), qCeil(document->size().height()));
+    return result;
+}
+
+void ChatWidgetPrerenderer::onChunkRendered(quint64 generation, const QVector<quint64>& keys,
+                                            const QVector<Result>& results)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    QVector<quint64> accepted;
+    accepted.reserve(keys.size());
+    for (int i = 0; i < keys.size(); ++i) {
+        auto it = m_pending.find(keys.at(i));
+        // 排队后内容已变化（或已被重新排队）的结果作废
+        if (it == m_pending.end() || it.value() != results.at(i).revision) {
+            continue;
+        }
+        m_pending.erase(it);
+        auto previous = m_results.find(keys.at(i));
+        if (previous != m_results.end()) {
+            releaseDocument(&previous.value());
+        }
+        m_results.insert(keys.at(i), results.at(i));
+        if (results.at(i).document) {
+            ++m_documentCount;
+            m_documentKeys.enqueue(keys.at(i));
+        }
+        accepted.append(keys.at(i));
+    }
+    trimDocuments();
+    if (!accepted.isEmpty()) {
+        emit rendered(accepted);
+    }
+}
+
+void ChatWidgetPrerenderer::releaseDocument(Result* result)
+{
+    if (result->document) {
+        result->document.reset();
+        --m_documentCount;
+    }
+}
+
+void ChatWidgetPrerenderer::trimDocuments()
+{
+    // 队列中已被接管、删除或改用新 key 的项直接跳过
+    while (m_documentCount > kMaxDocuments && !m_documentKeys.isEmpty()) {
+        auto it = m_results.find(m_documentKeys.dequeue());
+        if (it != m_results.end()) {
+            releaseDocument(&it.value());
+        }
+    }
+    while (!m_documentKeys.isEmpty()) {
+        auto it = m_results.constFind(m_documentKeys.head());
+        if (it != m_results.constEnd() && it->document) {
+            break;
+        }
+        m_documentKeys.dequeue();
+    }
+}
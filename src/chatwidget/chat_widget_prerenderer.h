@@ -0,0 +1,82 @@
+#ifndef CHAT_WIDGET_PRERENDERER_H
+#define CHAT_WIDGET_PRERENDERER_H
+
+#include <QFont>
+#include <QHash>
+#include <QObject>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <QtGlobal>
+
+class QTextDocument;
+
+// 历史消息预渲染：在线程池中由 md4c（可重入）解析 Markdown，直接构建线程内独立的
+// QTextDocument 并按给定字体与宽度量出文档尺寸。文档移交 GUI 线程后与尺寸一起按消息
+// 稳定标识保存，委托建立排版缓存时直接接管，不再重新解析；最近的 kMaxDocuments 份之外
+// 只保留尺寸。
+class ChatWidgetPrerenderer : public QObject {
+    Q_OBJECT
+
+public:
+    struct Request {
+        quint64 key = 0;
+        quint64 revision = 0;
+        QString source;
+    };
+
+    struct Result {
+        quint64 revision = 0;
+        quint32 styleGeneration = 0;
+        int textWidth = 0;
+        QSize documentSize; // 与委托的计算方式一致：宽度已收缩到 idealWidth
+        QSharedPointer<QTextDocument> document; // 已排版的文档（属于 GUI 线程），被接管或淘汰后为空
+    };
+
+    // 保留文档的结果数上限，超出时丢弃最早的文档（尺寸仍保留）
+    static constexpr int kMaxDocuments = 1024;
+
+    explicit ChatWidgetPrerenderer(QObject* parent = nullptr);
+    ~ChatWidgetPrerenderer() override;
+
+    void setMaxThreadCount(int threads);
+    int maxThreadCount() const;
+
+    // 请求按固定大小分片并行处理，每个分片完成后发出 rendered
+    void enqueue(const QVector<Request>& requests, const QFont& font, int textWidth, quint32 styleGeneration);
+    bool isPending(quint64 key, quint64 revision) const;
+    // 返回与修订号一致的结果；结果保留到 remove/clear，以便排版缓存淘汰后复用
+    bool find(quint64 key, quint64 revision, Result* result) const;
+    // 交出结果中的文档（之后结果只保留尺寸），没有时返回空
+    QSharedPointer<QTextDocument> takeDocument(quint64 key);
+    int documentCount() const;
+    void remove(quint64 key);
+    // 结果改用新 key；排队中的旧 key 作废（在途分片的结果被丢弃，需要时重新排版）
+    void remap(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys);
+    void clear();
+    int pendingCount() const;
+    int resultCount() const;
+
+    // 可在任意线程调用；文档属于调用线程
+    static Result render(const QString& source, const QFont& font, int textWidth);
+
+signals:
+    void rendered(const QVector<quint64>& keys);
+
+private:
+    void onChunkRendered(quint64 generation, const QVector<quint64>& keys, const QVector<Result>& results);
+    void releaseDocument(Result* result);
+    void trimDocuments();
+
+    QHash<quint64, quint64> m_pending; // key -> 排队时的修订号
+    QHash<quint64, Result> m_results;
+    QQueue<quint64> m_documentKeys; // 带文档的结果按到达顺序排列，可能含已失效的 key
+    int m_documentCount = 0;
+    QThreadPool m_pool;
+    quint64 m_generation = 0; // clear() 后递增，丢弃仍在途的旧分片
+};
+
+#endif // CHAT_WIDGET_PRERENDERER_H
@@ -0,0 +1,148 @@
+#include "chat_widget_row_reader.h"
+#include "chat_widget_model.h"
+
+namespace {
+QList<ChatWidgetReaction> reactionsFromVariant(const QVariant& value)
+{
+    QList<ChatWidgetReaction> reactions;
+    const QVariantList list = value.toList();
+    reactions.reserve(list.size());
+    for (const QVariant& item : list) {
+        const QVariantMap map = item.toMap();
+        const QString emoji = map.value("emoji").toString();
+        if (emoji.isEmpty()) {
+            continue;
+        }
+        ChatWidgetReaction reaction;
+        reaction.emoji = emoji;
+        reaction.count = map.value("count").toInt();
+        reactions.append(reaction);
+    }
+    return reactions;
+}
+} // namespace
+
+ChatWidgetRowReader::ChatWidgetRowReader(const QModelIndex& index)
+    : m_index(index)
+    , m_row(index.row())
+{
+    const auto* model = qobject_cast<const ChatWidgetModel*>(index.model());
+    if (model && m_row >= 0 && m_row < model->rowCount()) {
+        m_model = model;
+        m_store = &model->messageStore();
+    }
+}
+
+QVariant ChatWidgetRowReader::role(int role) const
+{
+    return m_index.data(role);
+}
+
+quint64 ChatWidgetRowReader::key() const
+{
+    return m_model ? m_model->messageKeyAt(m_row) : role(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong();
+}
+
+quint64 ChatWidgetRowReader::revision() const
+{
+    return m_model ? m_model->contentRevisionAt(m_row)
+                   : role(ChatWidgetModel::ChatWidgetContentRevisionRole).toULongLong();
+}
+
+ChatWidgetMessage::MessageType ChatWidgetRowReader::messageType() const
+{
+    return m_store ? m_store->messageType(m_row)
+                   : static_cast<ChatWidgetMessage::MessageType>(role(ChatWidgetModel::ChatWidgetMessageTypeRole).toInt());
+}
+
+ChatWidgetMessage::MessageStatus ChatWidgetRowReader::status() const
+{
+    return m_store
+        ? m_store->status(m_row)
+        : static_cast<ChatWidgetMessage::MessageStatus>(role(ChatWidgetModel::ChatWidgetMessageStatusRole).toInt());
+}
+
+bool ChatWidgetRowReader::isMine() const
+{
+    return m_store ? m_store->isMine(m_row) : role(ChatWidgetModel::ChatWidgetIsMineRole).toBool();
+}
+
+QDateTime ChatWidgetRowReader::timestamp() const
+{
+    return m_store ? m_store->timestamp(m_row) : role(ChatWidgetModel::ChatWidgetTimestampRole).toDateTime();
+}
+
+QString ChatWidgetRowReader::content() const
+{
+    return m_store ? m_store->content(m_row) : role(ChatWidgetModel::ChatWidgetContentRole).toString();
+}
+
+QString ChatWidgetRowReader::sender() const
+{
+    return m_store ? m_store->sender(m_row) : role(ChatWidgetModel::ChatWidgetSenderRole).toString();
+}
+
+QString ChatWidgetRowReader::senderId() const
+{
+    return m_store ? m_store->senderId(m_row) : role(ChatWidgetModel::ChatWidgetSenderIdRole).toString();
+}
+
+QString ChatWidgetRowReader::avatarPath() const
+{
+    return m_store ? m_store->avatarPath(m_row) : role(ChatWidgetModel::ChatWidgetAvatarRole).toString();
+}
+
+QString ChatWidgetRowReader::imagePath() const
+{
+    return m_store ? m_store->imagePath(m_row) : role(ChatWidgetModel::ChatWidgetImagePathRole).toString();
+}
+
+QString ChatWidgetRowReader::fileName() const
+{
+    return m_store ? m_store->fileName(m_row) : role(ChatWidgetModel::ChatWidgetFileNameRole).toString();
+}
+
+qint64 ChatWidgetRowReader::fileSize() const
+{
+    return m_store ? m_store->fileSize(m_row) : role(ChatWidgetModel::ChatWidgetFileSizeRole).toLongLong();
+}
+
+QString ChatWidgetRowReader::replyToMessageId() const
+{
+    return m_store ? m_store->replyToMessageId(m_row) : role(ChatWidgetModel::ChatWidgetReplyToMessageIdRole).toString();
+}
+
+QString ChatWidgetRowReader::replySender() const
+{
+    return m_store ? m_store->replySender(m_row) : role(ChatWidgetModel::ChatWidgetReplySenderRole).toString();
+}
+
+QString ChatWidgetRowReader::replyPreview() const
+{
+    return m_store ? m_store->replyPreview(m_row) : role(ChatWidgetModel::ChatWidgetReplyPreviewRole).toString();
+}
+
+bool ChatWidgetRowReader::isForwarded() const
+{
+    return m_store ? m_store->isForwarded(m_row) : role(ChatWidgetModel::ChatWidgetIsForwardedRole).toBool();
+}
+
+QString ChatWidgetRowReader::forwardedFrom() const
+{
+    return m_store ? m_store->forwardedFrom(m_row) : role(ChatWidgetModel::ChatWidgetForwardedFromRole).toString();
+}
+
+QList<ChatWidgetReaction> ChatWidgetRowReader::reactions() const
+{
+    return m_store ? m_store->reactions(m_row) : reactionsFromVariant(role(ChatWidgetModel::ChatWidgetReactionsRole));
+}
+
+QStringList ChatWidgetRowReader::mentions() const
+{
+    return m_store ? m_store->mentions(m_row) : role(ChatWidgetModel::ChatWidgetMentionsRole).toStringList();
+}
+
+QString ChatWidgetRowReader::searchKeyword() const
+{
+    return m_model ? m_model->searchKeyword() : role(ChatWidgetModel::ChatWidgetSearchKeywordRole).toString();
+}
@@ -0,0 +1,59 @@
+#ifndef CHAT_WIDGET_ROW_READER_H
+#define CHAT_WIDGET_ROW_READER_H
+
+#include "chat_widget_message.h"
+#include <QDateTime>
+#include <QList>
+#include <QModelIndex>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QtGlobal>
+
+class ChatWidgetModel;
+class ChatWidgetMessageStore;
+
+// 行数据的类型化读取。索引直接来自 ChatWidgetModel 时读取其列式存储：字符串共享存储中的数据，
+// 不经 QVariant 装箱，表情回应也不再经 QVariantList/QVariantMap 往返；
+// 其他模型（含代理模型）退化为按 ChatWidgetModel 的角色调用 data()。
+// 仅在单次 paint/sizeHint 调用内使用，不可跨模型修改保存
+class ChatWidgetRowReader {
+public:
+    explicit ChatWidgetRowReader(const QModelIndex& index);
+
+    const QModelIndex& index() const { return m_index; }
+    // 是否直接读取 ChatWidgetModel 的存储
+    bool isDirect() const { return m_model != nullptr; }
+
+    quint64 key() const;
+    quint64 revision() const;
+    ChatWidgetMessage::MessageType messageType() const;
+    ChatWidgetMessage::MessageStatus status() const;
+    bool isMine() const;
+    QDateTime timestamp() const;
+    QString content() const;
+    QString sender() const;
+    QString senderId() const;
+    QString avatarPath() const;
+    QString imagePath() const;
+    QString fileName() const;
+    qint64 fileSize() const;
+    QString replyToMessageId() const;
+    QString replySender() const;
+    QString replyPreview() const;
+    bool isForwarded() const;
+    QString forwardedFrom() const;
+    QList<ChatWidgetReaction> reactions() const;
+    QStringList mentions() const;
+    QString searchKeyword() const;
+
+private:
+    QVariant role(int role) const;
+
+    QModelIndex m_index;
+    const ChatWidgetModel* m_model = nullptr;
+    const ChatWidgetMessageStore* m_store = nullptr;
+    int m_row = -1;
+};
+
+#endif // CHAT_WIDGET_ROW_READER_H
@@ -0,0 +1,233 @@
+#include "chat_widget_search_index.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+bool isCjk(uint ucs4)
+{
+    return (ucs4 >= 0x3040 && ucs4 <= 0x30FF)     // 平假名、片假名
+        || (ucs4 >= 0x3400 && ucs4 <= 0x4DBF)     // CJK 扩展 A
+        || (ucs4 >= 0x4E00 && ucs4 <= 0x9FFF)     // CJK 统一表意文字
+        || (ucs4 >= 0xAC00 && ucs4 <= 0xD7AF)     // 韩文音节
+        || (ucs4 >= 0xF900 && ucs4 <= 0xFAFF)     // CJK 兼容表意文字
+        || (ucs4 >= 0x20000 && ucs4 <= 0x2FA1F);  // CJK 扩展 B 及以后
+}
+
+bool isWordChar(uint ucs4)
+{
+    return !isCjk(ucs4) && (QChar::isLetterOrNumber(ucs4) || ucs4 == '_');
+}
+
+QVector<quint64> intersect(const QVector<quint64>& a, const QVector<quint64>& b)
+{
+    QVector<quint64> result;
+    result.reserve(qMin(a.size(), b.size()));
+    std::set_intersection(a.cbegin(), a.cend(), b.cbegin(), b.cend(), std::back_inserter(result));
+    return result;
+}
+} // namespace
+
+QStringList ChatWidgetSearchIndex::tokenize(const QString& text)
+{
+    QStringList tokens;
+    QString word;
+    QVector<uint> cjkRun;
+    auto flushWord = [&]() {
+        if (!word.isEmpty()) {
+            tokens.append(word);
+            word.clear();
+        }
+    };
+    auto flushCjk = [&]() {
+        for (int i = 0; i + 1 < cjkRun.size(); ++i) {
+            tokens.append(QString::fromUcs4(&cjkRun[i], 2));
+        }
+        if (!cjkRun.isEmpty()) {
+            tokens.append(QString::fromUcs4(&cjkRun.last(), 1));
+        }
+        cjkRun.clear();
+    };
+
+    const QVector<uint> codePoints = text.toUcs4();
+    for (uint ucs4 : codePoints) {
+        if (isCjk(ucs4)) {
+            flushWord();
+            cjkRun.append(ucs4);
+        } else if (isWordChar(ucs4)) {
+            flushCjk();
+            word += QString::fromUcs4(&ucs4, 1).toCaseFolded();
+        } else {
+            flushWord();
+            flushCjk();
+        }
+    }
+    flushWord();
+    flushCjk();
+    return tokens;
+}
+
+bool ChatWidgetSearchIndex::isTokenStart(const QString& text, int position)
+{
+    if (position <= 0 || position >= text.size()) {
+        return true;
+    }
+    uint current = text.at(position).unicode();
+    if (QChar::isHighSurrogate(current) && position + 1 < text.size() && text.at(position + 1).isLowSurrogate()) {
+        current = QChar::surrogateToUcs4(text.at(position), text.at(position + 1));
+    }
+    if (!isWordChar(current)) {
+        return true;
+    }
+    uint previous = text.at(position - 1).unicode();
+    if (QChar::isLowSurrogate(previous) && position >= 2 && text.at(position - 2).isHighSurrogate()) {
+        previous = QChar::surrogateToUcs4(text.at(position - 2), text.at(position - 1));
+    }
+    return !isWordChar(previous);
+}
+
+void ChatWidgetSearchIndex::addDocument(quint64 key, const QString& text)
+{
+    Document document;
+    document.terms = tokenize(text);
+    document.terms.removeDuplicates();
+    document.text = text;
+    for (const QString& term : qAsConst(document.terms)) {
+        insertPosting(m_postings[term], key);
+    }
+    m_documents.insert(key, document);
+}
+
+void ChatWidgetSearchIndex::updateDocument(quint64 key, const QString& text)
+{
+    removeDocument(key);
+    addDocument(key, text);
+}
+
+void ChatWidgetSearchIndex::removeDocument(quint64 key)
+{
+    const Document document = m_documents.take(key);
+    for (const QString& term : document.terms) {
+        auto it = m_postings.find(term);
+        if (it == m_postings.end()) {
+            continue;
+        }
+        removePosting(it.value(), key);
+        if (it.value().isEmpty()) {
+            m_postings.erase(it);
+        }
+    }
+}
+
+void ChatWidgetSearchIndex::rekeyDocuments(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys)
+{
+    // 先全部取出再放回：新 key 可能正是另一个尚未换 key 的文档的旧 key
+    QVector<Document> documents;
+    documents.reserve(oldKeys.size());
+    for (quint64 key : oldKeys) {
+        documents.append(m_documents.take(key));
+        for (const QString& term : qAsConst(documents.last().terms)) {
+            auto it = m_postings.find(term);
+            if (it != m_postings.end()) {
+                removePosting(it.value(), key);
+            }
+        }
+    }
+    for (int i = 0; i < documents.size() && i < newKeys.size(); ++i) {
+        const Document& document = documents.at(i);
+        for (const QString& term : document.terms) {
+            insertPosting(m_postings[term], newKeys.at(i));
+        }
+        m_documents.insert(newKeys.at(i), document);
+    }
+}
+
+QString ChatWidgetSearchIndex::text(quint64 key) const
+{
+    return m_documents.value(key).text;
+}
+
+void ChatWidgetSearchIndex::clear()
+{
+    m_postings.clear();
+    m_documents.clear();
+}
+
+int ChatWidgetSearchIndex::documentCount() const
+{
+    return m_documents.size();
+}
+
+int ChatWidgetSearchIndex::termCount() const
+{
+    return m_postings.size();
+}
+
+QVector<quint64> ChatWidgetSearchIndex::candidates(const QString& query, bool* ok) const
+{
+    QStringList terms = tokenize(query);
+    if (ok) {
+        *ok = !terms.isEmpty();
+    }
+    if (terms.isEmpty()) {
+        return {};
+    }
+    const QString last = terms.takeLast();
+    terms.removeDuplicates();
+
+    // 先取最短的倒排表，交集规模随之最小
+    QVector<const QVector<quint64>*> exact;
+    for (const QString& term : terms) {
+        auto it = m_postings.constFind(term);
+        if (it == m_postings.constEnd()) {
+            return {};
+        }
+        exact.append(&it.value());
+    }
+    std::sort(exact.begin(), exact.end(),
+              [](const QVector<quint64>* a, const QVector<quint64>* b) { return a->size() < b->size(); });
+
+    QVector<quint64> result = prefixPostings(last);
+    for (const QVector<quint64>* postings : exact) {
+        if (result.isEmpty()) {
+            break;
+        }
+        result = intersect(result, *postings);
+    }
+    return result;
+}
+
+void ChatWidgetSearchIndex::insertPosting(QVector<quint64>& postings, quint64 key)
+{
+    // 新行的 key 单调递增，通常直接追加到末尾
+    if (postings.isEmpty() || postings.last() < key) {
+        postings.append(key);
+        return;
+    }
+    auto pos = std::lower_bound(postings.begin(), postings.end(), key);
+    if (pos == postings.end() || *pos != key) {
+        postings.insert(pos, key);
+    }
+}
+
+void ChatWidgetSearchIndex::removePosting(QVector<quint64>& postings, quint64 key)
+{
+    auto pos = std::lower_bound(postings.begin(), postings.end(), key);
+    if (pos != postings.end() && *pos == key) {
+        postings.erase(pos);
+    }
+}
+
+QVector<quint64> ChatWidgetSearchIndex::prefixPostings(const QString& prefix) const
+{
+    QVector<quint64> merged;
+    int termsMerged = 0;
+    for (auto it = m_postings.lowerBound(prefix); it != m_postings.constEnd() && it.key().startsWith(prefix); ++it) {
+        merged += it.value();
+        ++termsMerged;
+    }
+    if (termsMerged > 1) {
+        std::sort(merged.begin(), merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+    }
+    return merged;
+}
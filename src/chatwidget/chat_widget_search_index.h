@@ -0,0 +1,49 @@
+#ifndef CHAT_WIDGET_SEARCH_INDEX_H
+#define CHAT_WIDGET_SEARCH_INDEX_H
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 会话内全文倒排索引。文档以模型行的稳定标识（key）区分；
+// 拉丁字母/数字按词切分并折叠大小写，中日韩文字按相邻二元组切分（每段末字另记一元组）。
+// 查询的最后一个词按前缀匹配，其余词精确匹配；返回的是候选集，短语是否连续由调用方校验。
+// 索引同时保存每个文档的文本，调用方在同一份文本上校验，不必重新渲染。
+class ChatWidgetSearchIndex {
+public:
+    void addDocument(quint64 key, const QString& text);
+    void updateDocument(quint64 key, const QString& text);
+    void removeDocument(quint64 key);
+    // 文档按位置对应换用新 key，不重新切分；新旧 key 可以互相重叠
+    void rekeyDocuments(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys);
+    // 加入索引时的文本；不在索引中时返回空串
+    QString text(quint64 key) const;
+    void clear();
+    int documentCount() const;
+    int termCount() const;
+
+    // 升序返回包含全部查询词的文档；查询中没有可索引的词时 ok 置为 false
+    QVector<quint64> candidates(const QString& query, bool* ok = nullptr) const;
+
+    static QStringList tokenize(const QString& text);
+    // position 处是否为词首（与 tokenize 的切分一致）：中日韩文字与分隔符处总是词首，
+    // 字母/数字/下划线只在前一个字符不属于同一个词时才是
+    static bool isTokenStart(const QString& text, int position);
+
+private:
+    struct Document {
+        QStringList terms; // 删除/更新时定位倒排项
+        QString text;
+    };
+
+    static void insertPosting(QVector<quint64>& postings, quint64 key);
+    static void removePosting(QVector<quint64>& postings, quint64 key);
+    QVector<quint64> prefixPostings(const QString& prefix) const;
+
+    QMap<QString, QVector<quint64>> m_postings; // 词 -> 升序 key 列表（有序以支持前缀查询）
+    QHash<quint64, Document> m_documents;
+};
+
+#endif // CHAT_WIDGET_SEARCH_INDEX_H
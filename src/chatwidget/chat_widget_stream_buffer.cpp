@@ -0,0 +1,91 @@
+#include "chat_widget_stream_buffer.h"
+#include <QTimer>
+
+ChatWidgetStreamBuffer::ChatWidgetStreamBuffer(QObject* parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &ChatWidgetStreamBuffer::flush);
+}
+
+void ChatWidgetStreamBuffer::setFlushInterval(int msec)
+{
+    m_flushInterval = msec;
+    if (m_flushInterval <= 0) {
+        flush();
+    }
+}
+
+int ChatWidgetStreamBuffer::flushInterval() const
+{
+    return m_flushInterval;
+}
+
+void ChatWidgetStreamBuffer::setMaxBufferedChars(int chars)
+{
+    m_maxBufferedChars = chars;
+}
+
+int ChatWidgetStreamBuffer::maxBufferedChars() const
+{
+    return m_maxBufferedChars;
+}
+
+void ChatWidgetStreamBuffer::append(const QString& delta)
+{
+    if (delta.isEmpty()) {
+        return;
+    }
+    ++m_deltasReceived;
+    m_pending.append(delta);
+
+    if (m_flushInterval <= 0 || (m_maxBufferedChars > 0 && m_pending.size() >= m_maxBufferedChars)) {
+        flush();
+        return;
+    }
+    // 周期内的后续片段只追加到缓冲，不重启定时器，保证每个周期最多提交一次
+    if (!m_timer->isActive()) {
+        m_timer->start(m_flushInterval);
+    }
+}
+
+void ChatWidgetStreamBuffer::flush()
+{
+    m_timer->stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    QString text;
+    text.swap(m_pending);
+    ++m_flushesPerformed;
+    emit flushed(text);
+}
+
+void ChatWidgetStreamBuffer::discard()
+{
+    m_timer->stop();
+    m_pending.clear();
+}
+
+bool ChatWidgetStreamBuffer::hasPending() const
+{
+    return !m_pending.isEmpty();
+}
+
+qint64 ChatWidgetStreamBuffer::deltasReceived() const
+{
+    return m_deltasReceived;
+}
+
+qint64 ChatWidgetStreamBuffer::flushesPerformed() const
+{
+    return m_flushesPerformed;
+}
+
+void ChatWidgetStreamBuffer::resetStatistics()
+{
+    m_deltasReceived = 0;
+    m_flushesPerformed = 0;
+}
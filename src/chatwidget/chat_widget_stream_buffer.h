@@ -0,0 +1,44 @@
+#ifndef CHAT_WIDGET_STREAM_BUFFER_H
+#define CHAT_WIDGET_STREAM_BUFFER_H
+
+#include <QObject>
+#include <QString>
+
+class QTimer;
+
+// 流式输出缓冲：合并网络回调送来的细碎片段，每个刷新周期（默认约一帧）最多提交一次。
+class ChatWidgetStreamBuffer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ChatWidgetStreamBuffer(QObject* parent = nullptr);
+
+    // 刷新周期（毫秒），<= 0 表示每个片段立即提交
+    void setFlushInterval(int msec);
+    int flushInterval() const;
+    // 缓冲字符预算，超过后立即提交；<= 0 表示不限制
+    void setMaxBufferedChars(int chars);
+    int maxBufferedChars() const;
+
+    void append(const QString& delta);
+    void flush();
+    void discard();
+    bool hasPending() const;
+
+    qint64 deltasReceived() const;
+    qint64 flushesPerformed() const;
+    void resetStatistics();
+
+signals:
+    void flushed(const QString& text);
+
+private:
+    QTimer* m_timer;
+    QString m_pending;
+    int m_flushInterval = 16;
+    int m_maxBufferedChars = 4096;
+    qint64 m_deltasReceived = 0;
+    qint64 m_flushesPerformed = 0;
+};
+
+#endif // CHAT_WIDGET_STREAM_BUFFER_H
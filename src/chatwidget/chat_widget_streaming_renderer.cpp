@@ -0,0 +1,299 @@
+#include "chat_widget_streaming_renderer.h"
+#include "chat_widget_markdown_document_builder.h"
+#include <QTextBlock>
+#include <QTextBlockFormat>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextDocument>
+
+namespace {
+int leadingIndent(const QStringRef& line)
+{
+    int indent = 0;
+    while (indent < line.size() && (line.at(indent) == QLatin1Char(' ') || line.at(indent) == QLatin1Char('\t'))) {
+        ++indent;
+    }
+    return indent;
+}
+
+int runLength(const QStringRef& line, int from, QChar ch)
+{
+    int end = from;
+    while (end < line.size() && line.at(end) == ch) {
+        ++end;
+    }
+    return end - from;
+}
+
+bool isListItemStart(const QStringRef& line)
+{
+    if (line.isEmpty()) {
+        return false;
+    }
+    const QChar first = line.at(0);
+    if (first == QLatin1Char('-') || first == QLatin1Char('*') || first == QLatin1Char('+')) {
+        return line.size() == 1 || line.at(1).isSpace();
+    }
+    int digits = 0;
+    while (digits < line.size() && digits < 9 && line.at(digits).isDigit()) {
+        ++digits;
+    }
+    if (digits == 0 || digits >= line.size()) {
+        return false;
+    }
+    const QChar marker = line.at(digits);
+    if (marker != QLatin1Char('.') && marker != QLatin1Char(')')) {
+        return false;
+    }
+    return digits + 1 == line.size() || line.at(digits + 1).isSpace();
+}
+
+// 顶格围栏内一行代码在文档中的文本：与 md4c 一致，行首空白按 4 列制表位展开为空格，其余原样保留
+QString codeLineText(QStringRef line)
+{
+    if (line.endsWith(QLatin1Char('\r'))) {
+        line.chop(1);
+    }
+    int column = 0;
+    int offset = 0;
+    for (; offset < line.size(); ++offset) {
+        if (line.at(offset) == QLatin1Char('\t')) {
+            column = (column + 4) & ~3;
+        } else if (line.at(offset) == QLatin1Char(' ')) {
+            ++column;
+        } else {
+            break;
+        }
+    }
+    if (offset == column) {
+        return line.toString();
+    }
+    return QString(column, QLatin1Char(' ')) + line.mid(offset);
+}
+} // namespace
+
+ChatWidgetStreamingRenderer::ChatWidgetStreamingRenderer(QTextDocument* document,
+                                                         ChatWidgetCodeHighlighter* highlighter)
+    : m_document(document)
+    , m_highlighter(highlighter)
+{
+    // 频繁的删除/插入不需要撤销栈，避免内存随追加次数增长
+    m_document->setUndoRedoEnabled(false);
+}
+
+void ChatWidgetStreamingRenderer::reset(const QString& markdown)
+{
+    m_source = markdown;
+    m_stableLength = 0;
+    m_stablePosition = 0;
+    m_boundary = 0;
+    m_scanPosition = 0;
+    m_sawBlankLine = false;
+    m_inFence = false;
+    m_fenceLength = 0;
+    m_fenceIndent = 0;
+    m_fenceStart = -1;
+    m_fenceBodyStart = -1;
+    m_codeEnd = 0;
+    m_codePosition = 0;
+    m_codeState = 0;
+
+    scanCompleteLines();
+    render();
+}
+
+bool ChatWidgetStreamingRenderer::append(const QString& markdown)
+{
+    if (markdown.size() < m_source.size() || !markdown.startsWith(m_source)) {
+        return false;
+    }
+    if (markdown.size() == m_source.size()) {
+        return true;
+    }
+    m_source = markdown;
+    scanCompleteLines();
+    render();
+    return true;
+}
+
+QString ChatWidgetStreamingRenderer::source() const
+{
+    return m_source;
+}
+
+int ChatWidgetStreamingRenderer::stableLength() const
+{
+    return m_stableLength;
+}
+
+void ChatWidgetStreamingRenderer::scanCompleteLines()
+{
+    int lineEnd = m_source.indexOf(QLatin1Char('\n'), m_scanPosition);
+    while (lineEnd >= 0) {
+        scanLine(m_source.midRef(m_scanPosition, lineEnd - m_scanPosition), m_scanPosition, lineEnd + 1);
+        m_scanPosition = lineEnd + 1;
+        lineEnd = m_source.indexOf(QLatin1Char('\n'), m_scanPosition);
+    }
+}
+
+void ChatWidgetStreamingRenderer::scanLine(const QStringRef& line, int lineStart, int nextLineStart)
+{
+    const int indent = leadingIndent(line);
+    const bool blank = indent == line.size() || line.trimmed().isEmpty();
+
+    if (m_inFence) {
+        // 围栏代码块内的空行不是块边界，只有闭合围栏才结束该块
+        const int run = blank ? 0 : runLength(line, indent, m_fenceChar);
+        if (indent <= 3 && run >= m_fenceLength && line.mid(indent + run).trimmed().isEmpty()) {
+            m_inFence = false;
+            m_fenceStart = -1;
+            m_fenceBodyStart = -1;
+            if (m_fenceIndent == 0) {
+                m_boundary = nextLineStart;
+            }
+        }
+        return;
+    }
+
+    if (blank) {
+        m_sawBlankLine = true;
+        return;
+    }
+
+    // 空行之后、顶格且不是列表项的行才开启新块；缩进行与列表项可能属于上一个块
+    if (m_sawBlankLine && indent == 0 && !isListItemStart(line)) {
+        m_boundary = lineStart;
+    }
+    m_sawBlankLine = false;
+
+    if (indent <= 3 && indent < line.size()) {
+        const QChar ch = line.at(indent);
+        if (ch == QLatin1Char('`') || ch == QLatin1Char('~')) {
+            const int run = runLength(line, indent, ch);
+            if (run >= 3 && (ch == QLatin1Char('~') || !line.mid(indent + run).contains(QLatin1Char('`')))) {
+                m_inFence = true;
+                m_fenceChar = ch;
+                m_fenceLength = run;
+                m_fenceIndent = indent;
+                if (indent == 0) {
+                    // 顶格围栏总会结束之前的块（列表、引用、段落），其前内容可先闭合
+                    m_boundary = lineStart;
+                    m_fenceStart = lineStart;
+                    m_fenceBodyStart = nextLineStart;
+                    m_fenceLanguage = ChatWidgetCodeHighlighter::languageForInfo(line.mid(run));
+                }
+            }
+        }
+    }
+}
+
+void ChatWidgetStreamingRenderer::render()
+{
+    QTextCursor cursor(m_document);
+    const bool openFence = m_inFence && m_fenceStart >= 0 && m_fenceStart == m_boundary;
+    if (openFence && m_codeEnd > 0) {
+        appendCodeLines(cursor);
+        return;
+    }
+    m_codeEnd = 0;
+    cursor.setPosition(m_stablePosition);
+    cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+
+    if (m_boundary > m_stableLength) {
+        insertChunk(cursor, m_source.mid(m_stableLength, m_boundary - m_stableLength));
+        m_stableLength = m_boundary;
+        m_stablePosition = cursor.position();
+    }
+    if (!openFence || m_scanPosition <= m_fenceBodyStart) {
+        insertChunk(cursor, m_source.mid(m_stableLength));
+        return;
+    }
+    // 未闭合的顶格围栏已有完整行：开头行与完整行按代码块解析一次，之后逐行追加
+    const int codeStart = cursor.position();
+    insertChunk(cursor, m_source.mid(m_stableLength, m_scanPosition - m_stableLength), false);
+    m_codeEnd = m_scanPosition;
+    m_codePosition = cursor.position();
+    m_codeState = 0;
+    if (m_highlighter) {
+        const int lines = m_source.midRef(m_fenceBodyStart, m_codeEnd - m_fenceBodyStart).count(QLatin1Char('\n'));
+        // 代码块首行即插入的第一个块（insertChunk 先插入分隔块）
+        const QTextBlock first = m_document->findBlock(codeStart).next();
+        m_codeState = m_highlighter->highlightLines(codeStart > 0 ? first : m_document->begin(), lines,
+                                                    m_fenceLanguage, 0);
+    }
+    appendCodeLines(cursor);
+}
+
+void ChatWidgetStreamingRenderer::appendCodeLines(QTextCursor& cursor)
+{
+    // 删去上次插入的未完成行；新完成的行与未完成行沿用最后一个完整代码行的格式
+    cursor.setPosition(m_codePosition);
+    cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    const QTextBlock last = cursor.block();
+    QTextBlockFormat blockFormat = last.blockFormat();
+    // 只有代码块首行带上边距
+    blockFormat.clearProperty(QTextFormat::BlockTopMargin);
+    const QTextCharFormat charFormat = last.charFormat();
+
+    cursor.beginEditBlock();
+    int lines = 0;
+    int lineStart = m_codeEnd;
+    while (lineStart < m_scanPosition) {
+        const int lineEnd = m_source.indexOf(QLatin1Char('\n'), lineStart);
+        insertCodeLine(cursor, m_source.midRef(lineStart, lineEnd - lineStart), blockFormat, charFormat);
+        lineStart = lineEnd + 1;
+        ++lines;
+    }
+    const int partialStart = m_scanPosition;
+    if (partialStart < m_source.size()) {
+        insertCodeLine(cursor, m_source.midRef(partialStart), blockFormat, charFormat);
+    }
+    cursor.endEditBlock();
+
+    if (m_highlighter) {
+        QTextBlock block = last.next();
+        m_codeState = m_highlighter->highlightLines(block, lines, m_fenceLanguage, m_codeState);
+        if (partialStart < m_source.size()) {
+            m_highlighter->highlightLines(m_document->lastBlock(), 1, m_fenceLanguage, m_codeState);
+        }
+    }
+    m_codeEnd = m_scanPosition;
+    if (lines > 0) {
+        m_codePosition = partialStart < m_source.size() ? m_document->lastBlock().position() - 1
+                                                        : m_document->characterCount() - 1;
+    }
+}
+
+void ChatWidgetStreamingRenderer::insertCodeLine(QTextCursor& cursor, const QStringRef& line,
+                                                 const QTextBlockFormat& blockFormat,
+                                                 const QTextCharFormat& charFormat)
+{
+    cursor.insertBlock(blockFormat, charFormat);
+    const QString text = codeLineText(line);
+    if (!text.isEmpty()) {
+        cursor.insertText(text, charFormat);
+    }
+}
+
+void ChatWidgetStreamingRenderer::insertChunk(QTextCursor& cursor, const QString& markdown, bool highlight)
+{
+    if (markdown.trimmed().isEmpty()) {
+        return;
+    }
+    if (cursor.position() > 0) {
+        // 新块不继承上一块（标题、代码块等）的格式
+        cursor.insertBlock(QTextBlockFormat(), QTextCharFormat());
+    }
+    const int start = cursor.position();
+    ChatWidgetMarkdownDocumentBuilder::insert(cursor, markdown);
+    if (start > 0 && cursor.position() == start && cursor.blockFormat() == QTextBlockFormat()) {
+        // 没有产生任何块（如只有围栏开头行的空代码块）：去掉分隔块，与一次性解析一致
+        cursor.deletePreviousChar();
+        return;
+    }
+    if (m_highlighter && highlight) {
+        m_highlighter->highlight(m_document, markdown, start);
+    }
+}
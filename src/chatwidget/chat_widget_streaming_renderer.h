@@ -0,0 +1,61 @@
+#ifndef CHAT_WIDGET_STREAMING_RENDERER_H
+#define CHAT_WIDGET_STREAMING_RENDERER_H
+
+#include "chat_widget_code_highlighter.h"
+#include <QChar>
+#include <QString>
+#include <QStringRef>
+
+class QTextBlockFormat;
+class QTextCharFormat;
+class QTextCursor;
+class QTextDocument;
+
+// 流式 Markdown 渲染：已闭合的块只渲染一次并保留在文档中，
+// 每次追加仅重新解析末尾尚未闭合的块并拼接到持久化的 QTextDocument。
+// 未闭合的顶格围栏代码块以最后一个完整行为界，之后只追加新行（未完成的行每次替换），
+// 不再随长度重复解析整个代码块。设置了代码高亮器时只为新插入的内容着色，已有颜色保留。
+// 未完成的行（如尚未换行的闭合围栏）可能与一次性解析不同，流结束后应以完整内容重建一次。
+class ChatWidgetStreamingRenderer {
+public:
+    explicit ChatWidgetStreamingRenderer(QTextDocument* document, ChatWidgetCodeHighlighter* highlighter = nullptr);
+
+    // 以完整内容重建文档
+    void reset(const QString& markdown);
+    // markdown 必须以当前内容为前缀；否则返回 false，由调用方改用 reset()
+    bool append(const QString& markdown);
+
+    QString source() const;
+    int stableLength() const;
+
+private:
+    void scanCompleteLines();
+    void scanLine(const QStringRef& line, int lineStart, int nextLineStart);
+    void render();
+    void insertChunk(QTextCursor& cursor, const QString& markdown, bool highlight = true);
+    void appendCodeLines(QTextCursor& cursor);
+    void insertCodeLine(QTextCursor& cursor, const QStringRef& line, const QTextBlockFormat& blockFormat,
+                        const QTextCharFormat& charFormat);
+
+    QTextDocument* m_document;
+    ChatWidgetCodeHighlighter* m_highlighter;
+    QString m_source;
+    int m_stableLength = 0;   // m_source 中由已闭合块组成的前缀长度
+    int m_stablePosition = 0; // 文档中闭合块内容的结束位置
+    int m_boundary = 0;       // 最近一次确认的块边界（>= m_stableLength）
+    int m_scanPosition = 0;   // 下一行待扫描内容的起始位置
+    bool m_sawBlankLine = false;
+    bool m_inFence = false;
+    QChar m_fenceChar;
+    int m_fenceLength = 0;
+    int m_fenceIndent = 0;
+    // 顶格未闭合围栏：开头行与首个代码行在源码中的位置（-1 表示没有）
+    int m_fenceStart = -1;
+    int m_fenceBodyStart = -1;
+    ChatWidgetCodeHighlighter::Language m_fenceLanguage = ChatWidgetCodeHighlighter::PlainText;
+    int m_codeEnd = 0;      // 已作为完整代码行写入文档的源码前缀长度（0 表示尚未逐行追加）
+    int m_codePosition = 0; // 文档中最后一个完整代码行的结束位置
+    int m_codeState = 0;    // 最后一个完整代码行的高亮行尾状态
+};
+
+#endif // CHAT_WIDGET_STREAMING_RENDERER_H
@@ -1,13 +1,20 @@
 #include "chat_widget_view.h"
 #include "chat_widget_delegate.h"
+#include "chat_widget_list_view.h"
 #include "chat_widget_model.h"
 #include <QClipboard>
 #include <QGuiApplication>
-#include <QListView>
 #include <QMenu>
 #include <QMouseEvent>
+#include <QScrollBar>
 #include <QStyleOptionViewItem>
 #include <QVBoxLayout>
+#include <utility>
+
+namespace {
+// 少量新增行（发送、单条接收）直接在 GUI 线程排版，批量载入历史时才交给后台预渲染
+const int kPrerenderMinRows = 32;
+} // namespace
 
 ChatWidgetView::ChatWidgetView(QWidget* parent) : QWidget(parent)
 {
@@ -28,15 +35,144 @@ void ChatWidgetView::setModel(ChatWidgetModel* model)
         return;
     }
 
-    if (m_model && m_model->parent() == this) {
-        m_model->deleteLater();
+    if (m_model) {
+        disconnect(m_model, nullptr, m_delegate, nullptr);
+        disconnect(m_model, nullptr, this, nullptr);
+        if (m_model->parent() == this) {
+            m_model->deleteLater();
+        }
     }
 
     m_model = model;
+    m_merging = false;
     if (!m_model->parent()) {
         m_model->setParent(this);
     }
+    m_delegate->clearLayoutCache();
+    connectModel();
     m_chatView->setModel(m_model);
+    connectScrollAnchor();
+    emit messageKeysReset();
+}
+
+void ChatWidgetView::connectModel()
+{
+    // 先于列表视图连接，保证视图重新查询尺寸时缓存已失效
+    connect(m_model, &QAbstractItemModel::dataChanged, m_delegate, &ChatWidgetDelegate::invalidateLayout);
+    connect(m_model, &QAbstractItemModel::modelReset, m_delegate, &ChatWidgetDelegate::clearLayoutCache);
+    connect(m_model, &ChatWidgetModel::messageKeysChanged, m_delegate, &ChatWidgetDelegate::remapKeys);
+    connect(m_model, &ChatWidgetModel::messageKeysChanged, this, &ChatWidgetView::messageKeysChanged);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &ChatWidgetView::messageKeysReset);
+    connect(m_model, &ChatWidgetModel::searchKeywordChanged, this, &ChatWidgetView::repaintSearchMatches);
+    connect(m_model, &ChatWidgetModel::participantChanged, this, &ChatWidgetView::repaintParticipantRows);
+    connect(m_model, &QAbstractItemModel::rowsInserted, this,
+            [this](const QModelIndex&, int first, int last) { prerenderRows(first, last); });
+    connect(m_model, &QAbstractItemModel::modelReset, this,
+            [this]() { prerenderRows(0, m_model->rowCount() - 1); });
+}
+
+void ChatWidgetView::prerenderRows(int first, int last)
+{
+    if (last - first + 1 >= kPrerenderMinRows) {
+        m_delegate->prerenderRows(m_model, first, last);
+    }
+}
+
+void ChatWidgetView::repaintSearchMatches(const QString& keyword, const QString& previousKeyword)
+{
+    // 高亮在绘制时叠加、命中状态也按需判定，只需重绘视口（可见行），与历史长度无关
+    if (!keyword.trimmed().isEmpty() || !previousKeyword.trimmed().isEmpty()) {
+        m_chatView->viewport()->update();
+    }
+}
+
+void ChatWidgetView::repaintParticipantRows(const QString& senderId)
+{
+    // 显示名、头像在绘制时读取且不影响行高：只重绘视口内该参与者的行，与历史长度无关
+    QWidget* viewport = m_chatView->viewport();
+    const QModelIndex top = m_chatView->indexAt(QPoint(viewport->width() / 2, 0));
+    if (!top.isValid()) {
+        return;
+    }
+    const QModelIndex bottom = m_chatView->indexAt(QPoint(viewport->width() / 2, viewport->height() - 1));
+    const int last = bottom.isValid() ? bottom.row() : m_model->rowCount() - 1;
+    for (int row = top.row(); row <= last; ++row) {
+        const QModelIndex index = m_model->index(row, 0);
+        if (index.data(ChatWidgetModel::ChatWidgetSenderIdRole).toString() == senderId) {
+            viewport->update(m_chatView->visualRect(index));
+        }
+    }
+}
+
+void ChatWidgetView::connectScrollAnchor()
+{
+    // 在列表视图 setModel 之后连接，恢复锚点时视图已处理完行变化
+    connect(m_model, &QAbstractItemModel::rowsAboutToBeInserted, this, [this](const QModelIndex&, int first, int) {
+        if (!m_merging) {
+            captureScrollAnchor(first);
+        }
+    });
+    connect(m_model, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+            [this](const QModelIndex&, int first, int) { captureScrollAnchor(first); });
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, [this]() {
+        if (!m_merging) {
+            restoreScrollAnchor();
+        }
+    });
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, &ChatWidgetView::restoreScrollAnchor);
+    // 交错合并逐段插入：锚点（持久索引）随各段移动，整次合并只恢复一次
+    connect(m_model, &ChatWidgetModel::rowsAboutToBeMerged, this, [this](int firstRow) {
+        m_merging = true;
+        captureScrollAnchor(firstRow);
+    });
+    connect(m_model, &ChatWidgetModel::rowsMerged, this, [this]() {
+        m_merging = false;
+        restoreScrollAnchor();
+    });
+}
+
+void ChatWidgetView::captureScrollAnchor(int firstChangedRow)
+{
+    m_scrollAnchor = QPersistentModelIndex();
+    const QModelIndex top = m_chatView->indexAt(QPoint(m_chatView->viewport()->width() / 2, 1));
+    // 只有变化发生在可见区域上方（含顶部行）时才需要补偿
+    if (!top.isValid() || firstChangedRow > top.row()) {
+        return;
+    }
+    m_scrollAnchor = top;
+    m_scrollAnchorOffset = m_chatView->visualRect(top).top();
+}
+
+void ChatWidgetView::restoreScrollAnchor()
+{
+    if (!m_scrollAnchor.isValid()) {
+        m_scrollAnchor = QPersistentModelIndex();
+        return;
+    }
+    m_restoringAnchor = true;
+    m_chatView->doItemsLayout();
+    const int delta = m_chatView->visualRect(m_scrollAnchor).top() - m_scrollAnchorOffset;
+    QScrollBar* bar = m_chatView->verticalScrollBar();
+    bar->setValue(bar->value() + delta);
+    m_scrollAnchor = QPersistentModelIndex();
+    m_restoringAnchor = false;
+}
+
+void ChatWidgetView::checkScrollEdges()
+{
+    if (m_restoringAnchor || m_model->rowCount() == 0) {
+        return;
+    }
+    const QScrollBar* bar = m_chatView->verticalScrollBar();
+    if (bar->maximum() <= 0) {
+        return;
+    }
+    const int threshold = qMax(32, m_chatView->viewport()->height() / 2);
+    if (bar->value() - bar->minimum() <= threshold) {
+        emit nearTopReached();
+    } else if (bar->maximum() - bar->value() <= threshold) {
+        emit nearBottomReached();
+    }
 }
 
 void ChatWidgetView::setupUi()
@@ -44,17 +180,29 @@ void ChatWidgetView::setupUi()
     m_model = new ChatWidgetModel(this);
     m_delegate = new ChatWidgetDelegate(this);
 
-    m_chatView = new QListView(this);
+    m_chatView = new ChatWidgetListView(this);
     m_chatView->setObjectName("chatWidgetViewList");
+    connectModel();
     m_chatView->setModel(m_model);
+    connectScrollAnchor();
     m_chatView->setItemDelegate(m_delegate);
+    m_delegate->setMetricsWidget(m_chatView->viewport());
+    connect(m_delegate, &ChatWidgetDelegate::rowRepaintRequested, m_chatView,
+            [this](const QModelIndex& index) { m_chatView->update(index); });
+    // 预渲染结果到达后视口外行的估算值换成实际高度（滚动范围随之准确），
+    // 以顶部可见行为锚点重新布局，避免内容跳动
+    connect(m_delegate, &ChatWidgetDelegate::rowsPrerendered, this, [this](const QVector<int>& rows) {
+        captureScrollAnchor(rows.first());
+        m_chatView->refreshEstimates(rows);
+        restoreScrollAnchor();
+    });
     m_chatView->setObjectName("chatWidgetViewList");
     m_chatView->setSelectionMode(QAbstractItemView::SingleSelection);
     m_chatView->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_chatView->setFocusPolicy(Qt::NoFocus);
-    m_chatView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
-    m_chatView->setResizeMode(QListView::Adjust);
     m_chatView->viewport()->installEventFilter(this);
+    connect(m_chatView->verticalScrollBar(), &QScrollBar::valueChanged, this, &ChatWidgetView::checkScrollEdges);
+    connect(m_chatView, &ChatWidgetListView::viewportResolved, this, &ChatWidgetView::viewportResolved);
 
     QVBoxLayout* layout = new QVBoxLayout(this);
     layout->setContentsMargins(0, 0, 0, 0);
@@ -63,19 +211,34 @@ void ChatWidgetView::setupUi()
 
 void ChatWidgetView::setMessages(const QList<ChatWidgetMessage>& messages)
 {
-    m_model->setMessages(messages);
+    setMessages(QList<ChatWidgetMessage>(messages));
+}
+
+void ChatWidgetView::setMessages(QList<ChatWidgetMessage>&& messages)
+{
+    m_model->setMessages(std::move(messages));
     scrollToBottom();
 }
 
 void ChatWidgetView::appendMessages(const QList<ChatWidgetMessage>& messages)
 {
-    m_model->appendMessages(messages);
+    appendMessages(QList<ChatWidgetMessage>(messages));
+}
+
+void ChatWidgetView::appendMessages(QList<ChatWidgetMessage>&& messages)
+{
+    m_model->appendMessages(std::move(messages));
     scrollToBottom();
 }
 
 void ChatWidgetView::prependMessages(const QList<ChatWidgetMessage>& messages)
 {
-    m_model->prependMessages(messages);
+    prependMessages(QList<ChatWidgetMessage>(messages));
+}
+
+void ChatWidgetView::prependMessages(QList<ChatWidgetMessage>&& messages)
+{
+    m_model->prependMessages(std::move(messages));
     refreshLayout();
 }
 
@@ -90,6 +253,13 @@ ChatWidgetDelegate::Style ChatWidgetView::delegateStyle() const
     return m_delegate->style();
 }
 
+void ChatWidgetView::scrollToRow(int row)
+{
+    if (m_chatView && row >= 0 && row < m_model->rowCount()) {
+        m_chatView->scrollTo(m_model->index(row, 0), QAbstractItemView::PositionAtCenter);
+    }
+}
+
 void ChatWidgetView::scrollToBottom()
 {
     if (m_chatView) {
@@ -105,8 +275,34 @@ void ChatWidgetView::refreshLayout()
     }
 }
 
+void ChatWidgetView::finishStreaming(int row)
+{
+    if (!m_model || row < 0 || row >= m_model->rowCount()) {
+        return;
+    }
+    if (m_delegate->finishStreaming(m_model->index(row, 0))) {
+        m_chatView->remeasureRow(row);
+    }
+}
+
+void ChatWidgetView::setFrameBudget(int msecs)
+{
+    m_chatView->setFrameBudget(msecs);
+}
+
+int ChatWidgetView::frameBudget() const
+{
+    return m_chatView->frameBudget();
+}
+
 bool ChatWidgetView::eventFilter(QObject* watched, QEvent* event)
 {
+    // 窗口移到 DPI 不同的屏幕：重新解析字体度量并重新布局
+    if (watched == m_chatView->viewport() && event->type() == QEvent::ScreenChangeInternal) {
+        m_delegate->setMetricsWidget(m_chatView->viewport());
+        refreshLayout();
+        return QWidget::eventFilter(watched, event);
+    }
     if (watched == m_chatView->viewport() && event->type() == QEvent::MouseButtonRelease) {
         auto* mouseEvent = static_cast<QMouseEvent*>(event);
         const QModelIndex index = m_chatView->indexAt(mouseEvent->pos());
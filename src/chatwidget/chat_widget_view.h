@@ -4,11 +4,12 @@
 #include "chat_widget_delegate.h"
 #include "chat_widget_model.h"
 #include <QList>
+#include <QPersistentModelIndex>
 #include <QPoint>
 #include <QString>
 #include <QWidget>
 
-class QListView;
+class ChatWidgetListView;
 class QEvent;
 
 class ChatWidgetView : public QWidget {
@@ -22,13 +23,23 @@ public:
     void setModel(ChatWidgetModel* model);
 
     void setMessages(const QList<ChatWidgetMessage>& messages);
+    void setMessages(QList<ChatWidgetMessage>&& messages);
     void appendMessages(const QList<ChatWidgetMessage>& messages);
+    void appendMessages(QList<ChatWidgetMessage>&& messages);
     void prependMessages(const QList<ChatWidgetMessage>& messages);
+    void prependMessages(QList<ChatWidgetMessage>&& messages);
 
     void setDelegateStyle(const ChatWidgetDelegate::Style& style);
     ChatWidgetDelegate::Style delegateStyle() const;
     void scrollToBottom();
+    // 将指定行滚动到视口中部
+    void scrollToRow(int row);
     void refreshLayout();
+    // 流式输出结束：该行按完整内容重建一次文档并重新测量（见 ChatWidgetDelegate::finishStreaming）
+    void finishStreaming(int row);
+    // 每帧用于排版新进入视口的行的时间预算（毫秒，默认 8），超出的行先画骨架、后续帧补全；0 表示不限制
+    void setFrameBudget(int msecs);
+    int frameBudget() const;
 
 signals:
     void avatarClicked(const QString& sender, bool isMine, int row);
@@ -37,16 +48,38 @@ signals:
     void messageSelected(const QString& messageId);
     void messageContextMenuRequested(const QString& messageId, const QPoint& globalPos);
     void messageActionRequested(const QString& action, const QString& messageId);
+    // 滚动接近顶部/底部（约半个视口以内）时发出，供历史窗口按页加载
+    void nearTopReached();
+    void nearBottomReached();
+    // 视口内以骨架绘制的行全部补全
+    void viewportResolved();
+    // 转发模型的行 key 变化：局部重新分配（见 ChatWidgetModel::messageKeysChanged），
+    // 或模型重置/更换后全部失效。按 key 保存的定位（如搜索命中）据此更新
+    void messageKeysChanged(const QVector<quint64>& oldKeys, const QVector<quint64>& newKeys);
+    void messageKeysReset();
 
 protected:
     bool eventFilter(QObject* watched, QEvent* event) override;
 
 private:
     void setupUi();
+    void connectModel();
+    void connectScrollAnchor();
+    void captureScrollAnchor(int firstChangedRow);
+    void restoreScrollAnchor();
+    void checkScrollEdges();
+    void repaintSearchMatches(const QString& keyword, const QString& previousKeyword);
+    void repaintParticipantRows(const QString& senderId);
+    void prerenderRows(int first, int last);
 
-    QListView* m_chatView;
+    ChatWidgetListView* m_chatView;
     ChatWidgetModel* m_model;
     ChatWidgetDelegate* m_delegate;
+    // 视口顶部可见行及其偏移：在其上方插入/删除行后恢复，保持内容不跳动
+    QPersistentModelIndex m_scrollAnchor;
+    int m_scrollAnchorOffset = 0;
+    bool m_restoringAnchor = false;
+    bool m_merging = false; // 处于 ChatWidgetModel 的交错合并中
 };
 
 #endif // CHAT_WIDGET_VIEW_H
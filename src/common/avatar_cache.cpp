@@ -0,0 +1,150 @@
+#include "avatar_cache.h"
+#include <QBrush>
+#include <QCoreApplication>
+#include <QPainter>
+#include <QPainterPath>
+#include <QTransform>
+#include <QtMath>
+
+namespace {
+const int kRenderedBudgetKB = 8 * 1024;
+const int kSourceBudgetKB = 16 * 1024;
+
+int pixmapCost(const QPixmap& pixmap)
+{
+    return qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024);
+}
+
+QString renderedKey(const QString& path, int size, AvatarCache::Shape shape, int radius, qreal devicePixelRatio)
+{
+    return QStringLiteral("%1|%2|%3|%4|%5").arg(path).arg(size).arg(shape).arg(radius).arg(devicePixelRatio);
+}
+} // namespace
+
+AvatarCache* AvatarCache::instance()
+{
+    static AvatarCache s_instance;
+    static const bool s_cleanupRegistered = []() {
+        // QPixmap 必须在 QGuiApplication 销毁前释放：静态对象析构时应用已不存在，
+        // 由应用对象析构时调用的清理例程先清空缓存
+        qAddPostRoutine([]() { AvatarCache::instance()->clear(); });
+        return true;
+    }();
+    Q_UNUSED(s_cleanupRegistered);
+    return &s_instance;
+}
+
+AvatarCache::AvatarCache()
+    : m_sources(kSourceBudgetKB)
+    , m_rendered(kRenderedBudgetKB)
+{
+}
+
+QPixmap AvatarCache::avatar(const QString& path, int size, Shape shape, int radius, qreal devicePixelRatio)
+{
+    if (path.isEmpty() || size <= 0) {
+        return QPixmap();
+    }
+    const QString key = renderedKey(path, size, shape, radius, devicePixelRatio);
+    if (const QPixmap* rendered = m_rendered.object(key)) {
+        return *rendered;
+    }
+    const QPixmap* original = source(path);
+    if (!original) {
+        return QPixmap();
+    }
+    const QPixmap result = render(*original, size, shape, radius, devicePixelRatio);
+    m_rendered.insert(key, new QPixmap(result), pixmapCost(result));
+    return result;
+}
+
+QPixmap AvatarCache::render(const QPixmap& source, int size, Shape shape, int radius, qreal devicePixelRatio)
+{
+    if (source.isNull() || size <= 0) {
+        return QPixmap();
+    }
+    const qreal dpr = qMax<qreal>(1.0, devicePixelRatio);
+    const int pixels = qCeil(size * dpr);
+    const QPixmap scaled = source.scaled(pixels, pixels, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+
+    QPixmap result(pixels, pixels);
+    result.fill(Qt::transparent);
+    QPainterPath path;
+    const QRectF bounds(0, 0, pixels, pixels);
+    if (shape == Circle) {
+        path.addEllipse(bounds);
+    } else if (shape == RoundedRect) {
+        path.addRoundedRect(bounds, radius * dpr, radius * dpr);
+    } else {
+        path.addRect(bounds);
+    }
+    // 用图片画刷填充路径，边缘抗锯齿效果优于裁剪路径
+    QBrush brush(scaled);
+    brush.setTransform(QTransform::fromTranslate((pixels - scaled.width()) / 2, (pixels - scaled.height()) / 2));
+    QPainter painter(&result);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.fillPath(path, brush);
+    painter.end();
+
+    result.setDevicePixelRatio(dpr);
+    return result;
+}
+
+void AvatarCache::setMemoryBudget(int kilobytes)
+{
+    m_rendered.setMaxCost(qMax(0, kilobytes));
+}
+
+int AvatarCache::memoryBudget() const
+{
+    return m_rendered.maxCost();
+}
+
+int AvatarCache::count() const
+{
+    return m_rendered.count();
+}
+
+void AvatarCache::remove(const QString& path)
+{
+    m_sources.remove(path);
+    m_failed.remove(path);
+    const QString prefix = path + QLatin1Char('|');
+    const QList<QString> keys = m_rendered.keys();
+    for (const QString& key : keys) {
+        if (key.startsWith(prefix)) {
+            m_rendered.remove(key);
+        }
+    }
+}
+
+void AvatarCache::clear()
+{
+    m_sources.clear();
+    m_rendered.clear();
+    m_failed.clear();
+    m_scratch = QPixmap();
+}
+
+const QPixmap* AvatarCache::source(const QString& path)
+{
+    if (const QPixmap* cached = m_sources.object(path)) {
+        return cached;
+    }
+    // 加载失败的路径不再重复读盘
+    if (m_failed.contains(path)) {
+        return nullptr;
+    }
+    QPixmap loaded(path);
+    if (loaded.isNull()) {
+        m_failed.insert(path);
+        return nullptr;
+    }
+    auto* pixmap = new QPixmap(loaded);
+    if (!m_sources.insert(path, pixmap, pixmapCost(loaded))) {
+        // 原图超出预算：不缓存原图，只保留本次调用所需的临时副本
+        m_scratch = loaded;
+        return &m_scratch;
+    }
+    return pixmap;
+}
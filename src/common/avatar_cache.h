@@ -0,0 +1,49 @@
+#ifndef AVATAR_CACHE_H
+#define AVATAR_CACHE_H
+
+#include <QCache>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+
+// 头像缓存（ChatList / ChatWidget / Profile 共用）：每个路径只解码一次，按
+// 路径+尺寸+形状+圆角+像素比 缓存已裁剪好的成品，绘制时直接贴图。仅在 GUI 线程使用。
+// 应用对象析构时自动清空（qAddPostRoutine），不会在 QApplication 销毁后才释放 QPixmap。
+class AvatarCache {
+public:
+    enum Shape {
+        Circle,
+        Square,
+        RoundedRect
+    };
+
+    static AvatarCache* instance();
+
+    // size 为逻辑像素；路径无法加载时返回空图
+    QPixmap avatar(const QString& path, int size, Shape shape = Circle, int radius = 0, qreal devicePixelRatio = 1.0);
+    // 将任意图片裁剪为头像（居中铺满），结果已设置 devicePixelRatio
+    static QPixmap render(const QPixmap& source, int size, Shape shape = Circle, int radius = 0,
+                          qreal devicePixelRatio = 1.0);
+
+    // 成品缓存预算，单位 KB
+    void setMemoryBudget(int kilobytes);
+    int memoryBudget() const;
+    int count() const;
+    // 头像文件更新后调用，丢弃该路径的原图与全部成品
+    void remove(const QString& path);
+    void clear();
+
+private:
+    AvatarCache();
+    ~AvatarCache() = default;
+    Q_DISABLE_COPY(AvatarCache)
+
+    const QPixmap* source(const QString& path);
+
+    QCache<QString, QPixmap> m_sources;
+    QCache<QString, QPixmap> m_rendered;
+    QSet<QString> m_failed;
+    QPixmap m_scratch;
+};
+
+#endif // AVATAR_CACHE_H
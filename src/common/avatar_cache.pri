@@ -0,0 +1,9 @@
+AVATAR_CACHE_DIR = $$PWD
+
+INCLUDEPATH += $$AVATAR_CACHE_DIR
+
+SOURCES += \
+    $$AVATAR_CACHE_DIR/avatar_cache.cpp
+
+HEADERS += \
+    $$AVATAR_CACHE_DIR/avatar_cache.h
@@ -1,4 +1,5 @@
 #include "profile_widget.h"
+#include "avatar_cache.h"
 #include "qss_utils.h"
 
 #include <QColor>
@@ -6,8 +7,6 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QMouseEvent>
-#include <QPainter>
-#include <QPainterPath>
 #include <QPushButton>
 #include <QResizeEvent>
 #include <QStyle>
@@ -39,21 +38,6 @@ constexpr int kAvatarSize = 64;
 constexpr int kDetailTitleWidth = 70;
 constexpr int kHeaderGapHeight = 10;
 constexpr int kBottomButtonHeight = 45;
-
-QPixmap buildRoundedAvatar(const QPixmap& source, int size)
-{
-    QPixmap scaled = source.scaled(size, size, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-    QPixmap rounded(size, size);
-    rounded.fill(Qt::transparent);
-
-    QPainter painter(&rounded);
-    painter.setRenderHint(QPainter::Antialiasing, true);
-    QPainterPath path;
-    path.addEllipse(0, 0, size, size);
-    painter.setClipPath(path);
-    painter.drawPixmap(0, 0, scaled);
-    return rounded;
-}
 } // namespace
 
 ProfileWidget::ProfileWidget(QWidget* parent) : QWidget(parent)
@@ -113,7 +97,7 @@ QWidget* ProfileWidget::createHeaderWidget()
     m_avatarLabel->setObjectName("AvatarLabel");
     m_defaultAvatar = QPixmap(kAvatarSize, kAvatarSize);
     m_defaultAvatar.fill(QColor(220, 220, 220));
-    m_avatarLabel->setPixmap(buildRoundedAvatar(m_defaultAvatar, kAvatarSize));
+    m_avatarLabel->setPixmap(AvatarCache::render(m_defaultAvatar, kAvatarSize));
 
     QVBoxLayout* infoLayout = new QVBoxLayout();
     infoLayout->setSpacing(5);
@@ -276,7 +260,14 @@ void ProfileWidget::setAvatar(const QPixmap& pixmap)
 {
     const QPixmap& source = pixmap.isNull() ? m_defaultAvatar : pixmap;
     if (m_avatarLabel)
-        m_avatarLabel->setPixmap(buildRoundedAvatar(source, kAvatarSize));
+        m_avatarLabel->setPixmap(AvatarCache::render(source, kAvatarSize, AvatarCache::Circle, 0, devicePixelRatioF()));
+}
+
+void ProfileWidget::setAvatarPath(const QString& path)
+{
+    const QPixmap avatar = AvatarCache::instance()->avatar(path, kAvatarSize, AvatarCache::Circle, 0, devicePixelRatioF());
+    if (m_avatarLabel)
+        m_avatarLabel->setPixmap(avatar.isNull() ? AvatarCache::render(m_defaultAvatar, kAvatarSize) : avatar);
 }
 
 void ProfileWidget::setUserName(const QString& name)
@@ -42,6 +42,8 @@ public:
 
     // --- 基础信息接口 ---
     void setAvatar(const QPixmap& pixmap);
+    // 通过共享头像缓存加载，同一路径在各组件间只解码一次
+    void setAvatarPath(const QString& path);
     void setUserName(const QString& name);
     void setTmId(const QString& uuid);
     void applyDefaultStyle();
@@ -15,3 +15,4 @@ isEmpty(QCHAT_STYLES_QRC_INCLUDED) {
 }
 
 include($$PWD/../common/qss_utils.pri)
+include($$PWD/../common/avatar_cache.pri)
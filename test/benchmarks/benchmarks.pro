@@ -0,0 +1,54 @@
+TEMPLATE = app
+TARGET = benchmarks
+QT += testlib core gui widgets
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/../../src/chatwidget \
+    $$PWD/../../src/chatlist \
+    $$PWD/../../src/common \
+    $$PWD/../../3rdparty/md4c
+
+SOURCES += \
+    tst_benchmarks.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_model.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_search_index.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_delegate.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_row_reader.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_layout_cache.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_prerenderer.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_highlighter.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_image_cache.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_streaming_renderer.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_code_highlighter.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_utils.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_document_builder.cpp \
+    $$PWD/../../src/chatlist/chat_list_filter_model.cpp \
+    $$PWD/../../src/common/avatar_cache.cpp \
+    $$PWD/../../3rdparty/md4c/md4c.c \
+    $$PWD/../../3rdparty/md4c/md4c-html.c \
+    $$PWD/../../3rdparty/md4c/entity.c
+
+HEADERS += \
+    $$PWD/../../src/chatwidget/chat_widget_message.h \
+    $$PWD/../../src/chatwidget/chat_widget_model.h \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.h \
+    $$PWD/../../src/chatwidget/chat_widget_gap_vector.h \
+    $$PWD/../../src/chatwidget/chat_widget_search_index.h \
+    $$PWD/../../src/chatwidget/chat_widget_delegate.h \
+    $$PWD/../../src/chatwidget/chat_widget_row_reader.h \
+    $$PWD/../../src/chatwidget/chat_widget_layout_cache.h \
+    $$PWD/../../src/chatwidget/chat_widget_prerenderer.h \
+    $$PWD/../../src/chatwidget/chat_widget_highlighter.h \
+    $$PWD/../../src/chatwidget/chat_widget_image_cache.h \
+    $$PWD/../../src/chatwidget/chat_widget_streaming_renderer.h \
+    $$PWD/../../src/chatwidget/chat_widget_code_highlighter.h \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_utils.h \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_document_builder.h \
+    $$PWD/../../src/chatlist/chat_list_roles.h \
+    $$PWD/../../src/chatlist/chat_list_filter_model.h \
+    $$PWD/../../src/common/avatar_cache.h \
+    $$PWD/../../3rdparty/md4c/md4c.h \
+    $$PWD/../../3rdparty/md4c/md4c-html.h \
+    $$PWD/../../3rdparty/md4c/entity.h
@@ -0,0 +1,389 @@
+// 渲染热路径基准（QBENCHMARK）。
+// 机器可读输出使用 QtTest 自带格式，例如：
+//   benchmarks -o results.xml,xml        # 每个数据行一条 <BenchmarkResult>
+//   benchmarks -csv                      # 逗号分隔，便于直接入库
+// 计时器可用 -tickcounter / -callgrind 等切换，-iterations 固定迭代次数。
+
+#include <QtTest>
+#include <QImage>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QStandardItemModel>
+#include <QStyleOptionViewItem>
+#include <QTextDocument>
+
+#include "chat_list_filter_model.h"
+#include "chat_list_roles.h"
+#include "chat_widget_code_highlighter.h"
+#include "chat_widget_delegate.h"
+#include "chat_widget_markdown_document_builder.h"
+#include "chat_widget_markdown_utils.h"
+#include "chat_widget_model.h"
+
+namespace {
+const int kViewWidth = 720;
+
+QString codeBlockSample()
+{
+    QString text = QStringLiteral("下面是一个完整的实现：\n\n```cpp\n");
+    for (int i = 0; i < 40; ++i) {
+        text += QStringLiteral("int compute%1(const std::vector<int>& values) { return values.size() * %1; }\n").arg(i);
+    }
+    text += QStringLiteral("```\n\n调用 `compute0` 即可得到结果。\n");
+    return text;
+}
+
+// 约 2000 行的代码回答，覆盖注释、字符串、数字与预处理指令
+QString longCodeSample()
+{
+    QString text = QStringLiteral("```cpp\n#include <vector>\n");
+    for (int i = 0; i < 2000; ++i) {
+        text += QStringLiteral("    const double item%1 = lookup(\"key-%1\") * %1.5; // 第 %1 项\n").arg(i);
+    }
+    text += QStringLiteral("```\n");
+    return text;
+}
+
+QString tableSample()
+{
+    QString text = QStringLiteral("| 模型 | 上下文 | 延迟 (ms) | 备注 |\n|---|---|---:|---|\n");
+    for (int i = 0; i < 30; ++i) {
+        text += QStringLiteral("| model-%1 | %2k | %3 | **推荐** 用于 `batch` 场景 |\n").arg(i).arg(8 * (i + 1)).arg(40 + i);
+    }
+    return text;
+}
+
+QString longListSample()
+{
+    QString text = QStringLiteral("## 步骤\n\n");
+    for (int i = 0; i < 60; ++i) {
+        text += QStringLiteral("%1. 检查 *配置项* `option_%1`，必要时参考 [文档](https://example.com/%1)\n").arg(i + 1);
+        if (i % 10 == 0) {
+            text += QStringLiteral("   - 子项：确认 **权限** 与路径\n");
+        }
+    }
+    return text;
+}
+
+QString mixedSample()
+{
+    return QStringLiteral("# 总结\n\n") + longListSample().left(1200) + QStringLiteral("\n\n") + tableSample().left(800)
+        + QStringLiteral("\n\n") + codeBlockSample().left(1500);
+}
+
+QList<ChatWidgetMessage> makeMessages(int count, int firstId = 0)
+{
+    const QDateTime base = QDateTime::fromMSecsSinceEpoch(1700000000000LL, Qt::UTC);
+    QList<ChatWidgetMessage> messages;
+    messages.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        ChatWidgetMessage message;
+        const int id = firstId + i;
+        message.messageId = QString::number(id);
+        message.senderId = QStringLiteral("user-%1").arg(id % 20);
+        message.sender = QStringLiteral("用户 %1").arg(id % 20);
+        message.content = QStringLiteral("第 %1 条消息，包含一些 **Markdown** 文本。").arg(id);
+        message.timestamp = base.addSecs(id);
+        message.isMine = id % 3 == 0;
+        messages.append(message);
+    }
+    return messages;
+}
+
+QStyleOptionViewItem viewOption(int height = 0)
+{
+    QStyleOptionViewItem option;
+    option.rect = QRect(0, 0, kViewWidth, height);
+    return option;
+}
+} // namespace
+
+class ChatBenchmarks : public QObject {
+    Q_OBJECT
+
+private slots:
+    void renderMarkdown_data();
+    void renderMarkdown();
+    void buildDocument_data();
+    void buildDocument();
+    void delegateSizeHint_data();
+    void delegateSizeHint();
+    void delegatePaint();
+    void modelSetMessages_data();
+    void modelSetMessages();
+    void modelPrependMessages_data();
+    void modelPrependMessages();
+    void modelPrependPage_data();
+    void modelPrependPage();
+    void chatListFilter_data();
+    void chatListFilter();
+    void streamingAppend();
+    void highlightCode_data();
+    void highlightCode();
+};
+
+void ChatBenchmarks::renderMarkdown_data()
+{
+    QTest::addColumn<QString>("markdown");
+    QTest::newRow("code_block") << codeBlockSample();
+    QTest::newRow("table") << tableSample();
+    QTest::newRow("long_list") << longListSample();
+    QTest::newRow("mixed") << mixedSample();
+}
+
+void ChatBenchmarks::renderMarkdown()
+{
+    QFETCH(QString, markdown);
+    QString html;
+    QBENCHMARK {
+        html = ChatWidgetMarkdownUtils::renderMarkdown(markdown);
+    }
+    QVERIFY(!html.isEmpty());
+}
+
+void ChatBenchmarks::buildDocument_data()
+{
+    // html：md_html 生成 HTML 后 setHtml 解析；direct：md4c 回调直接构建
+    QTest::addColumn<QString>("markdown");
+    QTest::addColumn<bool>("direct");
+    const QList<QPair<const char*, QString>> samples = {
+        {"short", QStringLiteral("好的，我看一下 **明天** 前给你回复，参考 `config.yaml` 里的设置。")},
+        {"code_block", codeBlockSample()},
+        {"table", tableSample()},
+        {"long_list", longListSample()},
+        {"mixed", mixedSample()},
+    };
+    for (const auto& sample : samples) {
+        QTest::newRow(QByteArray(sample.first).append("_html").constData()) << sample.second << false;
+        QTest::newRow(QByteArray(sample.first).append("_direct").constData()) << sample.second << true;
+    }
+}
+
+void ChatBenchmarks::buildDocument()
+{
+    QFETCH(QString, markdown);
+    QFETCH(bool, direct);
+    QTextDocument document;
+    QBENCHMARK {
+        if (direct) {
+            ChatWidgetMarkdownDocumentBuilder::build(markdown, &document);
+        } else {
+            document.setHtml(ChatWidgetMarkdownUtils::renderMarkdown(markdown));
+        }
+    }
+    QVERIFY(!document.isEmpty());
+}
+
+void ChatBenchmarks::delegateSizeHint_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("cold") << false;
+    QTest::newRow("warm") << true;
+}
+
+void ChatBenchmarks::delegateSizeHint()
+{
+    QFETCH(bool, cached);
+    ChatWidgetModel model;
+    QList<ChatWidgetMessage> messages = makeMessages(200);
+    for (int i = 0; i < messages.size(); i += 4) {
+        messages[i].content = mixedSample();
+    }
+    model.setMessages(messages);
+    ChatWidgetDelegate delegate;
+    const QStyleOptionViewItem option = viewOption();
+
+    QBENCHMARK {
+        if (!cached) {
+            delegate.clearLayoutCache();
+        }
+        for (int row = 0; row < model.rowCount(); ++row) {
+            delegate.sizeHint(option, model.index(row, 0));
+        }
+    }
+}
+
+void ChatBenchmarks::delegatePaint()
+{
+    ChatWidgetModel model;
+    QList<ChatWidgetMessage> messages = makeMessages(50);
+    for (int i = 0; i < messages.size(); i += 4) {
+        messages[i].content = mixedSample();
+    }
+    model.setMessages(messages);
+    ChatWidgetDelegate delegate;
+
+    QVector<QSize> sizes;
+    int totalHeight = 0;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        sizes.append(delegate.sizeHint(viewOption(), model.index(row, 0)));
+        totalHeight += sizes.last().height();
+    }
+    QImage canvas(kViewWidth, qMin(totalHeight, 8000), QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        canvas.fill(Qt::white);
+        QPainter painter(&canvas);
+        int y = 0;
+        for (int row = 0; row < model.rowCount() && y < canvas.height(); ++row) {
+            QStyleOptionViewItem option = viewOption(sizes.at(row).height());
+            option.rect.moveTop(y);
+            delegate.paint(&painter, option, model.index(row, 0));
+            y += sizes.at(row).height();
+        }
+    }
+}
+
+void ChatBenchmarks::modelSetMessages_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void ChatBenchmarks::modelSetMessages()
+{
+    QFETCH(int, count);
+    const QList<ChatWidgetMessage> messages = makeMessages(count);
+    ChatWidgetModel model;
+    QBENCHMARK {
+        model.setMessages(messages);
+    }
+    QCOMPARE(model.rowCount(), count);
+}
+
+void ChatBenchmarks::modelPrependMessages_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void ChatBenchmarks::modelPrependMessages()
+{
+    QFETCH(int, count);
+    // 已有 count 行时在头部插入一页（50 条）历史
+    const QList<ChatWidgetMessage> existing = makeMessages(count, 1000000);
+    const QList<ChatWidgetMessage> page = makeMessages(50);
+    ChatWidgetModel model;
+    QBENCHMARK {
+        model.setMessages(existing);
+        model.prependMessages(page);
+    }
+    QCOMPARE(model.rowCount(), count + page.size());
+}
+
+void ChatBenchmarks::modelPrependPage_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+    QTest::newRow("1M") << 1000000;
+}
+
+void ChatBenchmarks::modelPrependPage()
+{
+    QFETCH(int, count);
+    // 只计向前翻页插入一页（50 条）的代价：各数据行的耗时应基本相同，与已加载行数无关
+    ChatWidgetModel model;
+    model.setMessages(makeMessages(count, 2000000));
+    int nextId = 2000000;
+    QBENCHMARK {
+        nextId -= 50;
+        model.prependMessages(makeMessages(50, nextId));
+    }
+    QVERIFY(model.rowCount() > count);
+    QCOMPARE(model.index(0, 0).data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), QString::number(nextId));
+}
+
+void ChatBenchmarks::chatListFilter_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::newRow("name") << QStringLiteral("联系人 12");
+    QTest::newRow("message") << QStringLiteral("周报");
+    QTest::newRow("no_match") << QStringLiteral("zzzz");
+}
+
+void ChatBenchmarks::chatListFilter()
+{
+    QFETCH(QString, pattern);
+    QStandardItemModel source;
+    for (int i = 0; i < 10000; ++i) {
+        auto* item = new QStandardItem();
+        item->setData(QStringLiteral("联系人 %1").arg(i), ChatListNameRole);
+        item->setData(i % 7 == 0 ? QStringLiteral("本周周报已提交") : QStringLiteral("好的，明天见"),
+                      ChatListMessageRole);
+        source.appendRow(item);
+    }
+    ChatListFilterModel filter;
+    filter.setSearchRoles({ChatListNameRole, ChatListMessageRole});
+    filter.setSourceModel(&source);
+
+    // 与 ChatListWidget::applyFilterText 一致：转义后的不区分大小写正则
+    const QRegularExpression re(QRegularExpression::escape(pattern), QRegularExpression::CaseInsensitiveOption);
+    QBENCHMARK {
+        filter.setFilterRegularExpression(re);
+        filter.setFilterRegularExpression(QRegularExpression());
+    }
+}
+
+void ChatBenchmarks::streamingAppend()
+{
+    // 模拟一次完整的流式回复：每个片段追加到最后一条消息后重新计算行高
+    const QString reply = mixedSample();
+    const int chunkSize = 8;
+    ChatWidgetModel model;
+    ChatWidgetDelegate delegate;
+    // 与 ChatWidgetView 相同的失效连接
+    connect(&model, &QAbstractItemModel::dataChanged, &delegate, &ChatWidgetDelegate::invalidateLayout);
+    connect(&model, &QAbstractItemModel::modelReset, &delegate, &ChatWidgetDelegate::clearLayoutCache);
+    const QStyleOptionViewItem option = viewOption();
+
+    QBENCHMARK {
+        model.setMessages(makeMessages(20));
+        ChatWidgetMessage message;
+        message.messageId = QStringLiteral("stream");
+        model.addMessage(message);
+        const QModelIndex last = model.index(model.rowCount() - 1, 0);
+        for (int pos = 0; pos < reply.size(); pos += chunkSize) {
+            model.appendContentToLastMessage(reply.mid(pos, chunkSize));
+            delegate.sizeHint(option, last);
+        }
+    }
+}
+
+void ChatBenchmarks::highlightCode_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("cold") << false;
+    QTest::newRow("warm") << true;
+}
+
+void ChatBenchmarks::highlightCode()
+{
+    // 2000 行代码块着色（不含排版）；cold 每次清空行缓存，warm 对应同一回答的重建
+    QFETCH(bool, cached);
+    const QString markdown = longCodeSample();
+    QTextDocument document;
+    document.setHtml(ChatWidgetMarkdownUtils::renderMarkdown(markdown));
+    ChatWidgetCodeHighlighter highlighter;
+    QTextCharFormat format;
+    format.setForeground(Qt::red);
+    for (int kind = 0; kind < ChatWidgetCodeHighlighter::TokenKindCount; ++kind) {
+        highlighter.setFormat(static_cast<ChatWidgetCodeHighlighter::TokenKind>(kind), format);
+    }
+    highlighter.highlight(&document, markdown);
+    QVERIFY(highlighter.tokenizedLineCount() > 2000);
+
+    QBENCHMARK {
+        if (!cached) {
+            highlighter.clearCache();
+        }
+        highlighter.highlight(&document, markdown);
+    }
+}
+
+QTEST_MAIN(ChatBenchmarks)
+#include "tst_benchmarks.moc"
@@ -3,11 +3,33 @@ TARGET = chatwidget_model_tests
 QT += testlib core
 CONFIG += console c++17
 
-INCLUDEPATH += $$PWD/../../src/chatwidget
+INCLUDEPATH += $$PWD/../../src/chatwidget \
+    $$PWD/../../3rdparty/md4c
 
 SOURCES += \
     tst_chatwidget_model.cpp \
-    $$PWD/../../src/chatwidget/chat_widget_model.cpp
+    $$PWD/../../src/chatwidget/chat_widget_model.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_search_index.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_history_window.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_highlighter.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_utils.cpp \
+    $$PWD/../../src/chatwidget/chat_file_history_source.cpp \
+    $$PWD/../../3rdparty/md4c/md4c.c \
+    $$PWD/../../3rdparty/md4c/md4c-html.c \
+    $$PWD/../../3rdparty/md4c/entity.c
 
 HEADERS += \
-    $$PWD/../../src/chatwidget/chat_widget_model.h
+    $$PWD/../../src/chatwidget/chat_widget_message.h \
+    $$PWD/../../src/chatwidget/chat_widget_model.h \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.h \
+    $$PWD/../../src/chatwidget/chat_widget_gap_vector.h \
+    $$PWD/../../src/chatwidget/chat_widget_search_index.h \
+    $$PWD/../../src/chatwidget/chat_widget_history_window.h \
+    $$PWD/../../src/chatwidget/chat_widget_highlighter.h \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_utils.h \
+    $$PWD/../../src/chatwidget/chat_history_source.h \
+    $$PWD/../../src/chatwidget/chat_file_history_source.h \
+    $$PWD/../../3rdparty/md4c/md4c.h \
+    $$PWD/../../3rdparty/md4c/md4c-html.h \
+    $$PWD/../../3rdparty/md4c/entity.h
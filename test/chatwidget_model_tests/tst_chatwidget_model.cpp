@@ -1,5 +1,10 @@
 #include <QtTest>
 
+#include "chat_file_history_source.h"
+#include "chat_widget_highlighter.h"
+#include "chat_widget_history_window.h"
+#include "chat_widget_markdown_utils.h"
+#include "chat_widget_message_store.h"
 #include "chat_widget_model.h"
 
 class ChatWidgetModelTest : public QObject {
@@ -8,6 +13,19 @@ class ChatWidgetModelTest : public QObject {
 private slots:
     void setMessages_sortsAndDedupesById();
     void appendMessages_dedupesById();
+    void movedLists_matchCopiedLists();
+    void contentRevision_changesOnlyWithContent();
+    void rowForMessageId_tracksPrependAndRemove();
+    void prependPages_keepRowOrderAcrossEviction();
+    void mergeMessages_interleavesLateArrivals();
+    void batch_mergesChangesAndAppends();
+    void messageStore_roundTripsAndInternsParticipants();
+    void participantUpdates_notifyOnlyTheirRows();
+    void historyWindow_pagesAndEvictsRows();
+    void fileHistorySource_scansIdsWithoutParsing();
+    void highlighter_matchesTextInOnePass();
+    void searchKeyword_updatesMatchesWithoutDataChanged();
+    void findMessages_usesIndexForPrefixAndCjk();
 };
 
 static ChatWidgetMessage makeMessage(const QString& id, const QDateTime& timestamp)
@@ -61,5 +79,646 @@ void ChatWidgetModelTest::appendMessages_dedupesById()
     QCOMPARE(last.data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), QString("3"));
 }
 
+void ChatWidgetModelTest::movedLists_matchCopiedLists()
+{
+    auto makeBatch = [](int first) {
+        QList<ChatWidgetMessage> messages;
+        for (int i = first + 4; i >= first; --i) {
+            ChatWidgetMessage message = makeMessage(QString::number(i), QDateTime(QDate(2024, 1, 1), QTime(9, i)));
+            message.fileName = QStringLiteral("f%1.txt").arg(i);
+            message.reactions = {ChatWidgetReaction("👍", i)};
+            messages << message;
+        }
+        messages << makeMessage(QString::number(first), QDateTime(QDate(2024, 1, 1), QTime(9, 59)));
+        return messages;
+    };
+
+    ChatWidgetModel copied;
+    ChatWidgetModel moved;
+    const QList<ChatWidgetMessage> initial = makeBatch(20);
+    const QList<ChatWidgetMessage> newer = makeBatch(22);
+    const QList<ChatWidgetMessage> older = makeBatch(10);
+    copied.setMessages(initial);
+    copied.appendMessages(newer);
+    copied.prependMessages(older);
+    copied.addMessage(makeMessage("x", QDateTime(QDate(2024, 1, 1), QTime(10, 0))));
+
+    moved.setMessages(makeBatch(20));
+    QList<ChatWidgetMessage> newerMoved = makeBatch(22);
+    moved.appendMessages(std::move(newerMoved));
+    QList<ChatWidgetMessage> olderMoved = makeBatch(10);
+    moved.prependMessages(std::move(olderMoved));
+    ChatWidgetMessage last = makeMessage("x", QDateTime(QDate(2024, 1, 1), QTime(10, 0)));
+    moved.addMessage(std::move(last));
+
+    // 左值重载不修改调用方的列表
+    QCOMPARE(initial.first().messageId, QString("24"));
+    QCOMPARE(newer.size(), 6);
+
+    QCOMPARE(moved.rowCount(), copied.rowCount());
+    for (int row = 0; row < copied.rowCount(); ++row) {
+        const QModelIndex a = copied.index(row, 0);
+        const QModelIndex b = moved.index(row, 0);
+        for (int role : {int(ChatWidgetModel::ChatWidgetMessageIdRole), int(ChatWidgetModel::ChatWidgetContentRole),
+                         int(ChatWidgetModel::ChatWidgetTimestampRole), int(ChatWidgetModel::ChatWidgetFileNameRole),
+                         int(ChatWidgetModel::ChatWidgetReactionsRole)}) {
+            QCOMPARE(b.data(role), a.data(role));
+        }
+        QCOMPARE(moved.rowForMessageId(b.data(ChatWidgetModel::ChatWidgetMessageIdRole).toString()), row);
+    }
+}
+
+void ChatWidgetModelTest::contentRevision_changesOnlyWithContent()
+{
+    ChatWidgetModel model;
+    model.addMessage(makeMessage("1", QDateTime(QDate(2024, 1, 1), QTime(9, 0))));
+
+    const quint64 key = model.index(0, 0).data(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong();
+    const quint64 revision = model.index(0, 0).data(ChatWidgetModel::ChatWidgetContentRevisionRole).toULongLong();
+    QVERIFY(key != 0);
+
+    model.updateMessageStatus("1", ChatWidgetMessage::MessageStatus::Read);
+    QCOMPARE(model.index(0, 0).data(ChatWidgetModel::ChatWidgetContentRevisionRole).toULongLong(), revision);
+
+    model.appendContentToMessageAt(0, " more");
+    QVERIFY(model.index(0, 0).data(ChatWidgetModel::ChatWidgetContentRevisionRole).toULongLong() != revision);
+
+    QList<ChatWidgetMessage> older;
+    older << makeMessage("0", QDateTime(QDate(2024, 1, 1), QTime(8, 0)));
+    model.prependMessages(older);
+    QCOMPARE(model.index(1, 0).data(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong(), key);
+}
+
+void ChatWidgetModelTest::rowForMessageId_tracksPrependAndRemove()
+{
+    ChatWidgetModel model;
+    QList<ChatWidgetMessage> messages;
+    messages << makeMessage("3", QDateTime(QDate(2024, 1, 1), QTime(10, 0)))
+             << makeMessage("4", QDateTime(QDate(2024, 1, 1), QTime(11, 0)))
+             << makeMessage("5", QDateTime(QDate(2024, 1, 1), QTime(12, 0)));
+    model.setMessages(messages);
+
+    QList<ChatWidgetMessage> older;
+    older << makeMessage("1", QDateTime(QDate(2024, 1, 1), QTime(8, 0)))
+          << makeMessage("2", QDateTime(QDate(2024, 1, 1), QTime(9, 0)));
+    model.prependMessages(older);
+    QCOMPARE(model.rowForMessageId("1"), 0);
+    QCOMPARE(model.rowForMessageId("5"), 4);
+
+    model.removeMessageAt(0);
+    QCOMPARE(model.rowForMessageId("1"), -1);
+    QCOMPARE(model.rowForMessageId("2"), 0);
+    model.removeMessageAt(1);
+    QCOMPARE(model.rowForMessageId("4"), 1);
+    QCOMPARE(model.rowForMessageId("5"), 2);
+
+    QSignalSpy spy(&model, &QAbstractItemModel::dataChanged);
+    QHash<QString, ChatWidgetMessage::MessageStatus> statuses;
+    statuses.insert("2", ChatWidgetMessage::MessageStatus::Read);
+    statuses.insert("4", ChatWidgetMessage::MessageStatus::Read);
+    statuses.insert("5", ChatWidgetMessage::MessageStatus::Read);
+    statuses.insert("missing", ChatWidgetMessage::MessageStatus::Read);
+    model.updateMessageStatuses(statuses);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).value<QModelIndex>().row(), 0);
+    QCOMPARE(spy.at(0).at(1).value<QModelIndex>().row(), 2);
+}
+
+void ChatWidgetModelTest::prependPages_keepRowOrderAcrossEviction()
+{
+    // 头部空位反复扩容、被淘汰行释放后复用，行号语义保持不变
+    const QDateTime base(QDate(2024, 1, 1), QTime(0, 0));
+    ChatWidgetModel model;
+    model.setMessages({makeMessage("1000", base.addSecs(1000))});
+    int first = 1000;
+    for (int page = 0; page < 40; ++page) {
+        QList<ChatWidgetMessage> older;
+        for (int id = first - 25; id < first; ++id) {
+            older << makeMessage(QString::number(id), base.addSecs(id));
+        }
+        model.prependMessages(std::move(older));
+        first -= 25;
+        if (page % 3 == 2) {
+            model.removeMessages(model.rowCount() - 30, 30);
+        }
+        if (page % 7 == 6) {
+            model.removeMessages(0, 10);
+            first += 10;
+        }
+    }
+    model.removeMessages(5, 3);
+
+    QCOMPARE(model.index(0, 0).data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), QString::number(first));
+    quint64 previousKey = 0;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const QModelIndex index = model.index(row, 0);
+        const QString id = index.data(ChatWidgetModel::ChatWidgetMessageIdRole).toString();
+        const int expected = row < 5 ? first + row : first + row + 3;
+        QCOMPARE(id, QString::number(expected));
+        QCOMPARE(index.data(ChatWidgetModel::ChatWidgetContentRole).toString(), id);
+        QCOMPARE(model.rowForMessageId(id), row);
+        const quint64 key = index.data(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong();
+        QVERIFY(key > previousKey);
+        QCOMPARE(model.rowForKey(key), row);
+        previousKey = key;
+    }
+}
+
+void ChatWidgetModelTest::mergeMessages_interleavesLateArrivals()
+{
+    const QDateTime base(QDate(2024, 1, 1), QTime(0, 0));
+    ChatWidgetModel model;
+    model.setMessages({makeMessage("10", base.addSecs(10)), makeMessage("20", base.addSecs(20)),
+                       makeMessage("30", base.addSecs(30))});
+
+    // 乱序输入：重复 id 被忽略，其余按时间落到头部、中间与末尾
+    QList<ChatWidgetMessage> page;
+    page << makeMessage("40", base.addSecs(40)) << makeMessage("20", base.addSecs(20))
+         << makeMessage("25", base.addSecs(25)) << makeMessage("5", base.addSecs(5))
+         << makeMessage("15", base.addSecs(15)) << makeMessage("25", base.addSecs(25));
+    qRegisterMetaType<QVector<quint64>>();
+    QSignalSpy insertedSpy(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    QSignalSpy keysSpy(&model, &ChatWidgetModel::messageKeysChanged);
+    QSignalSpy mergeBeginSpy(&model, &ChatWidgetModel::rowsAboutToBeMerged);
+    QSignalSpy mergeEndSpy(&model, &ChatWidgetModel::rowsMerged);
+    // 每次通知时模型中的行都已按时间排列，rowForMessageId 与行一致（不会读到属于其他消息的行）
+    int consistentNotifications = 0;
+    const QMetaObject::Connection check =
+        connect(&model, &QAbstractItemModel::rowsInserted, this, [&model, &consistentNotifications]() {
+            qint64 previous = -1;
+            for (int row = 0; row < model.rowCount(); ++row) {
+                const QModelIndex index = model.index(row, 0);
+                const qint64 time = index.data(ChatWidgetModel::ChatWidgetTimestampRole).toDateTime().toMSecsSinceEpoch();
+                if (time < previous
+                    || model.rowForMessageId(index.data(ChatWidgetModel::ChatWidgetMessageIdRole).toString()) != row) {
+                    return;
+                }
+                previous = time;
+            }
+            ++consistentNotifications;
+        });
+    model.mergeMessages(std::move(page));
+    disconnect(check);
+    // 按段从后往前插入并通知，每段的数据在各自的通知之间就位
+    QCOMPARE(insertedSpy.count(), 4);
+    QCOMPARE(consistentNotifications, 4);
+    const int insertedRows[] = {3, 2, 1, 0};
+    for (int i = 0; i < 4; ++i) {
+        QCOMPARE(insertedSpy.at(i).at(1).toInt(), insertedRows[i]);
+        QCOMPARE(insertedSpy.at(i).at(2).toInt(), insertedRows[i]);
+    }
+    QCOMPARE(mergeBeginSpy.count(), 1);
+    QCOMPARE(mergeBeginSpy.at(0).at(0).toInt(), 0);
+    QCOMPARE(mergeEndSpy.count(), 1);
+
+    // 同一间隔内反复插入：key 间隔不足时只局部重新分配并通知新旧 key，不重置模型
+    for (int i = 1; i <= 40; ++i) {
+        model.mergeMessages({makeMessage(QStringLiteral("10.%1").arg(i), base.addSecs(10).addMSecs(i))});
+    }
+    QCOMPARE(resetSpy.count(), 0);
+    QVERIFY(keysSpy.count() > 0);
+    for (const QList<QVariant>& arguments : keysSpy) {
+        const QVector<quint64> oldKeys = arguments.at(0).value<QVector<quint64>>();
+        const QVector<quint64> newKeys = arguments.at(1).value<QVector<quint64>>();
+        QCOMPARE(oldKeys.size(), newKeys.size());
+        QVERIFY(oldKeys.size() < model.rowCount());
+    }
+
+    // 整页早于首行（向前翻页）时按前插处理，一次插入
+    insertedSpy.clear();
+    model.mergeMessages({makeMessage("1", base.addSecs(1)), makeMessage("2", base.addSecs(2))});
+    QCOMPARE(insertedSpy.count(), 1);
+    QCOMPARE(insertedSpy.at(0).at(1).toInt(), 0);
+    QCOMPARE(insertedSpy.at(0).at(2).toInt(), 1);
+
+    QStringList expected{"1", "2", "5", "10"};
+    for (int i = 1; i <= 40; ++i) {
+        expected << QStringLiteral("10.%1").arg(i);
+    }
+    expected << "15" << "20" << "25" << "30" << "40";
+    QCOMPARE(model.rowCount(), expected.size());
+    quint64 previousKey = 0;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const QModelIndex index = model.index(row, 0);
+        QCOMPARE(index.data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), expected.at(row));
+        QCOMPARE(model.rowForMessageId(expected.at(row)), row);
+        const quint64 key = index.data(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong();
+        QVERIFY(key > previousKey);
+        QCOMPARE(model.rowForKey(key), row);
+        previousKey = key;
+    }
+}
+
+void ChatWidgetModelTest::batch_mergesChangesAndAppends()
+{
+    ChatWidgetModel model;
+    QList<ChatWidgetMessage> messages;
+    messages << makeMessage("1", QDateTime(QDate(2024, 1, 1), QTime(8, 0)))
+             << makeMessage("2", QDateTime(QDate(2024, 1, 1), QTime(9, 0)))
+             << makeMessage("3", QDateTime(QDate(2024, 1, 1), QTime(10, 0)));
+    model.setMessages(messages);
+
+    qRegisterMetaType<QVector<int>>();
+    QSignalSpy changedSpy(&model, &QAbstractItemModel::dataChanged);
+    QSignalSpy insertedSpy(&model, &QAbstractItemModel::rowsInserted);
+    {
+        ChatWidgetModelBatch batch(&model);
+        model.updateMessageStatus("1", ChatWidgetMessage::MessageStatus::Read);
+        model.updateMessageContent("2", "edited");
+        model.updateMessageStatus("3", ChatWidgetMessage::MessageStatus::Read);
+        model.addMessage(makeMessage("4", QDateTime(QDate(2024, 1, 1), QTime(11, 0))));
+        model.addMessage(makeMessage("5", QDateTime(QDate(2024, 1, 1), QTime(12, 0))));
+        model.removeLastMessage();
+        model.updateMessageStatus("4", ChatWidgetMessage::MessageStatus::Read);
+        QCOMPARE(changedSpy.count(), 0);
+        QCOMPARE(insertedSpy.count(), 0);
+        QCOMPARE(model.rowCount(), 3);
+    }
+
+    QCOMPARE(model.rowCount(), 4);
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.at(0).at(0).value<QModelIndex>().row(), 0);
+    QCOMPARE(changedSpy.at(0).at(1).value<QModelIndex>().row(), 2);
+    const QVector<int> roles = changedSpy.at(0).at(2).value<QVector<int>>();
+    QVERIFY(roles.contains(ChatWidgetModel::ChatWidgetMessageStatusRole));
+    QVERIFY(roles.contains(ChatWidgetModel::ChatWidgetContentRole));
+    QCOMPARE(insertedSpy.count(), 1);
+    QCOMPARE(insertedSpy.at(0).at(1).toInt(), 3);
+    QCOMPARE(insertedSpy.at(0).at(2).toInt(), 3);
+    QCOMPARE(model.index(3, 0).data(ChatWidgetModel::ChatWidgetMessageStatusRole).toInt(),
+             static_cast<int>(ChatWidgetMessage::MessageStatus::Read));
+}
+
+void ChatWidgetModelTest::messageStore_roundTripsAndInternsParticipants()
+{
+    ChatWidgetMessage plain = makeMessage("1", QDateTime(QDate(2024, 1, 1), QTime(8, 0), Qt::UTC));
+    plain.senderId = "u1";
+    plain.sender = "Alice";
+    plain.avatarPath = ":/a.png";
+
+    ChatWidgetMessage rich = makeMessage("2", QDateTime());
+    rich.senderId = "u1";
+    rich.sender = "Alice";
+    rich.avatarPath = ":/a.png";
+    rich.isMine = true;
+    rich.messageType = ChatWidgetMessage::MessageType::File;
+    rich.status = ChatWidgetMessage::MessageStatus::Failed;
+    rich.filePath = "/tmp/report.pdf";
+    rich.fileName = "report.pdf";
+    rich.fileSize = 1024;
+    rich.replyToMessageId = "1";
+    rich.isForwarded = true;
+    rich.reactions << ChatWidgetReaction("👍", 2);
+    rich.mentions << "u2";
+
+    ChatWidgetMessageStore store;
+    store.append(plain);
+    store.insert(0, { rich });
+    QCOMPARE(store.count(), 2);
+    QCOMPARE(store.participantCount(), 1);
+    QCOMPARE(store.extraCount(), 1);
+
+    const ChatWidgetMessage restored = store.message(0);
+    QCOMPARE(restored.messageId, rich.messageId);
+    QVERIFY(!restored.timestamp.isValid());
+    QCOMPARE(restored.isMine, true);
+    QCOMPARE(restored.messageType, rich.messageType);
+    QCOMPARE(restored.status, rich.status);
+    QCOMPARE(restored.fileName, rich.fileName);
+    QCOMPARE(restored.fileSize, rich.fileSize);
+    QCOMPARE(restored.replyToMessageId, rich.replyToMessageId);
+    QCOMPARE(restored.isForwarded, true);
+    QVERIFY(restored.reactions == rich.reactions);
+    QCOMPARE(restored.mentions, rich.mentions);
+    QCOMPARE(store.timestamp(1), plain.timestamp);
+    QCOMPARE(store.timestamp(1).timeSpec(), Qt::UTC);
+
+    QVERIFY(store.updateParticipant("u1", "Alice Chen", QString()));
+    QCOMPARE(store.sender(0), QString("Alice Chen"));
+    QCOMPARE(store.sender(1), QString("Alice Chen"));
+    QCOMPARE(store.avatarPath(1), QString(":/a.png"));
+
+    store.removeAt(0);
+    QCOMPARE(store.extraCount(), 0);
+    QCOMPARE(store.messageId(0), QString("1"));
+
+    // 固定偏移与时区的时间戳按原时区还原，时区记在附加表中
+    ChatWidgetMessage offset = makeMessage("3", QDateTime::fromMSecsSinceEpoch(1000, Qt::OffsetFromUTC, 8 * 3600));
+    offset.senderId = "u2";
+    const QTimeZone zone(9 * 3600);
+    ChatWidgetMessage zoned = makeMessage("4", QDateTime::fromMSecsSinceEpoch(2000, zone));
+    zoned.senderId = "u2";
+    store.append(offset);
+    store.append(zoned);
+    QCOMPARE(store.timestamp(1).timeSpec(), Qt::OffsetFromUTC);
+    QCOMPARE(store.timestamp(1).offsetFromUtc(), 8 * 3600);
+    QCOMPARE(store.timestamp(1), offset.timestamp);
+    QCOMPARE(store.timestamp(2).timeSpec(), Qt::TimeZone);
+    QCOMPARE(store.timestamp(2).timeZone(), zone);
+    QCOMPARE(store.extraCount(), 2);
+
+    // 参与者按引用的行数计数：最后一行删除后释放，空位给新参与者复用
+    QCOMPARE(store.participantCount(), 2);
+    store.removeRange(1, 2);
+    QCOMPARE(store.participantCount(), 1);
+    QCOMPARE(store.participantId("u2"), -1);
+    QCOMPARE(store.extraCount(), 0);
+    ChatWidgetMessage newcomer = makeMessage("5", QDateTime());
+    newcomer.senderId = "u3";
+    newcomer.sender = "Carol";
+    store.append(newcomer);
+    QCOMPARE(store.participantCount(), 2);
+    QCOMPARE(store.participantSlotCount(), 2);
+    QCOMPARE(store.sender(1), QString("Carol"));
+}
+
+void ChatWidgetModelTest::participantUpdates_notifyOnlyTheirRows()
+{
+    const QDateTime base(QDate(2024, 1, 1), QTime(0, 0));
+    QList<ChatWidgetMessage> messages;
+    for (int i = 0; i < 12; ++i) {
+        ChatWidgetMessage message = makeMessage(QString::number(i), base.addSecs(i));
+        message.senderId = QStringLiteral("u%1").arg(i % 3);
+        message.sender = QStringLiteral("User %1").arg(i % 3);
+        messages << message;
+    }
+    ChatWidgetModel model;
+    model.setMessages(messages);
+    QCOMPARE(model.messageStore().participantCount(), 3);
+
+    qRegisterMetaType<QVector<int>>();
+    QSignalSpy spy(&model, &QAbstractItemModel::dataChanged);
+    const auto changedRows = [&spy]() {
+        QVector<int> rows;
+        for (const QList<QVariant>& arguments : qAsConst(spy)) {
+            for (int row = arguments.at(0).toModelIndex().row(); row <= arguments.at(1).toModelIndex().row(); ++row) {
+                rows.append(row);
+            }
+        }
+        spy.clear();
+        return rows;
+    };
+
+    // 改名、换头像不影响行高：不逐行发出 dataChanged，只通知视图重绘可见的行
+    QSignalSpy participantSpy(&model, &ChatWidgetModel::participantChanged);
+    model.updateParticipantInfo("u1", "Bob", QString());
+    QVERIFY(changedRows().isEmpty());
+    QCOMPARE(participantSpy.count(), 1);
+    QCOMPARE(participantSpy.takeFirst().at(0).toString(), QString("u1"));
+    QCOMPARE(model.index(7, 0).data(ChatWidgetModel::ChatWidgetSenderRole).toString(), QString("Bob"));
+    QCOMPARE(model.index(8, 0).data(ChatWidgetModel::ChatWidgetSenderRole).toString(), QString("User 2"));
+
+    // 旧消息携带的旧名字不会覆盖当前资料
+    ChatWidgetMessage older = makeMessage("older", base.addSecs(-1));
+    older.senderId = "u1";
+    older.sender = "User 1";
+    model.prependMessages({ older });
+    QCOMPARE(model.index(0, 0).data(ChatWidgetModel::ChatWidgetSenderRole).toString(), QString("Bob"));
+    QVERIFY(changedRows().isEmpty());
+    QVERIFY(participantSpy.isEmpty());
+
+    // 随新消息到达的改名覆盖记录
+    ChatWidgetMessage renamed = makeMessage("renamed", base.addSecs(100));
+    renamed.senderId = "u1";
+    renamed.sender = "Robert";
+    model.addMessage(renamed);
+    QVERIFY(changedRows().isEmpty());
+    QCOMPARE(participantSpy.count(), 1);
+    QCOMPARE(model.index(13, 0).data(ChatWidgetModel::ChatWidgetSenderRole).toString(), QString("Robert"));
+    QCOMPARE(model.index(2, 0).data(ChatWidgetModel::ChatWidgetSenderRole).toString(), QString("Robert"));
+
+    model.updateIsMine("u2");
+    QCOMPARE(changedRows(), QVector<int>({ 3, 6, 9, 12 }));
+    QVERIFY(model.index(3, 0).data(ChatWidgetModel::ChatWidgetIsMineRole).toBool());
+    model.updateIsMine("u0");
+    QCOMPARE(changedRows(), QVector<int>({ 1, 3, 4, 6, 7, 9, 10, 12 }));
+    QVERIFY(!model.index(3, 0).data(ChatWidgetModel::ChatWidgetIsMineRole).toBool());
+    QVERIFY(model.index(1, 0).data(ChatWidgetModel::ChatWidgetIsMineRole).toBool());
+
+    // 参与者的行索引随删除、前插增量维护
+    model.removeMessageAt(0);
+    ChatWidgetMessage first = makeMessage("first", base.addSecs(-2));
+    first.senderId = "u2";
+    first.sender = "User 2";
+    model.prependMessages({ first });
+    changedRows();
+    model.updateIsMine("u2");
+    QCOMPARE(changedRows(), QVector<int>({ 0, 1, 3, 4, 6, 7, 9, 10, 12 }));
+
+    // 显示名由空变为非空时出现名字区、行高变化，仍逐行通知
+    ChatWidgetMessage unnamed = makeMessage("unnamed", base.addSecs(200));
+    unnamed.senderId = "u3";
+    model.addMessage(unnamed);
+    changedRows();
+    model.updateParticipantInfo("u3", "Carol", QString());
+    QCOMPARE(changedRows(), QVector<int>({ 14 }));
+}
+
+void ChatWidgetModelTest::historyWindow_pagesAndEvictsRows()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("history.jsonl");
+    QList<ChatWidgetMessage> history;
+    const QDateTime base(QDate(2024, 1, 1), QTime(0, 0));
+    for (int i = 0; i < 300; ++i) {
+        history << makeMessage(QString::number(i), base.addSecs(i));
+    }
+    QVERIFY(ChatFileHistorySource::writeMessages(path, history));
+
+    ChatFileHistorySource source(path);
+    QVERIFY(source.open());
+    QCOMPARE(source.messageCount(), 300);
+
+    ChatWidgetModel model;
+    ChatWidgetHistoryWindow window(&model);
+    window.setSource(&source);
+    window.setPageSize(50);
+    window.setMaxRows(120);
+    window.loadLatest();
+    QCOMPARE(model.rowCount(), 50);
+    QCOMPARE(model.index(49, 0).data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), QString("299"));
+    QVERIFY(window.hasMoreOlder());
+    QVERIFY(!window.hasMoreNewer());
+
+    QCOMPARE(window.loadOlder(), 50);
+    QCOMPARE(window.loadOlder(), 50);
+    QCOMPARE(model.rowCount(), 120);
+    QCOMPARE(model.index(0, 0).data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), QString("150"));
+    QCOMPARE(model.index(119, 0).data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), QString("269"));
+    QVERIFY(window.hasMoreNewer());
+    QCOMPARE(model.rowForMessageId("150"), 0);
+    QCOMPARE(model.rowForMessageId("299"), -1);
+
+    QCOMPARE(window.loadNewer(), 30);
+    QVERIFY(!window.hasMoreNewer());
+    QCOMPARE(model.rowCount(), 120);
+    QCOMPARE(model.index(0, 0).data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), QString("180"));
+    QCOMPARE(model.rowForMessageId("299"), 119);
+}
+
+void ChatWidgetModelTest::fileHistorySource_scansIdsWithoutParsing()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("history.jsonl");
+    const QDateTime base(QDate(2024, 1, 1), QTime(0, 0));
+    // 正文与嵌套数组中出现的 "id" 不算；含转义的 id 退回完整解析
+    ChatWidgetMessage decoy = makeMessage("decoy", base);
+    decoy.content = QStringLiteral("{\"id\":\"fake\"}");
+    decoy.reactions.append(ChatWidgetReaction("id", 1));
+    ChatWidgetMessage quoted = makeMessage(QStringLiteral("say \"hi\""), base.addSecs(1));
+    ChatWidgetMessage last = makeMessage("last", base.addSecs(2));
+    QVERIFY(ChatFileHistorySource::writeMessages(path, { decoy, quoted, last }));
+
+    ChatFileHistorySource source(path);
+    QVERIFY(source.open());
+    QCOMPARE(source.messageCount(), 3);
+    QVERIFY(source.fetchBefore("fake", 1).isEmpty());
+    const QList<ChatWidgetMessage> before = source.fetchBefore("last", 2);
+    QCOMPARE(before.size(), 2);
+    QCOMPARE(before.at(0).content, decoy.content);
+    QCOMPARE(source.fetchAfter(QStringLiteral("say \"hi\""), 1).value(0).messageId, QString("last"));
+    QCOMPARE(source.fetchAfter("decoy", 1).value(0).messageId, quoted.messageId);
+}
+
+void ChatWidgetModelTest::highlighter_matchesTextInOnePass()
+{
+    // 提及区分大小写、任意位置命中；关键字不区分大小写、只在词首命中；模式之间可以重叠
+    const ChatWidgetHighlighter highlighter({"@Alice", "@Al"}, "span");
+    const QString text = QStringLiteral("@Alice: SPAN timespan foo_span spanner @alice");
+    const QVector<ChatWidgetHighlighter::Match> matches = highlighter.match(text);
+
+    QStringList found;
+    for (const ChatWidgetHighlighter::Match& match : matches) {
+        found << QStringLiteral("%1:%2").arg(match.kind == ChatWidgetHighlighter::Mention ? "m" : "k",
+                                              text.mid(match.start, match.length));
+    }
+    QCOMPARE(found, QStringList({"m:@Al", "m:@Alice", "k:SPAN", "k:span"}));
+    QCOMPARE(matches.at(3).start, text.indexOf("spanner"));
+    QVERIFY(ChatWidgetSearchIndex::isTokenStart(text, text.indexOf("timespan")));
+    QVERIFY(!ChatWidgetSearchIndex::isTokenStart(text, text.indexOf("timespan") + 4));
+
+    QVERIFY(ChatWidgetHighlighter(QStringList(), "  ").isEmpty());
+}
+
+void ChatWidgetModelTest::searchKeyword_updatesMatchesWithoutDataChanged()
+{
+    ChatWidgetModel model;
+    QList<ChatWidgetMessage> messages;
+    const QStringList contents = {"Hello world", "hello there", "goodbye", "HELLO WORLD again"};
+    for (int i = 0; i < contents.size(); ++i) {
+        ChatWidgetMessage message;
+        message.messageId = QString::number(i);
+        message.content = contents.at(i);
+        message.timestamp = QDateTime::fromMSecsSinceEpoch(1000 + i);
+        messages.append(message);
+    }
+    model.setMessages(messages);
+
+    QSignalSpy changedSpy(&model, &QAbstractItemModel::dataChanged);
+    QSignalSpy keywordSpy(&model, &ChatWidgetModel::searchKeywordChanged);
+
+    model.setSearchKeyword("hello");
+    QCOMPARE(model.searchMatchCount(), 3);
+    model.setSearchKeyword("hello w");
+    QCOMPARE(model.searchMatchCount(), 2);
+    QVERIFY(model.isSearchMatch(0));
+    QVERIFY(!model.isSearchMatch(1));
+    QVERIFY(model.isSearchMatch(3));
+
+    QCOMPARE(changedSpy.count(), 0);
+    QCOMPARE(keywordSpy.count(), 2);
+    QCOMPARE(keywordSpy.last().at(1).toString(), QString("hello"));
+
+    // 新增与修改的消息按当前关键字判定
+    ChatWidgetMessage appended;
+    appended.content = "hello wonderful";
+    model.addMessage(appended);
+    QCOMPARE(model.searchMatchCount(), 3);
+    model.updateMessageContent("0", "bye");
+    QCOMPARE(model.searchMatchCount(), 2);
+    model.removeMessageAt(3);
+    QCOMPARE(model.searchMatchCount(), 1);
+
+    // 按渲染后的纯文本判定（与高亮一致）：只出现在链接地址中的文字不算命中，强调标记不影响命中
+    model.setSearchKeyword("hello");
+    ChatWidgetMessage linked;
+    linked.content = "see [docs](https://example.com/hello)";
+    model.addMessage(linked);
+    ChatWidgetMessage emphasized;
+    emphasized.content = "**hello** again";
+    model.addMessage(emphasized);
+    QVERIFY(!model.isSearchMatch(4));
+    QVERIFY(model.isSearchMatch(5));
+    QCOMPARE(model.searchMatchCount(), 3);
+    QCOMPARE(model.findMessages("hello"), QVector<int>({1, 3, 5}));
+
+    // 校验文本只经 md4c 解析得到：行内标记与链接地址去掉，块之间以 U+2029 分隔
+    QCOMPARE(ChatWidgetMarkdownUtils::plainText("plain words"), QString("plain words"));
+    QCOMPARE(ChatWidgetMarkdownUtils::plainText("**hello** [docs](https://example.com) &amp; more"),
+             QString("hello docs & more"));
+    QCOMPARE(ChatWidgetMarkdownUtils::plainText("- [x] done\n\n```\na\nb\n```"),
+             QString::fromUtf8("☑ done") + QChar(QChar::ParagraphSeparator) + "a" + QChar(QChar::ParagraphSeparator) + "b");
+
+    // 词中间的片段既不计数也不高亮
+    model.setSearchKeyword("ell");
+    QCOMPARE(model.searchMatchCount(), 0);
+    QVERIFY(model.findMessages("ell").isEmpty());
+
+    model.setSearchKeyword(QString());
+    QCOMPARE(model.searchMatchCount(), 0);
+}
+
+void ChatWidgetModelTest::findMessages_usesIndexForPrefixAndCjk()
+{
+    QCOMPARE(ChatWidgetSearchIndex::tokenize("Build 今天天气 OK"),
+             QStringList({"build", "今天", "天天", "天气", "气", "ok"}));
+
+    ChatWidgetModel model;
+    QList<ChatWidgetMessage> messages;
+    const QStringList contents = {"Deploy finished", "今天天气不错", "deployment failed", "明天再说"};
+    for (int i = 0; i < contents.size(); ++i) {
+        ChatWidgetMessage message;
+        message.messageId = QString::number(i);
+        message.content = contents.at(i);
+        message.timestamp = QDateTime::fromMSecsSinceEpoch(1000 + i);
+        messages.append(message);
+    }
+    model.setMessages(messages);
+
+    QCOMPARE(model.findMessages("deploy"), QVector<int>({0, 2}));
+    QCOMPARE(model.findMessages("deployment fa"), QVector<int>({2}));
+    QCOMPARE(model.findMessages("天气"), QVector<int>({1}));
+    QCOMPARE(model.findMessages("天"), QVector<int>({1, 3}));
+    QVERIFY(model.findMessages("不存在").isEmpty());
+
+    // 索引随追加、头部插入、修改与删除增量更新
+    ChatWidgetMessage older;
+    older.messageId = "older";
+    older.content = "deploy rollback";
+    older.timestamp = QDateTime::fromMSecsSinceEpoch(10);
+    model.prependMessages({older});
+    ChatWidgetMessage newer;
+    newer.messageId = "newer";
+    newer.content = "天气预报";
+    model.addMessage(newer);
+    QCOMPARE(model.findMessages("deploy"), QVector<int>({0, 1, 3}));
+    QCOMPARE(model.findMessages("天气"), QVector<int>({2, 5}));
+
+    const quint64 olderKey = model.index(0, 0).data(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong();
+    const quint64 lastKey = model.index(5, 0).data(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong();
+    QCOMPARE(model.rowForKey(olderKey), 0);
+    QCOMPARE(model.rowForKey(lastKey), 5);
+
+    model.updateMessageContent("0", "nothing here");
+    QCOMPARE(model.findMessages("deploy"), QVector<int>({0, 3}));
+    model.removeMessageAt(0);
+    QCOMPARE(model.findMessages("deploy"), QVector<int>({2}));
+    QCOMPARE(model.rowForKey(olderKey), -1);
+    QCOMPARE(model.rowForKey(lastKey), 4);
+}
+
 QTEST_MAIN(ChatWidgetModelTest)
 #include "tst_chatwidget_model.moc"
@@ -11,10 +11,25 @@ SOURCES += \
     tst_chatwidget.cpp \
     $$PWD/../../src/chatwidget/chat_widget.cpp \
     $$PWD/../../src/chatwidget/chat_widget_view.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_list_view.cpp \
     $$PWD/../../src/chatwidget/chat_widget_model.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_search_index.cpp \
     $$PWD/../../src/chatwidget/chat_widget_delegate.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_row_reader.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_layout_cache.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_prerenderer.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_highlighter.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_image_cache.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_streaming_renderer.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_code_highlighter.cpp \
     $$PWD/../../src/chatwidget/chat_widget_input.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_stream_buffer.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_history_window.cpp \
+    $$PWD/../../src/chatwidget/chat_file_history_source.cpp \
     $$PWD/../../src/chatwidget/chat_widget_markdown_utils.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_document_builder.cpp \
+    $$PWD/../../src/common/avatar_cache.cpp \
     $$PWD/../../src/common/qss_utils.cpp \
     $$PWD/../../3rdparty/md4c/md4c.c \
     $$PWD/../../3rdparty/md4c/md4c-html.c \
@@ -23,10 +38,28 @@ SOURCES += \
 HEADERS += \
     $$PWD/../../src/chatwidget/chat_widget.h \
     $$PWD/../../src/chatwidget/chat_widget_view.h \
+    $$PWD/../../src/chatwidget/chat_widget_list_view.h \
+    $$PWD/../../src/chatwidget/chat_widget_message.h \
     $$PWD/../../src/chatwidget/chat_widget_model.h \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.h \
+    $$PWD/../../src/chatwidget/chat_widget_gap_vector.h \
+    $$PWD/../../src/chatwidget/chat_widget_search_index.h \
     $$PWD/../../src/chatwidget/chat_widget_delegate.h \
+    $$PWD/../../src/chatwidget/chat_widget_row_reader.h \
+    $$PWD/../../src/chatwidget/chat_widget_layout_cache.h \
+    $$PWD/../../src/chatwidget/chat_widget_prerenderer.h \
+    $$PWD/../../src/chatwidget/chat_widget_highlighter.h \
+    $$PWD/../../src/chatwidget/chat_widget_image_cache.h \
+    $$PWD/../../src/chatwidget/chat_widget_streaming_renderer.h \
+    $$PWD/../../src/chatwidget/chat_widget_code_highlighter.h \
     $$PWD/../../src/chatwidget/chat_widget_input.h \
+    $$PWD/../../src/chatwidget/chat_widget_stream_buffer.h \
+    $$PWD/../../src/chatwidget/chat_widget_history_window.h \
+    $$PWD/../../src/chatwidget/chat_file_history_source.h \
+    $$PWD/../../src/chatwidget/chat_history_source.h \
     $$PWD/../../src/chatwidget/chat_widget_markdown_utils.h \
+    $$PWD/../../src/chatwidget/chat_widget_markdown_document_builder.h \
+    $$PWD/../../src/common/avatar_cache.h \
     $$PWD/../../src/common/qss_utils.h \
     $$PWD/../../3rdparty/md4c/md4c.h \
     $$PWD/../../3rdparty/md4c/md4c-html.h \
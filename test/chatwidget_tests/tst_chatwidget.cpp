@@ -2,6 +2,7 @@
 #include <type_traits>
 
 #include "chat_widget.h"
+#include "chat_widget_stream_buffer.h"
 #include "chat_widget_view.h"
 #include "chat_widget_model.h"
 
@@ -33,6 +34,9 @@ private slots:
     void modelMatchesView();
     void addMessage_params_withoutSenderId_usesIsMine();
     void addMessage_params_withSenderId_usesCurrentUser();
+    void streamOutput_coalescesUntilFlush();
+    void streamOutput_flushesBeforeAddMessage();
+    void findMessages_followsKeyChangesAndReset();
 };
 
 void ChatWidgetTest::defaultViewAndModel_notNull()
@@ -84,5 +88,85 @@ void ChatWidgetTest::addMessage_params_withSenderId_usesCurrentUser()
     QCOMPARE(idx.data(ChatWidgetModel::ChatWidgetSenderRole).toString(), QString("Me"));
 }
 
+void ChatWidgetTest::streamOutput_coalescesUntilFlush()
+{
+    ChatWidget widget;
+    ChatWidget::MessageParams params;
+    params.displayName = "AI";
+    widget.addMessage(params);
+    widget.setSendingState(true);
+
+    widget.streamOutput("Hel");
+    widget.streamOutput("lo");
+
+    QModelIndex idx = widget.model()->index(0, 0);
+    QCOMPARE(idx.data(ChatWidgetModel::ChatWidgetContentRole).toString(), QString());
+
+    widget.flushStreamOutput();
+
+    QCOMPARE(idx.data(ChatWidgetModel::ChatWidgetContentRole).toString(), QString("Hello"));
+    QCOMPARE(widget.streamBuffer()->deltasReceived(), qint64(2));
+    QCOMPARE(widget.streamBuffer()->flushesPerformed(), qint64(1));
+}
+
+void ChatWidgetTest::streamOutput_flushesBeforeAddMessage()
+{
+    ChatWidget widget;
+    ChatWidget::MessageParams reply;
+    reply.displayName = "AI";
+    widget.addMessage(reply);
+    widget.setSendingState(true);
+
+    // 缓冲中的片段属于第一条回复，不能落到随后加入的消息上
+    widget.streamOutput("first ");
+    widget.streamOutput("answer");
+    ChatWidget::MessageParams question;
+    question.content = "next question";
+    question.isMine = true;
+    widget.addMessage(question);
+    widget.addMessage(reply);
+    widget.streamOutput("second");
+    widget.flushStreamOutput();
+
+    QCOMPARE(widget.model()->rowCount(), 3);
+    QCOMPARE(widget.model()->index(0, 0).data(ChatWidgetModel::ChatWidgetContentRole).toString(), QString("first answer"));
+    QCOMPARE(widget.model()->index(1, 0).data(ChatWidgetModel::ChatWidgetContentRole).toString(), QString("next question"));
+    QCOMPARE(widget.model()->index(2, 0).data(ChatWidgetModel::ChatWidgetContentRole).toString(), QString("second"));
+}
+
+static ChatWidget::HistoryMessage makeHistory(const QString& id, const QString& content, const QDateTime& timestamp)
+{
+    ChatWidget::HistoryMessage message;
+    message.messageId = id;
+    message.senderId = "user-2";
+    message.content = content;
+    message.timestamp = timestamp;
+    return message;
+}
+
+void ChatWidgetTest::findMessages_followsKeyChangesAndReset()
+{
+    ChatWidget widget;
+    const QDateTime base(QDate(2024, 1, 1), QTime(0, 0));
+    widget.setHistoryMessages({makeHistory("a", "target first", base), makeHistory("b", "other", base.addSecs(10))});
+    QCOMPARE(widget.findMessages("target"), 1);
+
+    // 同一间隔内反复并入迟到消息，行 key 被局部重新分配；命中仍指向原消息
+    for (int i = 1; i <= 40; ++i) {
+        widget.appendHistoryMessages({makeHistory(QStringLiteral("late.%1").arg(i), "late", base.addMSecs(i))});
+    }
+    QCOMPARE(widget.model()->rowCount(), 42);
+    QCOMPARE(widget.findNext(), 0);
+
+    // 模型重置后按原查询重新检索
+    QSignalSpy matchSpy(&widget, &ChatWidget::searchMatchChanged);
+    widget.setHistoryMessages({makeHistory("c", "other", base), makeHistory("d", "target one", base.addSecs(1)),
+                               makeHistory("e", "target two", base.addSecs(2))});
+    QCOMPARE(widget.searchMatchCount(), 2);
+    QCOMPARE(widget.currentSearchMatch(), -1);
+    QVERIFY(matchSpy.count() > 0);
+    QCOMPARE(widget.findNext(), 1);
+}
+
 QTEST_MAIN(ChatWidgetTest)
 #include "tst_chatwidget.moc"
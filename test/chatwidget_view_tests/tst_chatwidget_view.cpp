@@ -1,6 +1,22 @@
 #include <QtTest>
+#include <QIdentityProxyModel>
 #include <QListView>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QTextList>
+#include <QTextTable>
 
+#include "avatar_cache.h"
+#include "chat_widget_code_highlighter.h"
+#include "chat_widget_image_cache.h"
+#include "chat_widget_list_view.h"
+#include "chat_widget_markdown_document_builder.h"
+#include "chat_widget_markdown_utils.h"
+#include "chat_widget_prerenderer.h"
+#include "chat_widget_row_reader.h"
+#include "chat_widget_streaming_renderer.h"
 #include "chat_widget_view.h"
 
 class ChatWidgetViewTest : public QObject {
@@ -11,8 +27,43 @@ private slots:
     void setModel_usesProvidedModel();
     void scrollToBottom_noCrash();
     void refreshLayout_noCrash();
+    void imageCache_decodesThumbnailAsync();
+    void avatarCache_rendersOncePerKey();
+    void prerenderer_matchesSynchronousLayout();
+    void delegate_resolvedMetricsFollowStyle();
+    void rowReader_directAndRoleAccessAgree();
+    void listView_measuresOnlyVisibleRows();
+    void listView_relayoutsOffscreenRowsWhenIdle();
+    void listView_resolvesViewportWithinFrameBudget();
+    void codeHighlighter_colorsFencedBlocksIncrementally();
+    void markdownBuilder_buildsDocumentWithoutHtml();
+    void streamingRenderer_matchesOneShotBuild();
+    void streamingRenderer_appendsOpenFenceByLine();
+    void delegate_rebuildsStreamedRowWhenFinished();
 };
 
+namespace {
+// 块结构摘要：文本、列表、缩进、上边距、标题级别与代码行标记
+QStringList blockStructure(const QTextDocument& document)
+{
+    QStringList blocks;
+    for (QTextBlock block = document.begin(); block.isValid(); block = block.next()) {
+        const QTextBlockFormat format = block.blockFormat();
+        const QTextList* list = block.textList();
+        blocks << QStringLiteral("%1|%2|%3|%4|%5|%6|%7|%8")
+                      .arg(block.text())
+                      .arg(list ? int(list->format().style()) : 0)
+                      .arg(list ? list->itemNumber(block) : -1)
+                      .arg(format.indent())
+                      .arg(format.topMargin())
+                      .arg(format.leftMargin())
+                      .arg(format.headingLevel())
+                      .arg(format.nonBreakableLines());
+    }
+    return blocks;
+}
+} // namespace
+
 void ChatWidgetViewTest::defaultModel_isNotNull()
 {
     ChatWidgetView view;
@@ -57,5 +108,593 @@ void ChatWidgetViewTest::refreshLayout_noCrash()
     QVERIFY(true);
 }
 
+void ChatWidgetViewTest::imageCache_decodesThumbnailAsync()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("photo.png");
+    QImage source(800, 400, QImage::Format_RGB32);
+    source.fill(Qt::red);
+    QVERIFY(source.save(path));
+
+    const QImage decoded = ChatWidgetImageCache::decodeThumbnail(path, QSize(180, 120));
+    QCOMPARE(decoded.size(), QSize(180, 120));
+
+    ChatWidgetImageCache cache;
+    QSignalSpy loadedSpy(&cache, &ChatWidgetImageCache::thumbnailLoaded);
+    QVERIFY(cache.thumbnail(path, QSize(180, 120)).isNull());
+    QVERIFY(cache.isPending(path, QSize(180, 120)));
+    QVERIFY(loadedSpy.wait(5000));
+    QCOMPARE(loadedSpy.at(0).at(0).toString(), path);
+
+    const QPixmap thumbnail = cache.thumbnail(path, QSize(180, 120));
+    QCOMPARE(thumbnail.size(), QSize(180, 120));
+    QCOMPARE(cache.count(), 1);
+
+    // 解码失败的图片不会重复排队
+    const QString missing = dir.filePath("missing.png");
+    QVERIFY(cache.thumbnail(missing, QSize(180, 120)).isNull());
+    QVERIFY(loadedSpy.wait(5000));
+    QVERIFY(cache.thumbnail(missing, QSize(180, 120)).isNull());
+    QVERIFY(!cache.isPending(missing, QSize(180, 120)));
+}
+
+void ChatWidgetViewTest::avatarCache_rendersOncePerKey()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("avatar.png");
+    QImage source(120, 80, QImage::Format_RGB32);
+    source.fill(Qt::blue);
+    QVERIFY(source.save(path));
+
+    AvatarCache* cache = AvatarCache::instance();
+    cache->clear();
+    const QPixmap circle = cache->avatar(path, 40, AvatarCache::Circle, 0, 2.0);
+    QCOMPARE(circle.size(), QSize(80, 80));
+    QCOMPARE(circle.devicePixelRatio(), 2.0);
+    // 圆形头像的四角透明
+    QCOMPARE(qAlpha(circle.toImage().pixel(0, 0)), 0);
+
+    QCOMPARE(cache->avatar(path, 40, AvatarCache::Circle, 0, 2.0).cacheKey(), circle.cacheKey());
+    cache->avatar(path, 40, AvatarCache::RoundedRect, 8, 2.0);
+    QCOMPARE(cache->count(), 2);
+
+    cache->remove(path);
+    QCOMPARE(cache->count(), 0);
+    QVERIFY(cache->avatar(dir.filePath("missing.png"), 40).isNull());
+}
+
+void ChatWidgetViewTest::prerenderer_matchesSynchronousLayout()
+{
+    ChatWidgetModel model;
+    QList<ChatWidgetMessage> messages;
+    for (int i = 0; i < 300; ++i) {
+        ChatWidgetMessage message;
+        message.messageId = QString::number(i);
+        message.content = QStringLiteral("第 %1 条\n\n- **列表** 项\n- `code`\n\n").arg(i).repeated(i % 4 + 1);
+        message.timestamp = QDateTime::fromMSecsSinceEpoch(1000 + i);
+        messages.append(message);
+    }
+    model.setMessages(messages);
+
+    QStyleOptionViewItem option;
+    option.rect = QRect(0, 0, 640, 0);
+    ChatWidgetDelegate prerendered;
+    prerendered.sizeHint(option, model.index(0, 0));
+    prerendered.clearLayoutCache();
+    QSignalSpy rowsSpy(&prerendered, &ChatWidgetDelegate::rowsPrerendered);
+    prerendered.prerenderRows(&model, 0, model.rowCount() - 1);
+    QVERIFY(prerendered.prerenderer()->pendingCount() > 0);
+    // 未完成的行返回估算高度，不阻塞
+    QVERIFY(prerendered.sizeHint(option, model.index(299, 0)).height() > 0);
+    QTRY_COMPARE_WITH_TIMEOUT(prerendered.prerenderer()->pendingCount(), 0, 10000);
+    QCOMPARE(prerendered.prerenderer()->resultCount(), model.rowCount());
+    // 每个分片按 key 映射回行号通知，覆盖全部行
+    QSet<int> notified;
+    for (const QList<QVariant>& arguments : rowsSpy) {
+        for (int row : arguments.at(0).value<QVector<int>>()) {
+            notified.insert(row);
+        }
+    }
+    QCOMPARE(notified.size(), model.rowCount());
+    // 后台构建的文档交给排版缓存接管，之后结果只保留尺寸
+    QCOMPARE(prerendered.prerenderer()->documentCount(), model.rowCount());
+    prerendered.sizeHint(option, model.index(1, 0));
+    QCOMPARE(prerendered.prerenderer()->documentCount(), model.rowCount() - 1);
+    QVERIFY(prerendered.prerenderer()->takeDocument(model.index(1, 0).data(ChatWidgetModel::ChatWidgetMessageKeyRole)
+                                                        .toULongLong())
+                .isNull());
+
+    ChatWidgetDelegate synchronous;
+    for (int row = 0; row < model.rowCount(); row += 37) {
+        const QModelIndex index = model.index(row, 0);
+        // 估算高度直接采用预渲染结果，与同步排版的实际高度一致
+        QCOMPARE(prerendered.estimatedHeight(option, index), synchronous.sizeHint(option, index).height());
+        QCOMPARE(prerendered.sizeHint(option, index), synchronous.sizeHint(option, index));
+    }
+
+    // 内容变化后旧结果不再使用
+    ChatWidgetPrerenderer::Result result;
+    const QModelIndex first = model.index(0, 0);
+    const quint64 key = first.data(ChatWidgetModel::ChatWidgetMessageKeyRole).toULongLong();
+    QVERIFY(prerendered.prerenderer()->find(key, first.data(ChatWidgetModel::ChatWidgetContentRevisionRole).toULongLong(),
+                                            &result));
+    QVERIFY(result.documentSize.height() > 0);
+    model.updateMessageContentAt(0, "changed");
+    QVERIFY(!prerendered.prerenderer()->find(key, first.data(ChatWidgetModel::ChatWidgetContentRevisionRole).toULongLong(),
+                                             nullptr));
+}
+
+void ChatWidgetViewTest::delegate_resolvedMetricsFollowStyle()
+{
+    ChatWidgetModel model;
+    ChatWidgetMessage message;
+    message.messageId = "m1";
+    message.senderId = "u1";
+    message.sender = "Alice";
+    message.content = "hello";
+    message.timestamp = QDateTime::fromMSecsSinceEpoch(1000);
+    model.setMessages({message});
+    const QModelIndex index = model.index(0, 0);
+
+    QStyleOptionViewItem option;
+    option.rect = QRect(0, 0, 640, 0);
+    ChatWidgetDelegate delegate;
+    const QSize original = delegate.sizeHint(option, index);
+
+    // 样式变化后派生的度量随之重建
+    ChatWidgetDelegate::Style style = delegate.style();
+    const ChatWidgetDelegate::Style defaults = style;
+    style.nameFont.setPointSize(24);
+    style.timestampFont.setPointSize(24);
+    delegate.setStyle(style);
+    QVERIFY(delegate.sizeHint(option, index).height() > original.height());
+
+    delegate.setStyle(defaults);
+    QCOMPARE(delegate.sizeHint(option, index), original);
+
+    // 同一 DPI 下指定度量控件不改变行高
+    QWidget widget;
+    delegate.setMetricsWidget(&widget);
+    if (widget.logicalDpiY() == QFontMetrics(defaults.messageFont).fontDpi()) {
+        QCOMPARE(delegate.sizeHint(option, index), original);
+    }
+}
+
+void ChatWidgetViewTest::rowReader_directAndRoleAccessAgree()
+{
+    ChatWidgetModel model;
+    ChatWidgetMessage message;
+    message.messageId = "m1";
+    message.senderId = "u1";
+    message.sender = "Alice";
+    message.content = "hello @Bob";
+    message.timestamp = QDateTime::fromMSecsSinceEpoch(1000);
+    message.status = ChatWidgetMessage::MessageStatus::Read;
+    message.fileName = "a.txt";
+    message.fileSize = 42;
+    message.replySender = "Bob";
+    message.isForwarded = true;
+    message.reactions = {ChatWidgetReaction{"👍", 3}};
+    message.mentions = {"Bob"};
+    model.setMessages({message});
+    model.setSearchKeyword("hello");
+
+    // 经代理模型的索引退化为按角色读取，结果应与直接读取存储一致
+    QIdentityProxyModel proxy;
+    proxy.setSourceModel(&model);
+    const ChatWidgetRowReader direct(model.index(0, 0));
+    const ChatWidgetRowReader viaRoles(proxy.index(0, 0));
+    QVERIFY(direct.isDirect());
+    QVERIFY(!viaRoles.isDirect());
+
+    QCOMPARE(direct.key(), viaRoles.key());
+    QCOMPARE(direct.revision(), viaRoles.revision());
+    QCOMPARE(direct.messageType(), viaRoles.messageType());
+    QCOMPARE(direct.status(), ChatWidgetMessage::MessageStatus::Read);
+    QCOMPARE(direct.status(), viaRoles.status());
+    QCOMPARE(direct.timestamp(), viaRoles.timestamp());
+    QCOMPARE(direct.content(), viaRoles.content());
+    QCOMPARE(direct.sender(), viaRoles.sender());
+    QCOMPARE(direct.senderId(), viaRoles.senderId());
+    QCOMPARE(direct.fileName(), viaRoles.fileName());
+    QCOMPARE(direct.fileSize(), viaRoles.fileSize());
+    QCOMPARE(direct.replySender(), viaRoles.replySender());
+    QCOMPARE(direct.isForwarded(), viaRoles.isForwarded());
+    QCOMPARE(direct.mentions(), viaRoles.mentions());
+    QCOMPARE(direct.searchKeyword(), viaRoles.searchKeyword());
+    QCOMPARE(direct.reactions().size(), 1);
+    QCOMPARE(viaRoles.reactions().size(), 1);
+    QCOMPARE(direct.reactions().first().emoji, viaRoles.reactions().first().emoji);
+    QCOMPARE(direct.reactions().first().count, viaRoles.reactions().first().count);
+}
+
+void ChatWidgetViewTest::listView_measuresOnlyVisibleRows()
+{
+    auto makeMessages = [](int first, int count) {
+        QList<ChatWidgetMessage> messages;
+        for (int i = first; i < first + count; ++i) {
+            ChatWidgetMessage message;
+            message.messageId = QString::number(i);
+            message.content = QStringLiteral("消息 %1 ").arg(i).repeated(i % 5 + 1);
+            message.timestamp = QDateTime::fromMSecsSinceEpoch(100000 + i * 1000);
+            messages.append(message);
+        }
+        return messages;
+    };
+
+    ChatWidgetView view;
+    view.resize(480, 360);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+    auto* listView = view.findChild<ChatWidgetListView*>("chatWidgetViewList");
+    QVERIFY(listView != nullptr);
+
+    view.setMessages(makeMessages(1000, 2000));
+    QCOMPARE(view.model()->rowCount(), 2000);
+    QVERIFY(listView->contentHeight() > listView->viewport()->height());
+    int measured = 0;
+    for (int row = 0; row < 2000; ++row) {
+        measured += listView->isRowMeasured(row) ? 1 : 0;
+    }
+    QVERIFY(measured > 0);
+    QVERIFY(measured < 100);
+    QVERIFY(listView->isRowMeasured(1999));
+
+    // 跳转到中间的行时只测量目标附近
+    const QModelIndex middle = view.model()->index(1000, 0);
+    listView->scrollTo(middle, QAbstractItemView::PositionAtTop);
+    QVERIFY(listView->isRowMeasured(1000));
+    QCOMPARE(listView->visualRect(middle).top(), 0);
+    QCOMPARE(listView->indexAt(QPoint(10, 1)), middle);
+
+    // 头部插入历史后顶部可见的消息保持原位
+    const QModelIndex top = listView->indexAt(QPoint(10, 1));
+    const QString topId = top.data(ChatWidgetModel::ChatWidgetMessageIdRole).toString();
+    const int topY = listView->visualRect(top).top();
+    view.prependMessages(makeMessages(0, 200));
+    const QModelIndex anchored = listView->indexAt(QPoint(10, 1));
+    QCOMPARE(anchored.data(ChatWidgetModel::ChatWidgetMessageIdRole).toString(), topId);
+    QCOMPARE(listView->visualRect(anchored).top(), topY);
+    QVERIFY(!listView->isRowMeasured(0));
+}
+
+void ChatWidgetViewTest::listView_relayoutsOffscreenRowsWhenIdle()
+{
+    QList<ChatWidgetMessage> messages;
+    for (int i = 0; i < 400; ++i) {
+        ChatWidgetMessage message;
+        message.messageId = QString::number(i);
+        message.content = QStringLiteral("较长的消息内容，用于在不同宽度下换行 %1 ").arg(i).repeated(i % 6 + 1);
+        message.timestamp = QDateTime::fromMSecsSinceEpoch(100000 + i * 1000);
+        messages.append(message);
+    }
+
+    ChatWidgetView view;
+    view.resize(480, 360);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+    auto* listView = view.findChild<ChatWidgetListView*>("chatWidgetViewList");
+    QVERIFY(listView != nullptr);
+    view.setMessages(messages);
+    // 等待历史预渲染结果到达并完成对应的重新布局
+    auto* delegate = qobject_cast<ChatWidgetDelegate*>(listView->itemDelegate());
+    QVERIFY(delegate != nullptr);
+    QTRY_COMPARE_WITH_TIMEOUT(delegate->prerenderer()->pendingCount(), 0, 10000);
+    QCoreApplication::processEvents();
+
+    QSignalSpy progressSpy(listView, &ChatWidgetListView::relayoutProgress);
+    QSignalSpy finishedSpy(listView, &ChatWidgetListView::relayoutFinished);
+    view.resize(900, 360);
+    // 视口内的行立即按新宽度测量，视口外的行留待空闲时处理
+    QVERIFY(listView->isRowMeasured(399));
+    QVERIFY(!listView->isRowMeasured(0));
+    QVERIFY(listView->isRelayoutPending());
+    QVERIFY(finishedSpy.wait(10000));
+    QVERIFY(progressSpy.count() > 0);
+    for (int row = 0; row < 400; ++row) {
+        QVERIFY(listView->isRowMeasured(row));
+    }
+    QVERIFY(listView->verticalScrollBar()->value() == listView->verticalScrollBar()->maximum());
+
+    // 同一档位内的宽度变化不触发重新测量
+    const int width = listView->viewport()->width();
+    view.resize(view.width() + 1, 360);
+    const bool sameBucket = ChatWidgetDelegate::textLayoutWidth(width)
+        == ChatWidgetDelegate::textLayoutWidth(listView->viewport()->width());
+    QCOMPARE(listView->isRelayoutPending(), !sameBucket);
+    listView->cancelRelayout();
+    QVERIFY(!listView->isRelayoutPending());
+}
+
+void ChatWidgetViewTest::listView_resolvesViewportWithinFrameBudget()
+{
+    // 少于预渲染阈值的行在绘制时同步排版；预算极小时多数行先画骨架，随后逐帧补全
+    QList<ChatWidgetMessage> messages;
+    for (int i = 0; i < 24; ++i) {
+        ChatWidgetMessage message;
+        message.messageId = QString::number(i);
+        message.content = QStringLiteral("**第 %1 条** `code` [link](https://example.com)\n\n- 列表项\n- 列表项\n").arg(i)
+                              .repeated(i % 3 + 1);
+        message.timestamp = QDateTime::fromMSecsSinceEpoch(100000 + i * 1000);
+        messages.append(message);
+    }
+
+    ChatWidgetView view;
+    view.setFrameBudget(1);
+    QCOMPARE(view.frameBudget(), 1);
+    view.resize(480, 720);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+    auto* listView = view.findChild<ChatWidgetListView*>("chatWidgetViewList");
+    QVERIFY(listView != nullptr);
+    auto* delegate = qobject_cast<ChatWidgetDelegate*>(listView->itemDelegate());
+    QVERIFY(delegate != nullptr);
+
+    view.setMessages(messages);
+    listView->scrollTo(view.model()->index(12, 0), QAbstractItemView::PositionAtCenter);
+    QTRY_VERIFY_WITH_TIMEOUT(listView->isViewportResolved(), 10000);
+
+    QStyleOptionViewItem option;
+    option.rect = QRect(0, 0, listView->viewport()->width(), 0);
+    const int top = listView->indexAt(QPoint(10, 1)).row();
+    const int bottom = listView->indexAt(QPoint(10, listView->viewport()->height() - 1)).row();
+    QVERIFY(top >= 0);
+    for (int row = top; row <= (bottom >= 0 ? bottom : top); ++row) {
+        QVERIFY(listView->isRowMeasured(row));
+        QVERIFY(delegate->isLayoutCached(option, view.model()->index(row, 0)));
+    }
+}
+
+void ChatWidgetViewTest::codeHighlighter_colorsFencedBlocksIncrementally()
+{
+    QCOMPARE(ChatWidgetCodeHighlighter::languageForName("C++"), ChatWidgetCodeHighlighter::Cpp);
+    QCOMPARE(ChatWidgetCodeHighlighter::languageForName("bash"), ChatWidgetCodeHighlighter::Shell);
+    QCOMPARE(ChatWidgetCodeHighlighter::languageForName("brainfuck"), ChatWidgetCodeHighlighter::PlainText);
+
+    QVector<ChatWidgetCodeHighlighter::Token> tokens;
+    QCOMPARE(ChatWidgetCodeHighlighter::tokenizeLine("int x = 42; // done", ChatWidgetCodeHighlighter::Cpp, 0,
+                                                     &tokens), 0);
+    QCOMPARE(tokens.size(), 3);
+    QCOMPARE(tokens.at(0).kind, ChatWidgetCodeHighlighter::Keyword);
+    QCOMPARE(tokens.at(1).kind, ChatWidgetCodeHighlighter::Number);
+    QCOMPARE(tokens.at(2).start, 12);
+    QCOMPARE(tokens.at(2).kind, ChatWidgetCodeHighlighter::Comment);
+    // 三引号字符串跨行延续
+    tokens.clear();
+    const int state = ChatWidgetCodeHighlighter::tokenizeLine("s = \"\"\"doc", ChatWidgetCodeHighlighter::Python, 0,
+                                                              &tokens);
+    QVERIFY(state != 0);
+    tokens.clear();
+    QCOMPARE(ChatWidgetCodeHighlighter::tokenizeLine("end\"\"\" if", ChatWidgetCodeHighlighter::Python, state,
+                                                     &tokens), 0);
+    QCOMPARE(tokens.size(), 2);
+    QCOMPARE(tokens.at(0).length, 6);
+    QCOMPARE(tokens.at(1).kind, ChatWidgetCodeHighlighter::Keyword);
+
+    ChatWidgetCodeHighlighter highlighter;
+    QTextCharFormat keywordFormat;
+    keywordFormat.setForeground(QColor(Qt::red));
+    highlighter.setFormat(ChatWidgetCodeHighlighter::Keyword, keywordFormat);
+    QTextCharFormat commentFormat;
+    commentFormat.setForeground(QColor(Qt::gray));
+    highlighter.setFormat(ChatWidgetCodeHighlighter::Comment, commentFormat);
+
+    // 颜色作为附加格式叠加在代码行上，文档文本不变
+    const QString markdown = QStringLiteral("说明 int\n\n```cpp\nint main() {\n    return 0; // done\n}\n```\n");
+    QTextDocument document;
+    document.setHtml(ChatWidgetMarkdownUtils::renderMarkdown(markdown));
+    const QString plainText = document.toPlainText();
+    highlighter.highlight(&document, markdown);
+    QCOMPARE(document.toPlainText(), plainText);
+    QTextBlock block = document.begin();
+    while (block.isValid() && block.text() != QLatin1String("int main() {")) {
+        block = block.next();
+    }
+    QVERIFY(block.isValid());
+    QCOMPARE(block.layout()->formats().size(), 1);
+    QCOMPARE(block.layout()->formats().at(0).length, 3);
+    QCOMPARE(block.layout()->formats().at(0).format.foreground().color(), QColor(Qt::red));
+    QCOMPARE(block.next().layout()->formats().size(), 2);
+    QVERIFY(document.begin().layout()->formats().isEmpty());
+    QCOMPARE(highlighter.tokenizedLineCount(), 3);
+    // 同样的代码再次着色只读缓存
+    highlighter.highlight(&document, markdown);
+    QCOMPARE(highlighter.tokenizedLineCount(), 3);
+
+    // 流式：未闭合的代码块只追加新行，闭合时整块重新插入，已扫描的行命中缓存
+    QStringList lines;
+    for (int i = 0; i < 2000; ++i) {
+        lines << QStringLiteral("int value%1 = %1; // line %1").arg(i);
+    }
+    QTextDocument streamed;
+    ChatWidgetStreamingRenderer renderer(&streamed, &highlighter);
+    const QString head = QStringLiteral("```cpp\n") + lines.mid(0, 1000).join('\n') + '\n';
+    renderer.reset(head);
+    const int scanned = highlighter.tokenizedLineCount();
+    QCOMPARE(scanned, 3 + 1000);
+    QVERIFY(renderer.append(head + lines.mid(1000).join('\n') + QStringLiteral("\n```\n")));
+    QCOMPARE(highlighter.tokenizedLineCount(), scanned + 1000);
+    block = streamed.lastBlock();
+    while (block.isValid() && block.text() != lines.last()) {
+        block = block.previous();
+    }
+    QVERIFY(block.isValid());
+    QCOMPARE(block.layout()->formats().size(), 2);
+}
+
+void ChatWidgetViewTest::markdownBuilder_buildsDocumentWithoutHtml()
+{
+    // 行内格式、实体与软换行：文本与 setHtml(md_html 输出) 一致
+    const QString inlineMarkdown = QStringLiteral("Hello *world* &amp; **bold** `code`\nnext [link](https://example.com \"tip\") &#x41;");
+    QTextDocument direct;
+    QVERIFY(ChatWidgetMarkdownDocumentBuilder::build(inlineMarkdown, &direct));
+    QTextDocument imported;
+    imported.setHtml(ChatWidgetMarkdownUtils::renderMarkdown(inlineMarkdown));
+    QCOMPARE(direct.toPlainText(), imported.toPlainText());
+    QTextCharFormat linkFormat;
+    for (QTextBlock::iterator it = direct.begin().begin(); !it.atEnd(); ++it) {
+        if (it.fragment().text() == QLatin1String("link")) {
+            linkFormat = it.fragment().charFormat();
+        }
+    }
+    QVERIFY(linkFormat.isAnchor());
+    QCOMPARE(linkFormat.anchorHref(), QString("https://example.com"));
+    QCOMPARE(linkFormat.toolTip(), QString("tip"));
+
+    const QString markdown = QStringLiteral("# 标题\n\n段落\n\n- 项 1\n- [x] 项 2\n\n1. 一\n2. 二\n\n> 引用\n\n"
+                                            "```cpp\nint a;\n\nint b;\n```\n\n| A | B |\n|---|--:|\n| 1 | 2 |\n");
+    QTextDocument document;
+    QVERIFY(ChatWidgetMarkdownDocumentBuilder::build(markdown, &document));
+    QTextBlock block = document.begin();
+    QCOMPARE(block.text(), QString("标题"));
+    QCOMPARE(block.blockFormat().headingLevel(), 1);
+    QCOMPARE(block.blockFormat().topMargin(), 0.0);
+    block = block.next();
+    QCOMPARE(block.text(), QString("段落"));
+    QVERIFY(block.blockFormat().topMargin() > 0);
+
+    block = block.next();
+    QTextList* bullets = block.textList();
+    QVERIFY(bullets != nullptr);
+    QCOMPARE(bullets->format().style(), QTextListFormat::ListDisc);
+    block = block.next();
+    QCOMPARE(block.text(), QString("☑ 项 2"));
+    QCOMPARE(block.textList(), bullets);
+    block = block.next();
+    QVERIFY(block.textList() != nullptr && block.textList() != bullets);
+    QCOMPARE(block.textList()->format().style(), QTextListFormat::ListDecimal);
+    QCOMPARE(block.textList()->count(), 2);
+    block = block.next().next();
+    QCOMPARE(block.text(), QString("引用"));
+    QVERIFY(block.blockFormat().leftMargin() > 0);
+
+    // 代码块每行一个不断行的块（含空行），代码高亮可直接定位
+    block = block.next();
+    QCOMPARE(block.text(), QString("int a;"));
+    QVERIFY(block.blockFormat().nonBreakableLines());
+    QVERIFY(block.next().text().isEmpty());
+    QCOMPARE(block.next().next().text(), QString("int b;"));
+    ChatWidgetCodeHighlighter highlighter;
+    QTextCharFormat keywordFormat;
+    keywordFormat.setForeground(QColor(Qt::red));
+    highlighter.setFormat(ChatWidgetCodeHighlighter::Keyword, keywordFormat);
+    highlighter.highlight(&document, markdown);
+    QCOMPARE(block.layout()->formats().size(), 1);
+
+    QTextTable* table = nullptr;
+    for (QTextBlock it = block; it.isValid() && !table; it = it.next()) {
+        table = QTextCursor(it).currentTable();
+    }
+    QVERIFY(table != nullptr);
+    QCOMPARE(table->rows(), 2);
+    QCOMPARE(table->columns(), 2);
+    QTextCursor cell = table->cellAt(0, 0).firstCursorPosition();
+    cell.movePosition(QTextCursor::NextCharacter);
+    QCOMPARE(cell.charFormat().fontWeight(), int(QFont::Bold));
+    QCOMPARE(table->cellAt(1, 1).firstCursorPosition().block().text(), QString("2"));
+    QCOMPARE(table->cellAt(1, 1).firstCursorPosition().blockFormat().alignment() & Qt::AlignHorizontal_Mask,
+             Qt::Alignment(Qt::AlignRight));
+}
+
+void ChatWidgetViewTest::streamingRenderer_matchesOneShotBuild()
+{
+    // 分片边界（围栏、松散列表、缩进续行）处流式文档与一次性解析同一前缀的结果一致
+    const QStringList samples = {
+        QStringLiteral("para\n\n```cpp\nint a;\n\n\tint b; // x\n```\n\nafter *x*\n"),
+        QStringLiteral("- one\n\n- two\n\n  continued\n\n3. x\n\ntail **b**\n\n# 标题\n"),
+        QStringLiteral("> quote\n```\nopen fence until the end\n\nline 2\n"),
+        QStringLiteral("1. a\n   ```py\n   x = 1\n   ```\n2. b\n\n    indented code\n\nend\n~~~\ntilde\n~~~\n"),
+    };
+    for (const QString& markdown : samples) {
+        for (const int step : {1, 5, 17}) {
+            QTextDocument streamed;
+            ChatWidgetStreamingRenderer renderer(&streamed);
+            renderer.reset(QString());
+            for (int end = step;; end += step) {
+                const QString prefix = markdown.left(qMin(end, markdown.size()));
+                QVERIFY(renderer.append(prefix));
+                // 未完成的行可能尚未确定块类型，只在行末比较
+                if (prefix.endsWith(QLatin1Char('\n'))) {
+                    QTextDocument oneShot;
+                    QVERIFY(ChatWidgetMarkdownDocumentBuilder::build(prefix, &oneShot));
+                    QCOMPARE(streamed.toRawText(), oneShot.toRawText());
+                    QCOMPARE(blockStructure(streamed), blockStructure(oneShot));
+                }
+                if (end >= markdown.size()) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // 已闭合的块不再重新解析
+    QTextDocument document;
+    ChatWidgetStreamingRenderer renderer(&document);
+    renderer.reset(QStringLiteral("para\n\n```\ncode\n```\n\nnext"));
+    QCOMPARE(renderer.stableLength(), QStringLiteral("para\n\n```\ncode\n```\n\n").size());
+}
+
+void ChatWidgetViewTest::streamingRenderer_appendsOpenFenceByLine()
+{
+    ChatWidgetCodeHighlighter highlighter;
+    QTextCharFormat keywordFormat;
+    keywordFormat.setForeground(Qt::red);
+    highlighter.setFormat(ChatWidgetCodeHighlighter::Keyword, keywordFormat);
+    QTextCharFormat numberFormat;
+    numberFormat.setForeground(Qt::blue);
+    highlighter.setFormat(ChatWidgetCodeHighlighter::Number, numberFormat);
+    QTextDocument document;
+    ChatWidgetStreamingRenderer renderer(&document, &highlighter);
+    QString source = QStringLiteral("说明\n\n```cpp\n");
+    renderer.reset(source);
+    for (int i = 0; i < 300; ++i) {
+        // 未完成的行每次替换，完成后只追加这一行
+        QVERIFY(renderer.append(source + QStringLiteral("int v%1").arg(i)));
+        source += QStringLiteral("int v%1 = %1;\n").arg(i);
+        QVERIFY(renderer.append(source));
+    }
+    QCOMPARE(renderer.stableLength(), QStringLiteral("说明\n\n").size());
+    QCOMPARE(document.blockCount(), 301);
+    QTextDocument oneShot;
+    ChatWidgetMarkdownDocumentBuilder::build(source, &oneShot);
+    QCOMPARE(blockStructure(document), blockStructure(oneShot));
+    // 完整的行各只扫描一次，未完成的行各一次
+    QCOMPARE(highlighter.tokenizedLineCount(), 600);
+    QCOMPARE(document.lastBlock().layout()->formats().size(), 2);
+}
+
+void ChatWidgetViewTest::delegate_rebuildsStreamedRowWhenFinished()
+{
+    ChatWidgetModel model;
+    ChatWidgetMessage message;
+    message.messageId = "m1";
+    message.content = QStringLiteral("开始\n");
+    message.timestamp = QDateTime::fromMSecsSinceEpoch(1000);
+    model.addMessage(message);
+
+    QStyleOptionViewItem option;
+    option.rect = QRect(0, 0, 640, 0);
+    ChatWidgetDelegate delegate;
+    const QModelIndex index = model.index(0, 0);
+    delegate.sizeHint(option, index);
+    QVERIFY(!delegate.finishStreaming(index));
+    for (const QString& chunk : {QStringLiteral("\n- a"), QStringLiteral("\n- b\n\n```\n"), QStringLiteral("x\n```\n")}) {
+        model.appendContentToMessageAt(0, chunk);
+        delegate.sizeHint(option, index);
+    }
+    QVERIFY(delegate.finishStreaming(index));
+    QVERIFY(!delegate.finishStreaming(index));
+    // 重建后与从未流式追加的排版一致
+    ChatWidgetDelegate oneShot;
+    QCOMPARE(delegate.sizeHint(option, index), oneShot.sizeHint(option, index));
+
+    ChatWidgetView view;
+    view.model()->addMessage(message);
+    view.finishStreaming(5);
+    view.finishStreaming(0);
+}
+
 QTEST_MAIN(ChatWidgetViewTest)
 #include "tst_chatwidget_view.moc"
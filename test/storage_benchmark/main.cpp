@@ -0,0 +1,163 @@
+// 消息存储内存基准：分别以 QList<ChatWidgetMessage> 与 ChatWidgetMessageStore 保存同一批消息，
+// 以堆占用差值计算每条消息的字节数。
+// 另测 const& 路径（模型与 ChatWidget 的左值重载）：复制并分离列表、由调用方仍持有的列表写入存储，
+// 字符串只增加引用计数而不复制内容；存储的字符串与调用方列表不共享时返回 2。
+// 用法：storage_benchmark [消息条数，默认 100000]
+
+#include "chat_widget_message.h"
+#include "chat_widget_message_store.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QList>
+#include <QTextStream>
+#include <functional>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+const int kParticipantCount = 20;
+
+// 当前进程已分配的堆内存（字节），不支持的平台返回 -1
+qint64 heapInUse()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS_EX counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters),
+                             sizeof(counters))) {
+        return static_cast<qint64>(counters.PrivateUsage);
+    }
+    return -1;
+#elif defined(Q_OS_MACOS)
+    malloc_statistics_t stats;
+    malloc_zone_statistics(nullptr, &stats);
+    return static_cast<qint64>(stats.size_in_use);
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+    return static_cast<qint64>(info.uordblks + info.hblkhd);
+#elif defined(__GLIBC__)
+    const struct mallinfo info = mallinfo();
+    return static_cast<qint64>(info.uordblks) + static_cast<qint64>(info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+// 模拟从网络/数据库解析出的消息：每条消息的字符串都是独立分配的
+ChatWidgetMessage makeMessage(int index, const QDateTime& base)
+{
+    const int participant = index % kParticipantCount;
+    ChatWidgetMessage message;
+    message.senderId = QStringLiteral("user_") + QString::number(participant);
+    message.sender = QStringLiteral("参与者 ") + QString::number(participant);
+    message.avatarPath = QStringLiteral(":/avatars/user_") + QString::number(participant) + QStringLiteral(".png");
+    message.content = QStringLiteral("第 %1 条消息，").arg(index) +
+                      QString(20 + (index * 7) % 80, QLatin1Char('x'));
+    message.timestamp = base.addSecs(index);
+    message.isMine = participant == 0;
+    message.messageId = QStringLiteral("msg_") + QString::number(index);
+    message.status = ChatWidgetMessage::MessageStatus::Read;
+
+    if (index % 20 == 0) {
+        message.replyToMessageId = QStringLiteral("msg_") + QString::number(qMax(0, index - 3));
+        message.replySender = QStringLiteral("参与者 ") + QString::number((index + 1) % kParticipantCount);
+        message.replyPreview = QStringLiteral("被引用的消息预览");
+    }
+    if (index % 33 == 0) {
+        message.messageType = ChatWidgetMessage::MessageType::Image;
+        message.imagePath = QStringLiteral("/data/images/") + QString::number(index) + QStringLiteral(".jpg");
+    }
+    if (index % 50 == 0) {
+        message.reactions.append(ChatWidgetReaction(QStringLiteral("👍"), 1 + index % 5));
+    }
+    if (index % 100 == 0) {
+        message.mentions.append(QStringLiteral("user_1"));
+    }
+    return message;
+}
+
+qint64 measure(const std::function<void()>& build)
+{
+    const qint64 before = heapInUse();
+    build();
+    const qint64 after = heapInUse();
+    if (before < 0 || after < 0) {
+        return -1;
+    }
+    return after - before;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    int count = 100000;
+    if (app.arguments().size() > 1) {
+        bool ok = false;
+        const int value = app.arguments().at(1).toInt(&ok);
+        if (ok && value > 0) {
+            count = value;
+        }
+    }
+
+    QTextStream out(stdout);
+    const QDateTime base(QDate(2024, 1, 1), QTime(0, 0));
+
+    QList<ChatWidgetMessage> list;
+    const qint64 listBytes = measure([&]() {
+        list.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            list.append(makeMessage(i, base));
+        }
+    });
+
+    ChatWidgetMessageStore store;
+    const qint64 storeBytes = measure([&]() {
+        store.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            store.append(makeMessage(i, base));
+        }
+    });
+
+    // 左值重载先复制列表，排序或剔除重复时分离：每条消息只分配一个列表节点
+    QList<ChatWidgetMessage> copied;
+    const qint64 copyBytes = measure([&]() {
+        copied = list;
+        copied.detach();
+    });
+
+    // 调用方保留原列表时，存储的各列与其共享字符串
+    ChatWidgetMessageStore sharedStore;
+    const qint64 sharedStoreBytes = measure([&]() {
+        sharedStore.reserve(count);
+        sharedStore.insert(0, list);
+    });
+    bool shared = sharedStore.count() == count;
+    for (int i = 0; shared && i < count; ++i) {
+        shared = sharedStore.content(i).constData() == list.at(i).content.constData()
+            && sharedStore.messageId(i).constData() == list.at(i).messageId.constData();
+    }
+
+    if (listBytes < 0 || storeBytes < 0 || copyBytes < 0 || sharedStoreBytes < 0) {
+        out << "heap statistics are not available on this platform" << Qt::endl;
+        return 1;
+    }
+
+    out << "messages:        " << count << Qt::endl;
+    out << "participants:    " << store.participantCount() << Qt::endl;
+    out << "sparse extras:   " << store.extraCount() << Qt::endl;
+    out << "QList<ChatWidgetMessage> bytes/message: " << double(listBytes) / count << Qt::endl;
+    out << "ChatWidgetMessageStore   bytes/message: " << double(storeBytes) / count << Qt::endl;
+    out << "ratio: " << (listBytes > 0 ? double(storeBytes) / double(listBytes) : 0.0) << Qt::endl;
+    out << "const& list copy (detached)      bytes/message: " << double(copyBytes) / count << Qt::endl;
+    out << "const& store from caller's list  bytes/message: " << double(sharedStoreBytes) / count << Qt::endl;
+    out << "strings shared with caller:      " << (shared ? "yes" : "no") << Qt::endl;
+    return shared ? 0 : 2;
+}
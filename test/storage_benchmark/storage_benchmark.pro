@@ -0,0 +1,19 @@
+TEMPLATE = app
+TARGET = storage_benchmark
+QT += core
+QT -= gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/../../src/chatwidget
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.cpp
+
+HEADERS += \
+    $$PWD/../../src/chatwidget/chat_widget_gap_vector.h \
+    $$PWD/../../src/chatwidget/chat_widget_message.h \
+    $$PWD/../../src/chatwidget/chat_widget_message_store.h
+
+win32: LIBS += -lpsapi